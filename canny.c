@@ -0,0 +1,457 @@
+/**
+ * @file canny.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief The Canny edge detector
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include "canny.h"
+#include "image_manip.h"
+#include "parallel.h"
+
+// Classes of the edge map
+enum { NOT_EDGE, WEAK_EDGE, EDGE };
+
+// tan(22.5 degrees) and tan(67.5 degrees) in 15 bit fixed point, used to sort the
+// gradient direction into horizontal, vertical and the two diagonals
+#define TAN_22_5 13573
+#define TAN_67_5 79109
+
+// Growable stack of pixel indices for hysteresis tracing
+typedef struct _pixel_stack {
+  size_t *items;
+  size_t count;
+  size_t capacity;
+} PixelStack;
+
+// Shared state of one canny call
+typedef struct _canny_job {
+  Image *im;
+  unsigned char *map;   // one class per pixel
+  int *bandStart;       // first row of each band, where the seams lie
+  PixelStack *stacks;   // one per band
+  int lowSq, highSq;    // thresholds on the squared Sobel magnitude
+  int failed;
+} CannyJob;
+
+// Rolling rows of one band; each ring slot remembers which row it holds
+typedef struct _canny_rows {
+  const Image *im;
+  unsigned char *gray;
+  unsigned short *hRows[5];   // gray rows smoothed horizontally (sum of weights 16)
+  int hKey[5];
+  unsigned char *sRows[3];    // fully smoothed rows
+  int sKey[3];
+  int *mRows[3];              // squared gradient magnitudes
+  short *gxRows[3], *gyRows[3];
+  int mKey[3];
+} CannyRows;
+
+/**
+ * Function: push_pixel
+ * --------------------
+ * Push a pixel index onto a stack, growing it when full
+ *
+ * Parameters:
+ *  PixelStack *s: the stack
+ *  size_t i: the pixel index
+ * Return:
+ *  0 on success, -1 if memory runs out
+ */
+static int push_pixel(PixelStack *s, size_t i) {
+  if (s->count == s->capacity) {
+    size_t capacity = s->capacity ? 2 * s->capacity : 1024;
+    size_t *items = realloc(s->items, capacity * sizeof(size_t));
+    if (!items) {
+      return -1;
+    }
+    s->items = items;
+    s->capacity = capacity;
+  }
+  s->items[s->count++] = i;
+  return 0;
+}
+
+/**
+ * Function: clamp_index
+ * ---------------------
+ * Clamp a row or column index into [0, n - 1], which replicates the border
+ *
+ * Parameters:
+ *  int i: the index
+ *  int n: the number of rows or columns
+ * Return:
+ *  the clamped index
+ */
+static int clamp_index(int i, int n) {
+  return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+/**
+ * Function: hsmooth_row
+ * ---------------------
+ * Grayscale row k smoothed with the horizontal binomial kernel [1 4 6 4 1]
+ *
+ * Parameters:
+ *  CannyRows *cr: the rolling rows of the band
+ *  int k: the row, clamped into the image
+ * Return:
+ *  the smoothed row (scaled by 16)
+ */
+static const unsigned short *hsmooth_row(CannyRows *cr, int k) {
+  const Image *im = cr->im;
+  k = clamp_index(k, im->rows);
+  int slot = k % 5;
+  unsigned short *out = cr->hRows[slot];
+  if (cr->hKey[slot] == k) {
+    return out;
+  }
+  cr->hKey[slot] = k;
+
+  int cols = im->cols;
+  const Pixel *row = &im->data[(size_t)k * cols];
+  unsigned char *g = cr->gray;
+  for (int c = 0; c < cols; c++) {
+    g[c] = pixel_to_gray(&row[c]);
+  }
+  for (int c = 0; c < cols; c++) {
+    if (c >= 2 && c < cols - 2) {
+      out[c] = (unsigned short)(g[c-2] + 4 * g[c-1] + 6 * g[c] + 4 * g[c+1] + g[c+2]);
+    } else {
+      out[c] = (unsigned short)(g[clamp_index(c-2, cols)] + 4 * g[clamp_index(c-1, cols)] + 6 * g[c] +
+                                4 * g[clamp_index(c+1, cols)] + g[clamp_index(c+2, cols)]);
+    }
+  }
+  return out;
+}
+
+/**
+ * Function: smooth_row
+ * --------------------
+ * Grayscale row k smoothed with the 5x5 binomial kernel
+ *
+ * Parameters:
+ *  CannyRows *cr: the rolling rows of the band
+ *  int k: the row, clamped into the image
+ * Return:
+ *  the smoothed row
+ */
+static const unsigned char *smooth_row(CannyRows *cr, int k) {
+  k = clamp_index(k, cr->im->rows);
+  int slot = k % 3;
+  unsigned char *out = cr->sRows[slot];
+  if (cr->sKey[slot] == k) {
+    return out;
+  }
+  cr->sKey[slot] = k;
+
+  const unsigned short *h0 = hsmooth_row(cr, k - 2), *h1 = hsmooth_row(cr, k - 1), *h2 = hsmooth_row(cr, k);
+  const unsigned short *h3 = hsmooth_row(cr, k + 1), *h4 = hsmooth_row(cr, k + 2);
+  for (int c = 0; c < cr->im->cols; c++) {
+    // The weights sum to 16 * 16, round to the nearest intensity
+    out[c] = (unsigned char)((h0[c] + 4 * h1[c] + 6 * h2[c] + 4 * h3[c] + h4[c] + 128) >> 8);
+  }
+  return out;
+}
+
+/**
+ * Function: gradient_row
+ * ----------------------
+ * Sobel gradient of row k of the smoothed image; the squared magnitude is 0 on the
+ * image border so no edge is ever found there
+ *
+ * Parameters:
+ *  CannyRows *cr: the rolling rows of the band
+ *  int k: the row (inside the image)
+ * Return:
+ *  the ring slot holding the magnitudes and gradients of the row
+ */
+static int gradient_row(CannyRows *cr, int k) {
+  int slot = k % 3;
+  if (cr->mKey[slot] == k) {
+    return slot;
+  }
+  cr->mKey[slot] = k;
+
+  int cols = cr->im->cols;
+  int *mag = cr->mRows[slot];
+  short *gx = cr->gxRows[slot], *gy = cr->gyRows[slot];
+  memset(mag, 0, sizeof(int) * cols);
+  memset(gx, 0, sizeof(short) * cols);
+  memset(gy, 0, sizeof(short) * cols);
+  if (k == 0 || k == cr->im->rows - 1) {
+    return slot;
+  }
+
+  const unsigned char *up = smooth_row(cr, k - 1), *mid = smooth_row(cr, k), *down = smooth_row(cr, k + 1);
+  for (int c = 1; c < cols - 1; c++) {
+    int x = (up[c+1] + 2 * mid[c+1] + down[c+1]) - (up[c-1] + 2 * mid[c-1] + down[c-1]);
+    int y = (down[c-1] + 2 * down[c] + down[c+1]) - (up[c-1] + 2 * up[c] + up[c+1]);
+    gx[c] = (short)x;
+    gy[c] = (short)y;
+    mag[c] = x * x + y * y;
+  }
+  return slot;
+}
+
+/**
+ * Function: trace_edges
+ * ---------------------
+ * Hysteresis: pop edge pixels off the stack and turn the weak edges around them into
+ * edges, until the stack is empty; only rows [r0, r1) are visited
+ *
+ * Parameters:
+ *  unsigned char *map: the edge map
+ *  int cols: the number of columns
+ *  PixelStack *s: stack of edge pixels still to be expanded
+ *  int r0: first row that may be visited
+ *  int r1: one past the last row that may be visited
+ * Return:
+ *  0 on success, -1 if memory runs out
+ */
+static int trace_edges(unsigned char *map, int cols, PixelStack *s, int r0, int r1) {
+  while (s->count > 0) {
+    size_t i = s->items[--s->count];
+    int r = (int)(i / cols), c = (int)(i % cols);
+    for (int dr = -1; dr <= 1; dr++) {
+      if (r + dr < r0 || r + dr >= r1) {
+        continue;
+      }
+      for (int dc = -1; dc <= 1; dc++) {
+        size_t j = i + (ptrdiff_t)dr * cols + dc;
+        if (c + dc >= 0 && c + dc < cols && map[j] == WEAK_EDGE) {
+          map[j] = EDGE;
+          if (push_pixel(s, j) != 0) {
+            return -1;
+          }
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+ * Function: canny_band
+ * --------------------
+ * Classify the pixels of one band (non-maximum suppression and the two thresholds) and
+ * trace the weak edges connected to edges inside the band
+ *
+ * Parameters:
+ *  void *ctx: the CannyJob
+ *  int band: index of the band
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void canny_band(void *ctx, int band, int r0, int r1) {
+  CannyJob *job = ctx;
+  const Image *im = job->im;
+  int cols = im->cols;
+  PixelStack *stack = &job->stacks[band];
+  job->bandStart[band] = r0;
+
+  // One allocation for all rolling rows, widest elements first to keep them aligned
+  CannyRows cr;
+  cr.im = im;
+  size_t perRow = cols * (3 * sizeof(int) + 6 * sizeof(short) + 5 * sizeof(unsigned short) + 4);
+  unsigned char *buf = malloc(perRow);
+  if (!buf) {
+    job->failed = 1;
+    return;
+  }
+  unsigned char *p = buf;
+  for (int i = 0; i < 3; i++, p += cols * sizeof(int)) {
+    cr.mRows[i] = (int *)p;
+    cr.mKey[i] = -1;
+  }
+  for (int i = 0; i < 3; i++) {
+    cr.gxRows[i] = (short *)p;
+    p += cols * sizeof(short);
+    cr.gyRows[i] = (short *)p;
+    p += cols * sizeof(short);
+  }
+  for (int i = 0; i < 5; i++, p += cols * sizeof(unsigned short)) {
+    cr.hRows[i] = (unsigned short *)p;
+    cr.hKey[i] = -1;
+  }
+  for (int i = 0; i < 3; i++, p += cols) {
+    cr.sRows[i] = p;
+    cr.sKey[i] = -1;
+  }
+  cr.gray = p;
+
+  for (int r = r0; r < r1; r++) {
+    unsigned char *out = &job->map[(size_t)r * cols];
+    memset(out, NOT_EDGE, cols);
+    if (r == 0 || r == im->rows - 1) {
+      continue;
+    }
+    const int *above = cr.mRows[gradient_row(&cr, r - 1)];
+    const int *below = cr.mRows[gradient_row(&cr, r + 1)];
+    int slot = gradient_row(&cr, r);
+    const int *mag = cr.mRows[slot];
+    const short *gx = cr.gxRows[slot], *gy = cr.gyRows[slot];
+
+    for (int c = 1; c < cols - 1; c++) {
+      int m = mag[c];
+      if (m == 0 || m < job->lowSq) {
+        continue;
+      }
+      // Neighbors across the edge, along the gradient direction
+      int ax = gx[c] < 0 ? -gx[c] : gx[c];
+      int ay = gy[c] < 0 ? -gy[c] : gy[c];
+      int n1, n2;
+      if (ay * 32768 < ax * TAN_22_5) {
+        n1 = mag[c-1];
+        n2 = mag[c+1];
+      } else if (ay * 32768 > ax * TAN_67_5) {
+        n1 = above[c];
+        n2 = below[c];
+      } else if ((gx[c] < 0) == (gy[c] < 0)) {
+        n1 = above[c-1];
+        n2 = below[c+1];
+      } else {
+        n1 = above[c+1];
+        n2 = below[c-1];
+      }
+      // Ties keep only one of two equal neighbors so plateaus stay one pixel wide
+      if (m > n1 && m >= n2) {
+        if (m >= job->highSq) {
+          out[c] = EDGE;
+          if (push_pixel(stack, (size_t)r * cols + c) != 0) {
+            job->failed = 1;
+          }
+        } else {
+          out[c] = WEAK_EDGE;
+        }
+      }
+    }
+  }
+  free(buf);
+
+  // Trace inside the band, the seams are joined afterwards
+  if (!job->failed && trace_edges(job->map, cols, stack, r0, r1) != 0) {
+    job->failed = 1;
+  }
+}
+
+/**
+ * Function: paint_band
+ * --------------------
+ * Turn the edge map of one band into black edges on white
+ *
+ * Parameters:
+ *  void *ctx: the CannyJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void paint_band(void *ctx, int band, int r0, int r1) {
+  CannyJob *job = ctx;
+  (void)band;
+  int cols = job->im->cols;
+  for (size_t i = (size_t)r0 * cols; i < (size_t)r1 * cols; i++) {
+    unsigned char v = job->map[i] == EDGE ? 0 : 255;
+    job->im->data[i].r = job->im->data[i].g = job->im->data[i].b = v;
+  }
+}
+
+/**
+ * Function: squared_threshold
+ * ---------------------------
+ * Convert a threshold on the edges() scale into one on the squared Sobel magnitude of
+ * the smoothed image (Sobel weighs the central difference by 4 and edges() halves it)
+ *
+ * Parameters:
+ *  double t: the threshold
+ * Return:
+ *  the squared threshold
+ */
+static int squared_threshold(double t) {
+  double s = 8 * t;
+  // The largest squared magnitude is 2 * 1020 * 1020
+  return s <= 0 ? 0 : (s >= 2048 ? 2048 * 2048 : (int)(s * s + 0.5));
+}
+
+/**
+ * Function: canny
+ * ---------------
+ * Detect thin edges with the Canny method: the grayscale image is smoothed with a 5x5
+ * binomial Gaussian, differentiated with Sobel filters, thinned to one pixel wide ridges
+ * by non-maximum suppression and thresholded with hysteresis (pixels above high are
+ * edges, pixels above low are edges if they are connected to an edge). Everything is
+ * computed in integers, one row band per thread. Edges become black, everything else
+ * white, as with edges().
+ *
+ * Parameters:
+ *  Image *im: the image to be processed (8 bit)
+ *  double low: the low threshold
+ *  double high: the high threshold; both are gradient magnitudes on the scale of the
+ *               edges() threshold (half the intensity difference across a pixel)
+ * Return:
+ *  -1: bad (or 16 bit) image pointer or allocation failure
+ *  0: success
+ */
+int canny(Image *im, double low, double high) {
+  // Error check
+  if (!im || IS_16BIT(im) || !im->data) {
+    fprintf(stderr, "Error:canny - canny given a bad (or 16 bit) image pointer\n");
+    return -1;
+  }
+
+  int bands = parallel_band_count(im->rows);
+  CannyJob job;
+  job.im = im;
+  job.lowSq = squared_threshold(low);
+  job.highSq = squared_threshold(high);
+  job.failed = 0;
+  job.map = malloc((size_t)im->rows * im->cols);
+  job.bandStart = malloc(sizeof(int) * bands);
+  job.stacks = calloc(bands, sizeof(PixelStack));
+  if (!job.map || !job.bandStart || !job.stacks) {
+    job.failed = 1;
+  } else {
+    parallel_for_bands(im->rows, canny_band, &job);
+  }
+
+  // Join edges across the seams between bands: every edge pixel next to a seam is
+  // traced again, this time without any row limit
+  PixelStack *stack = job.stacks;
+  for (int b = 1; b < bands && !job.failed; b++) {
+    int seam = job.bandStart[b];
+    for (int r = seam - 1; r <= seam && !job.failed; r++) {
+      for (int c = 0; c < im->cols; c++) {
+        if (job.map[(size_t)r * im->cols + c] == EDGE && push_pixel(stack, (size_t)r * im->cols + c) != 0) {
+          job.failed = 1;
+          break;
+        }
+      }
+    }
+    if (!job.failed && trace_edges(job.map, im->cols, stack, 0, im->rows) != 0) {
+      job.failed = 1;
+    }
+  }
+
+  if (!job.failed) {
+    parallel_for_bands(im->rows, paint_band, &job);
+  } else {
+    fprintf(stderr, "Error:canny - canny failed to allocate memory\n");
+  }
+  if (job.stacks) {
+    for (int b = 0; b < bands; b++) {
+      free(job.stacks[b].items);
+    }
+  }
+  free(job.stacks);
+  free(job.bandStart);
+  free(job.map);
+  return job.failed ? -1 : 0;
+}
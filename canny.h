@@ -0,0 +1,36 @@
+/**
+ * @file canny.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for the Canny edge detector
+ */
+
+// If not defined, define CANNY_H
+#ifndef CANNY_H
+#define CANNY_H
+
+// Include header files
+#include "ppm_io.h"
+
+/**
+ * Function: canny
+ * ---------------
+ * Detect thin edges with the Canny method: the grayscale image is smoothed with a 5x5
+ * binomial Gaussian, differentiated with Sobel filters, thinned to one pixel wide ridges
+ * by non-maximum suppression and thresholded with hysteresis (pixels above high are
+ * edges, pixels above low are edges if they are connected to an edge). Everything is
+ * computed in integers, one row band per thread. Edges become black, everything else
+ * white, as with edges().
+ *
+ * Parameters:
+ *  Image *im: the image to be processed (8 bit)
+ *  double low: the low threshold
+ *  double high: the high threshold; both are gradient magnitudes on the scale of the
+ *               edges() threshold (half the intensity difference across a pixel)
+ * Return:
+ *  -1: bad (or 16 bit) image pointer or allocation failure
+ *  0: success
+ */
+int canny(Image *im, double low, double high);
+
+// End of header file
+#endif
@@ -48,6 +48,10 @@ int main(int argc, char **argv) {
   // specify dimensions for the image
   im->rows = num_rows * square_size;
   im->cols = num_cols * square_size;
+  im->maxval = 255;
+  im->data16 = NULL;
+  im->mapped = 0;
+  im->unplaced = 0;
 
   // allocate space for array of Pixels
   Pixel *pix = malloc(sizeof(Pixel) * im->rows * im->cols);
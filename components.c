@@ -0,0 +1,487 @@
+/**
+ * @file components.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Connected-component labeling of binary images
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "components.h"
+#include "parallel.h"
+
+// Shared state of one labeling. A set pixel at index i starts with the provisional
+// label i + 1, and parent links every provisional label towards the smallest label
+// of its component, which is thereby the label of its first pixel in raster order.
+typedef struct _label_job {
+  const BinaryImage *im;
+  int connectivity;
+  unsigned *labels;
+  unsigned *parent;
+  int *starts;        // first row of each band
+  unsigned *roots;    // components whose first pixel lies in each band, then the
+                      // number of the first of them
+} LabelJob;
+
+/**
+ * Function: pixel_set
+ * -------------------
+ * Whether a pixel of a binary image is set
+ *
+ * Parameters:
+ *  const BinaryImage *im: the image
+ *  int r: row of the pixel
+ *  int c: column of the pixel
+ * Returns:
+ *  1 if the pixel is set, 0 otherwise
+ */
+static int pixel_set(const BinaryImage *im, int r, int c) {
+  return (im->data[(size_t)r * im->stride + (c >> 3)] >> (7 - (c & 7))) & 1;
+}
+
+/**
+ * Function: find_root
+ * -------------------
+ * The smallest label of the component of a provisional label, halving the path on
+ * the way
+ *
+ * Parameters:
+ *  unsigned *parent: the links
+ *  unsigned x: the label
+ * Returns:
+ *  the root label
+ */
+static unsigned find_root(unsigned *parent, unsigned x) {
+  while (parent[x] != x) {
+    parent[x] = parent[parent[x]];
+    x = parent[x];
+  }
+  return x;
+}
+
+/**
+ * Function: unite
+ * ---------------
+ * Join the components of two provisional labels under the smaller root
+ *
+ * Parameters:
+ *  unsigned *parent: the links
+ *  unsigned a: one label
+ *  unsigned b: the other label
+ * Returns:
+ *  void
+ */
+static void unite(unsigned *parent, unsigned a, unsigned b) {
+  a = find_root(parent, a);
+  b = find_root(parent, b);
+  if (a < b) {
+    parent[b] = a;
+  } else if (b < a) {
+    parent[a] = b;
+  }
+}
+
+/**
+ * Function: join_above
+ * --------------------
+ * Join a set pixel with its set neighbors in the row above
+ *
+ * Parameters:
+ *  LabelJob *job: the labeling
+ *  size_t i: index of the pixel, which is not in the first row
+ *  int c: its column
+ * Returns:
+ *  void
+ */
+static void join_above(LabelJob *job, size_t i, int c) {
+  int cols = job->im->cols;
+  const unsigned *above = job->labels + i - cols;
+  if (above[0]) {
+    unite(job->parent, job->labels[i], above[0]);
+  }
+  if (job->connectivity == 8) {
+    if (c > 0 && above[-1]) {
+      unite(job->parent, job->labels[i], above[-1]);
+    }
+    if (c + 1 < cols && above[1]) {
+      unite(job->parent, job->labels[i], above[1]);
+    }
+  }
+}
+
+/**
+ * Function: neighbor_label
+ * ------------------------
+ * The provisional label of a set pixel from its already labeled neighbors (left,
+ * and above within the band), joining those that are not yet known to be connected.
+ * Neighbors that touch each other already share a component, so at most one union
+ * is needed: with 8 connectivity the pixel above touches all the others, and the
+ * left and above-left pixels touch each other.
+ *
+ * Parameters:
+ *  LabelJob *job: the labeling
+ *  size_t i: index of the pixel
+ *  int c: its column
+ *  int up: nonzero if the row above belongs to the band
+ * Returns:
+ *  the label, 0 if no neighbor is set
+ */
+static unsigned neighbor_label(LabelJob *job, size_t i, int c, int up) {
+  int cols = job->im->cols;
+  unsigned left = c > 0 ? job->labels[i-1] : 0;
+  if (!up) {
+    return left;
+  }
+  const unsigned *above = job->labels + i - cols;
+  if (job->connectivity == 4) {
+    if (above[0] && left) {
+      unite(job->parent, above[0], left);
+    }
+    return above[0] ? above[0] : left;
+  }
+  unsigned right = c + 1 < cols ? above[1] : 0;
+  if (above[0]) {
+    return above[0];
+  }
+  unsigned l = left ? left : (c > 0 ? above[-1] : 0);
+  if (l && right) {
+    unite(job->parent, l, right);
+  }
+  return l ? l : right;
+}
+
+/**
+ * Function: first_pass_band
+ * -------------------------
+ * First pass over a band of rows: give every set pixel a provisional label, taken
+ * from a set neighbor to the left or, within the band, above when there is one, and
+ * join the neighbors it connects. Only labels of the band are touched, so the bands
+ * need no locking. Runs of eight unset pixels are cleared a byte at a time.
+ *
+ * Parameters:
+ *  void *ctx: the LabelJob
+ *  int band: index of the band
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void first_pass_band(void *ctx, int band, int r0, int r1) {
+  LabelJob *job = ctx;
+  int cols = job->im->cols;
+  job->starts[band] = r0;
+
+  for (int r = r0; r < r1; r++) {
+    const unsigned char *bits = job->im->data + (size_t)r * job->im->stride;
+    for (int c = 0; c < cols; c++) {
+      size_t i = (size_t)r * cols + c;
+      if ((c & 7) == 0 && bits[c >> 3] == 0 && c + 8 <= cols) {
+        memset(job->labels + i, 0, sizeof(unsigned) * 8);
+        c += 7;
+        continue;
+      }
+      if (!pixel_set(job->im, r, c)) {
+        job->labels[i] = 0;
+        continue;
+      }
+      unsigned l = neighbor_label(job, i, c, r > r0);
+      if (!l) {
+        l = (unsigned)(i + 1);
+        job->parent[l] = l;
+      }
+      job->labels[i] = l;
+    }
+  }
+}
+
+/**
+ * Function: resolve_band
+ * ----------------------
+ * Replace every label of a band of rows by its root and count the roots; parent is
+ * only read, so the bands run concurrently
+ *
+ * Parameters:
+ *  void *ctx: the LabelJob
+ *  int band: index of the band
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void resolve_band(void *ctx, int band, int r0, int r1) {
+  LabelJob *job = ctx;
+  size_t cols = job->im->cols;
+  unsigned roots = 0;
+
+  for (size_t i = r0 * cols; i < r1 * cols; i++) {
+    unsigned x = job->labels[i];
+    if (x) {
+      while (job->parent[x] != x) {
+        x = job->parent[x];
+      }
+      job->labels[i] = x;
+      roots += x == i + 1;
+    }
+  }
+  job->roots[band] = roots;
+}
+
+/**
+ * Function: number_band
+ * ---------------------
+ * Give the roots of a band of rows consecutive component numbers, starting from the
+ * number of the first root of the band; parent[root] becomes the number
+ *
+ * Parameters:
+ *  void *ctx: the LabelJob
+ *  int band: index of the band
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void number_band(void *ctx, int band, int r0, int r1) {
+  LabelJob *job = ctx;
+  size_t cols = job->im->cols;
+  unsigned next = job->roots[band];
+
+  for (size_t i = r0 * cols; i < r1 * cols; i++) {
+    if (job->labels[i] == i + 1) {
+      job->parent[i + 1] = next++;
+    }
+  }
+}
+
+/**
+ * Function: relabel_band
+ * ----------------------
+ * Replace the root labels of a band of rows by the component numbers
+ *
+ * Parameters:
+ *  void *ctx: the LabelJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void relabel_band(void *ctx, int band, int r0, int r1) {
+  LabelJob *job = ctx;
+  size_t cols = job->im->cols;
+  (void)band;
+
+  for (size_t i = r0 * cols; i < r1 * cols; i++) {
+    if (job->labels[i]) {
+      job->labels[i] = job->parent[job->labels[i]];
+    }
+  }
+}
+
+/**
+ * Function: label_components
+ * --------------------------
+ * Find and measure the connected components of the set pixels of a binary image
+ *
+ * Parameters:
+ *  const BinaryImage *im: the image
+ *  int connectivity: 4 (edge neighbors only) or 8 (diagonal neighbors as well)
+ *  int keepLabels: nonzero to keep the label of every pixel
+ * Returns:
+ *  Components *: the components, NULL on a bad image pointer or connectivity, or
+ *                allocation failure
+ */
+Components *label_components(const BinaryImage *im, int connectivity, int keepLabels) {
+  // Error check
+  if (!im || !im->data || im->rows <= 0 || im->cols <= 0 || (connectivity != 4 && connectivity != 8) ||
+      (unsigned long long)im->rows * im->cols >= UINT_MAX) {
+    fprintf(stderr, "Error:components - label_components given a bad image pointer or connectivity\n");
+    return NULL;
+  }
+
+  size_t pixels = (size_t)im->rows * im->cols;
+  int bands = parallel_band_count(im->rows);
+  Components *comps = calloc(1, sizeof(Components));
+  LabelJob job = { im, connectivity, malloc(sizeof(unsigned) * pixels), malloc(sizeof(unsigned) * (pixels + 1)),
+                   malloc(sizeof(int) * bands), malloc(sizeof(unsigned) * bands) };
+  if (!comps || !job.labels || !job.parent || !job.starts || !job.roots) {
+    fprintf(stderr, "Error:components - label_components failed to allocate memory\n");
+    free(comps);
+    free(job.labels);
+    free(job.parent);
+    free(job.starts);
+    free(job.roots);
+    return NULL;
+  }
+  comps->rows = im->rows;
+  comps->cols = im->cols;
+
+  // First pass by bands, then join each band to the last row of the band above
+  parallel_for_bands(im->rows, first_pass_band, &job);
+  for (int b = 1; b < bands; b++) {
+    int r = job.starts[b];
+    for (int c = 0; c < im->cols; c++) {
+      size_t i = (size_t)r * im->cols + c;
+      if (job.labels[i]) {
+        join_above(&job, i, c);
+      }
+    }
+  }
+
+  // Second pass: roots, their numbers (a running count over the bands), then the
+  // number of every pixel
+  parallel_for_bands(im->rows, resolve_band, &job);
+  unsigned count = 0;
+  for (int b = 0; b < bands; b++) {
+    unsigned roots = job.roots[b];
+    job.roots[b] = count + 1;
+    count += roots;
+  }
+  parallel_for_bands(im->rows, number_band, &job);
+  parallel_for_bands(im->rows, relabel_band, &job);
+  free(job.parent);
+  free(job.starts);
+  free(job.roots);
+
+  // Measure the components
+  comps->count = (int)count;
+  comps->items = calloc(count ? count : 1, sizeof(Component));
+  double *sumX = calloc(count ? count : 1, sizeof(double));
+  double *sumY = calloc(count ? count : 1, sizeof(double));
+  if (!comps->items || !sumX || !sumY) {
+    fprintf(stderr, "Error:components - label_components failed to allocate memory\n");
+    free(job.labels);
+    free(sumX);
+    free(sumY);
+    free_components(&comps);
+    return NULL;
+  }
+  for (int r = 0; r < im->rows; r++) {
+    const unsigned *row = job.labels + (size_t)r * im->cols;
+    for (int c = 0; c < im->cols; c++) {
+      if (!row[c]) {
+        continue;
+      }
+      Component *item = &comps->items[row[c] - 1];
+      if (item->area == 0) {
+        // The first pixel in raster order starts the box
+        item->x = c;
+        item->y = r;
+        item->w = 1;
+        item->h = 1;
+      } else {
+        if (c < item->x) {
+          item->w += item->x - c;
+          item->x = c;
+        } else if (c >= item->x + item->w) {
+          item->w = c - item->x + 1;
+        }
+        item->h = r - item->y + 1;
+      }
+      item->area++;
+      sumX[row[c] - 1] += c;
+      sumY[row[c] - 1] += r;
+    }
+  }
+  for (unsigned i = 0; i < count; i++) {
+    comps->items[i].cx = sumX[i] / comps->items[i].area;
+    comps->items[i].cy = sumY[i] / comps->items[i].area;
+  }
+  free(sumX);
+  free(sumY);
+
+  if (keepLabels) {
+    comps->labels = job.labels;
+  } else {
+    free(job.labels);
+  }
+  return comps;
+}
+
+/**
+ * Function: free_components
+ * -------------------------
+ * utility function to free components and set the pointer to null
+ *
+ * Parameters:
+ *  Components **comps: pointer to the components to be freed
+ * Returns:
+ *  void
+ */
+void free_components(Components **comps) {
+  if (comps && *comps) {
+    free((*comps)->items);
+    free((*comps)->labels);
+    free(*comps);
+    *comps = NULL;
+  }
+}
+
+/**
+ * Function: write_components
+ * --------------------------
+ * Write one line per component: its number, area, bounding box (x y w h) and
+ * centroid, after a comment line naming the columns
+ *
+ * Parameters:
+ *  FILE *fp: the file to write to
+ *  const Components *comps: the components
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_components(FILE *fp, const Components *comps) {
+  // Error check
+  if (!fp || !comps) {
+    fprintf(stderr, "Error:components - write_components given a bad file or components pointer\n");
+    return -1;
+  }
+
+  if (fprintf(fp, "# component area x y w h cx cy\n") < 0) {
+    return -1;
+  }
+  for (int i = 0; i < comps->count; i++) {
+    const Component *item = &comps->items[i];
+    if (fprintf(fp, "%d %lld %d %d %d %d %.3f %.3f\n", i + 1, item->area, item->x, item->y, item->w, item->h,
+                item->cx, item->cy) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Function: label_image
+ * ---------------------
+ * The labels as a gray image whose samples are the component numbers (0 for unset
+ * pixels), 16 bit if there are more than 255 components
+ *
+ * Parameters:
+ *  const Components *comps: the components, with labels kept
+ * Returns:
+ *  GrayImage *: the image, NULL if the labels were not kept, there are more than
+ *               65535 components or memory runs out
+ */
+GrayImage *label_image(const Components *comps) {
+  // Error check
+  if (!comps || !comps->labels || comps->count > 65535) {
+    fprintf(stderr, "Error:components - label_image needs kept labels and at most 65535 components\n");
+    return NULL;
+  }
+
+  GrayImage *gray = make_gray_image(comps->rows, comps->cols, comps->count > 255 ? 65535 : 255);
+  if (!gray) {
+    fprintf(stderr, "Error:components - label_image failed to allocate memory\n");
+    return NULL;
+  }
+  size_t pixels = (size_t)comps->rows * comps->cols;
+  for (size_t i = 0; i < pixels; i++) {
+    if (IS_16BIT(gray)) {
+      gray->data16[i] = (unsigned short)comps->labels[i];
+    } else {
+      gray->data[i] = (unsigned char)comps->labels[i];
+    }
+  }
+  return gray;
+}
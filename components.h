@@ -0,0 +1,99 @@
+/**
+ * @file components.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for connected-component labeling of binary images
+ *
+ * The set pixels (black, as edge-detection leaves edge points) are grouped into
+ * connected components with the two-pass union-find algorithm. Each band of rows is
+ * labeled by its own thread in the first pass, the bands are then joined across the
+ * seams between them, and the second pass replaces every label by its component's
+ * number. Components are numbered from 1 in the raster order of their first pixel.
+ */
+
+// If not defined, define COMPONENTS_H
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+// Include header files
+#include <stdio.h>
+#include "ppm_io.h"
+
+// Measurements of one component
+typedef struct _component {
+  long long area;   // number of pixels
+  int x;            // bounding box: left column, top row, width and height
+  int y;
+  int w;
+  int h;
+  double cx;        // centroid (mean column and row of the pixels)
+  double cy;
+} Component;
+
+// The components of an image
+typedef struct _components {
+  Component *items;   // items[i] is component i + 1
+  int count;
+  unsigned *labels;   // rows * cols component numbers, 0 for unset pixels; NULL
+                      // unless asked for
+  int rows;
+  int cols;
+} Components;
+
+/**
+ * Function: label_components
+ * --------------------------
+ * Find and measure the connected components of the set pixels of a binary image
+ *
+ * Parameters:
+ *  const BinaryImage *im: the image
+ *  int connectivity: 4 (edge neighbors only) or 8 (diagonal neighbors as well)
+ *  int keepLabels: nonzero to keep the label of every pixel
+ * Returns:
+ *  Components *: the components, NULL on a bad image pointer or connectivity, or
+ *                allocation failure
+ */
+Components *label_components(const BinaryImage *im, int connectivity, int keepLabels);
+
+/**
+ * Function: free_components
+ * -------------------------
+ * utility function to free components and set the pointer to null
+ *
+ * Parameters:
+ *  Components **comps: pointer to the components to be freed
+ * Returns:
+ *  void
+ */
+void free_components(Components **comps);
+
+/**
+ * Function: write_components
+ * --------------------------
+ * Write one line per component: its number, area, bounding box (x y w h) and
+ * centroid, after a comment line naming the columns
+ *
+ * Parameters:
+ *  FILE *fp: the file to write to
+ *  const Components *comps: the components
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_components(FILE *fp, const Components *comps);
+
+/**
+ * Function: label_image
+ * ---------------------
+ * The labels as a gray image whose samples are the component numbers (0 for unset
+ * pixels), 16 bit if there are more than 255 components
+ *
+ * Parameters:
+ *  const Components *comps: the components, with labels kept
+ * Returns:
+ *  GrayImage *: the image, NULL if the labels were not kept, there are more than
+ *               65535 components or memory runs out
+ */
+GrayImage *label_image(const Components *comps);
+
+// End of header file
+#endif
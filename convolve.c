@@ -0,0 +1,584 @@
+/**
+ * @file convolve.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Separable convolution, blurring and sharpening
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "convolve.h"
+#include "integral.h"
+#include "parallel.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Box blur means are taken by multiplying with a reciprocal in this fixed point, which
+// is exact for boxes up to 2 * BOX_MAX_RADIUS + 1 < 2^22 pixels wide
+#define BOX_SHIFT 52
+#define BOX_HALF (1ULL << (BOX_SHIFT - 1))
+
+// At this sharpening amount a difference of one level from the blurred image already
+// moves a sample past 0 or 255, so larger amounts give the same image
+#define SHARPEN_MAX_AMOUNT 512
+
+// Shared state of one filtering pass
+typedef struct _conv_job {
+  const Image *src;
+  Image *dst;
+  const short *weights;
+  int radius;
+  int failed;
+} ConvJob;
+
+// Shared state of a box blur through a summed-area table
+typedef struct _box_table_job {
+  const IntegralImage *table;
+  Image *dst;
+  int radius;
+} BoxTableJob;
+
+/**
+ * Function: clamp_row
+ * -------------------
+ * Clamp a row (or column) index into [0, n - 1], which replicates the border
+ *
+ * Parameters:
+ *  int i: the index
+ *  int n: the number of rows (or columns)
+ * Return:
+ *  the clamped index
+ */
+static int clamp_row(int i, int n) {
+  return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+/**
+ * Function: conv_accumulate
+ * -------------------------
+ * Weighted sum of taps source byte arrays: out[i] = sum_k weights[k] * srcs[k][i],
+ * rounded, shifted down by CONV_SHIFT and clamped to 0..255. This is the inner loop of
+ * both passes of a separable filter (vertical: one source per row, horizontal: one per
+ * pixel offset along a row) and is vectorized with SSE2 where available.
+ *
+ * Parameters:
+ *  unsigned char *out: receives len bytes
+ *  const unsigned char *const *srcs: taps source arrays of at least len bytes
+ *  const short *weights: taps fixed point weights
+ *  int taps: number of sources
+ *  int len: number of bytes to produce
+ * Return:
+ *  void
+ */
+void conv_accumulate(unsigned char *out, const unsigned char *const *srcs, const short *weights, int taps, int len) {
+  int i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi32(1 << (CONV_SHIFT - 1));
+  // 8 output bytes per iteration; taps are consumed in pairs so that one
+  // _mm_madd_epi16 multiplies and adds two taps for four outputs at once
+  for (; i + 8 <= len; i += 8) {
+    __m128i accLo = round, accHi = round;
+    for (int k = 0; k < taps; k += 2) {
+      int k1 = k + 1 < taps ? k + 1 : k;
+      short w1 = k + 1 < taps ? weights[k + 1] : 0;
+      __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(srcs[k] + i)), zero);
+      __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(srcs[k1] + i)), zero);
+      __m128i w = _mm_set1_epi32((int)(((unsigned)(unsigned short)w1 << 16) | (unsigned short)weights[k]));
+      accLo = _mm_add_epi32(accLo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+      accHi = _mm_add_epi32(accHi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+    }
+    accLo = _mm_srai_epi32(accLo, CONV_SHIFT);
+    accHi = _mm_srai_epi32(accHi, CONV_SHIFT);
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(accLo, accHi), zero);
+    _mm_storel_epi64((__m128i *)(out + i), packed);
+  }
+#endif
+  // Scalar tail (and fallback without SSE2)
+  for (; i < len; i++) {
+    int acc = 1 << (CONV_SHIFT - 1);
+    for (int k = 0; k < taps; k++) {
+      acc += weights[k] * srcs[k][i];
+    }
+    acc >>= CONV_SHIFT;
+    out[i] = (unsigned char)(acc < 0 ? 0 : (acc > 255 ? 255 : acc));
+  }
+}
+
+/**
+ * Function: conv_horizontal_band
+ * ------------------------------
+ * Horizontal pass over one band of rows: each row is copied into a buffer padded with
+ * replicated border pixels, then tap k reads that buffer shifted by k pixels
+ *
+ * Parameters:
+ *  void *ctx: the ConvJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void conv_horizontal_band(void *ctx, int band, int r0, int r1) {
+  ConvJob *job = ctx;
+  int cols = job->src->cols, radius = job->radius, taps = 2 * radius + 1;
+  (void)band;
+
+  Pixel *padded = malloc(sizeof(Pixel) * (cols + 2 * radius));
+  const unsigned char **srcs = malloc(sizeof(*srcs) * taps);
+  if (!padded || !srcs) {
+    job->failed = 1;
+    free(padded);
+    free((void *)srcs);
+    return;
+  }
+  for (int k = 0; k < taps; k++) {
+    srcs[k] = (const unsigned char *)(padded + k);
+  }
+
+  for (int r = r0; r < r1; r++) {
+    const Pixel *row = &job->src->data[(size_t)r * cols];
+    for (int k = 0; k < radius; k++) {
+      padded[k] = row[0];
+      padded[radius + cols + k] = row[cols - 1];
+    }
+    memcpy(padded + radius, row, sizeof(Pixel) * cols);
+    conv_accumulate((unsigned char *)&job->dst->data[(size_t)r * cols], srcs, job->weights, taps, cols * 3);
+  }
+  free(padded);
+  free((void *)srcs);
+}
+
+/**
+ * Function: conv_vertical_band
+ * ----------------------------
+ * Vertical pass over one band of rows: tap k of output row r reads row r + k - radius
+ *
+ * Parameters:
+ *  void *ctx: the ConvJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void conv_vertical_band(void *ctx, int band, int r0, int r1) {
+  ConvJob *job = ctx;
+  int rows = job->src->rows, cols = job->src->cols, radius = job->radius, taps = 2 * radius + 1;
+  (void)band;
+
+  const unsigned char **srcs = malloc(sizeof(*srcs) * taps);
+  if (!srcs) {
+    job->failed = 1;
+    return;
+  }
+  for (int r = r0; r < r1; r++) {
+    for (int k = 0; k < taps; k++) {
+      srcs[k] = (const unsigned char *)&job->src->data[(size_t)clamp_row(r + k - radius, rows) * cols];
+    }
+    conv_accumulate((unsigned char *)&job->dst->data[(size_t)r * cols], srcs, job->weights, taps, cols * 3);
+  }
+  free((void *)srcs);
+}
+
+/**
+ * Function: convolve_separable
+ * ----------------------------
+ * Convolve an 8 bit image with the outer product of a 1-D kernel with itself, as a
+ * horizontal pass followed by a vertical pass; borders are replicated
+ *
+ * Parameters:
+ *  Image *im: the image to be filtered
+ *  const double *kernel: 2 * radius + 1 weights, normalized to sum to 1 internally
+ *  int radius: the radius of the kernel
+ * Return:
+ *  -1: bad image pointer, 16 bit image or allocation failure
+ *  0: success
+ */
+int convolve_separable(Image *im, const double *kernel, int radius) {
+  // Error check
+  if (!im || IS_16BIT(im) || !im->data || !kernel || radius < 0) {
+    fprintf(stderr, "Error:convolve - convolve_separable given a bad (or 16 bit) image pointer\n");
+    return -1;
+  }
+  int taps = 2 * radius + 1;
+
+  // Convert the kernel to fixed point; the rounding error goes to the center tap so
+  // the weights sum to exactly 1 << CONV_SHIFT and flat areas stay unchanged
+  short *weights = malloc(sizeof(short) * taps);
+  if (!weights) {
+    fprintf(stderr, "Error:convolve - convolve_separable failed to allocate memory\n");
+    return -1;
+  }
+  double total = 0;
+  for (int k = 0; k < taps; k++) {
+    total += kernel[k];
+  }
+  int fixedTotal = 0;
+  for (int k = 0; k < taps; k++) {
+    weights[k] = (short)lround(kernel[k] / total * (1 << CONV_SHIFT));
+    fixedTotal += weights[k];
+  }
+  weights[radius] += (short)((1 << CONV_SHIFT) - fixedTotal);
+
+  Image *tmp = make_image(im->rows, im->cols);
+  if (!tmp) {
+    free(weights);
+    fprintf(stderr, "Error:convolve - convolve_separable failed to allocate memory\n");
+    return -1;
+  }
+
+  // Horizontal pass into tmp, then vertical pass back into im
+  ConvJob job = { im, tmp, weights, radius, 0 };
+  parallel_for_bands(im->rows, conv_horizontal_band, &job);
+  if (!job.failed) {
+    job.src = tmp;
+    job.dst = im;
+    parallel_for_bands(im->rows, conv_vertical_band, &job);
+  }
+
+  free(weights);
+  free_image(&tmp);
+  if (job.failed) {
+    fprintf(stderr, "Error:convolve - convolve_separable failed to allocate memory\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Function: gaussian_blur
+ * -----------------------
+ * Blur the image with a Gaussian of the given standard deviation (radius 3 sigma)
+ *
+ * Parameters:
+ *  Image *im: the image to be blurred
+ *  double sigma: the standard deviation in pixels
+ * Return:
+ *  -1: bad (or 16 bit) image pointer, non-positive sigma or allocation failure
+ *  0: success
+ */
+int gaussian_blur(Image *im, double sigma) {
+  // Error check
+  if (sigma <= 0) {
+    fprintf(stderr, "Error:convolve - gaussian_blur given a non-positive sigma\n");
+    return -1;
+  }
+
+  int radius = (int)ceil(3 * sigma);
+  double *kernel = malloc(sizeof(double) * (2 * radius + 1));
+  if (!kernel) {
+    fprintf(stderr, "Error:convolve - gaussian_blur failed to allocate memory\n");
+    return -1;
+  }
+  for (int k = -radius; k <= radius; k++) {
+    kernel[k + radius] = exp(-(double)(k * k) / (2 * sigma * sigma));
+  }
+  int rc = convolve_separable(im, kernel, radius);
+  free(kernel);
+  return rc;
+}
+
+/**
+ * Function: box_inverse
+ * ---------------------
+ * The reciprocal of the width of a box in BOX_SHIFT bit fixed point. Multiplying a sum
+ * of at most width samples of 255 by it and rounding gives the mean rounded exactly
+ * for any box up to 2^22 pixels wide (radius up to BOX_MAX_RADIUS): the error of the reciprocal stays below the
+ * 1 / (2 * width) that separates an odd width's means from the rounding points.
+ *
+ * Parameters:
+ *  int radius: the radius of the box
+ * Return:
+ *  the reciprocal
+ */
+static unsigned long long box_inverse(int radius) {
+  unsigned long long width = 2ULL * radius + 1;
+  return ((1ULL << BOX_SHIFT) + width / 2) / width;
+}
+
+/**
+ * Function: box_horizontal_band
+ * -----------------------------
+ * Horizontal running-sum pass of the box blur over one band of rows
+ *
+ * Parameters:
+ *  void *ctx: the ConvJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void box_horizontal_band(void *ctx, int band, int r0, int r1) {
+  ConvJob *job = ctx;
+  int cols = job->src->cols, radius = job->radius;
+  unsigned long long inverse = box_inverse(radius);
+  (void)band;
+
+  // The window around column 0 covers columns 0 to last of the image and overhangs the
+  // left border by radius columns and the right border by right columns
+  int last = radius < cols - 1 ? radius : cols - 1;
+  unsigned right = radius - last;
+
+  for (int r = r0; r < r1; r++) {
+    const unsigned char *row = (const unsigned char *)&job->src->data[(size_t)r * cols];
+    unsigned char *out = (unsigned char *)&job->dst->data[(size_t)r * cols];
+    for (int ch = 0; ch < 3; ch++) {
+      // Sum of the window around column 0, the border columns counted once per
+      // column of overhang
+      unsigned sum = row[ch] * (unsigned)radius + row[(cols - 1) * 3 + ch] * right;
+      for (int c = 0; c <= last; c++) {
+        sum += row[c * 3 + ch];
+      }
+      // Slide the window: add the entering column, drop the leaving one
+      for (int c = 0; c < cols; c++) {
+        out[c * 3 + ch] = (unsigned char)((sum * inverse + BOX_HALF) >> BOX_SHIFT);
+        sum += row[clamp_row(c + radius + 1, cols) * 3 + ch];
+        sum -= row[clamp_row(c - radius, cols) * 3 + ch];
+      }
+    }
+  }
+}
+
+/**
+ * Function: box_vertical_band
+ * ---------------------------
+ * Vertical running-sum pass of the box blur over one band of rows; whole rows of
+ * column sums are updated at once so the inner loops vectorize
+ *
+ * Parameters:
+ *  void *ctx: the ConvJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void box_vertical_band(void *ctx, int band, int r0, int r1) {
+  ConvJob *job = ctx;
+  int rows = job->src->rows, len = job->src->cols * 3, radius = job->radius;
+  unsigned long long inverse = box_inverse(radius);
+  (void)band;
+
+  unsigned *sums = calloc(len, sizeof(unsigned));
+  if (!sums) {
+    job->failed = 1;
+    return;
+  }
+
+  // Column sums of the window around the first row of the band: the rows first to
+  // last of the image, plus the border rows counted once per row of overhang
+  int first = r0 - radius < 0 ? 0 : r0 - radius, last = r0 + radius >= rows ? rows - 1 : r0 + radius;
+  unsigned above = first - (r0 - radius), below = (r0 + radius) - last;
+  const unsigned char *top = (const unsigned char *)job->src->data;
+  const unsigned char *bottom = (const unsigned char *)&job->src->data[(size_t)(rows - 1) * job->src->cols];
+  for (int i = 0; i < len; i++) {
+    sums[i] = top[i] * above + bottom[i] * below;
+  }
+  for (int k = first; k <= last; k++) {
+    const unsigned char *row = (const unsigned char *)&job->src->data[(size_t)k * job->src->cols];
+    for (int i = 0; i < len; i++) {
+      sums[i] += row[i];
+    }
+  }
+
+  for (int r = r0; r < r1; r++) {
+    unsigned char *out = (unsigned char *)&job->dst->data[(size_t)r * job->src->cols];
+    const unsigned char *enter = (const unsigned char *)&job->src->data[(size_t)clamp_row(r + radius + 1, rows) * job->src->cols];
+    const unsigned char *leave = (const unsigned char *)&job->src->data[(size_t)clamp_row(r - radius, rows) * job->src->cols];
+    for (int i = 0; i < len; i++) {
+      out[i] = (unsigned char)((sums[i] * inverse + BOX_HALF) >> BOX_SHIFT);
+      sums[i] += enter[i] - leave[i];
+    }
+  }
+  free(sums);
+}
+
+/**
+ * Function: add_box
+ * -----------------
+ * Add weight times the sums of a rectangle of the table to acc
+ *
+ * Parameters:
+ *  const IntegralImage *table: the table
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  unsigned long long weight: how many times the rectangle counts
+ *  unsigned long long acc[3]: the sums of r, g and b so far
+ * Return:
+ *  void
+ */
+static void add_box(const IntegralImage *table, int x, int y, int w, int h, unsigned long long weight,
+                    unsigned long long acc[3]) {
+  unsigned long long sum[3];
+  if (weight && integral_sum(table, x, y, w, h, sum) == 0) {
+    for (int i = 0; i < 3; i++) {
+      acc[i] += weight * sum[i];
+    }
+  }
+}
+
+/**
+ * Function: box_table_band
+ * ------------------------
+ * Box blur of a band of rows of a 16 bit image from its summed-area table. The part
+ * of the window outside the image replicates the border, as in the 8 bit passes: it
+ * adds the border rows, the border columns and the corners, each counted as many
+ * times as the window overhangs.
+ *
+ * Parameters:
+ *  void *ctx: the BoxTableJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void box_table_band(void *ctx, int band, int r0, int r1) {
+  BoxTableJob *job = ctx;
+  const IntegralImage *t = job->table;
+  int k = job->radius;
+  unsigned long long area = (2ULL * k + 1) * (2ULL * k + 1);
+  (void)band;
+
+  for (int r = r0; r < r1; r++) {
+    int y0 = r - k < 0 ? 0 : r - k, y1 = r + k >= t->rows ? t->rows - 1 : r + k;
+    unsigned long long above = y0 - (r - k), below = (r + k) - y1;
+    for (int c = 0; c < t->cols; c++) {
+      int x0 = c - k < 0 ? 0 : c - k, x1 = c + k >= t->cols ? t->cols - 1 : c + k;
+      unsigned long long left = x0 - (c - k), right = (c + k) - x1;
+      unsigned long long acc[3] = { 0, 0, 0 };
+      int w = x1 - x0 + 1, h = y1 - y0 + 1;
+      add_box(t, x0, y0, w, h, 1, acc);
+      add_box(t, x0, 0, w, 1, above, acc);
+      add_box(t, x0, t->rows - 1, w, 1, below, acc);
+      add_box(t, 0, y0, 1, h, left, acc);
+      add_box(t, t->cols - 1, y0, 1, h, right, acc);
+      add_box(t, 0, 0, 1, 1, above * left, acc);
+      add_box(t, t->cols - 1, 0, 1, 1, above * right, acc);
+      add_box(t, 0, t->rows - 1, 1, 1, below * left, acc);
+      add_box(t, t->cols - 1, t->rows - 1, 1, 1, below * right, acc);
+
+      Pixel16 *out = &job->dst->data16[(size_t)r * t->cols + c];
+      out->r = (unsigned short)((acc[0] + area / 2) / area);
+      out->g = (unsigned short)((acc[1] + area / 2) / area);
+      out->b = (unsigned short)((acc[2] + area / 2) / area);
+    }
+  }
+}
+
+/**
+ * Function: box_blur
+ * ------------------
+ * Replace each pixel by the mean of the (2 * radius + 1) square around it. Uses running
+ * sums for 8 bit images and a summed-area table for 16 bit ones, so the cost per pixel
+ * does not depend on the radius.
+ *
+ * Parameters:
+ *  Image *im: the image to be blurred
+ *  int radius: the radius of the box, at most BOX_MAX_RADIUS
+ * Return:
+ *  -1: bad image pointer, radius too large or allocation failure
+ *  0: success
+ */
+int box_blur(Image *im, int radius) {
+  // Error check
+  if (!im || (IS_16BIT(im) ? !im->data16 : !im->data)) {
+    fprintf(stderr, "Error:convolve - box_blur given a bad image pointer\n");
+    return -1;
+  }
+  if (radius > BOX_MAX_RADIUS) {
+    fprintf(stderr, "Error:convolve - box_blur given a radius above %d\n", BOX_MAX_RADIUS);
+    return -1;
+  }
+  if (radius <= 0) {
+    return 0;
+  }
+  if (IS_16BIT(im)) {
+    IntegralImage *table = make_integral_image(im, 0);
+    if (!table) {
+      fprintf(stderr, "Error:convolve - box_blur failed to allocate memory\n");
+      return -1;
+    }
+    // The table holds everything the blur reads, so the image is written in place
+    BoxTableJob job = { table, im, radius };
+    parallel_for_bands(im->rows, box_table_band, &job);
+    free_integral_image(&table);
+    return 0;
+  }
+
+  Image *tmp = make_image(im->rows, im->cols);
+  if (!tmp) {
+    fprintf(stderr, "Error:convolve - box_blur failed to allocate memory\n");
+    return -1;
+  }
+
+  // Horizontal pass into tmp, then vertical pass back into im
+  ConvJob job = { im, tmp, NULL, radius, 0 };
+  parallel_for_bands(im->rows, box_horizontal_band, &job);
+  job.src = tmp;
+  job.dst = im;
+  parallel_for_bands(im->rows, box_vertical_band, &job);
+  free_image(&tmp);
+  if (job.failed) {
+    fprintf(stderr, "Error:convolve - box_blur failed to allocate memory\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Function: sharpen
+ * -----------------
+ * Sharpen the image by unsharp masking: im + amount * (im - gaussian_blur(im, 1))
+ *
+ * Parameters:
+ *  Image *im: the image to be sharpened
+ *  double amount: the strength of the sharpening, >= 0
+ * Return:
+ *  -1: bad (or 16 bit) image pointer, negative amount or allocation failure
+ *  0: success
+ */
+int sharpen(Image *im, double amount) {
+  // Error check
+  if (!im || IS_16BIT(im) || !im->data) {
+    fprintf(stderr, "Error:convolve - sharpen given a bad (or 16 bit) image pointer\n");
+    return -1;
+  }
+  if (!(amount >= 0)) {
+    fprintf(stderr, "Error:convolve - sharpen given a negative amount\n");
+    return -1;
+  }
+  // Capped so that scale * (data[i] - low[i]) stays well inside an int
+  if (amount > SHARPEN_MAX_AMOUNT) {
+    amount = SHARPEN_MAX_AMOUNT;
+  }
+
+  Image *blurred = make_copy(im);
+  if (!blurred) {
+    fprintf(stderr, "Error:convolve - sharpen failed to allocate memory\n");
+    return -1;
+  }
+  if (gaussian_blur(blurred, 1.0) != 0) {
+    free_image(&blurred);
+    return -1;
+  }
+
+  // Add back the scaled high frequencies, amount in 8 bit fixed point
+  int scale = (int)lround(amount * 256);
+  unsigned char *data = (unsigned char *)im->data;
+  const unsigned char *low = (const unsigned char *)blurred->data;
+  size_t len = (size_t)im->rows * im->cols * 3;
+  for (size_t i = 0; i < len; i++) {
+    int v = data[i] + (scale * (data[i] - low[i]) + 128) / 256;
+    data[i] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+  }
+  free_image(&blurred);
+  return 0;
+}
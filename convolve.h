@@ -0,0 +1,101 @@
+/**
+ * @file convolve.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for separable convolution, blurring and sharpening
+ */
+
+// If not defined, define CONVOLVE_H
+#ifndef CONVOLVE_H
+#define CONVOLVE_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Fixed point weights are scaled so that they sum to 1 << CONV_SHIFT
+#define CONV_SHIFT 14
+
+// Largest box blur radius; the sums of larger boxes no longer round exactly
+#define BOX_MAX_RADIUS ((1 << 21) - 1)
+
+/**
+ * Function: conv_accumulate
+ * -------------------------
+ * Weighted sum of taps source byte arrays: out[i] = sum_k weights[k] * srcs[k][i],
+ * rounded, shifted down by CONV_SHIFT and clamped to 0..255. This is the inner loop of
+ * both passes of a separable filter (vertical: one source per row, horizontal: one per
+ * pixel offset along a row) and is vectorized with SSE2 where available.
+ *
+ * Parameters:
+ *  unsigned char *out: receives len bytes
+ *  const unsigned char *const *srcs: taps source arrays of at least len bytes
+ *  const short *weights: taps fixed point weights
+ *  int taps: number of sources
+ *  int len: number of bytes to produce
+ * Return:
+ *  void
+ */
+void conv_accumulate(unsigned char *out, const unsigned char *const *srcs, const short *weights, int taps, int len);
+
+/**
+ * Function: convolve_separable
+ * ----------------------------
+ * Convolve an 8 bit image with the outer product of a 1-D kernel with itself, as a
+ * horizontal pass followed by a vertical pass; borders are replicated
+ *
+ * Parameters:
+ *  Image *im: the image to be filtered
+ *  const double *kernel: 2 * radius + 1 weights, normalized to sum to 1 internally
+ *  int radius: the radius of the kernel
+ * Return:
+ *  -1: bad image pointer, 16 bit image or allocation failure
+ *  0: success
+ */
+int convolve_separable(Image *im, const double *kernel, int radius);
+
+/**
+ * Function: gaussian_blur
+ * -----------------------
+ * Blur the image with a Gaussian of the given standard deviation (radius 3 sigma)
+ *
+ * Parameters:
+ *  Image *im: the image to be blurred
+ *  double sigma: the standard deviation in pixels
+ * Return:
+ *  -1: bad (or 16 bit) image pointer, non-positive sigma or allocation failure
+ *  0: success
+ */
+int gaussian_blur(Image *im, double sigma);
+
+/**
+ * Function: box_blur
+ * ------------------
+ * Replace each pixel by the mean of the (2 * radius + 1) square around it. Uses running
+ * sums for 8 bit images and a summed-area table for 16 bit ones, so the cost per pixel
+ * does not depend on the radius.
+ *
+ * Parameters:
+ *  Image *im: the image to be blurred
+ *  int radius: the radius of the box, 0 to BOX_MAX_RADIUS
+ * Return:
+ *  -1: bad image pointer, radius too large or allocation failure
+ *  0: success
+ */
+int box_blur(Image *im, int radius);
+
+/**
+ * Function: sharpen
+ * -----------------
+ * Sharpen the image by unsharp masking: im + amount * (im - gaussian_blur(im, 1))
+ *
+ * Parameters:
+ *  Image *im: the image to be sharpened
+ *  double amount: the strength of the sharpening, >= 0 (all amounts from 512 up give
+ *                 the same image)
+ * Return:
+ *  -1: bad (or 16 bit) image pointer, negative amount or allocation failure
+ *  0: success
+ */
+int sharpen(Image *im, double amount);
+
+// End of header file
+#endif
@@ -0,0 +1,251 @@
+/**
+ * @file histogram.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Image histograms and statistics
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "histogram.h"
+#include "image_manip.h"
+#include "parallel.h"
+
+// Index of each histogram in the private bins of a band
+enum { H_RED, H_GREEN, H_BLUE, H_GRAY, H_GRADIENT, H_COUNT };
+
+// Private bins filled by one band
+typedef struct _band_bins {
+  unsigned long hist[H_COUNT][HIST_BINS];
+} BandBins;
+
+// Shared state of one image_stats call
+typedef struct _stats_job {
+  const Image *im;
+  BandBins *bins;
+  int failed;
+} StatsJob;
+
+/**
+ * Function: gray_row
+ * ------------------
+ * Convert one image row to grayscale intensities
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  int r: the row
+ *  unsigned char *out: receives im->cols intensities
+ * Return:
+ *  void
+ */
+static void gray_row(const Image *im, int r, unsigned char *out) {
+  const Pixel *row = &im->data[(size_t)r * im->cols];
+  for (int c = 0; c < im->cols; c++) {
+    out[c] = pixel_to_gray(&row[c]);
+  }
+}
+
+/**
+ * Function: stats_band
+ * --------------------
+ * Fill the private bins of one band: channel and gray histograms for its rows and the
+ * gradient histogram for its interior pixels (central differences, as in edges())
+ *
+ * Parameters:
+ *  void *ctx: the StatsJob
+ *  int band: index of the band
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void stats_band(void *ctx, int band, int r0, int r1) {
+  StatsJob *job = ctx;
+  const Image *im = job->im;
+  BandBins *bins = &job->bins[band];
+  int cols = im->cols;
+
+  // Rolling window of three grayscale rows: above, current and below
+  unsigned char *buf = malloc(3 * (size_t)cols);
+  if (!buf) {
+    job->failed = 1;
+    return;
+  }
+  unsigned char *up = buf, *cur = buf + cols, *down = buf + 2 * cols;
+  if (r0 > 0) {
+    gray_row(im, r0 - 1, up);
+  }
+  gray_row(im, r0, cur);
+
+  for (int r = r0; r < r1; r++) {
+    if (r + 1 < im->rows) {
+      gray_row(im, r + 1, down);
+    }
+
+    // Channel and gray histograms
+    const Pixel *row = &im->data[(size_t)r * cols];
+    for (int c = 0; c < cols; c++) {
+      bins->hist[H_RED][row[c].r]++;
+      bins->hist[H_GREEN][row[c].g]++;
+      bins->hist[H_BLUE][row[c].b]++;
+      bins->hist[H_GRAY][cur[c]]++;
+    }
+
+    // Gradient magnitude of the interior points
+    if (r > 0 && r < im->rows - 1) {
+      for (int c = 1; c < cols - 1; c++) {
+        int dx = cur[c-1] - cur[c+1];
+        int dy = up[c] - down[c];
+        int bin = (int)(sqrt((double)(dx * dx + dy * dy)) / 2);
+        bins->hist[H_GRADIENT][bin < HIST_BINS ? bin : HIST_BINS - 1]++;
+      }
+    }
+
+    // Slide the window down one row
+    unsigned char *tmp = up;
+    up = cur;
+    cur = down;
+    down = tmp;
+  }
+  free(buf);
+}
+
+/**
+ * Function: image_stats
+ * ---------------------
+ * Compute all histograms and statistics of an 8 bit image in a single pass over the
+ * pixels. Row bands are processed in parallel, each into private bins, and the bins
+ * are merged at the end.
+ *
+ * Parameters:
+ *  const Image *im: the image to be measured
+ *  ImageStats *stats: filled with the results
+ * Return:
+ *  -1: bad image pointer, 16 bit image or allocation failure
+ *  0: success
+ */
+int image_stats(const Image *im, ImageStats *stats) {
+  // Error check
+  if (!im || !stats || IS_16BIT(im) || !im->data) {
+    fprintf(stderr, "Error:histogram - image_stats given a bad (or 16 bit) image pointer\n");
+    return -1;
+  }
+
+  int bands = parallel_band_count(im->rows);
+  StatsJob job;
+  job.im = im;
+  job.failed = 0;
+  job.bins = calloc(bands, sizeof(BandBins));
+  if (!job.bins) {
+    fprintf(stderr, "Error:histogram - image_stats failed to allocate memory\n");
+    return -1;
+  }
+  parallel_for_bands(im->rows, stats_band, &job);
+  if (job.failed) {
+    free(job.bins);
+    fprintf(stderr, "Error:histogram - image_stats failed to allocate memory\n");
+    return -1;
+  }
+
+  // Merge the private bins
+  memset(stats, 0, sizeof(*stats));
+  unsigned long *merged[H_COUNT] = { stats->red, stats->green, stats->blue, stats->gray, stats->gradient };
+  for (int b = 0; b < bands; b++) {
+    for (int h = 0; h < H_COUNT; h++) {
+      for (int i = 0; i < HIST_BINS; i++) {
+        merged[h][i] += job.bins[b].hist[h][i];
+      }
+    }
+  }
+  free(job.bins);
+
+  // Derive min, max and mean of each channel from its histogram
+  stats->pixels = (unsigned long)im->rows * im->cols;
+  for (int h = H_RED; h <= H_GRAY; h++) {
+    double sum = 0;
+    stats->min[h] = -1;
+    for (int i = 0; i < HIST_BINS; i++) {
+      if (merged[h][i]) {
+        if (stats->min[h] < 0) {
+          stats->min[h] = i;
+        }
+        stats->max[h] = i;
+        sum += (double)i * merged[h][i];
+      }
+    }
+    stats->mean[h] = sum / stats->pixels;
+  }
+  for (int i = 0; i < HIST_BINS; i++) {
+    stats->gradient_pixels += stats->gradient[i];
+  }
+  return 0;
+}
+
+/**
+ * Function: otsu_threshold
+ * ------------------------
+ * Pick the threshold that best separates a histogram into two classes (Otsu's method,
+ * maximizing the between-class variance)
+ *
+ * Parameters:
+ *  const unsigned long hist[]: histogram with HIST_BINS bins
+ * Return:
+ *  the first bin of the upper class (1 to HIST_BINS - 1), or 1 for an empty histogram
+ */
+int otsu_threshold(const unsigned long hist[]) {
+  double total = 0, sum = 0;
+  for (int i = 0; i < HIST_BINS; i++) {
+    total += hist[i];
+    sum += (double)i * hist[i];
+  }
+
+  // Sweep the split point, keeping running weight and sum of the lower class
+  double weightLow = 0, sumLow = 0, best = -1;
+  int threshold = 1;
+  for (int t = 0; t < HIST_BINS - 1; t++) {
+    weightLow += hist[t];
+    sumLow += (double)t * hist[t];
+    double weightHigh = total - weightLow;
+    if (weightLow == 0 || weightHigh == 0) {
+      continue;
+    }
+    double meanLow = sumLow / weightLow;
+    double meanHigh = (sum - sumLow) / weightHigh;
+    double between = weightLow * weightHigh * sq(meanLow - meanHigh);
+    if (between > best) {
+      best = between;
+      threshold = t + 1;
+    }
+  }
+  return threshold;
+}
+
+/**
+ * Function: percentile_threshold
+ * ------------------------------
+ * Pick the threshold that puts the given percentage of a histogram below it
+ *
+ * Parameters:
+ *  const unsigned long hist[]: histogram with HIST_BINS bins
+ *  double percent: the percentage of counts to keep below the threshold (0 to 100)
+ * Return:
+ *  the first bin above the percentile (1 to HIST_BINS)
+ */
+int percentile_threshold(const unsigned long hist[], double percent) {
+  double total = 0;
+  for (int i = 0; i < HIST_BINS; i++) {
+    total += hist[i];
+  }
+
+  double wanted = total * percent / 100;
+  double seen = 0;
+  for (int i = 0; i < HIST_BINS; i++) {
+    seen += hist[i];
+    if (seen >= wanted) {
+      return i + 1;
+    }
+  }
+  return HIST_BINS;
+}
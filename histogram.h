@@ -0,0 +1,79 @@
+/**
+ * @file histogram.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for image histograms and statistics
+ */
+
+// If not defined, define HISTOGRAM_H
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Number of bins in every histogram (one per 8 bit intensity)
+#define HIST_BINS 256
+
+// Struct to store the statistics of an 8 bit image
+typedef struct _image_stats {
+  // histograms of the red, green and blue samples and of the grayscale intensity
+  unsigned long red[HIST_BINS];
+  unsigned long green[HIST_BINS];
+  unsigned long blue[HIST_BINS];
+  unsigned long gray[HIST_BINS];
+  // histogram of the gradient magnitude used by edges(), one bin per whole intensity
+  // step (bin b holds magnitudes in [b, b + 1)); boundary pixels are not counted
+  unsigned long gradient[HIST_BINS];
+  // smallest, largest and mean sample of each channel (red, green, blue, gray)
+  int min[4];
+  int max[4];
+  double mean[4];
+  // number of pixels counted in the channel histograms and in the gradient histogram
+  unsigned long pixels;
+  unsigned long gradient_pixels;
+} ImageStats;
+
+/**
+ * Function: image_stats
+ * ---------------------
+ * Compute all histograms and statistics of an 8 bit image in a single pass over the
+ * pixels. Row bands are processed in parallel, each into private bins, and the bins
+ * are merged at the end.
+ *
+ * Parameters:
+ *  const Image *im: the image to be measured
+ *  ImageStats *stats: filled with the results
+ * Return:
+ *  -1: bad image pointer, 16 bit image or allocation failure
+ *  0: success
+ */
+int image_stats(const Image *im, ImageStats *stats);
+
+/**
+ * Function: otsu_threshold
+ * ------------------------
+ * Pick the threshold that best separates a histogram into two classes (Otsu's method,
+ * maximizing the between-class variance)
+ *
+ * Parameters:
+ *  const unsigned long hist[]: histogram with HIST_BINS bins
+ * Return:
+ *  the first bin of the upper class (1 to HIST_BINS - 1), or 1 for an empty histogram
+ */
+int otsu_threshold(const unsigned long hist[]);
+
+/**
+ * Function: percentile_threshold
+ * ------------------------------
+ * Pick the threshold that puts the given percentage of a histogram below it
+ *
+ * Parameters:
+ *  const unsigned long hist[]: histogram with HIST_BINS bins
+ *  double percent: the percentage of counts to keep below the threshold (0 to 100)
+ * Return:
+ *  the first bin above the percentile (1 to HIST_BINS)
+ */
+int percentile_threshold(const unsigned long hist[], double percent);
+
+// End of header file
+#endif
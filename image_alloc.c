@@ -0,0 +1,212 @@
+/**
+ * @file image_alloc.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Allocating pixel arrays
+ */
+
+// MAP_ANONYMOUS, MADV_HUGEPAGE and syscall() are not part of POSIX
+#define _GNU_SOURCE
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "image_alloc.h"
+#include "parallel.h"
+
+// Size of a transparent huge page, and of a base page
+#define HUGE_PAGE ((size_t)2 << 20)
+#define BASE_PAGE ((size_t)4096)
+
+// Memory policy of mbind(2), from <linux/mempolicy.h>
+#define MPOL_INTERLEAVE_MODE 3
+
+// Largest number of NUMA nodes the interleave mask covers
+#define MAX_NUMA_NODES 1024
+
+// Shared state of one first touch
+typedef struct _touch_job {
+  unsigned char *pixels;
+  size_t row_bytes;
+} TouchJob;
+
+/**
+ * Function: touch_band
+ * --------------------
+ * Write one byte of every page of a band of rows, so the page is faulted in on the
+ * NUMA node of the thread that will process the band
+ *
+ * Parameters:
+ *  void *ctx: the TouchJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void touch_band(void *ctx, int band, int r0, int r1) {
+  TouchJob *job = ctx;
+  volatile unsigned char *first = job->pixels + (size_t)r0 * job->row_bytes;
+  volatile unsigned char *last = job->pixels + (size_t)r1 * job->row_bytes;
+  (void)band;
+
+  // Start at the page boundary so neighbouring bands do not both fault a page
+  uintptr_t start = ((uintptr_t)first + BASE_PAGE - 1) & ~(uintptr_t)(BASE_PAGE - 1);
+  for (volatile unsigned char *p = (volatile unsigned char *)start; p < last; p += BASE_PAGE) {
+    *p = 0;
+  }
+}
+
+/**
+ * Function: map_huge
+ * ------------------
+ * Map bytes of anonymous memory starting on a huge page boundary and ask for huge
+ * pages; the length is rounded up to whole huge pages
+ *
+ * Parameters:
+ *  size_t bytes: the size needed
+ *  size_t *mapped: receives the length of the mapping
+ * Returns:
+ *  the mapping, NULL if memory runs out
+ */
+static void *map_huge(size_t bytes, size_t *mapped) {
+  size_t length = (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+  // Over-map by one huge page, then unmap the unaligned head and tail
+  unsigned char *raw = mmap(NULL, length + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) {
+    return NULL;
+  }
+  unsigned char *aligned = (unsigned char *)(((uintptr_t)raw + HUGE_PAGE - 1) & ~(uintptr_t)(HUGE_PAGE - 1));
+  if (aligned > raw) {
+    munmap(raw, aligned - raw);
+  }
+  munmap(aligned + length, raw + HUGE_PAGE - aligned);
+
+  // Only a hint: without transparent huge pages the mapping simply keeps base pages
+  madvise(aligned, length, MADV_HUGEPAGE);
+  *mapped = length;
+  return aligned;
+}
+
+/**
+ * Function: online_nodes
+ * ----------------------
+ * Mark the online NUMA nodes listed in /sys/devices/system/node/online ("0-3,6")
+ *
+ * Parameters:
+ *  unsigned long *nodes: mask of MAX_NUMA_NODES bits, receives the nodes
+ * Returns:
+ *  one more than the highest node marked, 0 if the list cannot be read
+ */
+static int online_nodes(unsigned long *nodes) {
+  const int bits = 8 * sizeof(unsigned long);
+  char list[256];
+  FILE *fp = fopen("/sys/devices/system/node/online", "r");
+  if (!fp) {
+    return 0;
+  }
+  char *p = fgets(list, sizeof(list), fp);
+  fclose(fp);
+
+  int count = 0;
+  memset(nodes, 0, MAX_NUMA_NODES / 8);
+  while (p && *p >= '0' && *p <= '9') {
+    long first = strtol(p, &p, 10), last = first;
+    if (*p == '-') {
+      last = strtol(p + 1, &p, 10);
+    }
+    for (long n = first; n <= last && n < MAX_NUMA_NODES; n++) {
+      nodes[n / bits] |= 1UL << (n % bits);
+      count = (int)n + 1;
+    }
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return count;
+}
+
+/**
+ * Function: pixels_alloc
+ * ----------------------
+ * Allocate an uninitialized pixel array of rows rows of row_bytes bytes each
+ *
+ * Parameters:
+ *  int rows: number of rows
+ *  size_t row_bytes: bytes per row
+ *  PixelAlloc how: the allocation policy
+ *  size_t *mapped: receives the length of the mapping, or 0 if the array came from
+ *                  malloc; pixels_free needs it
+ *  int *unplaced: if not NULL, receives 1 when the pages were to be interleaved but
+ *                 the kernel refused (they then follow the default memory policy),
+ *                 0 otherwise
+ * Returns:
+ *  the array, NULL if memory runs out
+ */
+void *pixels_alloc(int rows, size_t row_bytes, PixelAlloc how, size_t *mapped, int *unplaced) {
+  size_t bytes = (size_t)rows * row_bytes;
+  *mapped = 0;
+  if (unplaced) {
+    *unplaced = 0;
+  }
+
+  if (how == PIXELS_AUTO) {
+    const char *numa = getenv("IMGPROC_NUMA");
+    if (bytes < PIXELS_HUGE_MIN) {
+      how = PIXELS_MALLOC;
+    } else if (numa && strcmp(numa, "interleave") == 0) {
+      how = PIXELS_HUGE_INTERLEAVE;
+    } else {
+      how = PIXELS_HUGE;
+    }
+  }
+  if (how == PIXELS_MALLOC || bytes == 0) {
+    return malloc(bytes);
+  }
+
+  void *pixels = map_huge(bytes, mapped);
+  if (!pixels) {
+    return NULL;
+  }
+  if (how == PIXELS_HUGE_INTERLEAVE) {
+    // The mask only spans the online nodes, as kernels built for fewer nodes than it
+    // could hold reject a longer one. The kernel reads maxnode - 1 bits of it. If the
+    // call fails the pages just follow the default policy, and the caller is told.
+    unsigned long nodes[MAX_NUMA_NODES / (8 * sizeof(unsigned long))];
+    int count = online_nodes(nodes);
+    if ((count == 0 || syscall(SYS_mbind, pixels, *mapped, MPOL_INTERLEAVE_MODE, nodes, (unsigned long)count + 1, 0) != 0) &&
+        unplaced) {
+      *unplaced = 1;
+    }
+  } else {
+    TouchJob job;
+    job.pixels = pixels;
+    job.row_bytes = row_bytes;
+    parallel_for_bands(rows, touch_band, &job);
+  }
+  return pixels;
+}
+
+/**
+ * Function: pixels_free
+ * ---------------------
+ * Free a pixel array from pixels_alloc (NULL is ignored)
+ *
+ * Parameters:
+ *  void *pixels: the array
+ *  size_t mapped: the length pixels_alloc reported
+ * Returns:
+ *  void
+ */
+void pixels_free(void *pixels, size_t mapped) {
+  if (pixels && mapped) {
+    munmap(pixels, mapped);
+  } else {
+    free(pixels);
+  }
+}
@@ -0,0 +1,67 @@
+/**
+ * @file image_alloc.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for allocating pixel arrays
+ *
+ * Small pixel arrays come from malloc. Large ones are mapped directly with mmap,
+ * aligned to 2 MB and marked MADV_HUGEPAGE, so the kernel backs them with transparent
+ * huge pages and walking a gigapixel image costs a few hundred TLB entries instead of
+ * hundreds of thousands. Their pages are then placed on the NUMA nodes either by first
+ * touch, one band of rows per worker thread exactly as parallel_for_bands splits the
+ * image, or by interleaving them over all nodes.
+ */
+
+// If not defined, define IMAGE_ALLOC_H
+#ifndef IMAGE_ALLOC_H
+#define IMAGE_ALLOC_H
+
+// Include header files
+#include <stddef.h>
+
+// Arrays from this size up are mapped with huge pages under PIXELS_AUTO
+#define PIXELS_HUGE_MIN ((size_t)8 << 20)
+
+// How a pixel array is allocated
+typedef enum {
+  PIXELS_AUTO,              // PIXELS_MALLOC below PIXELS_HUGE_MIN, otherwise huge pages
+                            // placed as the IMGPROC_NUMA environment variable says
+                            // ("interleave", or first touch by default)
+  PIXELS_MALLOC,            // plain malloc
+  PIXELS_HUGE,              // huge pages, first touched by the band threads
+  PIXELS_HUGE_INTERLEAVE    // huge pages, interleaved over all NUMA nodes
+} PixelAlloc;
+
+/**
+ * Function: pixels_alloc
+ * ----------------------
+ * Allocate an uninitialized pixel array of rows rows of row_bytes bytes each
+ *
+ * Parameters:
+ *  int rows: number of rows
+ *  size_t row_bytes: bytes per row
+ *  PixelAlloc how: the allocation policy
+ *  size_t *mapped: receives the length of the mapping, or 0 if the array came from
+ *                  malloc; pixels_free needs it
+ *  int *unplaced: if not NULL, receives 1 when the pages were to be interleaved but
+ *                 the kernel refused (they then follow the default memory policy),
+ *                 0 otherwise
+ * Returns:
+ *  the array, NULL if memory runs out
+ */
+void *pixels_alloc(int rows, size_t row_bytes, PixelAlloc how, size_t *mapped, int *unplaced);
+
+/**
+ * Function: pixels_free
+ * ---------------------
+ * Free a pixel array from pixels_alloc (NULL is ignored)
+ *
+ * Parameters:
+ *  void *pixels: the array
+ *  size_t mapped: the length pixels_alloc reported
+ * Returns:
+ *  void
+ */
+void pixels_free(void *pixels, size_t mapped);
+
+// End of header file
+#endif
@@ -7,10 +7,14 @@
 // Include header files
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <assert.h>
 #include "image_manip.h"
 #include "ppm_io.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /**
  * Function: pixel_to_gray
@@ -26,11 +30,416 @@ unsigned char pixel_to_gray(const Pixel *p) {
   return (unsigned char)((0.3 * (double)p->r) + (0.59 * (double)p->g) + (0.11 * (double)p->b));
 }
 
+/**
+ * Function: pixel16_to_gray
+ * -------------------------
+ * Convert a 16 bit RGB pixel to a single grayscale intensity using NTSC standard conversion
+ * 
+ * Parameters:
+ *  const Pixel16 *p: the pixel to be converted
+ * Return:
+ *  the grayscale intensity of the pixel (unsigned short)
+ */
+unsigned short pixel16_to_gray(const Pixel16 *p) {
+  return (unsigned short)((0.3 * (double)p->r) + (0.59 * (double)p->g) + (0.11 * (double)p->b));
+}
+
+/**
+ * Function: swirl_source
+ * ----------------------
+ * The pixel of the original image that pixel (c, r) of the swirled image comes from,
+ * shared by the swirl kernels and swirl_sources so both map pixels alike
+ *
+ * Parameters:
+ *  int r: row of the swirled pixel
+ *  int c: column of the swirled pixel
+ *  double cx: the x coordinate of the center of the swirl
+ *  double cy: the y coordinate of the center of the swirl
+ *  double s: the strength of the swirl
+ *  int *newR: receives the row of the original pixel (may be outside the image)
+ *  int *newC: receives the column of the original pixel (may be outside the image)
+ * Return:
+ *  void
+ */
+static void swirl_source(int r, int c, double cx, double cy, double s, int *newR, int *newC) {
+  double alpha = sqrt(pow(((double)c - (double)cx), 2) + pow(((double)r - (double)cy), 2)) / s;
+  *newC = (c - cx) * cos(alpha) - (r - cy) * sin(alpha) + cx;
+  *newR = (c - cx) * sin(alpha) + (r - cy) * cos(alpha) + cy;
+}
+
+/**
+ * Function: swirl_center
+ * ----------------------
+ * Resolve the default center of a swirl: a coordinate of -1 stands for the middle
+ * column or row of the image
+ *
+ * Parameters:
+ *  int rows: number of rows of the image
+ *  int cols: number of columns of the image
+ *  double *cx: the x coordinate of the center, replaced if -1
+ *  double *cy: the y coordinate of the center, replaced if -1
+ * Return:
+ *  void
+ */
+static void swirl_center(int rows, int cols, double *cx, double *cy) {
+  if (*cx == -1) {
+    *cx = cols / 2;
+  }
+  if (*cy == -1) {
+    *cy = rows / 2;
+  }
+}
+
+// 8 bit specializations of the kernels
+#define SAMPLE unsigned char
+#define PIXEL Pixel
+#define GRAY(p) pixel_to_gray(p)
+#define KERNEL(name) name##_8
+#include "image_manip_kernels.h"
+#undef SAMPLE
+#undef PIXEL
+#undef GRAY
+#undef KERNEL
+
+// 16 bit specializations of the kernels
+#define SAMPLE unsigned short
+#define PIXEL Pixel16
+#define GRAY(p) pixel16_to_gray(p)
+#define KERNEL(name) name##_16
+#include "image_manip_kernels.h"
+#undef SAMPLE
+#undef PIXEL
+#undef GRAY
+#undef KERNEL
+
+/**
+ * Function: bad_image
+ * -------------------
+ * Check whether an image pointer is unusable (null, or missing the pixels for its depth)
+ *
+ * Parameters:
+ *  const Image *im: the image to be checked
+ * Return:
+ *  1 if the image cannot be processed, 0 otherwise
+ */
+static int bad_image(const Image *im) {
+  return !im || (IS_16BIT(im) ? !im->data16 : !im->data);
+}
+
+/**
+ * Function: bad_view
+ * ------------------
+ * Check whether a view is unusable (null, missing pixels, or rows closer together than
+ * a row of pixels)
+ *
+ * Parameters:
+ *  const ImageView *v: the view to be checked
+ * Return:
+ *  1 if the view cannot be processed, 0 otherwise
+ */
+static int bad_view(const ImageView *v) {
+  return !v || v->rows < 0 || v->cols < 0 || v->maxval <= 0 || v->maxval > 65535 ||
+         (!v->data && v->rows && v->cols) ||
+         v->stride < (size_t)v->cols * (IS_16BIT(v) ? sizeof(Pixel16) : sizeof(Pixel));
+}
+
+/**
+ * Function: check_views
+ * ---------------------
+ * The checks every imgproc_ function makes: both views usable, of the same depth, dst
+ * of the expected size and, unless the operation works in place, not overlapping src
+ *
+ * Parameters:
+ *  const ImageView *src: the source view
+ *  const ImageView *dst: the destination view
+ *  int rows: the rows dst must have
+ *  int cols: the columns dst must have
+ *  int inPlace: 1 if dst may be exactly src
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+static int check_views(const ImageView *src, const ImageView *dst, int rows, int cols, int inPlace) {
+  if (bad_view(src) || bad_view(dst)) {
+    return IMGPROC_BAD_ARGUMENT;
+  }
+  if (dst->rows != rows || dst->cols != cols || IS_16BIT(dst) != IS_16BIT(src)) {
+    return IMGPROC_BAD_SIZE;
+  }
+  if (inPlace && src->data == dst->data && src->stride == dst->stride) {
+    return IMGPROC_OK;
+  }
+
+  // Compare the byte spans of the two views
+  size_t bpp = IS_16BIT(src) ? sizeof(Pixel16) : sizeof(Pixel);
+  const unsigned char *s = src->data, *d = dst->data;
+  if (!s || !d || !src->rows || !src->cols || !dst->rows || !dst->cols) {
+    return IMGPROC_OK;
+  }
+  const unsigned char *sEnd = s + (size_t)(src->rows - 1) * src->stride + (size_t)src->cols * bpp;
+  const unsigned char *dEnd = d + (size_t)(dst->rows - 1) * dst->stride + (size_t)dst->cols * bpp;
+  return (s < dEnd && d < sEnd) ? IMGPROC_OVERLAP : IMGPROC_OK;
+}
+
+/**
+ * Function: image_view
+ * --------------------
+ * A view of a whole image
+ *
+ * Parameters:
+ *  const Image *im: the image (its pixels are writable through the view)
+ * Return:
+ *  the view
+ */
+ImageView image_view(const Image *im) {
+  ImageView v;
+  v.data = IS_16BIT(im) ? (void *)im->data16 : (void *)im->data;
+  v.rows = im->rows;
+  v.cols = im->cols;
+  v.maxval = im->maxval;
+  v.stride = (size_t)im->cols * (IS_16BIT(im) ? sizeof(Pixel16) : sizeof(Pixel));
+  return v;
+}
+
+/**
+ * Function: view_region
+ * ---------------------
+ * A view of the w x h rectangle at (x, y) of another view; no pixels are copied
+ *
+ * Parameters:
+ *  const ImageView *v: the view to look into
+ *  int x: column of the top left corner of the rectangle
+ *  int y: row of the top left corner of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  ImageView *region: receives the view of the rectangle
+ * Return:
+ *  IMGPROC_OK, or IMGPROC_BAD_ARGUMENT if the rectangle does not fit in the view
+ */
+int view_region(const ImageView *v, int x, int y, int w, int h, ImageView *region) {
+  if (bad_view(v) || !region || w <= 0 || h <= 0 || x < 0 || y < 0 || x > v->cols - w || y > v->rows - h) {
+    return IMGPROC_BAD_ARGUMENT;
+  }
+  size_t bpp = IS_16BIT(v) ? sizeof(Pixel16) : sizeof(Pixel);
+  region->data = (unsigned char *)v->data + (size_t)y * v->stride + (size_t)x * bpp;
+  region->rows = h;
+  region->cols = w;
+  region->maxval = v->maxval;
+  region->stride = v->stride;
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_grayscale
+ * ---------------------------
+ * Write the grayscale version of src into dst (same size and depth; dst may be src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_grayscale(const ImageView *src, ImageView *dst) {
+  int rc = check_views(src, dst, src ? src->rows : 0, src ? src->cols : 0, 1);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  if (IS_16BIT(src)) {
+    grayscale_16(src, dst);
+  } else {
+    grayscale_8(src, dst);
+  }
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_swap
+ * ----------------------
+ * Write src with its channels rotated as by swap() into dst (same size and depth; dst
+ * may be src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_swap(const ImageView *src, ImageView *dst) {
+  int rc = check_views(src, dst, src ? src->rows : 0, src ? src->cols : 0, 1);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  if (IS_16BIT(src)) {
+    swap_16(src, dst);
+  } else {
+    swap_8(src, dst);
+  }
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_invert
+ * ------------------------
+ * Write the inverse of src into dst (same size and depth; dst may be src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_invert(const ImageView *src, ImageView *dst) {
+  int rc = check_views(src, dst, src ? src->rows : 0, src ? src->cols : 0, 1);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  if (IS_16BIT(src)) {
+    invert_16(src, dst);
+  } else {
+    invert_8(src, dst);
+  }
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_zoom_out
+ * --------------------------
+ * Write src zoomed out by a factor of 2 into dst (src->rows / 2 x src->cols / 2, same
+ * depth, not overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_zoom_out(const ImageView *src, ImageView *dst) {
+  int rc = check_views(src, dst, src ? src->rows / 2 : 0, src ? src->cols / 2 : 0, 0);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  if (IS_16BIT(src)) {
+    zoom_out_16(src, dst);
+  } else {
+    zoom_out_8(src, dst);
+  }
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_rotate_right
+ * ------------------------------
+ * Write src rotated clockwise by 90 degrees into dst (src->cols x src->rows, same depth,
+ * not overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_rotate_right(const ImageView *src, ImageView *dst) {
+  int rc = check_views(src, dst, src ? src->cols : 0, src ? src->rows : 0, 0);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  if (IS_16BIT(src)) {
+    rotate_right_16(src, dst);
+  } else {
+    rotate_right_8(src, dst);
+  }
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_swirl
+ * -----------------------
+ * Write src swirled around (cx, cy) into dst (same size and depth, not overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ *  double cx: the x coordinate of the center of the swirl
+ *  double cy: the y coordinate of the center of the swirl
+ *  double s: the strength of the swirl
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_swirl(const ImageView *src, ImageView *dst, double cx, double cy, double s) {
+  int rc = check_views(src, dst, src ? src->rows : 0, src ? src->cols : 0, 0);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  /*
+  Is(x, y) is the pixel at location (x, y) in the swirled image and Io((x - cx) cos α - (y - cy) sin α + cx, (x - cx) sin α + (y - cy) cos α + cy)
+  s the pixel at coordinates (x - cx) cos α - (y - cy) sin α + cx and (x - cx) sin α + (y - cy) cos α + cy in the original image.
+  Alpha is sqrt((x - cx)^2 + (y - cy)^2) / s
+  Is (x, y) = Io((x - cx) cos α - (y - cy) sin α + cx, (x - cx) sin α + (y - cy) cos α + cy)
+  */
+  if (IS_16BIT(src)) {
+    swirl_16(src, dst, cx, cy, s);
+  } else {
+    swirl_8(src, dst, cx, cy, s);
+  }
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_edges
+ * -----------------------
+ * Write the edges of src as found by edges() into dst (same size and depth, not
+ * overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ *  double threshold: the gradient magnitude from which a point is an edge
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_edges(const ImageView *src, ImageView *dst, double threshold) {
+  int rc = check_views(src, dst, src ? src->rows : 0, src ? src->cols : 0, 0);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  if (IS_16BIT(src)) {
+    edges_16(src, dst, threshold);
+  } else {
+    edges_8(src, dst, threshold);
+  }
+  return IMGPROC_OK;
+}
+
+/**
+ * Function: imgproc_copy
+ * ----------------------
+ * Copy src into dst (same size and depth, not overlapping src); with view_region this
+ * crops, pastes and moves rectangles between images
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_copy(const ImageView *src, ImageView *dst) {
+  int rc = check_views(src, dst, src ? src->rows : 0, src ? src->cols : 0, 0);
+  if (rc != IMGPROC_OK) {
+    return rc;
+  }
+  if (IS_16BIT(src)) {
+    copy_16(src, dst);
+  } else {
+    copy_8(src, dst);
+  }
+  return IMGPROC_OK;
+}
+
 /**
  * Function: grayscale
  * -------------------
  * Convert an image to grayscale (pixels are still RGB, but the three values will be equal)
- * 
+ *
  * Parameters:
  *  Image *im: the image to be grayscaled
  * Return:
@@ -38,30 +447,21 @@ unsigned char pixel_to_gray(const Pixel *p) {
  */
 void grayscale(Image *im) {
   // Error check
-  if (!im || !im->data) {
+  if (bad_image(im)) {
     fprintf(stderr, "Error:image_manip - grayscale given a bad image pointer\n");
     return;
   }
 
-  // Loop through each pixel and convert to grayscale
-  for (int r = 0; r < im->rows; r++) {
-    for (int c = 0; c < im->cols; c++) {
-      // Get the grayscale intensity of the pixel
-      unsigned char grayLevel = pixel_to_gray(&(im->data[(r*im->cols)+c]));
-      // Adjust the pixel to be grayscale
-      im->data[(r*im->cols)+c].r = grayLevel;
-      im->data[(r*im->cols)+c].g = grayLevel;
-      im->data[(r*im->cols)+c].b = grayLevel;
-    }
-  }
+  ImageView v = image_view(im);
+  imgproc_grayscale(&v, &v);
 }
 
 
-/** 
+/**
  * Function: swap
  * --------------
  * Swap color of an image (R <-> G, G <-> B, B <-> R)
- * 
+ *
  * Parameters:
  *  Image *im: the image to be swapped
  * Return:
@@ -69,28 +469,20 @@ void grayscale(Image *im) {
 */
 void swap(Image *im) {
   // Error check
-  if (!im || !im->data) {
+  if (bad_image(im)) {
     fprintf(stderr, "Error:image_manip - swap given a bad image pointer\n");
     return;
   }
 
-  // Loop through each pixel and swap the color channels
-  for (int r = 0; r < im->rows; r++){
-    for (int c = 0; c < im->cols; c++){
-      // Swap green to red, swap blue to green, swap red to blue
-      unsigned char temp = im->data[(r*im->cols)+c].r;
-      im->data[(r*im->cols)+c].r = im->data[(r*im->cols)+c].g;
-      im->data[(r*im->cols)+c].g = im->data[(r*im->cols)+c].b;
-      im->data[(r*im->cols)+c].b = temp;
-    }
-  }
+  ImageView v = image_view(im);
+  imgproc_swap(&v, &v);
 }
 
 /**
  * Function: invert
  * ----------------
- * Invert the intensity of each color channel
- * 
+ * Invert the intensity of each color channel (relative to the image's maximum value)
+ *
  * Parameters:
  *  Image *im: the image to be inverted
  * Return:
@@ -98,27 +490,20 @@ void swap(Image *im) {
  */
 void invert(Image *im) {
   // Error check
-  if (!im || !im->data) {
+  if (bad_image(im)) {
     fprintf(stderr, "Error:image_manip - invert given a bad image pointer\n");
     return;
   }
 
-  // Loop through each pixel and invert the color channels
-  for (int r = 0; r < im->rows; r++){
-    for (int c = 0; c < im->cols; c++){
-      // Invert the color channels by subtracting its value from 255
-      im->data[(r*im->cols)+c].r = 255 - im->data[(r*im->cols)+c].r;
-      im->data[(r*im->cols)+c].g = 255 - im->data[(r*im->cols)+c].g;
-      im->data[(r*im->cols)+c].b = 255 - im->data[(r*im->cols)+c].b;
-    }
-  }
+  ImageView v = image_view(im);
+  imgproc_invert(&v, &v);
 }
 
 /**
  * Function: zoom_out
  * ------------------
  * Zoom out the image by a factor of 2
- * 
+ *
  * Parameters:
  *  Image *im: the image to be zoomed out
  * Return:
@@ -126,51 +511,35 @@ void invert(Image *im) {
  */
 void zoom_out(Image *im) {
   // Error check
-  if (!im || !im->data) {
+  if (bad_image(im)) {
     fprintf(stderr, "Error:image_manip - zoom_out given a bad image pointer\n");
     return;
   }
-  /* 
-  In order to perform a zoom out, we take a 2X2 square of pixels in the input 
-  image and average each of the three color channels of the four pixels to make 
-  a single pixel. This means a zoomed out picture has half as many rows and half 
-  as many columns as the original image. However, note that the number of rows 
-  and/or columns in the input image might be odd, in which case we lose info about 
+  /*
+  In order to perform a zoom out, we take a 2X2 square of pixels in the input
+  image and average each of the three color channels of the four pixels to make
+  a single pixel. This means a zoomed out picture has half as many rows and half
+  as many columns as the original image. However, note that the number of rows
+  and/or columns in the input image might be odd, in which case we lose info about
   the bottom row and/or rightmost column.
   */
-  // Create a new image with half the rows and columns of the original image
-  Image *newImage = (Image *)malloc(sizeof(Image));
-  newImage->rows = im->rows / 2;
-  newImage->cols = im->cols / 2;
-  newImage->data = (Pixel *)malloc(sizeof(Pixel) * newImage->rows * newImage->cols);
-
-  // Loop through each pixel in the new image
-  for (int r = 0; r < newImage->rows; r++) {
-    for (int c = 0; c < newImage->cols; c++) {
-      // Get the average of the four pixels in the original image
-      unsigned char avgR = (im->data[((2*r)*im->cols)+(2*c)].r + im->data[((2*r)*im->cols)+(2*c)+1].r + im->data[((2*r)+1)*im->cols+(2*c)].r + im->data[((2*r)+1)*im->cols+(2*c)+1].r) / 4;
-      unsigned char avgG = (im->data[((2*r)*im->cols)+(2*c)].g + im->data[((2*r)*im->cols)+(2*c)+1].g + im->data[((2*r)+1)*im->cols+(2*c)].g + im->data[((2*r)+1)*im->cols+(2*c)+1].g) / 4;
-      unsigned char avgB = (im->data[((2*r)*im->cols)+(2*c)].b + im->data[((2*r)*im->cols)+(2*c)+1].b + im->data[((2*r)+1)*im->cols+(2*c)].b + im->data[((2*r)+1)*im->cols+(2*c)+1].b) / 4;
-      // Set the pixel in the new image to the average of the four pixels
-      newImage->data[(r*newImage->cols)+c].r = avgR;
-      newImage->data[(r*newImage->cols)+c].g = avgG;
-      newImage->data[(r*newImage->cols)+c].b = avgB;
-    }
+  Image *newImage = make_image_maxval(im->rows / 2, im->cols / 2, im->maxval);
+  if (!newImage) {
+    fprintf(stderr, "Error:image_manip - zoom_out failed to allocate memory\n");
+    return;
   }
+  ImageView src = image_view(im), dst = image_view(newImage);
+  imgproc_zoom_out(&src, &dst);
 
   // Free the old image and set the pointer to the new image
-  free(im->data);
-  im->rows = newImage->rows;
-  im->cols = newImage->cols;
-  im->data = newImage->data;
-  free(newImage);
+  replace_image(im, &newImage);
 }
 
 /**
  * Function: rotate_right
  * ----------------------
  * Rotate an image clockwise by 90 degrees
- * 
+ *
  * Parameters:
  *  Image *im: the image to be rotated
  * Return:
@@ -178,40 +547,28 @@ void zoom_out(Image *im) {
  */
 void rotate_right(Image *im) {
   // Error check
-  if (!im || !im->data) {
+  if (bad_image(im)) {
     fprintf(stderr, "Error:image_manip - rotate_right given a bad image pointer\n");
     return;
   }
 
-  // First you should allocate a new image with reversed dimensions (width and height) of the input image
-  Image *newImage = (Image *)malloc(sizeof(Image));
-  newImage->rows = im->cols;
-  newImage->cols = im->rows;
-  newImage->data = (Pixel *)malloc(sizeof(Pixel)*newImage->rows*newImage->cols);
-
-  // Loop through each pixel and rotate the image clockwise by 90 degrees
-  for (int r = 0; r < im->rows; r++){
-    for (int c = 0; c < im->cols; c++){
-      // Use a loop to assign each new pixel value using the corresponding cell in the original image. 
-      newImage->data[(c*newImage->cols)+(newImage->cols-1-r)].r = im->data[(r*im->cols)+c].r;
-      newImage->data[(c*newImage->cols)+(newImage->cols-1-r)].g = im->data[(r*im->cols)+c].g;
-      newImage->data[(c*newImage->cols)+(newImage->cols-1-r)].b = im->data[(r*im->cols)+c].b;
-    }
+  Image *newImage = make_image_maxval(im->cols, im->rows, im->maxval);
+  if (!newImage) {
+    fprintf(stderr, "Error:image_manip - rotate_right failed to allocate memory\n");
+    return;
   }
+  ImageView src = image_view(im), dst = image_view(newImage);
+  imgproc_rotate_right(&src, &dst);
 
   // Free the old image and set the pointer to the new image
-  free(im->data);
-  im->rows = newImage->rows;
-  im->cols = newImage->cols;
-  im->data = newImage->data;
-  free(newImage);
+  replace_image(im, &newImage);
 }
 
 /**
  * Function: swirl
  * ---------------------
- * Swirl the image using the given formula 
- * 
+ * Swirl the image using the given formula
+ *
  * Parameters:
  *  Image *im: the image to be swirled
  *  int cx: the x coordinate of the center of the swirl
@@ -222,62 +579,61 @@ void rotate_right(Image *im) {
  */
 void swirl(Image *im, double cx, double cy, double s) {
   // Error check
-  if (!im || !im->data) {
+  if (bad_image(im)) {
     fprintf(stderr, "Error:image_manip - swirl given a bad image pointer\n");
     return;
   }
 
-  if(cx == -1){
-    cx = im->cols/2;
-  }
-  if(cy == -1){
-    cy = im->rows/2;
+  swirl_center(im->rows, im->cols, &cx, &cy);
+
+  Image *newImage = make_image_maxval(im->rows, im->cols, im->maxval);
+  if (!newImage) {
+    fprintf(stderr, "Error:image_manip - swirl failed to allocate memory\n");
+    return;
   }
+  ImageView src = image_view(im), dst = image_view(newImage);
+  imgproc_swirl(&src, &dst, cx, cy, s);
 
-  /*
-  Is(x, y) is the pixel at location (x, y) in the swirled image and Io((x - cx) cos α - (y - cy) sin α + cx, (x - cx) sin α + (y - cy) cos α + cy) 
-  s the pixel at coordinates (x - cx) cos α - (y - cy) sin α + cx and (x - cx) sin α + (y - cy) cos α + cy in the original image.
-  Alpha is sqrt((x - cx)^2 + (y - cy)^2) / s
-  Is (x, y) = Io((x - cx) cos α - (y - cy) sin α + cx, (x - cx) sin α + (y - cy) cos α + cy)
-  */
-  // First you should allocate a new image with the same dimensions as the input image
-  Image *newImage = (Image *)malloc(sizeof(Image));
-  newImage->rows = im->rows;
-  newImage->cols = im->cols;
-  newImage->data = (Pixel *)malloc(sizeof(Pixel)*newImage->rows*newImage->cols);
-
-  // Loop through each pixel and swirl the image
-  for (int r = 0; r < im->rows; r++){
-    for (int c = 0; c < im->cols; c++){
-      // Then, you use a loop to assign each new pixel value using the corresponding cell in the original image. 
-      double alpha = sqrt(pow(((double)c - (double)cx), 2) + pow(((double)r - (double)cy), 2)) / s;
-      int newC = (c - cx) * cos(alpha) - (r - cy) * sin(alpha) + cx;
-      int newR = (c - cx) * sin(alpha) + (r - cy) * cos(alpha) + cy;
-      // Check if the new coordinates are out of bounds
-      if (newC < 0 || newC >= im->cols || newR < 0 || newR >= im->rows) {
-        newImage->data[(r*newImage->cols)+c].r = 0;
-        newImage->data[(r*newImage->cols)+c].g = 0;
-        newImage->data[(r*newImage->cols)+c].b = 0;
+  // Free the old image and set the pointer to the new image
+  replace_image(im, &newImage);
+}
+
+/**
+ * Function: swirl_sources
+ * -----------------------
+ * The pixel each pixel of a swirled image comes from, as swirl() maps them
+ *
+ * Parameters:
+ *  int rows: number of rows of the image
+ *  int cols: number of columns of the image
+ *  double cx: the x coordinate of the center of the swirl, -1 for the middle column
+ *  double cy: the y coordinate of the center of the swirl, -1 for the middle row
+ *  double s: the strength of the swirl
+ *  int *sources: receives rows x cols indices (row * cols + column) of the original
+ *                pixels, -1 where the swirled image is black
+ * Return:
+ *  void
+ */
+void swirl_sources(int rows, int cols, double cx, double cy, double s, int *sources) {
+  swirl_center(rows, cols, &cx, &cy);
+  for (int r = 0; r < rows; r++) {
+    for (int c = 0; c < cols; c++) {
+      int newR, newC;
+      swirl_source(r, c, cx, cy, s, &newR, &newC);
+      if (newC < 0 || newC >= cols || newR < 0 || newR >= rows) {
+        sources[(size_t)r * cols + c] = -1;
       } else {
-        newImage->data[(r*newImage->cols)+c].r = im->data[(newR*im->cols)+newC].r;
-        newImage->data[(r*newImage->cols)+c].g = im->data[(newR*im->cols)+newC].g;
-        newImage->data[(r*newImage->cols)+c].b = im->data[(newR*im->cols)+newC].b;
+        sources[(size_t)r * cols + c] = newR * cols + newC;
       }
     }
   }
-  // Free the old image and set the pointer to the new image
-  free(im->data);
-  im->rows = newImage->rows;
-  im->cols = newImage->cols;
-  im->data = newImage->data;
-  free(newImage);
 }
 
 /**
  * Function: edges
  * ---------------
- * The function detects edges in the image 
- * 
+ * The function detects edges in the image
+ *
  * Parameters:
  *  Image *im: the image to be swirled
  *  int threshold: the threshold to be used in the swirl
@@ -286,70 +642,415 @@ void swirl(Image *im, double cx, double cy, double s) {
  */
 void edges(Image *im, double threshold) {
   // Error check
-  if (!im || !im->data) {
+  if (bad_image(im)) {
     fprintf(stderr, "Error:image_manip - edges given a bad image pointer\n");
     return;
   }
 
-  // First convert the image to grayscale
-  grayscale(im);
+  // The kernel converts the pixels to grayscale intensities as it reads them
+  Image *newImage = make_image_maxval(im->rows, im->cols, im->maxval);
+  if (!newImage) {
+    fprintf(stderr, "Error:image_manip - edges failed to allocate memory\n");
+    return;
+  }
+  ImageView src = image_view(im), dst = image_view(newImage);
+  imgproc_edges(&src, &dst, threshold);
 
-  int count = 0;
+  // Free the old image and set the pointer to the new image
+  replace_image(im, &newImage);
+}
 
-  Image * newImage = (Image *)malloc(sizeof(Image));
-  newImage->rows = im->rows;
-  newImage->cols = im->cols;
-  newImage->data = (Pixel *)malloc(sizeof(Pixel)*newImage->rows*newImage->cols);
 
-  // Compute the intensity gradient for each interior point (i.e. points not on the boundary) of the image in both the horizontal (x) and vertical (y) directions
-  for (int r = 0; r < im->rows; r++){
-    for (int c = 0; c < im->cols; c++){
-      //edges
-      if(r == 0 || c == 0 || r == im->rows-1 || c == im->cols-1){
-        newImage->data[(r*im->cols)+c].r = im->data[(r*im->cols)+c].r ;
-        newImage->data[(r*im->cols)+c].g = im->data[(r*im->cols)+c].r ;
-        newImage->data[(r*im->cols)+c].b = im->data[(r*im->cols)+c].r ;
-	continue;
-      }
+/**
+ * Function: copy_region
+ * ---------------------
+ * Copy the w x h rectangle at (x, y) of an image into a new image
+ *
+ * Parameters:
+ *  const Image *im: the image to copy from
+ *  int x: column of the top left corner of the rectangle
+ *  int y: row of the top left corner of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ * Return:
+ *  Image *: the copied rectangle, NULL if the rectangle does not fit in the image
+ */
+Image *copy_region(const Image *im, int x, int y, int w, int h) {
+  // Error check
+  if (bad_image(im)) {
+    fprintf(stderr, "Error:image_manip - copy_region given a bad image pointer\n");
+    return NULL;
+  }
+  ImageView whole = image_view(im), src;
+  if (view_region(&whole, x, y, w, h, &src) != IMGPROC_OK) {
+    fprintf(stderr, "Error:image_manip - copy_region given a rectangle outside of the image\n");
+    return NULL;
+  }
 
-      // gradient x = (I(x + 1, y) - I(x - 1, y)) / 2
-      // gradient y = (I(x, y + 1) - I(x, y - 1)) / 2
-      // gradient magnitude = sqrt(gradient x^2 + gradient y^2)
-
-      int intensityAt1Up, intensityAt1Down, intensityAt1Left, intensityAt1Right;
-
-      intensityAt1Up = im->data[((r-1)*im->cols)+c].g;
-      intensityAt1Down = im->data[((r+1)*im->cols)+c].g;
-      intensityAt1Left = im->data[((r)*im->cols)+(c-1)].g;
-      intensityAt1Right = im->data[((r+1)*im->cols)+(c+1)].g;
-
-
-      double gradientX = (double)(intensityAt1Left - intensityAt1Right) / 2;
-      double gradientY = (double)(intensityAt1Up - intensityAt1Down) / 2;
-      double gradientMagnitude = sqrt(pow(gradientX, 2) + pow(gradientY, 2));
-      // Threshold each pixel and classify it as an edge or not an edge
-      // Set the values of all channels to 0 (black) if the magnitude exceeds the threshold, else set the values to 255 (white)
-      // Ignore the boundary points and leave them as they are
-      
-      if (gradientMagnitude < threshold){
-        newImage->data[(r*im->cols)+c].r = 255;
-        newImage->data[(r*im->cols)+c].g = 255;
-        newImage->data[(r*im->cols)+c].b = 255;
-      } else {
-        count++;
-        newImage->data[(r*im->cols)+c].r = 0;
-        newImage->data[(r*im->cols)+c].g = 0;
-        newImage->data[(r*im->cols)+c].b = 0;
-      }
+  Image *region = make_image_maxval(h, w, im->maxval);
+  if (!region) {
+    fprintf(stderr, "Error:image_manip - copy_region failed to allocate memory\n");
+    return NULL;
+  }
+  ImageView dst = image_view(region);
+  imgproc_copy(&src, &dst);
+  return region;
+}
+
+/**
+ * Function: paste_region
+ * ----------------------
+ * Paste an image into another one with its top left corner at (x, y)
+ *
+ * Parameters:
+ *  Image *im: the image to paste into
+ *  const Image *region: the image to be pasted
+ *  int x: column of the top left corner of the destination
+ *  int y: row of the top left corner of the destination
+ * Return:
+ *  void (image itself is already modified since it is a pointer)
+ */
+void paste_region(Image *im, const Image *region, int x, int y) {
+  // Error check
+  if (bad_image(im) || bad_image(region) || IS_16BIT(im) != IS_16BIT(region)) {
+    fprintf(stderr, "Error:image_manip - paste_region given a bad image pointer\n");
+    return;
+  }
+  ImageView whole = image_view(im), src = image_view(region), dst;
+  if (view_region(&whole, x, y, region->cols, region->rows, &dst) != IMGPROC_OK) {
+    fprintf(stderr, "Error:image_manip - paste_region given a rectangle outside of the image\n");
+    return;
+  }
+
+  if (imgproc_copy(&src, &dst) != IMGPROC_OK) {
+    fprintf(stderr, "Error:image_manip - paste_region given a region of the image itself\n");
+  }
+}
+
+/**
+ * Function: crop
+ * --------------
+ * Crop the image to the w x h rectangle with its top left corner at (x, y)
+ *
+ * Parameters:
+ *  Image *im: the image to be cropped
+ *  int x: column of the top left corner of the rectangle
+ *  int y: row of the top left corner of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ * Return:
+ *  void (image itself is already modified since it is a pointer)
+ */
+void crop(Image *im, int x, int y, int w, int h) {
+  // Error check
+  if (bad_image(im)) {
+    fprintf(stderr, "Error:image_manip - crop given a bad image pointer\n");
+    return;
+  }
+
+  Image *newImage = copy_region(im, x, y, w, h);
+  if (!newImage) {
+    return;
+  }
+
+  // Free the old pixels and take over the cropped ones
+  replace_image(im, &newImage);
+}
+
+/**
+ * Function: to_gray
+ * -----------------
+ * The grayscale intensities of an image (as grayscale() computes them), one sample per
+ * pixel
+ *
+ * Parameters:
+ *  const Image *im: the image
+ * Return:
+ *  GrayImage *: the intensities, NULL on a bad image pointer or allocation failure
+ */
+GrayImage *to_gray(const Image *im) {
+  // Error check
+  if (bad_image(im)) {
+    fprintf(stderr, "Error:image_manip - to_gray given a bad image pointer\n");
+    return NULL;
+  }
+
+  GrayImage *gray = make_gray_image(im->rows, im->cols, im->maxval);
+  if (!gray) {
+    fprintf(stderr, "Error:image_manip - to_gray failed to allocate memory\n");
+    return NULL;
+  }
+  ImageView src = image_view(im);
+  if (IS_16BIT(im)) {
+    to_gray_16(&src, gray->data16);
+  } else {
+    to_gray_8(&src, gray->data);
+  }
+  return gray;
+}
+
+/**
+ * Function: edges_gray
+ * --------------------
+ * The result of edges() as a gray image, produced directly at one sample per pixel
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  double threshold: the gradient magnitude from which a point is an edge
+ * Return:
+ *  GrayImage *: the edges, NULL on a bad image pointer or allocation failure
+ */
+GrayImage *edges_gray(const Image *im, double threshold) {
+  // Error check
+  if (bad_image(im)) {
+    fprintf(stderr, "Error:image_manip - edges_gray given a bad image pointer\n");
+    return NULL;
+  }
+
+  GrayImage *gray = make_gray_image(im->rows, im->cols, im->maxval);
+  if (!gray) {
+    fprintf(stderr, "Error:image_manip - edges_gray failed to allocate memory\n");
+    return NULL;
+  }
+  ImageView src = image_view(im);
+  if (IS_16BIT(im)) {
+    edges_gray_16(&src, gray->data16, threshold);
+  } else {
+    edges_gray_8(&src, gray->data, threshold);
+  }
+  return gray;
+}
+
+/**
+ * Function: gray_to_rgb
+ * ---------------------
+ * Expand a gray image to an RGB image with three equal channels
+ *
+ * Parameters:
+ *  const GrayImage *gray: the gray image
+ * Return:
+ *  Image *: the RGB image, NULL on a bad image pointer or allocation failure
+ */
+Image *gray_to_rgb(const GrayImage *gray) {
+  // Error check
+  if (!gray || (IS_16BIT(gray) ? !gray->data16 : !gray->data)) {
+    fprintf(stderr, "Error:image_manip - gray_to_rgb given a bad image pointer\n");
+    return NULL;
+  }
+
+  Image *im = make_image_maxval(gray->rows, gray->cols, gray->maxval);
+  if (!im) {
+    fprintf(stderr, "Error:image_manip - gray_to_rgb failed to allocate memory\n");
+    return NULL;
+  }
+  ImageView dst = image_view(im);
+  if (IS_16BIT(im)) {
+    from_gray_16(gray->data16, &dst);
+  } else {
+    from_gray_8(gray->data, &dst);
+  }
+  return im;
+}
+
+/**
+ * Function: edge_limit
+ * --------------------
+ * The smallest sum of squared central differences dx^2 + dy^2 whose gradient
+ * magnitude sqrt(dx^2 + dy^2) / 2, computed as edges() computes it, reaches the
+ * threshold, so that integer comparisons classify every point exactly as edges() does
+ *
+ * Parameters:
+ *  double threshold: the gradient magnitude from which a point is an edge
+ *  int maxval: the maximum intensity
+ * Return:
+ *  the limit; one more than the largest possible sum if no point can be an edge
+ */
+static long long edge_limit(double threshold, int maxval) {
+  long long lo = 0, hi = 2LL * maxval * maxval + 1;
+  // The magnitude grows with the sum, so search for the first sum that passes
+  while (lo < hi) {
+    long long mid = lo + (hi - lo) / 2;
+    // (dx/2)^2 + (dy/2)^2 is exactly mid/4 in double precision
+    if (sqrt((double)mid / 4) >= threshold) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
     }
   }
+  return lo;
+}
 
-  free(im->data);
-  im->data = newImage->data;
-  free(newImage);
+#ifdef __SSE2__
+/**
+ * Function: reverse_bits
+ * ----------------------
+ * Reverse the order of the bits of a byte (movemask puts the leftmost pixel in the
+ * least significant bit, PBM wants it in the most significant one)
+ *
+ * Parameters:
+ *  unsigned v: the byte
+ * Return:
+ *  the reversed byte
+ */
+static unsigned char reverse_bits(unsigned v) {
+  return (unsigned char)(((v * 0x0202020202ULL) & 0x010884422010ULL) % 1023);
+}
 
-  //Print count
-} 
+/**
+ * Function: edge_bits_sse2
+ * ------------------------
+ * Set the bits of the edge points of one interior row of an 8 bit image, 16 columns
+ * at a time: the squared central differences are summed with madd, compared with the
+ * limit, and the comparison masks are packed down to one bit per pixel
+ *
+ * Parameters:
+ *  const unsigned char *up: intensities of the row above, readable from index -1
+ *  const unsigned char *mid: intensities of the row, readable from index -1 to cols
+ *  const unsigned char *down: intensities of the row below
+ *  int cols: number of columns
+ *  int limit: the edge_limit of the threshold
+ *  unsigned char *out: the packed row, whose whole bytes are overwritten
+ * Return:
+ *  the first column left for edge_bits_8
+ */
+static int edge_bits_sse2(const unsigned char *up, const unsigned char *mid, const unsigned char *down,
+                          int cols, int limit, unsigned char *out) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i lim = _mm_set1_epi32(limit);
+  int c = 0;
+  for (; c + 16 <= cols; c += 16) {
+    __m128i left = _mm_loadu_si128((const __m128i *)(mid + c - 1));
+    __m128i right = _mm_loadu_si128((const __m128i *)(mid + c + 1));
+    __m128i above = _mm_loadu_si128((const __m128i *)(up + c));
+    __m128i below = _mm_loadu_si128((const __m128i *)(down + c));
+    __m128i dxLo = _mm_sub_epi16(_mm_unpacklo_epi8(left, zero), _mm_unpacklo_epi8(right, zero));
+    __m128i dxHi = _mm_sub_epi16(_mm_unpackhi_epi8(left, zero), _mm_unpackhi_epi8(right, zero));
+    __m128i dyLo = _mm_sub_epi16(_mm_unpacklo_epi8(above, zero), _mm_unpacklo_epi8(below, zero));
+    __m128i dyHi = _mm_sub_epi16(_mm_unpackhi_epi8(above, zero), _mm_unpackhi_epi8(below, zero));
+
+    // dx^2 + dy^2 of each column, as four groups of four 32 bit sums
+    __m128i s0 = _mm_madd_epi16(_mm_unpacklo_epi16(dxLo, dyLo), _mm_unpacklo_epi16(dxLo, dyLo));
+    __m128i s1 = _mm_madd_epi16(_mm_unpackhi_epi16(dxLo, dyLo), _mm_unpackhi_epi16(dxLo, dyLo));
+    __m128i s2 = _mm_madd_epi16(_mm_unpacklo_epi16(dxHi, dyHi), _mm_unpacklo_epi16(dxHi, dyHi));
+    __m128i s3 = _mm_madd_epi16(_mm_unpackhi_epi16(dxHi, dyHi), _mm_unpackhi_epi16(dxHi, dyHi));
+
+    // All ones where the sum is below the limit, narrowed to one byte per column
+    __m128i below0 = _mm_packs_epi32(_mm_cmpgt_epi32(lim, s0), _mm_cmpgt_epi32(lim, s1));
+    __m128i below1 = _mm_packs_epi32(_mm_cmpgt_epi32(lim, s2), _mm_cmpgt_epi32(lim, s3));
+    unsigned edge = ~(unsigned)_mm_movemask_epi8(_mm_packs_epi16(below0, below1)) & 0xffff;
+    out[c >> 3] = reverse_bits(edge & 0xff);
+    out[(c >> 3) + 1] = reverse_bits(edge >> 8);
+  }
+
+  // The boundary columns are never edges
+  out[0] &= 0x7f;
+  if (c == cols) {
+    out[(cols - 1) >> 3] &= (unsigned char)~(0x80 >> ((cols - 1) & 7));
+  }
+  return c;
+}
+#endif
+
+/**
+ * Function: edges_binary
+ * ----------------------
+ * The edge points of edges() as a binary image, produced directly at one bit per
+ * pixel (edges are black); the boundary points, which edges() leaves gray, are white.
+ * Three rows of intensities are kept, so no full size intermediate is made.
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  double threshold: the gradient magnitude from which a point is an edge
+ * Return:
+ *  BinaryImage *: the edges, NULL on a bad image pointer or allocation failure
+ */
+BinaryImage *edges_binary(const Image *im, double threshold) {
+  // Error check
+  if (bad_image(im)) {
+    fprintf(stderr, "Error:image_manip - edges_binary given a bad image pointer\n");
+    return NULL;
+  }
+
+  BinaryImage *bin = make_binary_image(im->rows, im->cols);
+  // Three rows of intensities, each with a spare sample on either side for the
+  // shifted vector loads
+  size_t sample = IS_16BIT(im) ? sizeof(unsigned short) : 1;
+  size_t span = (size_t)im->cols + 2;
+  unsigned char *rows = calloc(3 * span, sample);
+  if (!bin || !rows) {
+    fprintf(stderr, "Error:image_manip - edges_binary failed to allocate memory\n");
+    free_binary_image(&bin);
+    free(rows);
+    return NULL;
+  }
+
+  ImageView src = image_view(im);
+  long long limit = edge_limit(threshold, im->maxval);
+  void *gray[3];
+  for (int i = 0; i < 3; i++) {
+    gray[i] = rows + (i * span + 1) * sample;
+  }
+  for (int r = 0; r < im->rows; r++) {
+    // Intensities of row r go to gray[r % 3]
+    ImageView line;
+    view_region(&src, 0, r, im->cols, 1, &line);
+    if (IS_16BIT(im)) {
+      to_gray_16(&line, gray[r % 3]);
+    } else {
+      to_gray_8(&line, gray[r % 3]);
+    }
+    if (r < 2) {
+      continue;
+    }
+
+    // Row r - 1 now has both neighbours
+    void *up = gray[(r - 2) % 3], *mid = gray[(r - 1) % 3], *down = gray[r % 3];
+    unsigned char *out = bin->data + (size_t)(r - 1) * bin->stride;
+    if (IS_16BIT(im)) {
+      edge_bits_16(up, mid, down, 1, im->cols, limit, out);
+    } else {
+      int c0 = 1;
+#ifdef __SSE2__
+      c0 = edge_bits_sse2(up, mid, down, im->cols, (int)limit, out);
+#endif
+      edge_bits_8(up, mid, down, c0, im->cols, limit, out);
+    }
+  }
+  free(rows);
+  return bin;
+}
+
+/**
+ * Function: to_binary
+ * -------------------
+ * Threshold the grayscale intensities of an image at half of maxval into a binary
+ * image (darker pixels are black)
+ *
+ * Parameters:
+ *  const Image *im: the image
+ * Return:
+ *  BinaryImage *: the binary image, NULL on a bad image pointer or allocation failure
+ */
+BinaryImage *to_binary(const Image *im) {
+  // Error check
+  if (bad_image(im)) {
+    fprintf(stderr, "Error:image_manip - to_binary given a bad image pointer\n");
+    return NULL;
+  }
+
+  BinaryImage *bin = make_binary_image(im->rows, im->cols);
+  if (!bin) {
+    fprintf(stderr, "Error:image_manip - to_binary failed to allocate memory\n");
+    return NULL;
+  }
+  ImageView src = image_view(im);
+  if (IS_16BIT(im)) {
+    to_binary_16(&src, bin->data, bin->stride);
+  } else {
+    to_binary_8(&src, bin->data, bin->stride);
+  }
+  return bin;
+}
 
 // Change threshold (edge detection) to double
 // Finish Error Handling
@@ -20,6 +20,21 @@
 // macro to find the max of a number
 #define MAX(a,b) ((a > b) ? (a) : (b))
 
+// Return codes of the imgproc_ functions, which work on caller provided views, never
+// allocate and never print, so they can be called from any number of threads
+
+// Success
+#define IMGPROC_OK             0
+
+// Null pointer, missing pixels or an invalid parameter
+#define IMGPROC_BAD_ARGUMENT  -1
+
+// The destination does not have the size or depth the result needs
+#define IMGPROC_BAD_SIZE      -2
+
+// Source and destination overlap, and the operation cannot work in place
+#define IMGPROC_OVERLAP       -3
+
 /**
  * Function: pixel_to_gray
  * -----------------------
@@ -32,6 +47,18 @@
  */
 unsigned char pixel_to_gray(const Pixel *p);
 
+/**
+ * Function: pixel16_to_gray
+ * -------------------------
+ * Convert a 16 bit RGB pixel to a single grayscale intensity using NTSC standard conversion
+ * 
+ * Parameters:
+ *  const Pixel16 *p: the pixel to be converted
+ * Return:
+ *  the grayscale intensity of the pixel (unsigned short)
+ */
+unsigned short pixel16_to_gray(const Pixel16 *p);
+
 /**
  * Function: grayscale
  * -------------------
@@ -59,7 +86,7 @@ void swap(Image *im);
 /**
  * Function: invert
  * ----------------
- * Invert the intensity of each color channel
+ * Invert the intensity of each color channel (relative to the image's maximum value)
  * 
  * Parameters:
  *  Image *im: the image to be inverted
@@ -107,6 +134,24 @@ void rotate_right(Image *im);
  */
 void swirl(Image *im, double cx, double cy, double s);
 
+/**
+ * Function: swirl_sources
+ * -----------------------
+ * The pixel each pixel of a swirled image comes from, as swirl() maps them
+ *
+ * Parameters:
+ *  int rows: number of rows of the image
+ *  int cols: number of columns of the image
+ *  double cx: the x coordinate of the center of the swirl, -1 for the middle column
+ *  double cy: the y coordinate of the center of the swirl, -1 for the middle row
+ *  double s: the strength of the swirl
+ *  int *sources: receives rows x cols indices (row * cols + column) of the original
+ *                pixels, -1 where the swirled image is black
+ * Return:
+ *  void
+ */
+void swirl_sources(int rows, int cols, double cx, double cy, double s, int *sources);
+
 /**
  * Function: edges
  * ---------------
@@ -120,5 +165,259 @@ void swirl(Image *im, double cx, double cy, double s);
  */
 void edges(Image *im, double threshold);
 
+/**
+ * Function: copy_region
+ * ---------------------
+ * Copy the w x h rectangle at (x, y) of an image into a new image
+ * 
+ * Parameters:
+ *  const Image *im: the image to copy from
+ *  int x: column of the top left corner of the rectangle
+ *  int y: row of the top left corner of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ * Return:
+ *  Image *: the copied rectangle, NULL if the rectangle does not fit in the image
+ */
+Image *copy_region(const Image *im, int x, int y, int w, int h);
+
+/**
+ * Function: paste_region
+ * ----------------------
+ * Paste an image into another one with its top left corner at (x, y)
+ * 
+ * Parameters:
+ *  Image *im: the image to paste into
+ *  const Image *region: the image to be pasted
+ *  int x: column of the top left corner of the destination
+ *  int y: row of the top left corner of the destination
+ * Return:
+ *  void (image itself is already modified since it is a pointer)
+ */
+void paste_region(Image *im, const Image *region, int x, int y);
+
+/**
+ * Function: crop
+ * --------------
+ * Crop the image to the w x h rectangle with its top left corner at (x, y)
+ * 
+ * Parameters:
+ *  Image *im: the image to be cropped
+ *  int x: column of the top left corner of the rectangle
+ *  int y: row of the top left corner of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ * Return:
+ *  void (image itself is already modified since it is a pointer)
+ */
+void crop(Image *im, int x, int y, int w, int h);
+
+/**
+ * Function: to_gray
+ * -----------------
+ * The grayscale intensities of an image (as grayscale() computes them), one sample per
+ * pixel
+ *
+ * Parameters:
+ *  const Image *im: the image
+ * Return:
+ *  GrayImage *: the intensities, NULL on a bad image pointer or allocation failure
+ */
+GrayImage *to_gray(const Image *im);
+
+/**
+ * Function: edges_gray
+ * --------------------
+ * The result of edges() as a gray image, produced directly at one sample per pixel
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  double threshold: the gradient magnitude from which a point is an edge
+ * Return:
+ *  GrayImage *: the edges, NULL on a bad image pointer or allocation failure
+ */
+GrayImage *edges_gray(const Image *im, double threshold);
+
+/**
+ * Function: gray_to_rgb
+ * ---------------------
+ * Expand a gray image to an RGB image with three equal channels
+ *
+ * Parameters:
+ *  const GrayImage *gray: the gray image
+ * Return:
+ *  Image *: the RGB image, NULL on a bad image pointer or allocation failure
+ */
+Image *gray_to_rgb(const GrayImage *gray);
+
+/**
+ * Function: edges_binary
+ * ----------------------
+ * The edge points of edges() as a binary image, produced directly at one bit per
+ * pixel (edges are black); the boundary points, which edges() leaves gray, are white
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  double threshold: the gradient magnitude from which a point is an edge
+ * Return:
+ *  BinaryImage *: the edges, NULL on a bad image pointer or allocation failure
+ */
+BinaryImage *edges_binary(const Image *im, double threshold);
+
+/**
+ * Function: to_binary
+ * -------------------
+ * Threshold the grayscale intensities of an image at half of maxval into a binary
+ * image (darker pixels are black)
+ *
+ * Parameters:
+ *  const Image *im: the image
+ * Return:
+ *  BinaryImage *: the binary image, NULL on a bad image pointer or allocation failure
+ */
+BinaryImage *to_binary(const Image *im);
+
+/**
+ * Function: image_view
+ * --------------------
+ * A view of a whole image
+ *
+ * Parameters:
+ *  const Image *im: the image (its pixels are writable through the view)
+ * Return:
+ *  the view
+ */
+ImageView image_view(const Image *im);
+
+/**
+ * Function: view_region
+ * ---------------------
+ * A view of the w x h rectangle at (x, y) of another view; no pixels are copied
+ *
+ * Parameters:
+ *  const ImageView *v: the view to look into
+ *  int x: column of the top left corner of the rectangle
+ *  int y: row of the top left corner of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  ImageView *region: receives the view of the rectangle
+ * Return:
+ *  IMGPROC_OK, or IMGPROC_BAD_ARGUMENT if the rectangle does not fit in the view
+ */
+int view_region(const ImageView *v, int x, int y, int w, int h, ImageView *region);
+
+/**
+ * Function: imgproc_grayscale
+ * ---------------------------
+ * Write the grayscale version of src into dst (same size and depth; dst may be src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_grayscale(const ImageView *src, ImageView *dst);
+
+/**
+ * Function: imgproc_swap
+ * ----------------------
+ * Write src with its channels rotated as by swap() into dst (same size and depth; dst
+ * may be src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_swap(const ImageView *src, ImageView *dst);
+
+/**
+ * Function: imgproc_invert
+ * ------------------------
+ * Write the inverse of src into dst (same size and depth; dst may be src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_invert(const ImageView *src, ImageView *dst);
+
+/**
+ * Function: imgproc_zoom_out
+ * --------------------------
+ * Write src zoomed out by a factor of 2 into dst (src->rows / 2 x src->cols / 2, same
+ * depth, not overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_zoom_out(const ImageView *src, ImageView *dst);
+
+/**
+ * Function: imgproc_rotate_right
+ * ------------------------------
+ * Write src rotated clockwise by 90 degrees into dst (src->cols x src->rows, same depth,
+ * not overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_rotate_right(const ImageView *src, ImageView *dst);
+
+/**
+ * Function: imgproc_swirl
+ * -----------------------
+ * Write src swirled around (cx, cy) into dst (same size and depth, not overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ *  double cx: the x coordinate of the center of the swirl
+ *  double cy: the y coordinate of the center of the swirl
+ *  double s: the strength of the swirl
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_swirl(const ImageView *src, ImageView *dst, double cx, double cy, double s);
+
+/**
+ * Function: imgproc_edges
+ * -----------------------
+ * Write the edges of src as found by edges() into dst (same size and depth, not
+ * overlapping src)
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ *  double threshold: the gradient magnitude from which a point is an edge
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_edges(const ImageView *src, ImageView *dst, double threshold);
+
+/**
+ * Function: imgproc_copy
+ * ----------------------
+ * Copy src into dst (same size and depth, not overlapping src); with view_region this
+ * crops, pastes and moves rectangles between images
+ *
+ * Parameters:
+ *  const ImageView *src: the source pixels
+ *  ImageView *dst: the destination pixels
+ * Return:
+ *  IMGPROC_OK or the IMGPROC_ error code
+ */
+int imgproc_copy(const ImageView *src, ImageView *dst);
+
 // End of header file
 #endif
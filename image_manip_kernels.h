@@ -0,0 +1,238 @@
+/**
+ * @file image_manip_kernels.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Sample-type generic bodies of the image manipulation kernels
+ *
+ * This file is included once per sample type by image_manip.c, which defines
+ *  SAMPLE: the sample type (unsigned char or unsigned short)
+ *  PIXEL: the pixel type (Pixel or Pixel16)
+ *  GRAY(p): the grayscale intensity of a PIXEL pointer
+ *  KERNEL(name): the name of the specialized kernel
+ * so each kernel is compiled separately for 8 and 16 bit images and the 8 bit
+ * loops carry no per-pixel depth checks. The kernels read a source view and write
+ * a destination view whose sizes the public functions in image_manip.c have already
+ * checked; they neither allocate nor print.
+ */
+
+// Pointer to row r of a view
+#define ROW(v, r) ((PIXEL *)((unsigned char *)(v)->data + (size_t)(r) * (v)->stride))
+
+// Convert every pixel to its grayscale intensity (dst may be src)
+static void KERNEL(grayscale)(const ImageView *src, ImageView *dst) {
+  // Loop through each pixel and convert to grayscale
+  for (int r = 0; r < src->rows; r++) {
+    const PIXEL *in = ROW(src, r);
+    PIXEL *out = ROW(dst, r);
+    for (int c = 0; c < src->cols; c++) {
+      // Get the grayscale intensity of the pixel
+      SAMPLE grayLevel = GRAY(&in[c]);
+      // Adjust the pixel to be grayscale
+      out[c].r = grayLevel;
+      out[c].g = grayLevel;
+      out[c].b = grayLevel;
+    }
+  }
+}
+
+// Rotate the color channels of every pixel (dst may be src)
+static void KERNEL(swap)(const ImageView *src, ImageView *dst) {
+  // Loop through each pixel and swap the color channels
+  for (int r = 0; r < src->rows; r++){
+    const PIXEL *in = ROW(src, r);
+    PIXEL *out = ROW(dst, r);
+    for (int c = 0; c < src->cols; c++){
+      // Swap green to red, swap blue to green, swap red to blue
+      SAMPLE temp = in[c].r;
+      out[c].r = in[c].g;
+      out[c].g = in[c].b;
+      out[c].b = temp;
+    }
+  }
+}
+
+// Invert every sample against the maximum value of the image (dst may be src)
+static void KERNEL(invert)(const ImageView *src, ImageView *dst) {
+  const SAMPLE maxval = (SAMPLE)src->maxval;
+
+  // Loop through each pixel and invert the color channels
+  for (int r = 0; r < src->rows; r++){
+    const PIXEL *in = ROW(src, r);
+    PIXEL *out = ROW(dst, r);
+    for (int c = 0; c < src->cols; c++){
+      // Invert the color channels by subtracting its value from the maximum value
+      out[c].r = maxval - in[c].r;
+      out[c].g = maxval - in[c].g;
+      out[c].b = maxval - in[c].b;
+    }
+  }
+}
+
+// Average every 2x2 block into a view of half the size
+static void KERNEL(zoom_out)(const ImageView *src, ImageView *dst) {
+  // Loop through each pixel in the new image
+  for (int r = 0; r < dst->rows; r++) {
+    const PIXEL *top = ROW(src, 2 * r);
+    const PIXEL *bottom = ROW(src, 2 * r + 1);
+    PIXEL *out = ROW(dst, r);
+    for (int c = 0; c < dst->cols; c++) {
+      // Get the average of the four pixels in the original image
+      SAMPLE avgR = (top[2*c].r + top[2*c+1].r + bottom[2*c].r + bottom[2*c+1].r) / 4;
+      SAMPLE avgG = (top[2*c].g + top[2*c+1].g + bottom[2*c].g + bottom[2*c+1].g) / 4;
+      SAMPLE avgB = (top[2*c].b + top[2*c+1].b + bottom[2*c].b + bottom[2*c+1].b) / 4;
+      // Set the pixel in the new image to the average of the four pixels
+      out[c].r = avgR;
+      out[c].g = avgG;
+      out[c].b = avgB;
+    }
+  }
+}
+
+// Rotate clockwise by 90 degrees into a view with swapped dimensions
+static void KERNEL(rotate_right)(const ImageView *src, ImageView *dst) {
+  // Loop through each pixel and rotate the image clockwise by 90 degrees
+  for (int r = 0; r < src->rows; r++){
+    const PIXEL *in = ROW(src, r);
+    for (int c = 0; c < src->cols; c++){
+      // Use a loop to assign each new pixel value using the corresponding cell in the original image.
+      ROW(dst, c)[dst->cols-1-r] = in[c];
+    }
+  }
+}
+
+// Swirl around (cx, cy) into a view of the same size
+static void KERNEL(swirl)(const ImageView *src, ImageView *dst, double cx, double cy, double s) {
+  // Loop through each pixel and swirl the image
+  for (int r = 0; r < src->rows; r++){
+    PIXEL *out = ROW(dst, r);
+    for (int c = 0; c < src->cols; c++){
+      // Then, you use a loop to assign each new pixel value using the corresponding cell in the original image.
+      int newR, newC;
+      swirl_source(r, c, cx, cy, s, &newR, &newC);
+      // Check if the new coordinates are out of bounds
+      if (newC < 0 || newC >= src->cols || newR < 0 || newR >= src->rows) {
+        out[c].r = 0;
+        out[c].g = 0;
+        out[c].b = 0;
+      } else {
+        out[c] = ROW(src, newR)[newC];
+      }
+    }
+  }
+}
+
+// Classify one pixel as edge (0) or not (maxval) by thresholding the gradient
+// magnitude of the grayscale intensities; boundary points keep their intensity
+static SAMPLE KERNEL(edge_at)(const ImageView *src, int r, int c, double threshold) {
+  const PIXEL *in = ROW(src, r);
+
+  //edges
+  if(r == 0 || c == 0 || r == src->rows-1 || c == src->cols-1){
+    return GRAY(&in[c]);
+  }
+
+  // gradient x = (I(x + 1, y) - I(x - 1, y)) / 2
+  // gradient y = (I(x, y + 1) - I(x, y - 1)) / 2
+  // gradient magnitude = sqrt(gradient x^2 + gradient y^2)
+
+  int intensityAt1Up, intensityAt1Down, intensityAt1Left, intensityAt1Right;
+
+  intensityAt1Up = GRAY(&ROW(src, r-1)[c]);
+  intensityAt1Down = GRAY(&ROW(src, r+1)[c]);
+  intensityAt1Left = GRAY(&in[c-1]);
+  intensityAt1Right = GRAY(&in[c+1]);
+
+
+  double gradientX = (double)(intensityAt1Left - intensityAt1Right) / 2;
+  double gradientY = (double)(intensityAt1Up - intensityAt1Down) / 2;
+  double gradientMagnitude = sqrt(pow(gradientX, 2) + pow(gradientY, 2));
+  // Threshold each pixel and classify it as an edge or not an edge
+  // Set the values of all channels to 0 (black) if the magnitude exceeds the threshold, else set the values to the maximum (white)
+  return gradientMagnitude < threshold ? (SAMPLE)src->maxval : 0;
+}
+
+// Threshold the gradient magnitude of the grayscale intensities into a view of the
+// same size
+static void KERNEL(edges)(const ImageView *src, ImageView *dst, double threshold) {
+  // Compute the intensity gradient for each interior point (i.e. points not on the boundary) of the image in both the horizontal (x) and vertical (y) directions
+  for (int r = 0; r < src->rows; r++){
+    PIXEL *out = ROW(dst, r);
+    for (int c = 0; c < src->cols; c++){
+      SAMPLE value = KERNEL(edge_at)(src, r, c, threshold);
+      out[c].r = value;
+      out[c].g = value;
+      out[c].b = value;
+    }
+  }
+}
+
+// Like edges, into one sample per pixel (rows of src->cols samples)
+static void KERNEL(edges_gray)(const ImageView *src, SAMPLE *dst, double threshold) {
+  for (int r = 0; r < src->rows; r++){
+    SAMPLE *out = dst + (size_t)r * src->cols;
+    for (int c = 0; c < src->cols; c++){
+      out[c] = KERNEL(edge_at)(src, r, c, threshold);
+    }
+  }
+}
+
+// Set the bits of the edge points of one interior row in a packed binary row, from
+// columns c0 on, given the grayscale intensities of the row and the rows around it:
+// a point is an edge of edges() exactly when dx^2 + dy^2 of its central differences
+// reaches limit. The boundary columns are never set.
+static void KERNEL(edge_bits)(const SAMPLE *up, const SAMPLE *mid, const SAMPLE *down, int c0, int cols,
+                              long long limit, unsigned char *out) {
+  for (int c = c0 > 1 ? c0 : 1; c < cols - 1; c++) {
+    long long dx = (long long)mid[c-1] - mid[c+1], dy = (long long)up[c] - down[c];
+    if (dx * dx + dy * dy >= limit) {
+      out[c >> 3] |= (unsigned char)(0x80 >> (c & 7));
+    }
+  }
+}
+
+// Threshold the grayscale intensities at half of maxval into a packed binary image
+// (rows stride bytes apart, cleared by the caller): darker pixels are set (black)
+static void KERNEL(to_binary)(const ImageView *src, unsigned char *bits, size_t stride) {
+  for (int r = 0; r < src->rows; r++) {
+    const PIXEL *in = ROW(src, r);
+    unsigned char *out = bits + (size_t)r * stride;
+    for (int c = 0; c < src->cols; c++) {
+      if (2 * (long)GRAY(&in[c]) <= src->maxval) {
+        out[c >> 3] |= (unsigned char)(0x80 >> (c & 7));
+      }
+    }
+  }
+}
+
+// Like grayscale, into one sample per pixel (rows of src->cols samples)
+static void KERNEL(to_gray)(const ImageView *src, SAMPLE *dst) {
+  for (int r = 0; r < src->rows; r++) {
+    const PIXEL *in = ROW(src, r);
+    SAMPLE *out = dst + (size_t)r * src->cols;
+    for (int c = 0; c < src->cols; c++) {
+      out[c] = GRAY(&in[c]);
+    }
+  }
+}
+
+// Spread one sample per pixel (rows of dst->cols samples) over the three channels
+static void KERNEL(from_gray)(const SAMPLE *src, ImageView *dst) {
+  for (int r = 0; r < dst->rows; r++) {
+    const SAMPLE *in = src + (size_t)r * dst->cols;
+    PIXEL *out = ROW(dst, r);
+    for (int c = 0; c < dst->cols; c++) {
+      out[c].r = in[c];
+      out[c].g = in[c];
+      out[c].b = in[c];
+    }
+  }
+}
+
+// Copy a view into another one of the same size
+static void KERNEL(copy)(const ImageView *src, ImageView *dst) {
+  // Copy one contiguous row span at a time
+  for (int r = 0; r < src->rows; r++) {
+    memcpy(ROW(dst, r), ROW(src, r), sizeof(PIXEL) * src->cols);
+  }
+}
+
+#undef ROW
@@ -2,7 +2,7 @@
 #include <stdlib.h>
 #include "ppm_io.h"
 
-int check_color(unsigned char c1, unsigned c2, int max_delta) {
+int check_color(unsigned c1, unsigned c2, int max_delta) {
 	int diff = abs((int)c1 - (int)c2);
 	return diff <= max_delta;
 }
@@ -13,6 +13,12 @@ int check_pixels(Pixel p1, Pixel p2, int max_delta) {
 		&& check_color(p1.b, p2.b, max_delta);
 }
 
+int check_pixels16(Pixel16 p1, Pixel16 p2, int max_delta) {
+	return check_color(p1.r, p2.r, max_delta)
+		&& check_color(p1.g, p2.g, max_delta)
+		&& check_color(p1.b, p2.b, max_delta);
+}
+
 int main(int argc, char **argv) {
 	if (argc != 4) {
 		printf("Usage: %s <max delta> <file1> <file2>\n", argv[0]);
@@ -54,6 +60,13 @@ int main(int argc, char **argv) {
 	fclose(fp1);
 	fclose(fp2);
 
+	if (IS_16BIT(im1) != IS_16BIT(im2)) {
+		free_image(&im1);
+		free_image(&im2);
+		printf("Image sample depths differ\n");
+		return 1;
+	}
+
 	if (im1->cols != im2->cols || im1->rows != im2->rows) {
 		free_image(&im1);
 		free_image(&im2);
@@ -66,9 +79,9 @@ int main(int argc, char **argv) {
 	int mismatched = 0;
 	int num_pixels = im1->cols * im1->rows;
 	for (int i = 0; i < num_pixels; i++) {
-		Pixel p1 = im1->data[i];
-		Pixel p2 = im2->data[i];
-		if (!check_pixels(p1, p2, max_delta)) {
+		int match = IS_16BIT(im1) ? check_pixels16(im1->data16[i], im2->data16[i], max_delta)
+			: check_pixels(im1->data[i], im2->data[i], max_delta);
+		if (!match) {
 			mismatched++;
 		}
 	}
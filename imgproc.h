@@ -0,0 +1,40 @@
+/**
+ * @file imgproc.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for programs linking against libimgproc
+ *
+ * The library holds every module of the project except the command line front end.
+ * The imgproc_ functions of image_manip.h are its reentrant interface: they read a
+ * caller provided source view, write a caller provided destination view (either may
+ * be a strided window into a larger buffer), return an IMGPROC_ code and never
+ * allocate or print, so any number of threads may call them at once. The Image based
+ * functions are convenience wrappers that allocate the result and report errors on
+ * stderr.
+ */
+
+// If not defined, define IMGPROC_H
+#ifndef IMGPROC_H
+#define IMGPROC_H
+
+// Include header files
+#include "ppm_io.h"
+#include "image_manip.h"
+#include "histogram.h"
+#include "integral.h"
+#include "convolve.h"
+#include "canny.h"
+#include "resize.h"
+#include "morphology.h"
+#include "median.h"
+#include "components.h"
+#include "phash.h"
+#include "rotate.h"
+#include "point_ops.h"
+#include "tiled.h"
+#include "incremental.h"
+#include "stream.h"
+#include "ppz_io.h"
+#include "result_cache.h"
+
+// End of header file
+#endif
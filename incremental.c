@@ -0,0 +1,554 @@
+/**
+ * @file incremental.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Reprocessing only the changed tiles of successive frames
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "incremental.h"
+#include "image_manip.h"
+#include "parallel.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// A run of changed tiles in one row of tiles, columns [tc0, tc1)
+typedef struct _tile_run {
+  int tr;
+  int tc0;
+  int tc1;
+} TileRun;
+
+// Shared state of diff_tiles and copy_tiles, which work on bands of tile rows
+typedef struct _tile_job {
+  ImageView a;
+  ImageView b;
+  int maxDelta;
+  int tcols;
+  unsigned char *changed;
+  const unsigned char *mask;
+} TileJob;
+
+// Shared state of update_tiles, which works on bands of runs
+typedef struct _update_job {
+  Image *out;
+  const Image *in;
+  const TileRun *runs;
+  int rx;
+  int ry;
+  region_fn fn;
+  void *ctx;
+  int failed;
+} UpdateJob;
+
+/**
+ * Function: tile_count
+ * --------------------
+ * Number of tiles along a side of an image
+ *
+ * Parameters:
+ *  int pixels: number of rows or columns
+ * Returns:
+ *  the number of tiles
+ */
+int tile_count(int pixels) {
+  return (pixels + INCREMENTAL_TILE - 1) / INCREMENTAL_TILE;
+}
+
+/**
+ * Function: bytes_differ
+ * ----------------------
+ * Whether two runs of 8 bit samples differ by more than a delta anywhere
+ *
+ * Parameters:
+ *  const unsigned char *a: one run
+ *  const unsigned char *b: the other run
+ *  size_t n: number of samples
+ *  int maxDelta: largest difference that is not a change (0 to 255)
+ * Returns:
+ *  1 if they differ, 0 otherwise
+ */
+static int bytes_differ(const unsigned char *a, const unsigned char *b, size_t n, int maxDelta) {
+  size_t i = 0;
+#ifdef __SSE2__
+  // |a - b| is the larger of the two saturated differences; it is above the delta
+  // where subtracting the delta (saturated) leaves something
+  const __m128i limit = _mm_set1_epi8((char)maxDelta);
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(a + i));
+    __m128i y = _mm_loadu_si128((const __m128i *)(b + i));
+    __m128i d = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(d, limit), zero)) != 0xFFFF) {
+      return 1;
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    if (abs(a[i] - b[i]) > maxDelta) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Function: samples_differ
+ * ------------------------
+ * Whether two runs of 16 bit samples differ by more than a delta anywhere
+ *
+ * Parameters:
+ *  const unsigned short *a: one run
+ *  const unsigned short *b: the other run
+ *  size_t n: number of samples
+ *  int maxDelta: largest difference that is not a change
+ * Returns:
+ *  1 if they differ, 0 otherwise
+ */
+static int samples_differ(const unsigned short *a, const unsigned short *b, size_t n, int maxDelta) {
+  for (size_t i = 0; i < n; i++) {
+    if (abs(a[i] - b[i]) > maxDelta) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Function: diff_band
+ * -------------------
+ * Compare the tiles of one band of tile rows, row by row of pixels; a tile is no
+ * longer compared once it is known to have changed
+ *
+ * Parameters:
+ *  void *ctx: the TileJob
+ *  int band: index of the band (unused)
+ *  int t0: first tile row of the band
+ *  int t1: one past the last tile row of the band
+ * Returns:
+ *  void
+ */
+static void diff_band(void *ctx, int band, int t0, int t1) {
+  (void)band;
+  TileJob *job = ctx;
+  int is16 = IS_16BIT(&job->a);
+  size_t pixelSize = is16 ? sizeof(Pixel16) : sizeof(Pixel);
+  for (int tr = t0; tr < t1; tr++) {
+    unsigned char *changed = job->changed + (size_t)tr * job->tcols;
+    memset(changed, 0, job->tcols);
+    int r1 = (tr + 1) * INCREMENTAL_TILE < job->a.rows ? (tr + 1) * INCREMENTAL_TILE : job->a.rows;
+    for (int r = tr * INCREMENTAL_TILE; r < r1; r++) {
+      const unsigned char *rowA = (const unsigned char *)job->a.data + (size_t)r * job->a.stride;
+      const unsigned char *rowB = (const unsigned char *)job->b.data + (size_t)r * job->b.stride;
+      for (int tc = 0; tc < job->tcols; tc++) {
+        if (changed[tc]) {
+          continue;
+        }
+        int c0 = tc * INCREMENTAL_TILE;
+        int width = job->a.cols - c0 < INCREMENTAL_TILE ? job->a.cols - c0 : INCREMENTAL_TILE;
+        size_t offset = (size_t)c0 * pixelSize, n = (size_t)width * 3;
+        changed[tc] = is16 ? samples_differ((const unsigned short *)(rowA + offset), (const unsigned short *)(rowB + offset), n, job->maxDelta)
+                           : bytes_differ(rowA + offset, rowB + offset, n, job->maxDelta);
+      }
+    }
+  }
+}
+
+/**
+ * Function: diff_tiles
+ * --------------------
+ * Find the tiles of an image that changed by more than a delta since an earlier one;
+ * the tiles are compared on several threads, 16 bytes at a time where SSE2 is
+ * available
+ *
+ * Parameters:
+ *  const Image *prev: the earlier image
+ *  const Image *cur: the image (same size and depth)
+ *  int maxDelta: largest difference of a sample that is not a change
+ *  unsigned char *changed: receives the tile mask
+ * Returns:
+ *  the number of changed tiles, -1 if the images do not match in size or depth
+ */
+int diff_tiles(const Image *prev, const Image *cur, int maxDelta, unsigned char *changed) {
+  // Error check
+  if (!prev || !cur || !changed || prev->rows != cur->rows || prev->cols != cur->cols ||
+      IS_16BIT(prev) != IS_16BIT(cur) || maxDelta < 0) {
+    fprintf(stderr, "Error:incremental - diff_tiles given mismatched images\n");
+    return -1;
+  }
+
+  TileJob job;
+  job.a = image_view(prev);
+  job.b = image_view(cur);
+  // A delta of a whole sample range never changes anything
+  job.maxDelta = !IS_16BIT(prev) && maxDelta > 255 ? 255 : maxDelta;
+  job.tcols = tile_count(prev->cols);
+  job.changed = changed;
+  job.mask = NULL;
+  int trows = tile_count(prev->rows);
+  parallel_for_range(trows, 1, diff_band, &job);
+
+  int count = 0;
+  for (size_t t = 0; t < (size_t)trows * job.tcols; t++) {
+    count += changed[t];
+  }
+  return count;
+}
+
+/**
+ * Function: copy_band
+ * -------------------
+ * Copy the masked tiles of one band of tile rows
+ *
+ * Parameters:
+ *  void *ctx: the TileJob (a is the destination, b the source)
+ *  int band: index of the band (unused)
+ *  int t0: first tile row of the band
+ *  int t1: one past the last tile row of the band
+ * Returns:
+ *  void
+ */
+static void copy_band(void *ctx, int band, int t0, int t1) {
+  (void)band;
+  TileJob *job = ctx;
+  size_t pixelSize = IS_16BIT(&job->a) ? sizeof(Pixel16) : sizeof(Pixel);
+  for (int tr = t0; tr < t1; tr++) {
+    const unsigned char *mask = job->mask + (size_t)tr * job->tcols;
+    int r1 = (tr + 1) * INCREMENTAL_TILE < job->a.rows ? (tr + 1) * INCREMENTAL_TILE : job->a.rows;
+    for (int tc = 0; tc < job->tcols; tc++) {
+      if (!mask[tc]) {
+        continue;
+      }
+      // Neighboring marked tiles are copied together
+      int tc1 = tc + 1;
+      while (tc1 < job->tcols && mask[tc1]) {
+        tc1++;
+      }
+      int c0 = tc * INCREMENTAL_TILE;
+      int c1 = tc1 * INCREMENTAL_TILE < job->a.cols ? tc1 * INCREMENTAL_TILE : job->a.cols;
+      for (int r = tr * INCREMENTAL_TILE; r < r1; r++) {
+        memcpy((unsigned char *)job->a.data + (size_t)r * job->a.stride + c0 * pixelSize,
+               (const unsigned char *)job->b.data + (size_t)r * job->b.stride + c0 * pixelSize, (size_t)(c1 - c0) * pixelSize);
+      }
+      tc = tc1;
+    }
+  }
+}
+
+/**
+ * Function: copy_tiles
+ * --------------------
+ * Copy the tiles of a mask from one image to another of the same size and depth
+ *
+ * Parameters:
+ *  Image *dst: the image to copy to
+ *  const Image *src: the image to copy from
+ *  const unsigned char *changed: the tile mask
+ * Returns:
+ *  void
+ */
+void copy_tiles(Image *dst, const Image *src, const unsigned char *changed) {
+  // Error check
+  if (!dst || !src || !changed || dst->rows != src->rows || dst->cols != src->cols || IS_16BIT(dst) != IS_16BIT(src)) {
+    fprintf(stderr, "Error:incremental - copy_tiles given mismatched images\n");
+    return;
+  }
+
+  TileJob job;
+  job.a = image_view(dst);
+  job.b = image_view(src);
+  job.maxDelta = 0;
+  job.tcols = tile_count(dst->cols);
+  job.changed = NULL;
+  job.mask = changed;
+  parallel_for_range(tile_count(dst->rows), 1, copy_band, &job);
+}
+
+/**
+ * Function: grow_tiles
+ * --------------------
+ * Mark the tiles an operation with the given radii changes when the tiles of a mask
+ * of its input change: the tiles within rx columns and ry rows of a changed one
+ *
+ * Parameters:
+ *  const unsigned char *changed: the tile mask of the input
+ *  unsigned char *grown: receives the tile mask of the output (not changed)
+ *  int rows: number of rows of the image
+ *  int cols: number of columns of the image
+ *  int rx: horizontal radius of the operation in pixels
+ *  int ry: vertical radius of the operation in pixels
+ * Returns:
+ *  the number of tiles marked in grown
+ */
+int grow_tiles(const unsigned char *changed, unsigned char *grown, int rows, int cols, int rx, int ry) {
+  int trows = tile_count(rows), tcols = tile_count(cols);
+  // A radius reaches into the tiles it overlaps, whole or in part
+  int gx = tile_count(rx), gy = tile_count(ry);
+  memset(grown, 0, (size_t)trows * tcols);
+  for (int tr = 0; tr < trows; tr++) {
+    for (int tc = 0; tc < tcols; tc++) {
+      if (!changed[(size_t)tr * tcols + tc]) {
+        continue;
+      }
+      int r0 = tr - gy < 0 ? 0 : tr - gy, r1 = tr + gy >= trows ? trows - 1 : tr + gy;
+      int c0 = tc - gx < 0 ? 0 : tc - gx, c1 = tc + gx >= tcols ? tcols - 1 : tc + gx;
+      for (int r = r0; r <= r1; r++) {
+        memset(grown + (size_t)r * tcols + c0, 1, c1 - c0 + 1);
+      }
+    }
+  }
+
+  int count = 0;
+  for (size_t t = 0; t < (size_t)trows * tcols; t++) {
+    count += grown[t];
+  }
+  return count;
+}
+
+/**
+ * Function: update_band
+ * ---------------------
+ * Compute one band of runs of changed tiles again
+ *
+ * Parameters:
+ *  void *ctx: the UpdateJob
+ *  int band: index of the band (unused)
+ *  int i0: first run of the band
+ *  int i1: one past the last run of the band
+ * Returns:
+ *  void
+ */
+static void update_band(void *ctx, int band, int i0, int i1) {
+  (void)band;
+  UpdateJob *job = ctx;
+  int rows = job->in->rows, cols = job->in->cols;
+  for (int i = i0; i < i1 && !job->failed; i++) {
+    const TileRun *run = &job->runs[i];
+    int x0 = run->tc0 * INCREMENTAL_TILE, x1 = run->tc1 * INCREMENTAL_TILE < cols ? run->tc1 * INCREMENTAL_TILE : cols;
+    int y0 = run->tr * INCREMENTAL_TILE, y1 = y0 + INCREMENTAL_TILE < rows ? y0 + INCREMENTAL_TILE : rows;
+    // The halo, cut off at the edges of the image
+    int hx0 = x0 - job->rx < 0 ? 0 : x0 - job->rx, hx1 = x1 + job->rx > cols ? cols : x1 + job->rx;
+    int hy0 = y0 - job->ry < 0 ? 0 : y0 - job->ry, hy1 = y1 + job->ry > rows ? rows : y1 + job->ry;
+
+    Image *region = copy_region(job->in, hx0, hy0, hx1 - hx0, hy1 - hy0);
+    if (!region) {
+      job->failed = 1;
+      return;
+    }
+    if (job->fn(region, job->ctx) != 0 || region->rows != hy1 - hy0 || region->cols != hx1 - hx0) {
+      free_image(&region);
+      job->failed = 1;
+      return;
+    }
+    ImageView whole = image_view(region), wholeOut = image_view(job->out), src, dst;
+    view_region(&whole, x0 - hx0, y0 - hy0, x1 - x0, y1 - y0, &src);
+    view_region(&wholeOut, x0, y0, x1 - x0, y1 - y0, &dst);
+    imgproc_copy(&src, &dst);
+    free_image(&region);
+  }
+}
+
+/**
+ * Function: update_tiles
+ * ----------------------
+ * Compute the tiles of a mask again: each run of changed tiles in a row of tiles is
+ * copied out of the input with a halo of rx columns and ry rows (less at the edges of
+ * the image), fn is run on the copy and its part inside the run goes to the output.
+ * An operation that reads no farther than its radii and treats the edges of the image
+ * as the edges of the copy gives the same result as on the whole input. The runs are
+ * processed on several threads.
+ *
+ * Parameters:
+ *  Image *out: the result kept from the previous frame, updated
+ *  const Image *in: the input (same size and depth)
+ *  const unsigned char *changed: the tile mask of the output
+ *  int rx: horizontal radius of the operation
+ *  int ry: vertical radius of the operation
+ *  region_fn fn: the operation
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  -1: mismatched images, allocation failure or failure of fn
+ *  0: success
+ */
+int update_tiles(Image *out, const Image *in, const unsigned char *changed, int rx, int ry, region_fn fn, void *ctx) {
+  // Error check
+  if (!out || !in || !changed || !fn || out->rows != in->rows || out->cols != in->cols ||
+      IS_16BIT(out) != IS_16BIT(in) || rx < 0 || ry < 0) {
+    fprintf(stderr, "Error:incremental - update_tiles given mismatched images\n");
+    return -1;
+  }
+
+  // Gather the runs of changed tiles, at most one per two tiles
+  int trows = tile_count(in->rows), tcols = tile_count(in->cols);
+  TileRun *runs = malloc(sizeof(TileRun) * ((size_t)trows * ((tcols + 1) / 2)));
+  if (!runs) {
+    fprintf(stderr, "Error:incremental - update_tiles failed to allocate memory\n");
+    return -1;
+  }
+  int nruns = 0;
+  for (int tr = 0; tr < trows; tr++) {
+    const unsigned char *row = changed + (size_t)tr * tcols;
+    for (int tc = 0; tc < tcols; tc++) {
+      if (row[tc]) {
+        runs[nruns].tr = tr;
+        runs[nruns].tc0 = tc;
+        while (tc < tcols && row[tc]) {
+          tc++;
+        }
+        runs[nruns++].tc1 = tc;
+      }
+    }
+  }
+
+  UpdateJob job = { out, in, runs, rx, ry, fn, ctx, 0 };
+  parallel_for_range(nruns, 1, update_band, &job);
+  free(runs);
+  if (job.failed) {
+    fprintf(stderr, "Error:incremental - update_tiles failed to compute a region\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Function: make_remap
+ * --------------------
+ * Group the pixels of a mapping by the tile of their source
+ *
+ * Parameters:
+ *  int rows: number of rows of the images
+ *  int cols: number of columns of the images
+ *  int *sources: rows x cols sources as described in Remap, malloc'ed; the remap
+ *                takes it over (and frees it if it cannot be made)
+ * Returns:
+ *  Remap *: the remap, NULL on bad arguments or allocation failure
+ */
+Remap *make_remap(int rows, int cols, int *sources) {
+  // Error check
+  if (!sources || rows <= 0 || cols <= 0 || (size_t)rows * cols > INT_MAX) {
+    fprintf(stderr, "Error:incremental - make_remap given bad dimensions\n");
+    free(sources);
+    return NULL;
+  }
+
+  Remap *map = malloc(sizeof(Remap));
+  int trows = tile_count(rows), tcols = tile_count(cols), pixels = rows * cols;
+  int *next = malloc(sizeof(int) * ((size_t)trows * tcols));
+  if (!map || !next) {
+    fprintf(stderr, "Error:incremental - make_remap failed to allocate memory\n");
+    free(map);
+    free(next);
+    free(sources);
+    return NULL;
+  }
+  map->rows = rows;
+  map->cols = cols;
+  map->trows = trows;
+  map->tcols = tcols;
+  map->sources = sources;
+  map->starts = calloc((size_t)trows * tcols + 1, sizeof(int));
+  map->order = NULL;
+
+  // Count the pixels coming from each tile, then place them by counting sort
+  int mapped = 0;
+  if (map->starts) {
+    for (int p = 0; p < pixels; p++) {
+      if (sources[p] >= 0) {
+        int s = sources[p];
+        map->starts[(s / cols / INCREMENTAL_TILE) * tcols + (s % cols) / INCREMENTAL_TILE + 1]++;
+        mapped++;
+      }
+    }
+    map->order = malloc(sizeof(int) * (mapped > 0 ? mapped : 1));
+  }
+  if (!map->order) {
+    fprintf(stderr, "Error:incremental - make_remap failed to allocate memory\n");
+    free(next);
+    free_remap(&map);
+    return NULL;
+  }
+  for (int t = 0; t < trows * tcols; t++) {
+    map->starts[t + 1] += map->starts[t];
+    next[t] = map->starts[t];
+  }
+  for (int p = 0; p < pixels; p++) {
+    if (sources[p] >= 0) {
+      int s = sources[p];
+      map->order[next[(s / cols / INCREMENTAL_TILE) * tcols + (s % cols) / INCREMENTAL_TILE]++] = p;
+    }
+  }
+  free(next);
+  return map;
+}
+
+/**
+ * Function: remap_tiles
+ * ---------------------
+ * Bring an output image up to date with the changed tiles of its input: every pixel
+ * whose source is in a changed tile is copied again
+ *
+ * Parameters:
+ *  const Remap *map: the mapping
+ *  const Image *in: the input
+ *  Image *out: the output kept from the previous frame, updated
+ *  const unsigned char *changed: the tile mask of the input
+ *  unsigned char *moved: receives the tile mask of the output
+ * Returns:
+ *  the number of tiles marked in moved, -1 if the images do not match the remap
+ */
+int remap_tiles(const Remap *map, const Image *in, Image *out, const unsigned char *changed, unsigned char *moved) {
+  // Error check
+  if (!map || !in || !out || !changed || !moved || in->rows != map->rows || in->cols != map->cols ||
+      out->rows != map->rows || out->cols != map->cols || IS_16BIT(in) != IS_16BIT(out)) {
+    fprintf(stderr, "Error:incremental - remap_tiles given mismatched images\n");
+    return -1;
+  }
+
+  int cols = map->cols, tcols = map->tcols, is16 = IS_16BIT(in);
+  memset(moved, 0, (size_t)map->trows * tcols);
+  for (int t = 0; t < map->trows * tcols; t++) {
+    if (!changed[t]) {
+      continue;
+    }
+    for (int k = map->starts[t]; k < map->starts[t + 1]; k++) {
+      int p = map->order[k];
+      if (is16) {
+        out->data16[p] = in->data16[map->sources[p]];
+      } else {
+        out->data[p] = in->data[map->sources[p]];
+      }
+      moved[(p / cols / INCREMENTAL_TILE) * tcols + (p % cols) / INCREMENTAL_TILE] = 1;
+    }
+  }
+
+  int count = 0;
+  for (int t = 0; t < map->trows * tcols; t++) {
+    count += moved[t];
+  }
+  return count;
+}
+
+/**
+ * Function: free_remap
+ * --------------------
+ * utility function to free a remap and set the pointer to null
+ *
+ * Parameters:
+ *  Remap **map: pointer to the remap to be freed
+ * Returns:
+ *  void
+ */
+void free_remap(Remap **map) {
+  if (!map || !*map) {
+    return;
+  }
+  free((*map)->sources);
+  free((*map)->order);
+  free((*map)->starts);
+  free(*map);
+  *map = NULL;
+}
@@ -0,0 +1,174 @@
+/**
+ * @file incremental.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for reprocessing only the changed tiles of successive frames
+ *
+ * Frames are compared in square tiles of INCREMENTAL_TILE pixels. A tile has changed
+ * when one of its samples differs by more than a given delta (as img_cmp compares
+ * images), and only the changed tiles of a result are computed again; everything else
+ * is kept from the previous frame. Operations that read a neighborhood of each pixel
+ * grow the changed tiles by their radius and are run on the changed rectangles plus
+ * that halo. Operations that move pixels to fixed places (swirl) follow each changed
+ * tile to the pixels it feeds through a Remap.
+ *
+ * Tile masks hold one byte per tile, row major, nonzero for a changed tile.
+ */
+
+// If not defined, define INCREMENTAL_H
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Side of a tile in pixels
+#define INCREMENTAL_TILE 32
+
+// A fixed mapping of the pixels of an output image to the pixels of an input image
+// of the same size, with the output pixels grouped by the tile of their source
+typedef struct _remap {
+  int rows;
+  int cols;
+  int trows;
+  int tcols;
+  int *sources;  // rows x cols input pixel (row * cols + column) of each output
+                 // pixel, -1 for a pixel that is always black
+  int *order;    // the output pixels that have a source, grouped by source tile
+  int *starts;   // trows * tcols + 1 offsets of the groups in order
+} Remap;
+
+// Work done on a rectangle of the input, in place; returns 0 on success. It may be
+// called on several rectangles at once from different threads.
+typedef int (*region_fn)(Image *region, void *ctx);
+
+/**
+ * Function: tile_count
+ * --------------------
+ * Number of tiles along a side of an image
+ *
+ * Parameters:
+ *  int pixels: number of rows or columns
+ * Returns:
+ *  the number of tiles
+ */
+int tile_count(int pixels);
+
+/**
+ * Function: diff_tiles
+ * --------------------
+ * Find the tiles of an image that changed by more than a delta since an earlier one;
+ * the tiles are compared on several threads, 16 bytes at a time where SSE2 is
+ * available
+ *
+ * Parameters:
+ *  const Image *prev: the earlier image
+ *  const Image *cur: the image (same size and depth)
+ *  int maxDelta: largest difference of a sample that is not a change
+ *  unsigned char *changed: receives the tile mask
+ * Returns:
+ *  the number of changed tiles, -1 if the images do not match in size or depth
+ */
+int diff_tiles(const Image *prev, const Image *cur, int maxDelta, unsigned char *changed);
+
+/**
+ * Function: copy_tiles
+ * --------------------
+ * Copy the tiles of a mask from one image to another of the same size and depth
+ *
+ * Parameters:
+ *  Image *dst: the image to copy to
+ *  const Image *src: the image to copy from
+ *  const unsigned char *changed: the tile mask
+ * Returns:
+ *  void
+ */
+void copy_tiles(Image *dst, const Image *src, const unsigned char *changed);
+
+/**
+ * Function: grow_tiles
+ * --------------------
+ * Mark the tiles an operation with the given radii changes when the tiles of a mask
+ * of its input change: the tiles within rx columns and ry rows of a changed one
+ *
+ * Parameters:
+ *  const unsigned char *changed: the tile mask of the input
+ *  unsigned char *grown: receives the tile mask of the output (not changed)
+ *  int rows: number of rows of the image
+ *  int cols: number of columns of the image
+ *  int rx: horizontal radius of the operation in pixels
+ *  int ry: vertical radius of the operation in pixels
+ * Returns:
+ *  the number of tiles marked in grown
+ */
+int grow_tiles(const unsigned char *changed, unsigned char *grown, int rows, int cols, int rx, int ry);
+
+/**
+ * Function: update_tiles
+ * ----------------------
+ * Compute the tiles of a mask again: each run of changed tiles in a row of tiles is
+ * copied out of the input with a halo of rx columns and ry rows (less at the edges of
+ * the image), fn is run on the copy and its part inside the run goes to the output.
+ * An operation that reads no farther than its radii and treats the edges of the image
+ * as the edges of the copy gives the same result as on the whole input. The runs are
+ * processed on several threads.
+ *
+ * Parameters:
+ *  Image *out: the result kept from the previous frame, updated
+ *  const Image *in: the input (same size and depth)
+ *  const unsigned char *changed: the tile mask of the output
+ *  int rx: horizontal radius of the operation
+ *  int ry: vertical radius of the operation
+ *  region_fn fn: the operation
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  -1: mismatched images, allocation failure or failure of fn
+ *  0: success
+ */
+int update_tiles(Image *out, const Image *in, const unsigned char *changed, int rx, int ry, region_fn fn, void *ctx);
+
+/**
+ * Function: make_remap
+ * --------------------
+ * Group the pixels of a mapping by the tile of their source
+ *
+ * Parameters:
+ *  int rows: number of rows of the images
+ *  int cols: number of columns of the images
+ *  int *sources: rows x cols sources as described in Remap, malloc'ed; the remap
+ *                takes it over (and frees it if it cannot be made)
+ * Returns:
+ *  Remap *: the remap, NULL on bad arguments or allocation failure
+ */
+Remap *make_remap(int rows, int cols, int *sources);
+
+/**
+ * Function: remap_tiles
+ * ---------------------
+ * Bring an output image up to date with the changed tiles of its input: every pixel
+ * whose source is in a changed tile is copied again
+ *
+ * Parameters:
+ *  const Remap *map: the mapping
+ *  const Image *in: the input
+ *  Image *out: the output kept from the previous frame, updated
+ *  const unsigned char *changed: the tile mask of the input
+ *  unsigned char *moved: receives the tile mask of the output
+ * Returns:
+ *  the number of tiles marked in moved, -1 if the images do not match the remap
+ */
+int remap_tiles(const Remap *map, const Image *in, Image *out, const unsigned char *changed, unsigned char *moved);
+
+/**
+ * Function: free_remap
+ * --------------------
+ * utility function to free a remap and set the pointer to null
+ *
+ * Parameters:
+ *  Remap **map: pointer to the remap to be freed
+ * Returns:
+ *  void
+ */
+void free_remap(Remap **map);
+
+// End of header file
+#endif
@@ -0,0 +1,303 @@
+/**
+ * @file integral.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Summed-area tables (integral images) and region statistics
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include "integral.h"
+#include "image_alloc.h"
+#include "parallel.h"
+
+// Fewest table columns (times channels) worth a thread of their own in the vertical pass
+#define INTEGRAL_MIN_ITEMS 4096
+
+// Shared state of one table build
+typedef struct _integral_job {
+  const Image *im;
+  IntegralImage *table;
+} IntegralJob;
+
+/**
+ * Function: prefix_rows
+ * ---------------------
+ * First pass of the build: every table row below row 0 receives the running sums
+ * along its image row, for a band of rows
+ *
+ * Parameters:
+ *  void *ctx: the IntegralJob
+ *  int band: index of the band (unused)
+ *  int r0: first image row of the band
+ *  int r1: one past the last image row of the band
+ * Returns:
+ *  void
+ */
+static void prefix_rows(void *ctx, int band, int r0, int r1) {
+  IntegralJob *job = ctx;
+  const Image *im = job->im;
+  size_t span = ((size_t)im->cols + 1) * 3;
+  (void)band;
+
+  for (int r = r0; r < r1; r++) {
+    unsigned long long *out = job->table->sum + (r + 1) * span;
+    unsigned long long *sq = job->table->sqsum ? job->table->sqsum + (r + 1) * span : NULL;
+    unsigned long long run[3] = { 0, 0, 0 }, runSq[3] = { 0, 0, 0 };
+    for (int i = 0; i < 3; i++) {
+      out[i] = 0;
+      if (sq) {
+        sq[i] = 0;
+      }
+    }
+    for (int c = 0; c < im->cols; c++) {
+      unsigned long long v[3];
+      if (IS_16BIT(im)) {
+        const Pixel16 *p = &im->data16[(size_t)r * im->cols + c];
+        v[0] = p->r; v[1] = p->g; v[2] = p->b;
+      } else {
+        const Pixel *p = &im->data[(size_t)r * im->cols + c];
+        v[0] = p->r; v[1] = p->g; v[2] = p->b;
+      }
+      for (int i = 0; i < 3; i++) {
+        run[i] += v[i];
+        out[(c + 1) * 3 + i] = run[i];
+        if (sq) {
+          runSq[i] += v[i] * v[i];
+          sq[(c + 1) * 3 + i] = runSq[i];
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Function: prefix_columns
+ * ------------------------
+ * Second pass of the build: accumulate the row sums down the table, for a range of
+ * entries of a table row (each entry is one column of one channel)
+ *
+ * Parameters:
+ *  void *ctx: the IntegralJob
+ *  int band: index of the band (unused)
+ *  int i0: first entry of the range
+ *  int i1: one past the last entry of the range
+ * Returns:
+ *  void
+ */
+static void prefix_columns(void *ctx, int band, int i0, int i1) {
+  IntegralJob *job = ctx;
+  IntegralImage *table = job->table;
+  size_t span = ((size_t)table->cols + 1) * 3;
+  (void)band;
+
+  for (int r = 2; r <= table->rows; r++) {
+    unsigned long long *out = table->sum + r * span;
+    const unsigned long long *above = out - span;
+    for (int i = i0; i < i1; i++) {
+      out[i] += above[i];
+    }
+    if (table->sqsum) {
+      out = table->sqsum + r * span;
+      above = out - span;
+      for (int i = i0; i < i1; i++) {
+        out[i] += above[i];
+      }
+    }
+  }
+}
+
+/**
+ * Function: make_integral_image
+ * -----------------------------
+ * Build the summed-area tables of an image (8 or 16 bit) on several threads
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  int squares: nonzero to also build the table of squares, which variance needs
+ * Returns:
+ *  IntegralImage *: the tables, NULL on a bad image pointer or allocation failure
+ */
+IntegralImage *make_integral_image(const Image *im, int squares) {
+  // Error check
+  if (!im || im->rows <= 0 || im->cols <= 0 || (IS_16BIT(im) ? !im->data16 : !im->data)) {
+    fprintf(stderr, "Error:integral - make_integral_image given a bad image pointer\n");
+    return NULL;
+  }
+
+  IntegralImage *table = calloc(1, sizeof(IntegralImage));
+  size_t rowBytes = ((size_t)im->cols + 1) * 3 * sizeof(unsigned long long);
+  if (table) {
+    table->rows = im->rows;
+    table->cols = im->cols;
+    table->sum = pixels_alloc(im->rows + 1, rowBytes, PIXELS_AUTO, &table->mapped, NULL);
+    if (squares) {
+      table->sqsum = pixels_alloc(im->rows + 1, rowBytes, PIXELS_AUTO, &table->sqmapped, NULL);
+    }
+  }
+  if (!table || !table->sum || (squares && !table->sqsum)) {
+    fprintf(stderr, "Error:integral - make_integral_image failed to allocate memory\n");
+    free_integral_image(&table);
+    return NULL;
+  }
+
+  // Row 0 is all zero; the rows below are filled by the two passes
+  for (size_t i = 0; i < rowBytes / sizeof(unsigned long long); i++) {
+    table->sum[i] = 0;
+    if (squares) {
+      table->sqsum[i] = 0;
+    }
+  }
+  IntegralJob job = { im, table };
+  parallel_for_bands(im->rows, prefix_rows, &job);
+  parallel_for_range((im->cols + 1) * 3, INTEGRAL_MIN_ITEMS, prefix_columns, &job);
+  return table;
+}
+
+/**
+ * Function: free_integral_image
+ * -----------------------------
+ * utility function to free summed-area tables and set the pointer to null
+ *
+ * Parameters:
+ *  IntegralImage **table: pointer to the tables to be freed
+ * Returns:
+ *  void
+ */
+void free_integral_image(IntegralImage **table) {
+  if (table && *table) {
+    pixels_free((*table)->sum, (*table)->mapped);
+    pixels_free((*table)->sqsum, (*table)->sqmapped);
+    free(*table);
+    *table = NULL;
+  }
+}
+
+/**
+ * Function: rect_sums
+ * -------------------
+ * Sums of one table over a rectangle already checked to lie inside the image
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables (for the size)
+ *  const unsigned long long *t: the table to read, sum or sqsum
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  unsigned long long out[3]: receives the sums of r, g and b
+ * Returns:
+ *  void
+ */
+static void rect_sums(const IntegralImage *table, const unsigned long long *t, int x, int y, int w, int h,
+                      unsigned long long out[3]) {
+  size_t span = ((size_t)table->cols + 1) * 3;
+  const unsigned long long *top = t + y * span, *bottom = t + (y + h) * span;
+  for (int i = 0; i < 3; i++) {
+    // Unsigned wraparound cancels out in the final result
+    out[i] = bottom[(x + w) * 3 + i] - bottom[x * 3 + i] - top[(x + w) * 3 + i] + top[x * 3 + i];
+  }
+}
+
+/**
+ * Function: bad_rect
+ * ------------------
+ * Check whether a rectangle is empty or reaches outside the image of the tables
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ * Returns:
+ *  1 if the rectangle cannot be queried, 0 otherwise
+ */
+static int bad_rect(const IntegralImage *table, int x, int y, int w, int h) {
+  return !table || x < 0 || y < 0 || w <= 0 || h <= 0 || w > table->cols - x || h > table->rows - y;
+}
+
+/**
+ * Function: integral_sum
+ * ----------------------
+ * Sum of each channel over a rectangle, in constant time
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  unsigned long long sum[3]: receives the sums of r, g and b
+ * Returns:
+ *  0 on success, -1 if the rectangle is empty or not inside the image
+ */
+int integral_sum(const IntegralImage *table, int x, int y, int w, int h, unsigned long long sum[3]) {
+  if (bad_rect(table, x, y, w, h)) {
+    return -1;
+  }
+  rect_sums(table, table->sum, x, y, w, h, sum);
+  return 0;
+}
+
+/**
+ * Function: integral_mean
+ * -----------------------
+ * Mean of each channel over a rectangle, in constant time
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  double mean[3]: receives the means of r, g and b
+ * Returns:
+ *  0 on success, -1 if the rectangle is empty or not inside the image
+ */
+int integral_mean(const IntegralImage *table, int x, int y, int w, int h, double mean[3]) {
+  unsigned long long sum[3];
+  if (integral_sum(table, x, y, w, h, sum) != 0) {
+    return -1;
+  }
+  double area = (double)w * h;
+  for (int i = 0; i < 3; i++) {
+    mean[i] = (double)sum[i] / area;
+  }
+  return 0;
+}
+
+/**
+ * Function: integral_variance
+ * ---------------------------
+ * Mean and (population) variance of each channel over a rectangle, in constant time
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables, built with squares
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  double mean[3]: receives the means of r, g and b
+ *  double variance[3]: receives the variances of r, g and b
+ * Returns:
+ *  0 on success, -1 if the rectangle is empty or not inside the image or the table of
+ *  squares was not built
+ */
+int integral_variance(const IntegralImage *table, int x, int y, int w, int h, double mean[3], double variance[3]) {
+  if (bad_rect(table, x, y, w, h) || !table->sqsum) {
+    return -1;
+  }
+  unsigned long long sum[3], sq[3];
+  rect_sums(table, table->sum, x, y, w, h, sum);
+  rect_sums(table, table->sqsum, x, y, w, h, sq);
+  long double area = (long double)w * h;
+  for (int i = 0; i < 3; i++) {
+    long double m = sum[i] / area;
+    long double v = sq[i] / area - m * m;
+    mean[i] = (double)m;
+    // Rounding can leave a tiny negative value for a constant region
+    variance[i] = v > 0 ? (double)v : 0;
+  }
+  return 0;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file integral.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for summed-area tables (integral images) and region statistics
+ *
+ * The table holds, for every channel, the sum of all samples above and to the left of
+ * each grid point, so the sum over any rectangle is four lookups however large the
+ * rectangle is. Sums are 64 bit: even the squares of a gigapixel 16 bit image fit.
+ */
+
+// If not defined, define INTEGRAL_H
+#ifndef INTEGRAL_H
+#define INTEGRAL_H
+
+// Include header files
+#include <stddef.h>
+#include "ppm_io.h"
+
+// Summed-area tables of an image. Entry (r, c) of sum, at index
+// (r * (cols + 1) + c) * 3 + channel, is the sum of the samples of the rows above r and
+// columns left of c, so row 0 and column 0 are zero. sqsum holds the sums of the
+// squared samples in the same layout, or is NULL if they were not asked for.
+typedef struct _integral_image {
+  unsigned long long *sum;
+  unsigned long long *sqsum;
+  int rows;
+  int cols;
+  size_t mapped;    // lengths of the mappings holding sum and sqsum, as for Image
+  size_t sqmapped;
+} IntegralImage;
+
+/**
+ * Function: make_integral_image
+ * -----------------------------
+ * Build the summed-area tables of an image (8 or 16 bit) on several threads
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  int squares: nonzero to also build the table of squares, which variance needs
+ * Returns:
+ *  IntegralImage *: the tables, NULL on a bad image pointer or allocation failure
+ */
+IntegralImage *make_integral_image(const Image *im, int squares);
+
+/**
+ * Function: free_integral_image
+ * -----------------------------
+ * utility function to free summed-area tables and set the pointer to null
+ *
+ * Parameters:
+ *  IntegralImage **table: pointer to the tables to be freed
+ * Returns:
+ *  void
+ */
+void free_integral_image(IntegralImage **table);
+
+/**
+ * Function: integral_sum
+ * ----------------------
+ * Sum of each channel over a rectangle, in constant time
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  unsigned long long sum[3]: receives the sums of r, g and b
+ * Returns:
+ *  0 on success, -1 if the rectangle is empty or not inside the image
+ */
+int integral_sum(const IntegralImage *table, int x, int y, int w, int h, unsigned long long sum[3]);
+
+/**
+ * Function: integral_mean
+ * -----------------------
+ * Mean of each channel over a rectangle, in constant time
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  double mean[3]: receives the means of r, g and b
+ * Returns:
+ *  0 on success, -1 if the rectangle is empty or not inside the image
+ */
+int integral_mean(const IntegralImage *table, int x, int y, int w, int h, double mean[3]);
+
+/**
+ * Function: integral_variance
+ * ---------------------------
+ * Mean and (population) variance of each channel over a rectangle, in constant time
+ *
+ * Parameters:
+ *  const IntegralImage *table: the tables, built with squares
+ *  int x: left column of the rectangle
+ *  int y: top row of the rectangle
+ *  int w: width of the rectangle
+ *  int h: height of the rectangle
+ *  double mean[3]: receives the means of r, g and b
+ *  double variance[3]: receives the variances of r, g and b
+ * Returns:
+ *  0 on success, -1 if the rectangle is empty or not inside the image or the table of
+ *  squares was not built
+ */
+int integral_variance(const IntegralImage *table, int x, int y, int w, int h, double mean[3], double variance[3]);
+
+// End of header file
+#endif
@@ -0,0 +1,281 @@
+/**
+ * @file median.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Constant-time median filter
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "median.h"
+#include "parallel.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Fine histograms have a bin per value, coarse ones a bin per 16 values; the median
+// is located in the coarse histogram first, then within one coarse bin
+#define FINE_BINS 256
+#define COARSE_BINS 16
+
+// Columns per strip: the column histograms of a strip (and of the radius on either
+// side) stay in the cache while the strip is filtered top to bottom
+#define MEDIAN_STRIP 256
+
+// Shared state of one median filter
+typedef struct _median_job {
+  const Image *src;
+  Image *dst;
+  int radius;
+  int failed;
+} MedianJob;
+
+/**
+ * Function: clamp_index
+ * ---------------------
+ * Clamp a row (or column) index into [0, n - 1], which replicates the border
+ *
+ * Parameters:
+ *  int i: the index
+ *  int n: the number of rows (or columns)
+ * Return:
+ *  the clamped index
+ */
+static int clamp_index(int i, int n) {
+  return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+/**
+ * Function: hist_slide
+ * --------------------
+ * dst += add - sub, bin by bin; the counts wrap around in between but not in the
+ * result, so the order does not matter
+ *
+ * Parameters:
+ *  unsigned short *dst: the histogram to update
+ *  const unsigned short *add: the histogram entering the window
+ *  const unsigned short *sub: the histogram leaving the window, NULL for none
+ *  int bins: number of bins, a multiple of 8
+ * Return:
+ *  void
+ */
+static void hist_slide(unsigned short *dst, const unsigned short *add, const unsigned short *sub, int bins) {
+  int i = 0;
+#ifdef __SSE2__
+  for (; i + 8 <= bins; i += 8) {
+    __m128i d = _mm_add_epi16(_mm_loadu_si128((const __m128i *)(dst + i)), _mm_loadu_si128((const __m128i *)(add + i)));
+    if (sub) {
+      d = _mm_sub_epi16(d, _mm_loadu_si128((const __m128i *)(sub + i)));
+    }
+    _mm_storeu_si128((__m128i *)(dst + i), d);
+  }
+#endif
+  for (; i < bins; i++) {
+    dst[i] = (unsigned short)(dst[i] + add[i] - (sub ? sub[i] : 0));
+  }
+}
+
+/**
+ * Function: fine_segment
+ * ----------------------
+ * Bring the fine window histogram of one coarse bin of one channel from column from up
+ * to column c: slid column by column if it is close, rebuilt from the columns of the
+ * window otherwise. Only the coarse bins the median falls in are ever brought up to
+ * date, which is what keeps the cost per pixel low.
+ *
+ * Parameters:
+ *  unsigned short *segment: the fine counts of the coarse bin
+ *  const unsigned short *columns: the fine column histograms from column lo, offset
+ *                                 to the bin of the channel
+ *  int from: the column the segment is up to date for (far below 0 if never)
+ *  int c: the column it is needed for
+ *  int k: the radius
+ *  int lo: the first column with a histogram
+ *  int cols: number of columns of the image
+ * Return:
+ *  void
+ */
+static void fine_segment(unsigned short *segment, const unsigned short *columns, int from, int c, int k, int lo, int cols) {
+  const int width = FINE_BINS / COARSE_BINS;
+  const size_t stride = 3 * FINE_BINS;
+  if (c - from > 2 * k + 1) {
+    memset(segment, 0, sizeof(unsigned short) * width);
+    for (int j = -k; j <= k; j++) {
+      hist_slide(segment, columns + (clamp_index(c + j, cols) - lo) * stride, NULL, width);
+    }
+    return;
+  }
+  for (int t = from + 1; t <= c; t++) {
+    hist_slide(segment, columns + (clamp_index(t + k, cols) - lo) * stride,
+               columns + (clamp_index(t - 1 - k, cols) - lo) * stride, width);
+  }
+}
+
+/**
+ * Function: column_update
+ * -----------------------
+ * Add (count 1) or remove (count -1) one row of the image to or from the column
+ * histograms
+ *
+ * Parameters:
+ *  unsigned short *fine: FINE_BINS counts per channel per column
+ *  unsigned short *coarse: COARSE_BINS counts per channel per column
+ *  const Pixel *row: the row
+ *  int cols: number of columns
+ *  int count: 1 or -1
+ * Return:
+ *  void
+ */
+static void column_update(unsigned short *fine, unsigned short *coarse, const Pixel *row, int cols, int count) {
+  for (int c = 0; c < cols; c++) {
+    const unsigned char v[3] = { row[c].r, row[c].g, row[c].b };
+    for (int ch = 0; ch < 3; ch++) {
+      size_t h = (size_t)c * 3 + ch;
+      fine[h * FINE_BINS + v[ch]] = (unsigned short)(fine[h * FINE_BINS + v[ch]] + count);
+      coarse[h * COARSE_BINS + v[ch] / (FINE_BINS / COARSE_BINS)] =
+          (unsigned short)(coarse[h * COARSE_BINS + v[ch] / (FINE_BINS / COARSE_BINS)] + count);
+    }
+  }
+}
+
+/**
+ * Function: median_band
+ * ---------------------
+ * Median filter of a band of rows, one strip of columns at a time. The column
+ * histograms are built for the first row of the band, then moved down one row at a
+ * time; along each row the coarse window histogram is started from the columns
+ * around the first column of the strip and slid to the right, and the fine one is
+ * caught up only in the coarse bins the medians fall in.
+ *
+ * Parameters:
+ *  void *ctx: the MedianJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void median_band(void *ctx, int band, int r0, int r1) {
+  MedianJob *job = ctx;
+  int rows = job->src->rows, cols = job->src->cols, k = job->radius;
+  int need = ((2 * k + 1) * (2 * k + 1) + 1) / 2;
+  const Pixel *src = job->src->data;
+  (void)band;
+
+  // Histograms of the columns of a strip, then of the window; the three channels of a
+  // column are adjacent so one update covers them all. The fine window histograms are
+  // kept per coarse bin, each up to date for the column in upToDate.
+  size_t span = (size_t)(MEDIAN_STRIP + 2 * k < cols ? MEDIAN_STRIP + 2 * k : cols) * 3;
+  unsigned short *fine = malloc(span * FINE_BINS * sizeof(unsigned short));
+  unsigned short *coarse = malloc(span * COARSE_BINS * sizeof(unsigned short));
+  unsigned short windowFine[3 * FINE_BINS], windowCoarse[3 * COARSE_BINS];
+  int upToDate[3 * COARSE_BINS];
+  if (!fine || !coarse) {
+    job->failed = 1;
+    free(fine);
+    free(coarse);
+    return;
+  }
+
+  for (int c0 = 0; c0 < cols; c0 += MEDIAN_STRIP) {
+    int c1 = c0 + MEDIAN_STRIP < cols ? c0 + MEDIAN_STRIP : cols;
+    int lo = c0 - k > 0 ? c0 - k : 0, hi = c1 + k < cols ? c1 + k : cols;
+    memset(fine, 0, (size_t)(hi - lo) * 3 * FINE_BINS * sizeof(unsigned short));
+    memset(coarse, 0, (size_t)(hi - lo) * 3 * COARSE_BINS * sizeof(unsigned short));
+    for (int j = -k; j <= k; j++) {
+      column_update(fine, coarse, &src[(size_t)clamp_index(r0 + j, rows) * cols + lo], hi - lo, 1);
+    }
+
+    for (int r = r0; r < r1; r++) {
+      if (r > r0) {
+        column_update(fine, coarse, &src[(size_t)clamp_index(r - 1 - k, rows) * cols + lo], hi - lo, -1);
+        column_update(fine, coarse, &src[(size_t)clamp_index(r + k, rows) * cols + lo], hi - lo, 1);
+      }
+      memset(windowCoarse, 0, sizeof(windowCoarse));
+      for (int j = -k; j <= k; j++) {
+        size_t c = clamp_index(c0 + j, cols) - lo;
+        hist_slide(windowCoarse, coarse + c * 3 * COARSE_BINS, NULL, 3 * COARSE_BINS);
+      }
+      for (int i = 0; i < 3 * COARSE_BINS; i++) {
+        upToDate[i] = c0 - 2 * k - 2;
+      }
+
+      Pixel *out = &job->dst->data[(size_t)r * cols];
+      for (int c = c0; c < c1; c++) {
+        if (c > c0) {
+          size_t enter = clamp_index(c + k, cols) - lo, leave = clamp_index(c - 1 - k, cols) - lo;
+          hist_slide(windowCoarse, coarse + enter * 3 * COARSE_BINS, coarse + leave * 3 * COARSE_BINS, 3 * COARSE_BINS);
+        }
+        unsigned char value[3];
+        for (int ch = 0; ch < 3; ch++) {
+          // The coarse bin holding the median, then the value within it
+          const unsigned short *counts = windowCoarse + ch * COARSE_BINS;
+          int b = 0, seen = 0;
+          while (seen + counts[b] < need) {
+            seen += counts[b++];
+          }
+          int first = b * (FINE_BINS / COARSE_BINS);
+          unsigned short *segment = windowFine + ch * FINE_BINS + first;
+          fine_segment(segment, fine + ch * FINE_BINS + first, upToDate[ch * COARSE_BINS + b], c, k, lo, cols);
+          upToDate[ch * COARSE_BINS + b] = c;
+          int v = 0;
+          while (seen + segment[v] < need) {
+            seen += segment[v++];
+          }
+          value[ch] = (unsigned char)(first + v);
+        }
+        out[c].r = value[0];
+        out[c].g = value[1];
+        out[c].b = value[2];
+      }
+    }
+  }
+  free(fine);
+  free(coarse);
+}
+
+/**
+ * Function: median_filter
+ * -----------------------
+ * Replace each channel of each pixel by its median over the (2 * radius + 1) square
+ * around it; borders are replicated. Follows Perreault and Hebert: every column keeps
+ * a histogram of the samples of its window rows, and the histogram of the square is
+ * slid along a row by adding the column entering it and subtracting the one leaving,
+ * so the cost per pixel does not depend on the radius. Histograms are updated 8 bins
+ * at a time with SSE2 where available, and each band of rows runs on its own thread.
+ *
+ * Parameters:
+ *  Image *im: the image to be filtered (8 bit)
+ *  int radius: the radius of the square, 0 to MEDIAN_MAX_RADIUS
+ * Return:
+ *  -1: bad image pointer, 16 bit image, bad radius or allocation failure
+ *  0: success
+ */
+int median_filter(Image *im, int radius) {
+  // Error check
+  if (!im || IS_16BIT(im) || !im->data || radius < 0 || radius > MEDIAN_MAX_RADIUS) {
+    fprintf(stderr, "Error:median - median_filter given a bad (or 16 bit) image pointer or radius\n");
+    return -1;
+  }
+  if (radius == 0) {
+    return 0;
+  }
+
+  Image *result = make_image(im->rows, im->cols);
+  if (!result) {
+    fprintf(stderr, "Error:median - median_filter failed to allocate memory\n");
+    return -1;
+  }
+  MedianJob job = { im, result, radius, 0 };
+  parallel_for_bands(im->rows, median_band, &job);
+  if (job.failed) {
+    fprintf(stderr, "Error:median - median_filter failed to allocate memory\n");
+    free_image(&result);
+    return -1;
+  }
+
+  // Free the old image and set the pointer to the new image
+  replace_image(im, &result);
+  return 0;
+}
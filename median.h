@@ -0,0 +1,37 @@
+/**
+ * @file median.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for the constant-time median filter
+ */
+
+// If not defined, define MEDIAN_H
+#ifndef MEDIAN_H
+#define MEDIAN_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Largest radius: the window counts are kept in 16 bits, so (2r + 1)^2 < 65536
+#define MEDIAN_MAX_RADIUS 127
+
+/**
+ * Function: median_filter
+ * -----------------------
+ * Replace each channel of each pixel by its median over the (2 * radius + 1) square
+ * around it; borders are replicated. Follows Perreault and Hebert: every column keeps
+ * a histogram of the samples of its window rows, and the histogram of the square is
+ * slid along a row by adding the column entering it and subtracting the one leaving,
+ * so the cost per pixel does not depend on the radius. Histograms are updated 8 bins
+ * at a time with SSE2 where available, and each band of rows runs on its own thread.
+ *
+ * Parameters:
+ *  Image *im: the image to be filtered (8 bit)
+ *  int radius: the radius of the square, 0 to MEDIAN_MAX_RADIUS
+ * Return:
+ *  -1: bad image pointer, 16 bit image, bad radius or allocation failure
+ *  0: success
+ */
+int median_filter(Image *im, int radius);
+
+// End of header file
+#endif
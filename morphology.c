@@ -0,0 +1,477 @@
+/**
+ * @file morphology.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Erosion, dilation, opening and closing
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "morphology.h"
+#include "parallel.h"
+
+// Samples per column strip of the vertical pass, which bounds its buffers
+#define MORPH_STRIP 256
+
+// One van Herk/Gil-Werman pass of a sample type and operation
+typedef void (*vhgw_fn)(void *samples, int n, size_t step, int w, int r, void *g, void *h);
+
+// Shared state of one pass over a plane of samples: rows of rowLen samples of size
+// bytes, channels interleaved
+typedef struct _morph_job {
+  unsigned char *data;
+  int rows;
+  int cols;
+  int channels;
+  size_t rowLen;
+  size_t size;
+  vhgw_fn fn;
+  int radius;
+  int failed;
+} MorphJob;
+
+/**
+ * Function: vhgw_length
+ * ---------------------
+ * Length of the padded sequence of the van Herk/Gil-Werman filter: n plus r on either
+ * side, rounded up to whole windows
+ *
+ * Parameters:
+ *  int n: length of the sequence
+ *  int r: radius of the window
+ * Return:
+ *  the padded length
+ */
+static int vhgw_length(int n, int r) {
+  int k = 2 * r + 1;
+  return (n + 2 * r + k - 1) / k * k;
+}
+
+// Minimum and maximum of 8 bit samples
+#define SAMPLE unsigned char
+#define IDENTITY 255
+#define COMBINE(a, b) ((a) < (b) ? (a) : (b))
+#define KERNEL(name) name##_min_8
+#include "morphology_kernels.h"
+#undef IDENTITY
+#undef COMBINE
+#undef KERNEL
+#define IDENTITY 0
+#define COMBINE(a, b) ((a) > (b) ? (a) : (b))
+#define KERNEL(name) name##_max_8
+#include "morphology_kernels.h"
+#undef SAMPLE
+#undef IDENTITY
+#undef COMBINE
+#undef KERNEL
+
+// Minimum and maximum of 16 bit samples
+#define SAMPLE unsigned short
+#define IDENTITY 65535
+#define COMBINE(a, b) ((a) < (b) ? (a) : (b))
+#define KERNEL(name) name##_min_16
+#include "morphology_kernels.h"
+#undef IDENTITY
+#undef COMBINE
+#undef KERNEL
+#define IDENTITY 0
+#define COMBINE(a, b) ((a) > (b) ? (a) : (b))
+#define KERNEL(name) name##_max_16
+#include "morphology_kernels.h"
+#undef SAMPLE
+#undef IDENTITY
+#undef COMBINE
+#undef KERNEL
+
+// Bitwise or and and of 64 pixel words of binary images
+#define SAMPLE unsigned long long
+#define IDENTITY 0ULL
+#define COMBINE(a, b) ((a) | (b))
+#define KERNEL(name) name##_or_64
+#include "morphology_kernels.h"
+#undef IDENTITY
+#undef COMBINE
+#undef KERNEL
+#define IDENTITY ~0ULL
+#define COMBINE(a, b) ((a) & (b))
+#define KERNEL(name) name##_and_64
+#include "morphology_kernels.h"
+#undef SAMPLE
+#undef IDENTITY
+#undef COMBINE
+#undef KERNEL
+
+/**
+ * Function: clamp_radius
+ * ----------------------
+ * A radius reaching past both ends of a sequence from every position gives the same
+ * result as one of n - 1, and keeps the padded buffers small
+ *
+ * Parameters:
+ *  int r: the radius
+ *  int n: length of the sequence
+ * Return:
+ *  the radius to use
+ */
+static int clamp_radius(int r, int n) {
+  return r > n - 1 ? (n > 1 ? n - 1 : 0) : r;
+}
+
+/**
+ * Function: morph_row_band
+ * ------------------------
+ * Row pass over a band of rows: each channel of each row is filtered on its own
+ *
+ * Parameters:
+ *  void *ctx: the MorphJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void morph_row_band(void *ctx, int band, int r0, int r1) {
+  MorphJob *job = ctx;
+  size_t len = vhgw_length(job->cols, job->radius);
+  (void)band;
+
+  unsigned char *g = malloc(len * job->size), *h = malloc(len * job->size);
+  if (!g || !h) {
+    job->failed = 1;
+    free(g);
+    free(h);
+    return;
+  }
+  for (int r = r0; r < r1; r++) {
+    unsigned char *row = job->data + (size_t)r * job->rowLen * job->size;
+    for (int c = 0; c < job->channels; c++) {
+      job->fn(row + c * job->size, job->cols, job->channels, 1, job->radius, g, h);
+    }
+  }
+  free(g);
+  free(h);
+}
+
+/**
+ * Function: morph_column_band
+ * ---------------------------
+ * Column pass over a range of the samples of a row: strips of columns are filtered
+ * down the whole image, a row of the strip at a time
+ *
+ * Parameters:
+ *  void *ctx: the MorphJob
+ *  int band: index of the band (unused)
+ *  int i0: first sample of the range
+ *  int i1: one past the last sample of the range
+ * Return:
+ *  void
+ */
+static void morph_column_band(void *ctx, int band, int i0, int i1) {
+  MorphJob *job = ctx;
+  size_t len = (size_t)vhgw_length(job->rows, job->radius) * MORPH_STRIP;
+  (void)band;
+
+  unsigned char *g = malloc(len * job->size), *h = malloc(len * job->size);
+  if (!g || !h) {
+    job->failed = 1;
+    free(g);
+    free(h);
+    return;
+  }
+  for (int i = i0; i < i1; i += MORPH_STRIP) {
+    int w = i1 - i < MORPH_STRIP ? i1 - i : MORPH_STRIP;
+    job->fn(job->data + (size_t)i * job->size, job->rows, job->rowLen, w, job->radius, g, h);
+  }
+  free(g);
+  free(h);
+}
+
+/**
+ * Function: morph_plane
+ * ---------------------
+ * Apply a morphological operation to a plane of samples, one pass per rectangle
+ * dimension and per step of the operation
+ *
+ * Parameters:
+ *  MorphJob *job: the plane (data, rows, cols, channels, rowLen and size set)
+ *  vhgw_fn erode: the pass taking the minimum
+ *  vhgw_fn dilate: the pass taking the maximum
+ *  MorphOp op: the operation
+ *  int rx: horizontal radius of the rectangle
+ *  int ry: vertical radius of the rectangle
+ * Return:
+ *  -1: allocation failure
+ *  0: success
+ */
+static int morph_plane(MorphJob *job, vhgw_fn erode, vhgw_fn dilate, MorphOp op, int rx, int ry) {
+  vhgw_fn steps[2] = { op == MORPH_DILATE || op == MORPH_CLOSE ? dilate : erode, NULL };
+  if (op == MORPH_OPEN) {
+    steps[1] = dilate;
+  } else if (op == MORPH_CLOSE) {
+    steps[1] = erode;
+  }
+  rx = clamp_radius(rx, job->cols);
+  ry = clamp_radius(ry, job->rows);
+
+  job->failed = 0;
+  for (int s = 0; s < 2 && steps[s]; s++) {
+    job->fn = steps[s];
+    if (rx > 0) {
+      job->radius = rx;
+      parallel_for_bands(job->rows, morph_row_band, job);
+    }
+    if (ry > 0 && !job->failed) {
+      job->radius = ry;
+      parallel_for_range((int)job->rowLen, MORPH_STRIP, morph_column_band, job);
+    }
+  }
+  return job->failed ? -1 : 0;
+}
+
+/**
+ * Function: morph
+ * ---------------
+ * Apply a morphological operation to every channel of an image (8 or 16 bit)
+ *
+ * Parameters:
+ *  Image *im: the image to be processed
+ *  MorphOp op: the operation
+ *  int rx: horizontal radius of the rectangle
+ *  int ry: vertical radius of the rectangle
+ * Returns:
+ *  -1: bad image pointer, negative radius or allocation failure
+ *  0: success
+ */
+int morph(Image *im, MorphOp op, int rx, int ry) {
+  // Error check
+  if (!im || (IS_16BIT(im) ? !im->data16 : !im->data) || rx < 0 || ry < 0) {
+    fprintf(stderr, "Error:morphology - morph given a bad image pointer or radius\n");
+    return -1;
+  }
+
+  MorphJob job;
+  memset(&job, 0, sizeof(job));
+  job.data = IS_16BIT(im) ? (unsigned char *)im->data16 : (unsigned char *)im->data;
+  job.rows = im->rows;
+  job.cols = im->cols;
+  job.channels = 3;
+  job.rowLen = (size_t)im->cols * 3;
+  job.size = IS_16BIT(im) ? sizeof(unsigned short) : 1;
+  int rc = IS_16BIT(im) ? morph_plane(&job, vhgw_min_16, vhgw_max_16, op, rx, ry)
+                        : morph_plane(&job, vhgw_min_8, vhgw_max_8, op, rx, ry);
+  if (rc != 0) {
+    fprintf(stderr, "Error:morphology - morph failed to allocate memory\n");
+  }
+  return rc;
+}
+
+/**
+ * Function: morph_gray
+ * --------------------
+ * Apply a morphological operation to a gray image (8 or 16 bit)
+ *
+ * Parameters:
+ *  GrayImage *im: the image to be processed
+ *  MorphOp op: the operation
+ *  int rx: horizontal radius of the rectangle
+ *  int ry: vertical radius of the rectangle
+ * Returns:
+ *  -1: bad image pointer, negative radius or allocation failure
+ *  0: success
+ */
+int morph_gray(GrayImage *im, MorphOp op, int rx, int ry) {
+  // Error check
+  if (!im || (IS_16BIT(im) ? !im->data16 : !im->data) || rx < 0 || ry < 0) {
+    fprintf(stderr, "Error:morphology - morph_gray given a bad image pointer or radius\n");
+    return -1;
+  }
+
+  MorphJob job;
+  memset(&job, 0, sizeof(job));
+  job.data = IS_16BIT(im) ? (unsigned char *)im->data16 : im->data;
+  job.rows = im->rows;
+  job.cols = im->cols;
+  job.channels = 1;
+  job.rowLen = (size_t)im->cols;
+  job.size = IS_16BIT(im) ? sizeof(unsigned short) : 1;
+  int rc = IS_16BIT(im) ? morph_plane(&job, vhgw_min_16, vhgw_max_16, op, rx, ry)
+                        : morph_plane(&job, vhgw_min_8, vhgw_max_8, op, rx, ry);
+  if (rc != 0) {
+    fprintf(stderr, "Error:morphology - morph_gray failed to allocate memory\n");
+  }
+  return rc;
+}
+
+/**
+ * Function: spread_row
+ * --------------------
+ * Or into every pixel of a row of words the r pixels on either side of it (a row pass
+ * of erosion in the binary convention). Each doubling step ors the row with itself
+ * shifted by the span covered so far, so a radius costs about 2 log2(r) passes over
+ * the words, 64 pixels each. Pixels shifted in from outside the row are 0.
+ *
+ * Parameters:
+ *  unsigned long long *row: the row, leftmost pixel in the most significant bit
+ *  int words: number of words in the row
+ *  int r: the radius
+ * Return:
+ *  void
+ */
+static void spread_row(unsigned long long *row, int words, int r) {
+  for (int dir = 0; dir < 2; dir++) {
+    for (int have = 1; have < r + 1; ) {
+      int s = have < r + 1 - have ? have : r + 1 - have;
+      int q = s / 64, b = s % 64;
+      if (dir == 0) {
+        // Towards the right: word i takes from words i - q and i - q - 1, both still
+        // unmodified when going downward
+        for (int i = words - 1; i >= q; i--) {
+          unsigned long long v = row[i - q] >> b;
+          if (b && i - q - 1 >= 0) {
+            v |= row[i - q - 1] << (64 - b);
+          }
+          row[i] |= v;
+        }
+      } else {
+        for (int i = 0; i + q < words; i++) {
+          unsigned long long v = row[i + q] << b;
+          if (b && i + q + 1 < words) {
+            v |= row[i + q + 1] >> (64 - b);
+          }
+          row[i] |= v;
+        }
+      }
+      have += s;
+    }
+  }
+}
+
+// Shared state of one row pass over a binary image
+typedef struct _spread_job {
+  unsigned long long *words;
+  int perRow;
+  int cols;
+  int radius;
+  int invert;
+} SpreadJob;
+
+/**
+ * Function: spread_band
+ * ---------------------
+ * Row pass of a binary image over a band of rows; dilation (white spreads) is the
+ * same spreading done on the inverted pixels
+ *
+ * Parameters:
+ *  void *ctx: the SpreadJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void spread_band(void *ctx, int band, int r0, int r1) {
+  SpreadJob *job = ctx;
+  int last = (job->cols - 1) / 64;
+  // Bits of the last word that hold pixels
+  unsigned long long tail = ~0ULL << (63 - (job->cols - 1) % 64);
+  (void)band;
+
+  for (int r = r0; r < r1; r++) {
+    unsigned long long *row = job->words + (size_t)r * job->perRow;
+    if (job->invert) {
+      for (int i = 0; i <= last; i++) {
+        row[i] = ~row[i];
+      }
+      row[last] &= tail;
+    }
+    spread_row(row, last + 1, job->radius);
+    if (job->invert) {
+      for (int i = 0; i <= last; i++) {
+        row[i] = ~row[i];
+      }
+    }
+    // The padding bits stay 0
+    row[last] &= tail;
+  }
+}
+
+/**
+ * Function: morph_binary
+ * ----------------------
+ * Apply a morphological operation to a binary image, 64 pixels at a time
+ *
+ * Parameters:
+ *  BinaryImage *im: the image to be processed
+ *  MorphOp op: the operation
+ *  int rx: horizontal radius of the rectangle
+ *  int ry: vertical radius of the rectangle
+ * Returns:
+ *  -1: bad image pointer, negative radius or allocation failure
+ *  0: success
+ */
+int morph_binary(BinaryImage *im, MorphOp op, int rx, int ry) {
+  // Error check
+  if (!im || !im->data || rx < 0 || ry < 0) {
+    fprintf(stderr, "Error:morphology - morph_binary given a bad image pointer or radius\n");
+    return -1;
+  }
+  if (im->rows <= 0 || im->cols <= 0) {
+    return 0;
+  }
+
+  // Load the rows as 64 bit words in pixel order, whatever the byte order of the host
+  int perRow = (int)(im->stride / 8);
+  size_t count = (size_t)im->rows * perRow;
+  unsigned long long *words = malloc(sizeof(unsigned long long) * count);
+  if (!words) {
+    fprintf(stderr, "Error:morphology - morph_binary failed to allocate memory\n");
+    return -1;
+  }
+  for (size_t i = 0; i < count; i++) {
+    unsigned long long v = 0;
+    for (int b = 0; b < 8; b++) {
+      v = v << 8 | im->data[i * 8 + b];
+    }
+    words[i] = v;
+  }
+
+  // Erosion spreads black (1) with or; dilation spreads white with and
+  int erodes[2] = { op == MORPH_ERODE || op == MORPH_OPEN, op == MORPH_CLOSE };
+  int steps = op == MORPH_OPEN || op == MORPH_CLOSE ? 2 : 1;
+  rx = clamp_radius(rx, im->cols);
+  ry = clamp_radius(ry, im->rows);
+  MorphJob job;
+  memset(&job, 0, sizeof(job));
+  job.data = (unsigned char *)words;
+  job.rows = im->rows;
+  job.cols = perRow;
+  job.channels = 1;
+  job.rowLen = perRow;
+  job.size = sizeof(unsigned long long);
+  for (int s = 0; s < steps && !job.failed; s++) {
+    if (rx > 0) {
+      SpreadJob spread = { words, perRow, im->cols, rx, !erodes[s] };
+      parallel_for_bands(im->rows, spread_band, &spread);
+    }
+    if (ry > 0) {
+      job.fn = erodes[s] ? vhgw_or_64 : vhgw_and_64;
+      job.radius = ry;
+      parallel_for_range(perRow, 1, morph_column_band, &job);
+    }
+  }
+
+  if (!job.failed) {
+    for (size_t i = 0; i < count; i++) {
+      for (int b = 0; b < 8; b++) {
+        im->data[i * 8 + b] = (unsigned char)(words[i] >> (56 - 8 * b));
+      }
+    }
+  }
+  free(words);
+  if (job.failed) {
+    fprintf(stderr, "Error:morphology - morph_binary failed to allocate memory\n");
+    return -1;
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file morphology.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for erosion, dilation, opening and closing
+ *
+ * The structuring element is a (2 * rx + 1) x (2 * ry + 1) rectangle centered on the
+ * pixel, and the part of it outside the image is ignored. Erosion takes the minimum
+ * intensity under the rectangle, dilation the maximum, so on an edge map (black edges
+ * on white) erosion thickens the edges and closing removes isolated black specks. A
+ * rectangle is separable into a row and a column pass, and each pass uses the van
+ * Herk/Gil-Werman algorithm: three comparisons per sample whatever the radius.
+ * Binary images are processed 64 pixels per word with bitwise operations and follow
+ * the same convention (1 is black), so erosion of a PBM matches erosion of the image
+ * it was made from.
+ */
+
+// If not defined, define MORPHOLOGY_H
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Morphological operations
+typedef enum {
+  MORPH_ERODE,    // minimum under the rectangle
+  MORPH_DILATE,   // maximum under the rectangle
+  MORPH_OPEN,     // erosion, then dilation: removes small bright features
+  MORPH_CLOSE     // dilation, then erosion: removes small dark features
+} MorphOp;
+
+/**
+ * Function: morph
+ * ---------------
+ * Apply a morphological operation to every channel of an image (8 or 16 bit)
+ *
+ * Parameters:
+ *  Image *im: the image to be processed
+ *  MorphOp op: the operation
+ *  int rx: horizontal radius of the rectangle
+ *  int ry: vertical radius of the rectangle
+ * Returns:
+ *  -1: bad image pointer, negative radius or allocation failure
+ *  0: success
+ */
+int morph(Image *im, MorphOp op, int rx, int ry);
+
+/**
+ * Function: morph_gray
+ * --------------------
+ * Apply a morphological operation to a gray image (8 or 16 bit)
+ *
+ * Parameters:
+ *  GrayImage *im: the image to be processed
+ *  MorphOp op: the operation
+ *  int rx: horizontal radius of the rectangle
+ *  int ry: vertical radius of the rectangle
+ * Returns:
+ *  -1: bad image pointer, negative radius or allocation failure
+ *  0: success
+ */
+int morph_gray(GrayImage *im, MorphOp op, int rx, int ry);
+
+/**
+ * Function: morph_binary
+ * ----------------------
+ * Apply a morphological operation to a binary image, 64 pixels at a time
+ *
+ * Parameters:
+ *  BinaryImage *im: the image to be processed
+ *  MorphOp op: the operation
+ *  int rx: horizontal radius of the rectangle
+ *  int ry: vertical radius of the rectangle
+ * Returns:
+ *  -1: bad image pointer, negative radius or allocation failure
+ *  0: success
+ */
+int morph_binary(BinaryImage *im, MorphOp op, int rx, int ry);
+
+// End of header file
+#endif
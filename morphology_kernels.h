@@ -0,0 +1,66 @@
+/**
+ * @file morphology_kernels.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Sample-type generic body of the van Herk/Gil-Werman filter
+ *
+ * This file is included once per sample type and operation by morphology.c, which
+ * defines
+ *  SAMPLE: the sample type (unsigned char, unsigned short or a 64 bit word of pixels)
+ *  COMBINE(a, b): the operation (min, max, bitwise or, bitwise and)
+ *  IDENTITY: the value COMBINE leaves the other operand unchanged with
+ *  KERNEL(name): the name of the specialized kernel
+ * so the inner loops carry neither a depth check nor a call per sample.
+ */
+
+// Van Herk/Gil-Werman: COMBINE over every window of 2 * r + 1 of a sequence of n
+// vectors of w samples each, vector j starting at data + j * step, in place; the part of
+// a window outside the sequence counts as IDENTITY. The (padded) sequence is cut into
+// blocks of one window length; g runs COMBINE forward from the start of each block, h
+// backward from its end, and any window spans the end of one block and the start of
+// the next, so each output is one COMBINE of h and g whatever r is. g and h hold
+// vhgw_length(n, r) * w samples each.
+static void KERNEL(vhgw)(void *samples, int n, size_t step, int w, int r, void *gBuf, void *hBuf) {
+  SAMPLE *data = samples, *g = gBuf, *h = hBuf;
+  int k = 2 * r + 1, m = vhgw_length(n, r);
+
+  // Padded index j holds vector j - r
+  for (int j = 0; j < m; j++) {
+    SAMPLE *gj = g + (size_t)j * w;
+    const SAMPLE *x = j - r >= 0 && j - r < n ? data + (size_t)(j - r) * step : NULL;
+    if (j % k == 0) {
+      for (int i = 0; i < w; i++) {
+        gj[i] = x ? x[i] : IDENTITY;
+      }
+    } else if (x) {
+      for (int i = 0; i < w; i++) {
+        gj[i] = COMBINE(gj[i - w], x[i]);
+      }
+    } else {
+      memcpy(gj, gj - w, sizeof(SAMPLE) * w);
+    }
+  }
+  for (int j = m - 1; j >= 0; j--) {
+    SAMPLE *hj = h + (size_t)j * w;
+    const SAMPLE *x = j - r >= 0 && j - r < n ? data + (size_t)(j - r) * step : NULL;
+    if (j % k == k - 1) {
+      for (int i = 0; i < w; i++) {
+        hj[i] = x ? x[i] : IDENTITY;
+      }
+    } else if (x) {
+      for (int i = 0; i < w; i++) {
+        hj[i] = COMBINE(hj[i + w], x[i]);
+      }
+    } else {
+      memcpy(hj, hj + w, sizeof(SAMPLE) * w);
+    }
+  }
+
+  // The window of output j is padded [j, j + k - 1]
+  for (int j = 0; j < n; j++) {
+    SAMPLE *out = data + (size_t)j * step;
+    const SAMPLE *hj = h + (size_t)j * w, *gj = g + (size_t)(j + k - 1) * w;
+    for (int i = 0; i < w; i++) {
+      out[i] = COMBINE(hj[i], gj[i]);
+    }
+  }
+}
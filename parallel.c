@@ -0,0 +1,178 @@
+/**
+ * @file parallel.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Splitting image work into row bands run on threads
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+// Include header files
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+
+// Bands are never made smaller than this many rows, so small images stay on one thread
+#define MIN_BAND_ROWS 16
+
+// Arguments handed to one band thread
+typedef struct _band_job {
+  band_fn fn;
+  void *ctx;
+  int band;
+  int r0;
+  int r1;
+} BandJob;
+
+/**
+ * Function: run_band
+ * ------------------
+ * Thread entry point that runs one band
+ *
+ * Parameters:
+ *  void *arg: the BandJob to run
+ * Returns:
+ *  NULL
+ */
+static void *run_band(void *arg) {
+  BandJob *job = arg;
+  job->fn(job->ctx, job->band, job->r0, job->r1);
+  return NULL;
+}
+
+/**
+ * Function: parallel_thread_count
+ * -------------------------------
+ * Number of threads to use for image work: the IMGPROC_THREADS environment variable
+ * if it is set to a positive number, otherwise the number of online processors
+ *
+ * Parameters:
+ *  none
+ * Returns:
+ *  the number of threads (at least 1)
+ */
+int parallel_thread_count(void) {
+  const char *env = getenv("IMGPROC_THREADS");
+  if (env && atoi(env) > 0) {
+    return atoi(env);
+  }
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  return cpus > 0 ? (int)cpus : 1;
+}
+
+/**
+ * Function: parallel_range_count
+ * ------------------------------
+ * Like parallel_band_count, for work split into items of arbitrary size (chunks, tiles,
+ * columns); no band is made smaller than min_items items
+ *
+ * Parameters:
+ *  int items: number of items to be split
+ *  int min_items: smallest number of items worth a thread of its own
+ * Returns:
+ *  the number of bands (at least 1)
+ */
+int parallel_range_count(int items, int min_items) {
+  int bands = parallel_thread_count();
+  if (min_items < 1) {
+    min_items = 1;
+  }
+  if (bands > items / min_items) {
+    bands = items / min_items;
+  }
+  return bands > 0 ? bands : 1;
+}
+
+/**
+ * Function: parallel_band_count
+ * -----------------------------
+ * Number of bands parallel_for_bands will split the given number of rows into, so
+ * callers can allocate per-band private state beforehand
+ *
+ * Parameters:
+ *  int rows: number of rows to be split
+ * Returns:
+ *  the number of bands (at least 1)
+ */
+int parallel_band_count(int rows) {
+  return parallel_range_count(rows, MIN_BAND_ROWS);
+}
+
+/**
+ * Function: parallel_for_range
+ * ----------------------------
+ * Like parallel_for_bands, for work split into items of arbitrary size; the items are
+ * split into parallel_range_count(items, min_items) bands and fn gets item indices
+ * instead of rows
+ *
+ * Parameters:
+ *  int items: number of items to be split
+ *  int min_items: smallest number of items worth a thread of its own
+ *  band_fn fn: the work done on each band
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  void
+ */
+void parallel_for_range(int items, int min_items, band_fn fn, void *ctx) {
+  int bands = parallel_range_count(items, min_items);
+  if (bands == 1) {
+    fn(ctx, 0, 0, items);
+    return;
+  }
+
+  BandJob *jobs = malloc(sizeof(BandJob) * bands);
+  pthread_t *threads = malloc(sizeof(pthread_t) * bands);
+  int *started = calloc(bands, sizeof(int));
+  if (!jobs || !threads || !started) {
+    // Not enough memory to bookkeep threads, do the work serially
+    free(jobs);
+    free(threads);
+    free(started);
+    fn(ctx, 0, 0, items);
+    return;
+  }
+
+  // Band b covers items [b * items / bands, (b + 1) * items / bands)
+  for (int b = 0; b < bands; b++) {
+    jobs[b].fn = fn;
+    jobs[b].ctx = ctx;
+    jobs[b].band = b;
+    jobs[b].r0 = (int)((long long)b * items / bands);
+    jobs[b].r1 = (int)((long long)(b + 1) * items / bands);
+  }
+  for (int b = 1; b < bands; b++) {
+    started[b] = pthread_create(&threads[b], NULL, run_band, &jobs[b]) == 0;
+  }
+
+  // The calling thread takes the first band, then any band that failed to start
+  run_band(&jobs[0]);
+  for (int b = 1; b < bands; b++) {
+    if (started[b]) {
+      pthread_join(threads[b], NULL);
+    } else {
+      run_band(&jobs[b]);
+    }
+  }
+
+  free(jobs);
+  free(threads);
+  free(started);
+}
+
+/**
+ * Function: parallel_for_bands
+ * ----------------------------
+ * Split the rows into parallel_band_count(rows) contiguous bands of nearly equal size and
+ * run fn on each band in its own thread (the calling thread takes band 0). Returns once
+ * every band is done. Bands whose thread cannot be started run on the calling thread.
+ *
+ * Parameters:
+ *  int rows: number of rows to be split
+ *  band_fn fn: the work done on each band
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  void
+ */
+void parallel_for_bands(int rows, band_fn fn, void *ctx) {
+  parallel_for_range(rows, MIN_BAND_ROWS, fn, ctx);
+}
@@ -0,0 +1,88 @@
+/**
+ * @file parallel.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for splitting image work into row bands run on threads
+ */
+
+// If not defined, define PARALLEL_H
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// Work done on the rows [r0, r1) of one band; band is the index of the band (0 based)
+typedef void (*band_fn)(void *ctx, int band, int r0, int r1);
+
+/**
+ * Function: parallel_thread_count
+ * -------------------------------
+ * Number of threads to use for image work: the IMGPROC_THREADS environment variable
+ * if it is set to a positive number, otherwise the number of online processors
+ *
+ * Parameters:
+ *  none
+ * Returns:
+ *  the number of threads (at least 1)
+ */
+int parallel_thread_count(void);
+
+/**
+ * Function: parallel_band_count
+ * -----------------------------
+ * Number of bands parallel_for_bands will split the given number of rows into, so
+ * callers can allocate per-band private state beforehand
+ *
+ * Parameters:
+ *  int rows: number of rows to be split
+ * Returns:
+ *  the number of bands (at least 1)
+ */
+int parallel_band_count(int rows);
+
+/**
+ * Function: parallel_range_count
+ * ------------------------------
+ * Like parallel_band_count, for work split into items of arbitrary size (chunks, tiles,
+ * columns); no band is made smaller than min_items items
+ *
+ * Parameters:
+ *  int items: number of items to be split
+ *  int min_items: smallest number of items worth a thread of its own
+ * Returns:
+ *  the number of bands (at least 1)
+ */
+int parallel_range_count(int items, int min_items);
+
+/**
+ * Function: parallel_for_range
+ * ----------------------------
+ * Like parallel_for_bands, for work split into items of arbitrary size; the items are
+ * split into parallel_range_count(items, min_items) bands and fn gets item indices
+ * instead of rows
+ *
+ * Parameters:
+ *  int items: number of items to be split
+ *  int min_items: smallest number of items worth a thread of its own
+ *  band_fn fn: the work done on each band
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  void
+ */
+void parallel_for_range(int items, int min_items, band_fn fn, void *ctx);
+
+/**
+ * Function: parallel_for_bands
+ * ----------------------------
+ * Split the rows into parallel_band_count(rows) contiguous bands of nearly equal size and
+ * run fn on each band in its own thread (the calling thread takes band 0). Returns once
+ * every band is done. Bands whose thread cannot be started run on the calling thread.
+ *
+ * Parameters:
+ *  int rows: number of rows to be split
+ *  band_fn fn: the work done on each band
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  void
+ */
+void parallel_for_bands(int rows, band_fn fn, void *ctx);
+
+// End of header file
+#endif
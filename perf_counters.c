@@ -0,0 +1,271 @@
+/**
+ * @file perf_counters.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Measuring operations with hardware performance counters
+ */
+
+// syscall() is not part of POSIX
+#define _GNU_SOURCE
+
+// Include header files
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "perf_counters.h"
+
+// Type and config of each counted event, in the order of the PERF_* enum
+static const struct {
+  unsigned type;
+  unsigned long long config;
+  const char *name;
+} EVENTS[PERF_EVENTS] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles" },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions" },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "LLC-misses" },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+    (PERF_COUNT_HW_CACHE_RESULT_MISS << 16), "dTLB-misses" },
+};
+
+/**
+ * Function: now
+ * -------------
+ * Monotonic wall clock time
+ *
+ * Parameters:
+ *  none
+ * Returns:
+ *  the time in seconds
+ */
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Function: read_counter
+ * ----------------------
+ * Read a counter together with the times it was enabled and running
+ *
+ * Parameters:
+ *  int fd: the counter
+ *  unsigned long long out[3]: receives the value, time enabled and time running
+ * Returns:
+ *  0 on success, -1 on failure
+ */
+static int read_counter(int fd, unsigned long long out[3]) {
+  return read(fd, out, 3 * sizeof(unsigned long long)) == (ssize_t)(3 * sizeof(unsigned long long)) ? 0 : -1;
+}
+
+/**
+ * Function: perf_open
+ * -------------------
+ * Open the cycle, instruction, last level cache miss and data TLB miss counters for
+ * the calling process. Only user space is counted, so the counters work up to
+ * perf_event_paranoid 2. Threads started later by the process are counted as well.
+ * Events the processor, the kernel or the permissions do not allow are left out; with
+ * none of them only the wall clock time is measured.
+ *
+ * Parameters:
+ *  PerfCounters *pc: receives the counters
+ * Returns:
+ *  the number of counters opened
+ */
+int perf_open(PerfCounters *pc) {
+  pc->opened = 0;
+  pc->error = 0;
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = EVENTS[e].type;
+    attr.config = EVENTS[e].config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // Counts of the band threads are folded into the parent counter when read
+    attr.inherit = 1;
+
+    // Each event is its own group: the kernel multiplexes them if there are not
+    // enough hardware counters, and the readings are scaled back up
+    pc->fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (pc->fds[e] < 0) {
+      pc->fds[e] = -1;
+      if (!pc->error) {
+        pc->error = errno;
+      }
+    } else {
+      pc->opened++;
+    }
+  }
+  return pc->opened;
+}
+
+/**
+ * Function: perf_close
+ * --------------------
+ * Close the counters
+ *
+ * Parameters:
+ *  PerfCounters *pc: the counters
+ * Returns:
+ *  void
+ */
+void perf_close(PerfCounters *pc) {
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    if (pc->fds[e] >= 0) {
+      close(pc->fds[e]);
+      pc->fds[e] = -1;
+    }
+  }
+  pc->opened = 0;
+}
+
+/**
+ * Function: perf_begin
+ * --------------------
+ * Take a snapshot of the counters and the clock at the start of a measurement
+ *
+ * Parameters:
+ *  const PerfCounters *pc: the counters
+ *  PerfSnapshot *snapshot: receives the snapshot
+ * Returns:
+ *  void
+ */
+void perf_begin(const PerfCounters *pc, PerfSnapshot *snapshot) {
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    unsigned long long reading[3] = { 0, 0, 0 };
+    if (pc->fds[e] >= 0) {
+      read_counter(pc->fds[e], reading);
+    }
+    snapshot->values[e] = reading[0];
+    snapshot->enabled[e] = reading[1];
+    snapshot->running[e] = reading[2];
+  }
+  // Read the clock last so the counter reads are not part of the measured time
+  snapshot->seconds = now();
+}
+
+/**
+ * Function: perf_end
+ * ------------------
+ * End a measurement started with perf_begin and add what happened in between to a
+ * running total
+ *
+ * Parameters:
+ *  const PerfCounters *pc: the counters
+ *  const PerfSnapshot *snapshot: the snapshot taken by perf_begin
+ *  double megapixels: pixels processed by the measured work, in millions
+ *  PerfSample *total: the running total (zero it before the first run)
+ * Returns:
+ *  void
+ */
+void perf_end(const PerfCounters *pc, const PerfSnapshot *snapshot, double megapixels, PerfSample *total) {
+  total->seconds += now() - snapshot->seconds;
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    unsigned long long reading[3];
+    if (pc->fds[e] < 0 || read_counter(pc->fds[e], reading) != 0) {
+      continue;
+    }
+    double count = (double)(reading[0] - snapshot->values[e]);
+    unsigned long long enabled = reading[1] - snapshot->enabled[e];
+    unsigned long long running = reading[2] - snapshot->running[e];
+    // A multiplexed counter only saw part of the interval, extrapolate to all of it
+    if (running > 0 && running < enabled) {
+      count *= (double)enabled / running;
+    }
+    total->values[e] += count;
+  }
+  total->megapixels += megapixels;
+  total->runs++;
+}
+
+/**
+ * Function: perf_report_header
+ * ----------------------------
+ * Print the column headings of the report, and why counters are missing if they are
+ *
+ * Parameters:
+ *  FILE *fp: where to print
+ *  const PerfCounters *pc: the counters
+ * Returns:
+ *  void
+ */
+void perf_report_header(FILE *fp, const PerfCounters *pc) {
+  if (pc->opened < PERF_EVENTS) {
+    fprintf(fp, "profile: ");
+    for (int e = 0, listed = 0; e < PERF_EVENTS; e++) {
+      if (pc->fds[e] < 0) {
+        fprintf(fp, "%s%s", listed++ ? ", " : "", EVENTS[e].name);
+      }
+    }
+    fprintf(fp, " not available (%s)%s\n", strerror(pc->error),
+            pc->error == EACCES || pc->error == EPERM ? ", see /proc/sys/kernel/perf_event_paranoid" : "");
+  }
+  fprintf(fp, "%-16s %5s %10s %14s %14s %6s %12s %12s | %10s %12s %12s %10s %10s\n",
+          "operation", "runs", "ms", "cycles", "instructions", "IPC", "LLC-misses", "dTLB-misses",
+          "ms/MP", "cycles/MP", "instr/MP", "LLC/MP", "dTLB/MP");
+}
+
+/**
+ * Function: print_count
+ * ---------------------
+ * Print one event count of the report, or "-" if its counter is not open
+ *
+ * Parameters:
+ *  FILE *fp: where to print
+ *  const PerfCounters *pc: the counters
+ *  int event: the event
+ *  double count: the count
+ *  int width: the column width
+ * Returns:
+ *  void
+ */
+static void print_count(FILE *fp, const PerfCounters *pc, int event, double count, int width) {
+  if (pc->fds[event] >= 0) {
+    fprintf(fp, " %*.0f", width, count);
+  } else {
+    fprintf(fp, " %*s", width, "-");
+  }
+}
+
+/**
+ * Function: perf_report
+ * ---------------------
+ * Print one line of the report: time, event counts and IPC of a total, and the time
+ * and counts per megapixel. Counters that are not open are printed as "-".
+ *
+ * Parameters:
+ *  FILE *fp: where to print
+ *  const PerfCounters *pc: the counters
+ *  const char *label: name of the measured work
+ *  const PerfSample *total: the total to print
+ * Returns:
+ *  void
+ */
+void perf_report(FILE *fp, const PerfCounters *pc, const char *label, const PerfSample *total) {
+  static const int WIDTHS[PERF_EVENTS] = { 14, 14, 12, 12 };
+  static const int MP_WIDTHS[PERF_EVENTS] = { 12, 12, 10, 10 };
+  double mp = total->megapixels > 0 ? total->megapixels : 1;
+
+  fprintf(fp, "%-16s %5ld %10.3f", label, total->runs, total->seconds * 1e3);
+  print_count(fp, pc, PERF_CYCLES, total->values[PERF_CYCLES], WIDTHS[PERF_CYCLES]);
+  print_count(fp, pc, PERF_INSTRUCTIONS, total->values[PERF_INSTRUCTIONS], WIDTHS[PERF_INSTRUCTIONS]);
+  if (pc->fds[PERF_CYCLES] >= 0 && pc->fds[PERF_INSTRUCTIONS] >= 0 && total->values[PERF_CYCLES] > 0) {
+    fprintf(fp, " %6.2f", total->values[PERF_INSTRUCTIONS] / total->values[PERF_CYCLES]);
+  } else {
+    fprintf(fp, " %6s", "-");
+  }
+  print_count(fp, pc, PERF_LLC_MISSES, total->values[PERF_LLC_MISSES], WIDTHS[PERF_LLC_MISSES]);
+  print_count(fp, pc, PERF_DTLB_MISSES, total->values[PERF_DTLB_MISSES], WIDTHS[PERF_DTLB_MISSES]);
+
+  fprintf(fp, " | %10.3f", total->seconds * 1e3 / mp);
+  for (int e = 0; e < PERF_EVENTS; e++) {
+    print_count(fp, pc, e, total->values[e] / mp, MP_WIDTHS[e]);
+  }
+  fprintf(fp, "\n");
+}
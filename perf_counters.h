@@ -0,0 +1,133 @@
+/**
+ * @file perf_counters.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for measuring operations with hardware performance counters
+ */
+
+// If not defined, define PERF_COUNTERS_H
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+// Include header files
+#include <stdio.h>
+
+// The hardware events that are counted
+enum {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_LLC_MISSES,
+  PERF_DTLB_MISSES,
+  PERF_EVENTS
+};
+
+// Open counters of the calling process; counters that could not be opened have fd -1
+typedef struct _perf_counters {
+  int fds[PERF_EVENTS];
+  int opened;        // number of counters opened
+  int error;         // errno of the first counter that failed to open, 0 if none failed
+} PerfCounters;
+
+// Totals measured over one or more runs of an operation
+typedef struct _perf_sample {
+  double seconds;               // wall clock time
+  double values[PERF_EVENTS];   // event counts, scaled up when the counter was multiplexed
+  double megapixels;            // pixels processed, in millions
+  long runs;
+} PerfSample;
+
+// Raw counter readings at the start of a measurement
+typedef struct _perf_snapshot {
+  double seconds;
+  unsigned long long values[PERF_EVENTS];
+  unsigned long long enabled[PERF_EVENTS];  // time the counter was enabled, in ns
+  unsigned long long running[PERF_EVENTS];  // time the counter was on the PMU, in ns
+} PerfSnapshot;
+
+/**
+ * Function: perf_open
+ * -------------------
+ * Open the cycle, instruction, last level cache miss and data TLB miss counters for
+ * the calling process. Only user space is counted, so the counters work up to
+ * perf_event_paranoid 2. Threads started later by the process are counted as well.
+ * Events the processor, the kernel or the permissions do not allow are left out; with
+ * none of them only the wall clock time is measured.
+ *
+ * Parameters:
+ *  PerfCounters *pc: receives the counters
+ * Returns:
+ *  the number of counters opened
+ */
+int perf_open(PerfCounters *pc);
+
+/**
+ * Function: perf_close
+ * --------------------
+ * Close the counters
+ *
+ * Parameters:
+ *  PerfCounters *pc: the counters
+ * Returns:
+ *  void
+ */
+void perf_close(PerfCounters *pc);
+
+/**
+ * Function: perf_begin
+ * --------------------
+ * Take a snapshot of the counters and the clock at the start of a measurement
+ *
+ * Parameters:
+ *  const PerfCounters *pc: the counters
+ *  PerfSnapshot *snapshot: receives the snapshot
+ * Returns:
+ *  void
+ */
+void perf_begin(const PerfCounters *pc, PerfSnapshot *snapshot);
+
+/**
+ * Function: perf_end
+ * ------------------
+ * End a measurement started with perf_begin and add what happened in between to a
+ * running total
+ *
+ * Parameters:
+ *  const PerfCounters *pc: the counters
+ *  const PerfSnapshot *snapshot: the snapshot taken by perf_begin
+ *  double megapixels: pixels processed by the measured work, in millions
+ *  PerfSample *total: the running total (zero it before the first run)
+ * Returns:
+ *  void
+ */
+void perf_end(const PerfCounters *pc, const PerfSnapshot *snapshot, double megapixels, PerfSample *total);
+
+/**
+ * Function: perf_report_header
+ * ----------------------------
+ * Print the column headings of the report, and why counters are missing if they are
+ *
+ * Parameters:
+ *  FILE *fp: where to print
+ *  const PerfCounters *pc: the counters
+ * Returns:
+ *  void
+ */
+void perf_report_header(FILE *fp, const PerfCounters *pc);
+
+/**
+ * Function: perf_report
+ * ---------------------
+ * Print one line of the report: time, event counts and IPC of a total, and the time
+ * and counts per megapixel. Counters that are not open are printed as "-".
+ *
+ * Parameters:
+ *  FILE *fp: where to print
+ *  const PerfCounters *pc: the counters
+ *  const char *label: name of the measured work
+ *  const PerfSample *total: the total to print
+ * Returns:
+ *  void
+ */
+void perf_report(FILE *fp, const PerfCounters *pc, const char *label, const PerfSample *total);
+
+// End of header file
+#endif
@@ -0,0 +1,498 @@
+/**
+ * @file phash.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Perceptual hashes and the near-duplicate index
+ */
+
+// getline() is POSIX
+#define _POSIX_C_SOURCE 200809L
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include "phash.h"
+#include "image_manip.h"
+#include "ppz_io.h"
+#include "parallel.h"
+
+// Side of the block of lowest DCT frequencies the bits come from
+#define PHASH_FREQS 8
+
+// Values of one 16 bit chunk
+#define CHUNK_VALUES 65536
+
+// First line of an index file
+#define PHASH_MAGIC "PHASH 1"
+
+// Shared state of hashing a list of files
+typedef struct _phash_files_job {
+  char *const *names;
+  unsigned long long *hashes;
+  int *ok;
+} PhashFilesJob;
+
+// State of one index query
+typedef struct _phash_query {
+  const PhashIndex *idx;
+  unsigned long long hash;
+  int distance;
+  int radius;    // bits each chunk is probed within
+  phash_match_fn fn;
+  void *ctx;
+  int found;
+} PhashQuery;
+
+/**
+ * Function: chunk
+ * ---------------
+ * One 16 bit chunk of a hash
+ *
+ * Parameters:
+ *  unsigned long long hash: the hash
+ *  int k: the chunk, 0 to PHASH_CHUNKS - 1
+ * Returns:
+ *  the chunk's value
+ */
+static unsigned chunk(unsigned long long hash, int k) {
+  return (unsigned)(hash >> (16 * k)) & (CHUNK_VALUES - 1);
+}
+
+/**
+ * Function: phash_distance
+ * ------------------------
+ * The Hamming distance of two hashes
+ *
+ * Parameters:
+ *  unsigned long long a: one hash
+ *  unsigned long long b: the other hash
+ * Returns:
+ *  the number of bits they differ in
+ */
+int phash_distance(unsigned long long a, unsigned long long b) {
+  unsigned long long x = a ^ b;
+  int bits = 0;
+  while (x) {
+    x &= x - 1;
+    bits++;
+  }
+  return bits;
+}
+
+/**
+ * Function: cell_spans
+ * --------------------
+ * Split n rows (or columns) among the PHASH_THUMB cells of the thumbnail: cell i
+ * averages [first[i], last[i]). Fewer than PHASH_THUMB rows are repeated instead.
+ *
+ * Parameters:
+ *  int n: the number of rows (or columns)
+ *  int *first: set to the first row of each cell
+ *  int *last: set to one past the last row of each cell
+ * Returns:
+ *  void
+ */
+static void cell_spans(int n, int *first, int *last) {
+  for (int i = 0; i < PHASH_THUMB; i++) {
+    first[i] = (int)((long long)i * n / PHASH_THUMB);
+    last[i] = (int)((long long)(i + 1) * n / PHASH_THUMB);
+    if (last[i] <= first[i]) {
+      last[i] = first[i] + 1;
+    }
+  }
+}
+
+/**
+ * Function: image_phash
+ * ---------------------
+ * Compute the perceptual hash of an image
+ *
+ * Parameters:
+ *  const Image *im: the image (8 or 16 bit)
+ *  unsigned long long *hash: set to the hash
+ * Returns:
+ *  -1: bad image pointer
+ *  0: success
+ */
+int image_phash(const Image *im, unsigned long long *hash) {
+  // Error check
+  if (!im || !hash || im->rows <= 0 || im->cols <= 0 || (IS_16BIT(im) ? !im->data16 : !im->data)) {
+    fprintf(stderr, "Error:phash - image_phash given a bad image pointer\n");
+    return -1;
+  }
+
+  // Average the gray levels down to the thumbnail, one row of the image at a time
+  int rowFirst[PHASH_THUMB], rowLast[PHASH_THUMB], colFirst[PHASH_THUMB], colLast[PHASH_THUMB];
+  double thumb[PHASH_THUMB][PHASH_THUMB] = { { 0 } }, cells[PHASH_THUMB];
+  cell_spans(im->rows, rowFirst, rowLast);
+  cell_spans(im->cols, colFirst, colLast);
+  for (int r = 0, cell = 0; r < im->rows; r++) {
+    for (int j = 0; j < PHASH_THUMB; j++) {
+      double sum = 0;
+      for (int c = colFirst[j]; c < colLast[j]; c++) {
+        size_t i = (size_t)r * im->cols + c;
+        sum += IS_16BIT(im) ? pixel16_to_gray(&im->data16[i]) : pixel_to_gray(&im->data[i]);
+      }
+      cells[j] = sum / (colLast[j] - colFirst[j]);
+    }
+    while (cell < PHASH_THUMB && rowLast[cell] <= r) {
+      cell++;
+    }
+    for (int i = cell; i < PHASH_THUMB && rowFirst[i] <= r; i++) {
+      for (int j = 0; j < PHASH_THUMB; j++) {
+        thumb[i][j] += cells[j] / ((rowLast[i] - rowFirst[i]) * (double)im->maxval);
+      }
+    }
+  }
+
+  // The lowest frequencies of the orthonormal DCT of the thumbnail, rows then columns
+  const double pi = 3.14159265358979323846;
+  double basis[PHASH_FREQS][PHASH_THUMB], partial[PHASH_FREQS][PHASH_THUMB], freqs[PHASH_FREQS * PHASH_FREQS];
+  for (int u = 0; u < PHASH_FREQS; u++) {
+    for (int x = 0; x < PHASH_THUMB; x++) {
+      basis[u][x] = sqrt((u ? 2.0 : 1.0) / PHASH_THUMB) * cos((2 * x + 1) * u * pi / (2 * PHASH_THUMB));
+    }
+  }
+  for (int v = 0; v < PHASH_FREQS; v++) {
+    for (int x = 0; x < PHASH_THUMB; x++) {
+      partial[v][x] = 0;
+      for (int y = 0; y < PHASH_THUMB; y++) {
+        partial[v][x] += basis[v][y] * thumb[y][x];
+      }
+    }
+  }
+  for (int v = 0; v < PHASH_FREQS; v++) {
+    for (int u = 0; u < PHASH_FREQS; u++) {
+      double sum = 0;
+      for (int x = 0; x < PHASH_THUMB; x++) {
+        sum += basis[u][x] * partial[v][x];
+      }
+      freqs[v * PHASH_FREQS + u] = sum;
+    }
+  }
+
+  // Compare each frequency with the median of all but the mean (the first), which
+  // would otherwise outweigh them
+  double sorted[PHASH_FREQS * PHASH_FREQS - 1];
+  memcpy(sorted, freqs + 1, sizeof(sorted));
+  for (int i = 1; i < PHASH_FREQS * PHASH_FREQS - 1; i++) {
+    double v = sorted[i];
+    int j = i;
+    for (; j > 0 && sorted[j-1] > v; j--) {
+      sorted[j] = sorted[j-1];
+    }
+    sorted[j] = v;
+  }
+  double median = sorted[(PHASH_FREQS * PHASH_FREQS - 1) / 2];
+  *hash = 0;
+  for (int i = 0; i < PHASH_FREQS * PHASH_FREQS; i++) {
+    if (freqs[i] > median) {
+      *hash |= 1ULL << i;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Function: hash_files_band
+ * -------------------------
+ * Read and hash a range of the files
+ *
+ * Parameters:
+ *  void *ctx: the PhashFilesJob
+ *  int band: index of the range (unused)
+ *  int i0: first file of the range
+ *  int i1: one past the last file of the range
+ * Returns:
+ *  void
+ */
+static void hash_files_band(void *ctx, int band, int i0, int i1) {
+  PhashFilesJob *job = ctx;
+  (void)band;
+
+  for (int i = i0; i < i1; i++) {
+    job->ok[i] = 0;
+    FILE *fp = fopen(job->names[i], "rb");
+    if (!fp) {
+      continue;
+    }
+    Image *im = is_ppz(fp) ? read_ppz(fp) : read_ppm(fp);
+    fclose(fp);
+    if (im) {
+      job->ok[i] = image_phash(im, &job->hashes[i]) == 0;
+      free_image(&im);
+    }
+  }
+}
+
+/**
+ * Function: phash_files
+ * ---------------------
+ * Compute the perceptual hashes of image files (PPM or PPZ); the files are read and
+ * hashed on several threads
+ *
+ * Parameters:
+ *  char *const *names: the file names
+ *  int n: the number of files
+ *  unsigned long long *hashes: set to the n hashes
+ *  int *ok: set to 1 for each file that was read, 0 for the others
+ * Returns:
+ *  void
+ */
+void phash_files(char *const *names, int n, unsigned long long *hashes, int *ok) {
+  PhashFilesJob job = { names, hashes, ok };
+  parallel_for_range(n, 1, hash_files_band, &job);
+}
+
+/**
+ * Function: make_phash_index
+ * --------------------------
+ * Make an empty index
+ *
+ * Parameters:
+ *  void
+ * Returns:
+ *  PhashIndex *: the index, NULL if memory runs out
+ */
+static PhashIndex *make_phash_index(void) {
+  PhashIndex *idx = calloc(1, sizeof(PhashIndex));
+  if (!idx || !(idx->heads = malloc(sizeof(int) * PHASH_CHUNKS * CHUNK_VALUES))) {
+    free(idx);
+    return NULL;
+  }
+  memset(idx->heads, -1, sizeof(int) * PHASH_CHUNKS * CHUNK_VALUES);
+  return idx;
+}
+
+/**
+ * Function: phash_index_add
+ * -------------------------
+ * Add an entry to the index
+ *
+ * Parameters:
+ *  PhashIndex *idx: the index
+ *  unsigned long long hash: the hash of the image
+ *  const char *name: its name (without line breaks)
+ * Returns:
+ *  -1: bad name or allocation failure
+ *  0: success
+ */
+int phash_index_add(PhashIndex *idx, unsigned long long hash, const char *name) {
+  // Error check
+  if (!idx || !name || strpbrk(name, "\r\n")) {
+    fprintf(stderr, "Error:phash - phash_index_add given a bad index pointer or name\n");
+    return -1;
+  }
+
+  // Grow the entries (next holds PHASH_CHUNKS links per entry, so it grows in place)
+  if (idx->count == idx->capacity) {
+    int capacity = idx->capacity ? 2 * idx->capacity : 1024;
+    unsigned long long *hashes = realloc(idx->hashes, sizeof(unsigned long long) * capacity);
+    if (hashes) {
+      idx->hashes = hashes;
+    }
+    char **names = realloc(idx->names, sizeof(char *) * capacity);
+    if (names) {
+      idx->names = names;
+    }
+    int *next = realloc(idx->next, sizeof(int) * PHASH_CHUNKS * capacity);
+    if (next) {
+      idx->next = next;
+    }
+    if (!hashes || !names || !next) {
+      fprintf(stderr, "Error:phash - phash_index_add failed to allocate memory\n");
+      return -1;
+    }
+    idx->capacity = capacity;
+  }
+  size_t len = strlen(name);
+  char *copy = malloc(len + 1);
+  if (!copy) {
+    fprintf(stderr, "Error:phash - phash_index_add failed to allocate memory\n");
+    return -1;
+  }
+  memcpy(copy, name, len + 1);
+
+  // Link the entry into the bucket of each of its chunks
+  int e = idx->count++;
+  idx->hashes[e] = hash;
+  idx->names[e] = copy;
+  for (int k = 0; k < PHASH_CHUNKS; k++) {
+    int *head = &idx->heads[k * CHUNK_VALUES + chunk(hash, k)];
+    idx->next[e * PHASH_CHUNKS + k] = *head;
+    *head = e;
+  }
+  return 0;
+}
+
+/**
+ * Function: phash_index_load
+ * --------------------------
+ * Read an index file; a file that does not exist yet gives an empty index
+ *
+ * Parameters:
+ *  const char *path: the index file
+ * Returns:
+ *  PhashIndex *: the index, NULL if the file is not an index or memory runs out
+ */
+PhashIndex *phash_index_load(const char *path) {
+  PhashIndex *idx = make_phash_index();
+  if (!idx) {
+    fprintf(stderr, "Error:phash - phash_index_load failed to allocate memory\n");
+    return NULL;
+  }
+  FILE *fp = fopen(path, "r");
+  if (!fp) {
+    if (errno == ENOENT) {
+      return idx;
+    }
+    fprintf(stderr, "Error:phash - phash_index_load failed to open %s\n", path);
+    free_phash_index(&idx);
+    return NULL;
+  }
+
+  char *line = NULL;
+  size_t size = 0;
+  ssize_t len = getline(&line, &size, fp);
+  int failed = len < 0 || strcmp(line, PHASH_MAGIC "\n") != 0;
+  while (!failed && (len = getline(&line, &size, fp)) > 0) {
+    // "<16 hex digits> <name>"
+    if (line[len-1] == '\n') {
+      line[--len] = '\0';
+    }
+    char *end;
+    unsigned long long hash = strtoull(line, &end, 16);
+    failed = end != line + 16 || *end != ' ' || phash_index_add(idx, hash, end + 1) != 0;
+  }
+  free(line);
+  fclose(fp);
+  if (failed) {
+    fprintf(stderr, "Error:phash - %s is not a valid index file\n", path);
+    free_phash_index(&idx);
+    return NULL;
+  }
+  idx->saved = idx->count;
+  idx->has_file = 1;
+  return idx;
+}
+
+/**
+ * Function: phash_index_save
+ * --------------------------
+ * Append the entries added since the index was loaded (or last saved) to its file
+ *
+ * Parameters:
+ *  PhashIndex *idx: the index
+ *  const char *path: the index file it was loaded from
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int phash_index_save(PhashIndex *idx, const char *path) {
+  // Error check
+  if (!idx || !path) {
+    fprintf(stderr, "Error:phash - phash_index_save given a bad index pointer\n");
+    return -1;
+  }
+
+  FILE *fp = fopen(path, "a");
+  int failed = !fp || (!idx->has_file && fprintf(fp, PHASH_MAGIC "\n") < 0);
+  for (int e = idx->saved; !failed && e < idx->count; e++) {
+    failed = fprintf(fp, "%016llx %s\n", idx->hashes[e], idx->names[e]) < 0;
+  }
+  if ((fp && fclose(fp) != 0) || failed) {
+    fprintf(stderr, "Error:phash - phash_index_save failed to write %s\n", path);
+    return -1;
+  }
+  idx->saved = idx->count;
+  idx->has_file = 1;
+  return 0;
+}
+
+/**
+ * Function: probe
+ * ---------------
+ * Visit the buckets of one chunk's table whose values differ from the query's chunk
+ * in at most flips of the bits from bit on, then report the entries within the
+ * distance that were not already found through an earlier chunk
+ *
+ * Parameters:
+ *  PhashQuery *q: the query
+ *  int k: the chunk
+ *  unsigned value: the chunk value of the bucket
+ *  int bit: the lowest bit still to be flipped
+ *  int flips: how many more bits may be flipped
+ * Returns:
+ *  void
+ */
+static void probe(PhashQuery *q, int k, unsigned value, int bit, int flips) {
+  const PhashIndex *idx = q->idx;
+  for (int e = idx->heads[k * CHUNK_VALUES + value]; e >= 0; e = idx->next[e * PHASH_CHUNKS + k]) {
+    int earlier = 0;
+    for (int j = 0; j < k && !earlier; j++) {
+      earlier = phash_distance(chunk(idx->hashes[e], j), chunk(q->hash, j)) <= q->radius;
+    }
+    int distance = phash_distance(idx->hashes[e], q->hash);
+    if (!earlier && distance <= q->distance) {
+      q->fn(q->ctx, e, distance);
+      q->found++;
+    }
+  }
+  for (; flips > 0 && bit < 16; bit++) {
+    probe(q, k, value ^ (1u << bit), bit + 1, flips - 1);
+  }
+}
+
+/**
+ * Function: phash_index_query
+ * ---------------------------
+ * Find every entry of the index within a Hamming distance of a hash; each one is
+ * reported once
+ *
+ * Parameters:
+ *  const PhashIndex *idx: the index
+ *  unsigned long long hash: the hash
+ *  int distance: the largest distance, 0 to PHASH_MAX_DISTANCE
+ *  phash_match_fn fn: called for each entry found
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  the number of entries found, -1 on a bad distance
+ */
+int phash_index_query(const PhashIndex *idx, unsigned long long hash, int distance, phash_match_fn fn, void *ctx) {
+  // Error check
+  if (!idx || !fn || distance < 0 || distance > PHASH_MAX_DISTANCE) {
+    fprintf(stderr, "Error:phash - phash_index_query given a bad index pointer or distance\n");
+    return -1;
+  }
+
+  PhashQuery q = { idx, hash, distance, distance / PHASH_CHUNKS, fn, ctx, 0 };
+  for (int k = 0; k < PHASH_CHUNKS; k++) {
+    probe(&q, k, chunk(hash, k), 0, q.radius);
+  }
+  return q.found;
+}
+
+/**
+ * Function: free_phash_index
+ * --------------------------
+ * utility function to free an index and set the pointer to null
+ *
+ * Parameters:
+ *  PhashIndex **idx: pointer to the index to be freed
+ * Returns:
+ *  void
+ */
+void free_phash_index(PhashIndex **idx) {
+  PhashIndex *rmv = *idx;
+  for (int e = 0; e < rmv->count; e++) {
+    free(rmv->names[e]);
+  }
+  free(rmv->hashes);
+  free(rmv->names);
+  free(rmv->heads);
+  free(rmv->next);
+  free(rmv);
+  *idx = NULL;
+}
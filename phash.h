@@ -0,0 +1,167 @@
+/**
+ * @file phash.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for perceptual hashes and the near-duplicate index
+ *
+ * The perceptual hash of an image is 64 bits: the image is averaged down to a
+ * PHASH_THUMB square of gray levels (as zoom-out averages, but to a fixed size), the
+ * 8x8 lowest frequencies of its DCT are taken, and each bit tells whether one of them
+ * is above their median. Resizing, recompression and small edits flip few bits, so
+ * near-duplicates are images whose hashes are a small Hamming distance apart.
+ *
+ * The index keeps the hashes of a set of images in a text file, one "<hex hash>
+ * <name>" line each. In memory it is searched by multi-index hashing: the hash is cut
+ * into PHASH_CHUNKS chunks of 16 bits, each with a table of the entries by chunk
+ * value. Two hashes within distance d agree within d / PHASH_CHUNKS bits on at least
+ * one chunk, so a query only visits the table buckets that close to its own chunks.
+ */
+
+// If not defined, define PHASH_H
+#ifndef PHASH_H
+#define PHASH_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Side of the gray thumbnail the hash is computed from
+#define PHASH_THUMB 32
+
+// The hash is cut into this many 16 bit chunks for the index tables
+#define PHASH_CHUNKS 4
+
+// Largest query distance: every chunk is then probed within 3 bits (697 buckets)
+#define PHASH_MAX_DISTANCE 15
+
+// Default query distance of near-duplicates
+#define PHASH_DEFAULT_DISTANCE 8
+
+// The hashes of a set of images
+typedef struct _phash_index {
+  unsigned long long *hashes;
+  char **names;
+  int count;
+  int capacity;
+  int saved;     // entries already in the index file
+  int has_file;  // the index file exists (with its first line)
+  int *heads;    // PHASH_CHUNKS * 65536 first entries of the buckets, -1 if empty
+  int *next;     // PHASH_CHUNKS * capacity next entries in the same bucket
+} PhashIndex;
+
+// Called with the number and distance of each entry a query finds
+typedef void (*phash_match_fn)(void *ctx, int entry, int distance);
+
+/**
+ * Function: image_phash
+ * ---------------------
+ * Compute the perceptual hash of an image
+ *
+ * Parameters:
+ *  const Image *im: the image (8 or 16 bit)
+ *  unsigned long long *hash: set to the hash
+ * Returns:
+ *  -1: bad image pointer
+ *  0: success
+ */
+int image_phash(const Image *im, unsigned long long *hash);
+
+/**
+ * Function: phash_files
+ * ---------------------
+ * Compute the perceptual hashes of image files (PPM or PPZ); the files are read and
+ * hashed on several threads
+ *
+ * Parameters:
+ *  char *const *names: the file names
+ *  int n: the number of files
+ *  unsigned long long *hashes: set to the n hashes
+ *  int *ok: set to 1 for each file that was read, 0 for the others
+ * Returns:
+ *  void
+ */
+void phash_files(char *const *names, int n, unsigned long long *hashes, int *ok);
+
+/**
+ * Function: phash_distance
+ * ------------------------
+ * The Hamming distance of two hashes
+ *
+ * Parameters:
+ *  unsigned long long a: one hash
+ *  unsigned long long b: the other hash
+ * Returns:
+ *  the number of bits they differ in
+ */
+int phash_distance(unsigned long long a, unsigned long long b);
+
+/**
+ * Function: phash_index_load
+ * --------------------------
+ * Read an index file; a file that does not exist yet gives an empty index
+ *
+ * Parameters:
+ *  const char *path: the index file
+ * Returns:
+ *  PhashIndex *: the index, NULL if the file is not an index or memory runs out
+ */
+PhashIndex *phash_index_load(const char *path);
+
+/**
+ * Function: phash_index_save
+ * --------------------------
+ * Append the entries added since the index was loaded (or last saved) to its file
+ *
+ * Parameters:
+ *  PhashIndex *idx: the index
+ *  const char *path: the index file it was loaded from
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int phash_index_save(PhashIndex *idx, const char *path);
+
+/**
+ * Function: phash_index_add
+ * -------------------------
+ * Add an entry to the index
+ *
+ * Parameters:
+ *  PhashIndex *idx: the index
+ *  unsigned long long hash: the hash of the image
+ *  const char *name: its name (without line breaks)
+ * Returns:
+ *  -1: bad name or allocation failure
+ *  0: success
+ */
+int phash_index_add(PhashIndex *idx, unsigned long long hash, const char *name);
+
+/**
+ * Function: phash_index_query
+ * ---------------------------
+ * Find every entry of the index within a Hamming distance of a hash; each one is
+ * reported once
+ *
+ * Parameters:
+ *  const PhashIndex *idx: the index
+ *  unsigned long long hash: the hash
+ *  int distance: the largest distance, 0 to PHASH_MAX_DISTANCE
+ *  phash_match_fn fn: called for each entry found
+ *  void *ctx: passed unchanged to fn
+ * Returns:
+ *  the number of entries found, -1 on a bad distance
+ */
+int phash_index_query(const PhashIndex *idx, unsigned long long hash, int distance, phash_match_fn fn, void *ctx);
+
+/**
+ * Function: free_phash_index
+ * --------------------------
+ * utility function to free an index and set the pointer to null
+ *
+ * Parameters:
+ *  PhashIndex **idx: pointer to the index to be freed
+ * Returns:
+ *  void
+ */
+void free_phash_index(PhashIndex **idx);
+
+// End of header file
+#endif
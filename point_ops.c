@@ -0,0 +1,352 @@
+/**
+ * @file point_ops.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Composing per-pixel operations into lookup tables
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "point_ops.h"
+#include "parallel.h"
+
+// A mapping of one sample value, given the maxval and the mapping's parameters
+typedef int (*value_fn)(int v, int maxval, const double *params);
+
+// Shared state of one point_op_apply call
+typedef struct _apply_job {
+  Image *im;
+  const PointOp *op;
+} ApplyJob;
+
+/**
+ * Function: clamp_sample
+ * ----------------------
+ * Clamp a value into [0, maxval]
+ *
+ * Parameters:
+ *  long v: the value
+ *  int maxval: the maximum sample value
+ * Returns:
+ *  the clamped value
+ */
+static int clamp_sample(long v, int maxval) {
+  return v < 0 ? 0 : (v > maxval ? maxval : (int)v);
+}
+
+/**
+ * Function: compose
+ * -----------------
+ * Append a mapping that treats every channel the same: each table entry is passed
+ * through the mapping
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  value_fn fn: the mapping
+ *  const double *params: the parameters of the mapping
+ * Returns:
+ *  void
+ */
+static void compose(PointOp *op, value_fn fn, const double *params) {
+  for (int c = 0; c < 3; c++) {
+    unsigned short *lut = op->lut[c];
+    for (int v = 0; v <= op->maxval; v++) {
+      lut[v] = (unsigned short)fn(lut[v], op->maxval, params);
+    }
+  }
+}
+
+/**
+ * Function: point_op_init
+ * -----------------------
+ * Start an empty chain (the identity) for images with the given maxval
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  int maxval: the maxval of the images it will be applied to
+ * Returns:
+ *  0 on success, -1 if memory runs out
+ */
+int point_op_init(PointOp *op, int maxval) {
+  op->maxval = maxval;
+  op->tables = malloc(sizeof(unsigned short) * 3 * (maxval + 1));
+  if (!op->tables) {
+    return -1;
+  }
+  for (int c = 0; c < 3; c++) {
+    op->shuffle[c] = c;
+    op->lut[c] = op->tables + c * (maxval + 1);
+    for (int v = 0; v <= maxval; v++) {
+      op->lut[c][v] = (unsigned short)v;
+    }
+  }
+  return 0;
+}
+
+/**
+ * Function: point_op_free
+ * -----------------------
+ * Free the lookup tables of a chain
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ * Returns:
+ *  void
+ */
+void point_op_free(PointOp *op) {
+  free(op->tables);
+  op->tables = op->lut[0] = op->lut[1] = op->lut[2] = NULL;
+}
+
+/**
+ * Function: point_op_swap
+ * -----------------------
+ * Append the channel rotation done by swap(): red takes green, green takes blue and
+ * blue takes red
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ * Returns:
+ *  void
+ */
+void point_op_swap(PointOp *op) {
+  // Output channel c now reads what channel c + 1 produced, table and all
+  int shuffle = op->shuffle[0];
+  unsigned short *lut = op->lut[0];
+  op->shuffle[0] = op->shuffle[1];
+  op->shuffle[1] = op->shuffle[2];
+  op->shuffle[2] = shuffle;
+  op->lut[0] = op->lut[1];
+  op->lut[1] = op->lut[2];
+  op->lut[2] = lut;
+}
+
+/**
+ * Function: invert_value
+ * ----------------------
+ * value_fn of invert(): maxval minus the sample
+ *
+ * Parameters:
+ *  int v: the sample
+ *  int maxval: the maximum sample value
+ *  const double *params: unused
+ * Returns:
+ *  the mapped sample
+ */
+static int invert_value(int v, int maxval, const double *params) {
+  (void)params;
+  return maxval - v;
+}
+
+/**
+ * Function: point_op_invert
+ * -------------------------
+ * Append invert(): every sample becomes maxval minus itself
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ * Returns:
+ *  void
+ */
+void point_op_invert(PointOp *op) {
+  compose(op, invert_value, NULL);
+}
+
+/**
+ * Function: brightness_value
+ * --------------------------
+ * value_fn of brightness: the sample plus the amount, clamped
+ *
+ * Parameters:
+ *  int v: the sample
+ *  int maxval: the maximum sample value
+ *  const double *params: params[0] is the amount on the maxval scale
+ * Returns:
+ *  the mapped sample
+ */
+static int brightness_value(int v, int maxval, const double *params) {
+  return clamp_sample(v + lround(params[0]), maxval);
+}
+
+/**
+ * Function: point_op_brightness
+ * -----------------------------
+ * Append a brightness change: amount is added to every sample, clamped
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  int amount: the change, on the 0 to 255 scale (scaled up for 16 bit images)
+ * Returns:
+ *  void
+ */
+void point_op_brightness(PointOp *op, int amount) {
+  double params[1] = { amount * op->maxval / 255.0 };
+  compose(op, brightness_value, params);
+}
+
+/**
+ * Function: contrast_value
+ * ------------------------
+ * value_fn of contrast: the sample scaled away from mid gray, clamped
+ *
+ * Parameters:
+ *  int v: the sample
+ *  int maxval: the maximum sample value
+ *  const double *params: params[0] is the factor
+ * Returns:
+ *  the mapped sample
+ */
+static int contrast_value(int v, int maxval, const double *params) {
+  double mid = (maxval + 1) / 2.0;
+  return clamp_sample(lround((v - mid) * params[0] + mid), maxval);
+}
+
+/**
+ * Function: point_op_contrast
+ * ---------------------------
+ * Append a contrast change: samples are scaled by factor away from mid gray, clamped
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  double factor: the scale (1 keeps the image, 0 makes it flat gray)
+ * Returns:
+ *  void
+ */
+void point_op_contrast(PointOp *op, double factor) {
+  compose(op, contrast_value, &factor);
+}
+
+/**
+ * Function: levels_value
+ * ----------------------
+ * value_fn of levels and gamma: the sample stretched from [black, white] to
+ * [0, maxval] with a gamma curve
+ *
+ * Parameters:
+ *  int v: the sample
+ *  int maxval: the maximum sample value
+ *  const double *params: params[0], params[1] and params[2] are the black point, the
+ *                       white point (on the maxval scale) and the gamma
+ * Returns:
+ *  the mapped sample
+ */
+static int levels_value(int v, int maxval, const double *params) {
+  double t = (v - params[0]) / (params[1] - params[0]);
+  if (t <= 0) {
+    return 0;
+  }
+  if (t >= 1) {
+    return maxval;
+  }
+  return clamp_sample(lround(maxval * pow(t, 1 / params[2])), maxval);
+}
+
+/**
+ * Function: point_op_gamma
+ * ------------------------
+ * Append a gamma correction: out = maxval * (in / maxval) ^ (1 / gamma), so gamma
+ * above 1 brightens the midtones
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  double gamma: the gamma, > 0
+ * Returns:
+ *  void
+ */
+void point_op_gamma(PointOp *op, double gamma) {
+  double params[3] = { 0, op->maxval, gamma };
+  compose(op, levels_value, params);
+}
+
+/**
+ * Function: point_op_levels
+ * -------------------------
+ * Append a levels adjustment: black and everything below becomes 0, white and
+ * everything above becomes maxval, the range in between is stretched with the given
+ * gamma
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  int black: the input black point, on the 0 to 255 scale
+ *  int white: the input white point, on the 0 to 255 scale (> black)
+ *  double gamma: the midtone gamma, > 0 (1 for a linear stretch)
+ * Returns:
+ *  void
+ */
+void point_op_levels(PointOp *op, int black, int white, double gamma) {
+  double params[3] = { black * op->maxval / 255.0, white * op->maxval / 255.0, gamma };
+  compose(op, levels_value, params);
+}
+
+/**
+ * Function: apply_band
+ * --------------------
+ * Apply a chain to one band of rows
+ *
+ * Parameters:
+ *  void *ctx: the ApplyJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void apply_band(void *ctx, int band, int r0, int r1) {
+  ApplyJob *job = ctx;
+  const PointOp *op = job->op;
+  const unsigned short *lr = op->lut[0], *lg = op->lut[1], *lb = op->lut[2];
+  int sr = op->shuffle[0], sg = op->shuffle[1], sb = op->shuffle[2];
+  size_t first = (size_t)r0 * job->im->cols, last = (size_t)r1 * job->im->cols;
+  (void)band;
+
+  if (IS_16BIT(job->im)) {
+    Pixel16 *p = job->im->data16;
+    for (size_t i = first; i < last; i++) {
+      unsigned short in[3] = { p[i].r, p[i].g, p[i].b };
+      p[i].r = lr[in[sr]];
+      p[i].g = lg[in[sg]];
+      p[i].b = lb[in[sb]];
+    }
+  } else if (sr == 0 && sg == 1 && sb == 2) {
+    // No channel movement, straight table lookups
+    Pixel *p = job->im->data;
+    for (size_t i = first; i < last; i++) {
+      p[i].r = (unsigned char)lr[p[i].r];
+      p[i].g = (unsigned char)lg[p[i].g];
+      p[i].b = (unsigned char)lb[p[i].b];
+    }
+  } else {
+    Pixel *p = job->im->data;
+    for (size_t i = first; i < last; i++) {
+      unsigned char in[3] = { p[i].r, p[i].g, p[i].b };
+      p[i].r = (unsigned char)lr[in[sr]];
+      p[i].g = (unsigned char)lg[in[sg]];
+      p[i].b = (unsigned char)lb[in[sb]];
+    }
+  }
+}
+
+/**
+ * Function: point_op_apply
+ * ------------------------
+ * Apply a chain to an image in one pass; row bands run in parallel
+ *
+ * Parameters:
+ *  Image *im: the image, whose maxval must be the one the chain was built for
+ *  const PointOp *op: the chain
+ * Returns:
+ *  0 on success, -1 on a bad image pointer or a maxval mismatch
+ */
+int point_op_apply(Image *im, const PointOp *op) {
+  // Error check
+  if (!im || !op || im->maxval != op->maxval || (IS_16BIT(im) ? !im->data16 : !im->data)) {
+    fprintf(stderr, "Error:point_ops - point_op_apply given a bad image pointer\n");
+    return -1;
+  }
+  ApplyJob job;
+  job.im = im;
+  job.op = op;
+  parallel_for_bands(im->rows, apply_band, &job);
+  return 0;
+}
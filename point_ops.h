@@ -0,0 +1,150 @@
+/**
+ * @file point_ops.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for composing per-pixel operations into lookup tables
+ *
+ * A PointOp is any chain of operations in which every output sample depends only on
+ * one input sample of the same pixel (invert, channel swaps, brightness, contrast,
+ * gamma, levels). However long the chain, it folds into a channel shuffle followed by
+ * one lookup table per channel:
+ *   out.channel[c] = lut[c][in.channel[shuffle[c]]]
+ * so applying it costs a single pass over the pixels.
+ */
+
+// If not defined, define POINT_OPS_H
+#ifndef POINT_OPS_H
+#define POINT_OPS_H
+
+// Include header files
+#include "ppm_io.h"
+
+// A composed chain of point operations for images of one maxval
+typedef struct _point_op {
+  int maxval;
+  int shuffle[3];           // input channel feeding each output channel (r, g, b)
+  unsigned short *lut[3];   // maxval + 1 entries per output channel
+  unsigned short *tables;   // the block holding the three tables
+} PointOp;
+
+/**
+ * Function: point_op_init
+ * -----------------------
+ * Start an empty chain (the identity) for images with the given maxval
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  int maxval: the maxval of the images it will be applied to
+ * Returns:
+ *  0 on success, -1 if memory runs out
+ */
+int point_op_init(PointOp *op, int maxval);
+
+/**
+ * Function: point_op_free
+ * -----------------------
+ * Free the lookup tables of a chain
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ * Returns:
+ *  void
+ */
+void point_op_free(PointOp *op);
+
+/**
+ * Function: point_op_swap
+ * -----------------------
+ * Append the channel rotation done by swap(): red takes green, green takes blue and
+ * blue takes red
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ * Returns:
+ *  void
+ */
+void point_op_swap(PointOp *op);
+
+/**
+ * Function: point_op_invert
+ * -------------------------
+ * Append invert(): every sample becomes maxval minus itself
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ * Returns:
+ *  void
+ */
+void point_op_invert(PointOp *op);
+
+/**
+ * Function: point_op_brightness
+ * -----------------------------
+ * Append a brightness change: amount is added to every sample, clamped
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  int amount: the change, on the 0 to 255 scale (scaled up for 16 bit images)
+ * Returns:
+ *  void
+ */
+void point_op_brightness(PointOp *op, int amount);
+
+/**
+ * Function: point_op_contrast
+ * ---------------------------
+ * Append a contrast change: samples are scaled by factor away from mid gray, clamped
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  double factor: the scale (1 keeps the image, 0 makes it flat gray)
+ * Returns:
+ *  void
+ */
+void point_op_contrast(PointOp *op, double factor);
+
+/**
+ * Function: point_op_gamma
+ * ------------------------
+ * Append a gamma correction: out = maxval * (in / maxval) ^ (1 / gamma), so gamma
+ * above 1 brightens the midtones
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  double gamma: the gamma, > 0
+ * Returns:
+ *  void
+ */
+void point_op_gamma(PointOp *op, double gamma);
+
+/**
+ * Function: point_op_levels
+ * -------------------------
+ * Append a levels adjustment: black and everything below becomes 0, white and
+ * everything above becomes maxval, the range in between is stretched with the given
+ * gamma
+ *
+ * Parameters:
+ *  PointOp *op: the chain
+ *  int black: the input black point, on the 0 to 255 scale
+ *  int white: the input white point, on the 0 to 255 scale (> black)
+ *  double gamma: the midtone gamma, > 0 (1 for a linear stretch)
+ * Returns:
+ *  void
+ */
+void point_op_levels(PointOp *op, int black, int white, double gamma);
+
+/**
+ * Function: point_op_apply
+ * ------------------------
+ * Apply a chain to an image in one pass; row bands run in parallel
+ *
+ * Parameters:
+ *  Image *im: the image, whose maxval must be the one the chain was built for
+ *  const PointOp *op: the chain
+ * Returns:
+ *  0 on success, -1 on a bad image pointer or a maxval mismatch
+ */
+int point_op_apply(Image *im, const PointOp *op);
+
+// End of header file
+#endif
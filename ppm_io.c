@@ -4,13 +4,38 @@
  * @brief Source file for reading and writing PPM images
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 // Include the header files
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "ppm_io.h"
+#include "parallel.h"
+
+// Payloads from this size up are read and written by several threads with pread and
+// pwrite when the file is a regular file; smaller ones go through stdio
+#define PARALLEL_IO_MIN ((size_t)32 << 20)
+
+// Each thread moves at least this many bytes, and converts 16 bit samples in buffers
+// of at most this size
+#define PARALLEL_IO_CHUNK ((size_t)8 << 20)
+
+// Shared state of one parallel payload transfer
+typedef struct _payload_job {
+    int fd;
+    off_t offset;          // file offset of the first payload byte
+    unsigned char *pixels;
+    size_t row_bytes;
+    int wide;              // 16 bit samples, stored big endian in the file
+    char *failed;          // one flag per band
+} PayloadJob;
 
 /**
  * Function: read_num
@@ -48,82 +73,469 @@ int read_num(FILE *fp) {
 }
 
 /**
- * Function: read_ppm
- * ------------------
- * Read a PPM image from a file pointer and return an Image struct pointer
+ * Function: read_maxval
+ * ---------------------
+ * helper function for read_ppm_header, reads the maxval field and then exactly one
+ * whitespace character, since the first payload byte may itself look like whitespace
  * 
  * Parameters:
  *  FILE *fp: file pointer
  * Returns:
- *  Image *: image pointer
+ *  -1: If failed to read number from file
+ *  val: value of the number
  */
-Image *read_ppm(FILE *fp) {
-    /* confirm that we received a good file handle */
-    assert(fp != NULL);
+static int read_maxval(FILE *fp) {
+    int ch;
+    while ((ch = fgetc(fp)) == '#' || isspace(ch)) {
+        if (ch == '#') {
+            while (((ch = fgetc(fp)) != '\n') && ch != EOF) {
+                /* discard characters til end of line */
+            }
+        }
+    }
+    ungetc(ch, fp);
 
-    /* allocate image (but not space to hold pixels -- yet) */
-    Image *im = malloc(sizeof(Image));
-    if (!im) {
-        fprintf(stderr, "Error:ppm_io - failed to allocate memory for image!\n");
-        return NULL;
+    int val;
+    if (fscanf(fp, "%d", &val) != 1 || !isspace(fgetc(fp))) {
+        fprintf(stderr, "Error:ppm_io - failed to read number from file\n");
+        return -1;
+    }
+    return val;
+}
+
+/**
+ * Function: samples_from_big_endian
+ * ---------------------------------
+ * helper function that converts 16 bit samples read from a file (most significant byte
+ * first, as PPM stores them) into host byte order, in place
+ * 
+ * Parameters:
+ *  Pixel16 *data: the pixels to be converted
+ *  size_t count: number of pixels
+ * Returns:
+ *  void
+ */
+static void samples_from_big_endian(Pixel16 *data, size_t count) {
+    unsigned short *samples = (unsigned short *) data;
+    for (size_t i = 0; i < count * 3; i++) {
+        const unsigned char *bytes = (const unsigned char *) &samples[i];
+        samples[i] = (unsigned short) ((bytes[0] << 8) | bytes[1]);
+    }
+}
+
+/**
+ * Function: pixel_bytes
+ * ---------------------
+ * helper function returning the size of one stored pixel for an image depth
+ * 
+ * Parameters:
+ *  int maxval: maximum sample value of the image
+ * Returns:
+ *  3 for 8 bit images, 6 for 16 bit images
+ */
+static size_t pixel_bytes(int maxval) {
+    return maxval > 255 ? sizeof(Pixel16) : sizeof(Pixel);
+}
+
+/**
+ * Function: parallel_io_fd
+ * ------------------------
+ * helper function deciding whether a payload goes through pread/pwrite threads
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer, positioned at the first payload byte
+ *  size_t bytes: size of the payload
+ *  int writing: 1 for writes, which cannot be positioned in append mode
+ * Returns:
+ *  -1: If the payload is small or the file is not a regular file
+ *  fd: the descriptor of the file
+ */
+static int parallel_io_fd(FILE *fp, size_t bytes, int writing) {
+    struct stat st;
+    int fd = fileno(fp);
+    if (bytes < PARALLEL_IO_MIN || fd < 0 ||
+        fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+    if (writing && (fcntl(fd, F_GETFL) & O_APPEND)) {
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Function: read_band
+ * -------------------
+ * helper function for read_payload, preads one band of rows and converts its 16 bit samples
+ * 
+ * Parameters:
+ *  void *ctx: the PayloadJob
+ *  int band: index of the band
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void read_band(void *ctx, int band, int r0, int r1) {
+    PayloadJob *job = ctx;
+    unsigned char *dst = job->pixels + (size_t) r0 * job->row_bytes;
+    size_t bytes = (size_t) (r1 - r0) * job->row_bytes;
+    off_t offset = job->offset + (off_t) r0 * (off_t) job->row_bytes;
+
+    for (size_t done = 0; done < bytes; ) {
+        ssize_t got = pread(job->fd, dst + done, bytes - done, offset + (off_t) done);
+        if (got <= 0) {
+            job->failed[band] = 1;
+            return;
+        }
+        done += (size_t) got;
+    }
+    if (job->wide) {
+        samples_from_big_endian((Pixel16 *) dst, bytes / sizeof(Pixel16));
+    }
+}
+
+/**
+ * Function: write_band
+ * --------------------
+ * helper function for write_payload, pwrites one band of rows, 16 bit samples converted
+ * to big endian through a bounded buffer
+ * 
+ * Parameters:
+ *  void *ctx: the PayloadJob
+ *  int band: index of the band
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Returns:
+ *  void
+ */
+static void write_band(void *ctx, int band, int r0, int r1) {
+    PayloadJob *job = ctx;
+    size_t step = job->wide ? PARALLEL_IO_CHUNK / job->row_bytes : (size_t) (r1 - r0);
+    unsigned char *buffer = NULL;
+    if (step == 0) {
+        step = 1;
+    }
+    if (job->wide && !(buffer = malloc(step * job->row_bytes))) {
+        job->failed[band] = 1;
+        return;
+    }
+
+    for (int r = r0; r < r1; r += (int) step) {
+        int rEnd = r + (int) step < r1 ? r + (int) step : r1;
+        size_t bytes = (size_t) (rEnd - r) * job->row_bytes;
+        const unsigned char *src = job->pixels + (size_t) r * job->row_bytes;
+        off_t offset = job->offset + (off_t) r * (off_t) job->row_bytes;
+        if (job->wide) {
+            const unsigned short *samples = (const unsigned short *) src;
+            for (size_t i = 0; i < bytes / 2; i++) {
+                buffer[2 * i] = (unsigned char) (samples[i] >> 8);
+                buffer[2 * i + 1] = (unsigned char) (samples[i] & 0xff);
+            }
+            src = buffer;
+        }
+        for (size_t done = 0; done < bytes; ) {
+            ssize_t put = pwrite(job->fd, src + done, bytes - done, offset + (off_t) done);
+            if (put <= 0) {
+                job->failed[band] = 1;
+                free(buffer);
+                return;
+            }
+            done += (size_t) put;
+        }
+    }
+    free(buffer);
+}
+
+/**
+ * Function: transfer_payload
+ * --------------------------
+ * helper function running read_band or write_band over bands of rows in parallel and
+ * leaving the file pointer just past the payload
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer, positioned at the first payload byte
+ *  int fd: its descriptor
+ *  void *pixels: the pixel array
+ *  int rows: number of rows
+ *  size_t row_bytes: bytes per stored row
+ *  int wide: 1 for 16 bit samples
+ *  band_fn fn: read_band or write_band
+ * Returns:
+ *  -1: If any band failed
+ *  0: On success
+ */
+static int transfer_payload(FILE *fp, int fd, void *pixels, int rows, size_t row_bytes, int wide, band_fn fn) {
+    off_t offset = ftello(fp);
+    int min_rows = (int) (PARALLEL_IO_CHUNK / row_bytes) + 1;
+    int bands = parallel_range_count(rows, min_rows);
+    char *failed = calloc((size_t) bands, 1);
+    if (offset < 0 || !failed) {
+        free(failed);
+        return -1;
     }
 
-    /* initialize fields to error codes, in case we have to bail out early */
-    im->rows = im->cols = -1;
+    PayloadJob job;
+    job.fd = fd;
+    job.offset = offset;
+    job.pixels = pixels;
+    job.row_bytes = row_bytes;
+    job.wide = wide;
+    job.failed = failed;
+    parallel_for_range(rows, min_rows, fn, &job);
+
+    int rc = 0;
+    for (int b = 0; b < bands; b++) {
+        rc |= failed[b];
+    }
+    free(failed);
+    if (rc || fseeko(fp, offset + (off_t) rows * (off_t) row_bytes, SEEK_SET) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Function: read_ppm_header
+ * -------------------------
+ * Read a P6 header from a file pointer, leaving the file positioned at the first payload byte
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer
+ *  int *cols: set to the number of columns in the image
+ *  int *rows: set to the number of rows in the image
+ *  int *maxval: set to the maximum sample value of the image
+ * Returns:
+ *  -1: If the header is malformed or unsupported
+ *  0: success
+ */
+int read_ppm_header(FILE *fp, int *cols, int *rows, int *maxval) {
+    /* confirm that we received a good file handle */
+    assert(fp != NULL);
 
     /* read in tag; fail if not P6 */
     char tag[20];
     tag[19] = '\0';
-    fscanf(fp, "%19s\n", tag);
-    if (strncmp(tag, "P6", 20)) {
+    if (fscanf(fp, "%19s\n", tag) != 1 || strncmp(tag, "P6", 20)) {
         fprintf(stderr, "Error:ppm_io - not a PPM (bad tag)\n");
-        free(im);
-        return NULL;
+        return -1;
     }
 
     /* read image dimensions */
     //read in columns
-    im->cols = read_num(fp); // NOTE: cols, then rows (i.e. X size followed by Y size)
+    *cols = read_num(fp); // NOTE: cols, then rows (i.e. X size followed by Y size)
     //read in rows
-    im->rows = read_num(fp);
+    *rows = read_num(fp);
 
-    //read in colors; fail if not 255
-    int colors = read_num(fp);
-    if (colors != 255) {
-        fprintf(stderr, "Error:ppm_io - PPM file with colors different from 255\n");
-        free(im);
-        return NULL;
+    //read in colors; fail if outside of 1..65535
+    *maxval = read_maxval(fp);
+    if (*maxval <= 0 || *maxval > 65535) {
+        fprintf(stderr, "Error:ppm_io - PPM file with colors outside of 1 to 65535\n");
+        return -1;
     }
 
     //confirm that dimensions are positive
-    if (im->cols <= 0 || im->rows <= 0) {
+    if (*cols <= 0 || *rows <= 0) {
         fprintf(stderr, "Error:ppm_io - PPM file with non-positive dimensions\n");
-        free(im);
-        return NULL;
+        return -1;
     }
 
-    /* finally, read in Pixels */
-    /* allocate the right amount of space for the Pixels */
-    im->data = malloc(sizeof(Pixel) * (im->rows) * (im->cols));
+    return 0;
+}
 
-    if (!im->data) {
+/**
+ * Function: read_ppm
+ * ------------------
+ * Read a PPM image from a file pointer and return an Image struct pointer
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer
+ * Returns:
+ *  Image *: image pointer
+ */
+Image *read_ppm(FILE *fp) {
+    int cols, rows, maxval;
+    if (read_ppm_header(fp, &cols, &rows, &maxval) != 0) {
+        return NULL;
+    }
+
+    /* allocate the image and the right amount of space for the Pixels */
+    Image *im = make_image_maxval(rows, cols, maxval);
+    if (!im) {
         fprintf(stderr, "Error:ppm_io - failed to allocate memory for image pixels!\n");
-        free(im);
         return NULL;
     }
 
-    /* read in the binary Pixel data */
-    if (fread(im->data, sizeof(Pixel), (im->rows) * (im->cols), fp) !=
+    /* read in the binary Pixel data, large payloads of regular files with several threads */
+    void *pixels = IS_16BIT(im) ? (void *) im->data16 : (void *) im->data;
+    size_t row_bytes = (size_t) cols * pixel_bytes(maxval);
+    int fd = parallel_io_fd(fp, row_bytes * rows, 0);
+    if (fd >= 0) {
+        if (transfer_payload(fp, fd, pixels, rows, row_bytes, IS_16BIT(im), read_band) != 0) {
+            fprintf(stderr, "Error:ppm_io - failed to read data from file!\n");
+            free_image(&im);
+            return NULL;
+        }
+        return im;
+    }
+    if (fread(pixels, pixel_bytes(maxval), (im->rows) * (im->cols), fp) !=
         (size_t) ((im->rows) * (im->cols))) {
         fprintf(stderr, "Error:ppm_io - failed to read data from file!\n");
-        free(im);
+        free_image(&im);
         return NULL;
     }
+    if (IS_16BIT(im)) {
+        samples_from_big_endian(im->data16, (size_t) im->rows * im->cols);
+    }
 
     //return the image struct pointer
     return im;
 }
 
+/**
+ * Function: read_ppm_region
+ * -------------------------
+ * Read only the w x h window at (x, y) of a P6 payload whose header has already been
+ * consumed by read_ppm_header. Rows sit at fixed offsets after the header, so on a
+ * seekable file only the needed row spans are fetched with pread; pipes fall back
+ * to streaming past the unused bytes.
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer positioned at the start of the payload
+ *  int cols: number of columns in the stored image
+ *  int rows: number of rows in the stored image
+ *  int maxval: maximum sample value of the stored image
+ *  int x: column of the top left corner of the window
+ *  int y: row of the top left corner of the window
+ *  int w: width of the window
+ *  int h: height of the window
+ * Returns:
+ *  Image *: image holding the window, NULL on failure
+ */
+Image *read_ppm_region(FILE *fp, int cols, int rows, int maxval, int x, int y, int w, int h) {
+    assert(fp != NULL);
+
+    // the window must be non-empty and lie entirely inside the stored image
+    if (w <= 0 || h <= 0 || x < 0 || y < 0 || x > cols - w || y > rows - h) {
+        fprintf(stderr, "Error:ppm_io - region lies outside of the image\n");
+        return NULL;
+    }
+
+    Image *im = make_image_maxval(h, w, maxval);
+    if (!im) {
+        fprintf(stderr, "Error:ppm_io - failed to allocate memory for image pixels!\n");
+        return NULL;
+    }
+
+    size_t bpp = pixel_bytes(maxval);
+    size_t row_bytes = (size_t) cols * bpp;
+    size_t span_bytes = (size_t) w * bpp;
+    unsigned char *pixels = IS_16BIT(im) ? (unsigned char *) im->data16 : (unsigned char *) im->data;
+    off_t payload = ftello(fp);
+
+    if (payload >= 0) {
+        // seekable: fetch each row span straight from its offset
+        int fd = fileno(fp);
+        for (int r = 0; r < h; r++) {
+            off_t offset = payload + (off_t) (y + r) * (off_t) row_bytes + (off_t) x * (off_t) bpp;
+            unsigned char *dst = pixels + (size_t) r * span_bytes;
+            size_t done = 0;
+            while (done < span_bytes) {
+                ssize_t got = pread(fd, dst + done, span_bytes - done, offset + (off_t) done);
+                if (got <= 0) {
+                    fprintf(stderr, "Error:ppm_io - failed to read data from file!\n");
+                    free_image(&im);
+                    return NULL;
+                }
+                done += (size_t) got;
+            }
+        }
+        if (IS_16BIT(im)) {
+            samples_from_big_endian(im->data16, (size_t) w * h);
+        }
+        return im;
+    }
+
+    // not seekable: stream through the payload, keeping only the window
+    unsigned char *row = malloc(row_bytes);
+    if (!row) {
+        fprintf(stderr, "Error:ppm_io - failed to allocate memory for image pixels!\n");
+        free_image(&im);
+        return NULL;
+    }
+    for (int r = 0; r < y + h; r++) {
+        if (fread(row, 1, row_bytes, fp) != row_bytes) {
+            fprintf(stderr, "Error:ppm_io - failed to read data from file!\n");
+            free(row);
+            free_image(&im);
+            return NULL;
+        }
+        if (r >= y) {
+            memcpy(pixels + (size_t) (r - y) * span_bytes, row + (size_t) x * bpp, span_bytes);
+        }
+    }
+    free(row);
+    if (IS_16BIT(im)) {
+        samples_from_big_endian(im->data16, (size_t) w * h);
+    }
+    return im;
+}
+
+/**
+ * Function: write_payload
+ * -----------------------
+ * helper function for write_ppm and write_pgm, writes the samples after the header,
+ * 16 bit samples most significant byte first
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer, positioned after the header
+ *  const void *pixels: the samples
+ *  int rows: number of rows
+ *  size_t row_bytes: bytes per row
+ *  int wide: 1 for 16 bit samples
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+static int write_payload(FILE *fp, const void *pixels, int rows, size_t row_bytes, int wide) {
+    // large payloads to regular files are written by several threads
+    int fd = parallel_io_fd(fp, row_bytes * rows, 1);
+    if (fd >= 0) {
+        if (fflush(fp) != 0) {
+            return -1;
+        }
+        return transfer_payload(fp, fd, (void *) pixels, rows, row_bytes, wide, write_band);
+    }
+    
+    if (wide) {
+        // 16 bit samples are stored most significant byte first, one row at a time
+        size_t count = row_bytes / 2;
+        unsigned char *row = malloc(row_bytes);
+        if (!row) {
+            return -1;
+        }
+        for (int r = 0; r < rows; r++) {
+            const unsigned short *samples = (const unsigned short *) pixels + (size_t) r * count;
+            for (size_t i = 0; i < count; i++) {
+                row[2 * i] = (unsigned char) (samples[i] >> 8);
+                row[2 * i + 1] = (unsigned char) (samples[i] & 0xff);
+            }
+            if (fwrite(row, 2, count, fp) != count) {
+                free(row);
+                return -1;
+            }
+        }
+        free(row);
+        return 0;
+    }
+
+    //if the number of elements printed in the file is not equal to the number of elements we wanted, return -1
+    if (fwrite(pixels, row_bytes, rows, fp) != (size_t) rows) {
+        return -1;
+    }
+    return 0;
+}
+
 /**
  * Function: write_ppm
  * -------------------
@@ -137,17 +549,61 @@ Image *read_ppm(FILE *fp) {
  *  0: success
  */
 int write_ppm(FILE *fp, const Image *im) {
-    // TODO: IMPLEMENT THIS FUNCTION
-    /* initialize fields to error codes, in case we have to bail out early */
     // write tag
-    fprintf(fp,"P6\n%d %d\n255\n", im->cols, im->rows);
-    
-    //if the number of elements printed in the file is not equal to the number of elements we wanted, return -1
-    if (fwrite(im->data, sizeof(Pixel), (im->rows) * (im->cols), fp) != (size_t) ((im->rows) * (im->cols))) {
-        return -1;
-    }
+    fprintf(fp,"P6\n%d %d\n%d\n", im->cols, im->rows, im->maxval);
+
+    const void *pixels = IS_16BIT(im) ? (const void *) im->data16 : (const void *) im->data;
+    return write_payload(fp, pixels, im->rows, (size_t) im->cols * pixel_bytes(im->maxval), IS_16BIT(im));
+}
 
-    return 0; // REPLACE THIS STUB
+/**
+ * Function: write_pgm
+ * -------------------
+ * Writes a gray image to the file specified by fp as a binary PGM (P5).
+ * 
+ * Parameters:
+ *  FILE* fp: the file to write to
+ *  const GrayImage* im: the image to write
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_pgm(FILE *fp, const GrayImage *im) {
+    // write tag
+    fprintf(fp,"P5\n%d %d\n%d\n", im->cols, im->rows, im->maxval);
+
+    const void *samples = IS_16BIT(im) ? (const void *) im->data16 : (const void *) im->data;
+    size_t sample_bytes = IS_16BIT(im) ? sizeof(unsigned short) : sizeof(unsigned char);
+    return write_payload(fp, samples, im->rows, (size_t) im->cols * sample_bytes, IS_16BIT(im));
+}
+
+/**
+ * Function: write_pbm
+ * -------------------
+ * Writes a binary image to the file specified by fp as a raw PBM (P4).
+ * 
+ * Parameters:
+ *  FILE* fp: the file to write to
+ *  const BinaryImage* im: the image to write
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_pbm(FILE *fp, const BinaryImage *im) {
+    // write tag
+    fprintf(fp,"P4\n%d %d\n", im->cols, im->rows);
+
+    // the file rows are not padded, so write them one at a time unless the padding is empty
+    size_t row_bytes = ((size_t) im->cols + 7) / 8;
+    if (row_bytes == im->stride) {
+        return write_payload(fp, im->data, im->rows, row_bytes, 0);
+    }
+    for (int r = 0; r < im->rows; r++) {
+        if (fwrite(im->data + (size_t) r * im->stride, 1, row_bytes, fp) != row_bytes) {
+            return -1;
+        }
+    }
+    return 0;
 }
 
 /**
@@ -162,6 +618,41 @@ int write_ppm(FILE *fp, const Image *im) {
  *  Image *im: pointer to the image struct
  */
 Image *make_image(int rows, int cols) {
+    return make_image_maxval(rows, cols, 255);
+}
+
+/**
+ * Function: make_image_maxval
+ * ---------------------------
+ * Allocate a new image of the specified size and maximum sample value, doesn't initialize
+ * pixel values; maxval above 255 allocates 16 bit pixels
+ * 
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ *  int maxval: maximum sample value (1 to 65535)
+ * Returns:
+ *  Image *im: pointer to the image struct
+ */
+Image *make_image_maxval(int rows, int cols, int maxval) {
+    return make_image_alloc(rows, cols, maxval, PIXELS_AUTO);
+}
+
+/**
+ * Function: make_image_alloc
+ * --------------------------
+ * Like make_image_maxval, with the allocation policy of the pixel array chosen by the
+ * caller (make_image_maxval uses PIXELS_AUTO)
+ * 
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ *  int maxval: maximum sample value (1 to 65535)
+ *  PixelAlloc how: how the pixel array is allocated
+ * Returns:
+ *  Image *im: pointer to the image struct
+ */
+Image *make_image_alloc(int rows, int cols, int maxval, PixelAlloc how) {
 
     // allocate space
     Image *im = malloc(sizeof(Image));
@@ -172,10 +663,17 @@ Image *make_image(int rows, int cols) {
     // set size 
     im->rows = rows;
     im->cols = cols;
+    im->maxval = maxval;
+    im->data = NULL;
+    im->data16 = NULL;
 
-    // allocate pixel array
-    im->data = malloc((im->rows * im->cols) * sizeof(Pixel));
-    if (!im->data) {
+    // allocate pixel array of the right depth
+    if (IS_16BIT(im)) {
+        im->data16 = pixels_alloc(rows, (size_t) cols * sizeof(Pixel16), how, &im->mapped, &im->unplaced);
+    } else {
+        im->data = pixels_alloc(rows, (size_t) cols * sizeof(Pixel), how, &im->mapped, &im->unplaced);
+    }
+    if (!im->data && !im->data16) {
         free(im);
         return NULL;
     }
@@ -210,9 +708,138 @@ void free_image(Image **im) {
     // TODO: IMPLEMENT THIS FUNCTION
     // Remove each Pixel inside the image
     Image * rmv = *im; //we get the value of our current image
-    Pixel * currDataPix = rmv->data;
-    free(currDataPix);
+    pixels_free(rmv->data, rmv->mapped);
+    pixels_free(rmv->data16, rmv->mapped);
+    free(rmv);
+    *im = NULL;
+}
+
+/**
+ * Function: make_gray_image
+ * -------------------------
+ * Allocate a new gray image of the specified size and maximum sample value, doesn't
+ * initialize sample values; maxval above 255 allocates 16 bit samples
+ * 
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ *  int maxval: maximum sample value (1 to 65535)
+ * Returns:
+ *  GrayImage *im: pointer to the image struct
+ */
+GrayImage *make_gray_image(int rows, int cols, int maxval) {
+    GrayImage *im = malloc(sizeof(GrayImage));
+    if (!im) {
+        return NULL;
+    }
+    im->rows = rows;
+    im->cols = cols;
+    im->maxval = maxval;
+    im->data = NULL;
+    im->data16 = NULL;
+
+    // allocate sample array of the right depth
+    if (IS_16BIT(im)) {
+        im->data16 = pixels_alloc(rows, (size_t) cols * sizeof(unsigned short), PIXELS_AUTO, &im->mapped, NULL);
+    } else {
+        im->data = pixels_alloc(rows, (size_t) cols, PIXELS_AUTO, &im->mapped, NULL);
+    }
+    if (!im->data && !im->data16) {
+        free(im);
+        return NULL;
+    }
+    return im;
+}
+
+/**
+ * Function: free_gray_image
+ * -------------------------
+ * utility function to free a gray image and set the pointer to null
+ * 
+ * Parameters:
+ *  GrayImage **im: pointer to the image to be freed
+ * Returns:
+ *  void
+ */
+void free_gray_image(GrayImage **im) {
+    GrayImage *rmv = *im;
+    pixels_free(rmv->data, rmv->mapped);
+    pixels_free(rmv->data16, rmv->mapped);
     free(rmv);
+    *im = NULL;
+}
+
+/**
+ * Function: make_binary_image
+ * ---------------------------
+ * Allocate a new binary image of the specified size with every pixel white (0)
+ * 
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ * Returns:
+ *  BinaryImage *im: pointer to the image struct
+ */
+BinaryImage *make_binary_image(int rows, int cols) {
+    BinaryImage *im = malloc(sizeof(BinaryImage));
+    if (!im) {
+        return NULL;
+    }
+    im->rows = rows;
+    im->cols = cols;
+    // whole 64 bit words per row
+    im->stride = (((size_t) cols + 63) / 64) * 8;
+    im->data = pixels_alloc(rows, im->stride, PIXELS_AUTO, &im->mapped, NULL);
+    if (!im->data) {
+        free(im);
+        return NULL;
+    }
+    memset(im->data, 0, (size_t) rows * im->stride);
+    return im;
+}
+
+/**
+ * Function: free_binary_image
+ * ---------------------------
+ * utility function to free a binary image and set the pointer to null
+ * 
+ * Parameters:
+ *  BinaryImage **im: pointer to the image to be freed
+ * Returns:
+ *  void
+ */
+void free_binary_image(BinaryImage **im) {
+    BinaryImage *rmv = *im;
+    pixels_free(rmv->data, rmv->mapped);
+    free(rmv);
+    *im = NULL;
+}
+
+/**
+ * Function: replace_image
+ * -----------------------
+ * utility function for out-of-place operations: releases the pixels of im, moves the
+ * pixels and dimensions of *src into it, then frees the *src struct and sets it to null
+ * 
+ * Parameters:
+ *  Image *im: the image that receives the new pixels
+ *  Image **src: pointer to the image whose pixels are taken
+ * Returns:
+ *  void
+ */
+void replace_image(Image *im, Image **src) {
+    Image *from = *src;
+    pixels_free(im->data, im->mapped);
+    pixels_free(im->data16, im->mapped);
+    im->data = from->data;
+    im->data16 = from->data16;
+    im->mapped = from->mapped;
+    im->unplaced = from->unplaced;
+    im->rows = from->rows;
+    im->cols = from->cols;
+    im->maxval = from->maxval;
+    free(from);
+    *src = NULL;
 }
 
 /**
@@ -257,11 +884,13 @@ int resize_image(Image **im, int rows, int cols) {
  */
 Image *make_copy(Image *orig) {
     // Allocate space
-    Image *copy = make_image(orig->rows, orig->cols);
+    Image *copy = make_image_maxval(orig->rows, orig->cols, orig->maxval);
 
     // If we got space, copy pixel values
-    if (copy) {
-        memcpy(copy->data, orig->data, (copy->rows * copy->cols) * sizeof(Pixel));
+    if (copy && IS_16BIT(copy)) {
+        memcpy(copy->data16, orig->data16, ((size_t) copy->rows * copy->cols) * sizeof(Pixel16));
+    } else if (copy) {
+        memcpy(copy->data, orig->data, ((size_t) copy->rows * copy->cols) * sizeof(Pixel));
     }
 
     return copy;
@@ -11,6 +11,7 @@
 // Include the header files
 #include <stdio.h>
 #include <stdlib.h>
+#include "image_alloc.h"
 
 // Struct to store a point
 typedef struct _point {
@@ -25,13 +26,64 @@ typedef struct _pixel {
   unsigned char b;
 } Pixel;
 
-// Struct to store an entire image
+// Struct to store an RGB pixel, two bytes per channel (in host byte order)
+typedef struct _pixel16 {
+  unsigned short r;
+  unsigned short g;
+  unsigned short b;
+} Pixel16;
+
+// Struct to store an entire image; 8 bit images (maxval <= 255) keep their
+// pixels in data, 16 bit images (maxval > 255) keep them in data16. mapped is the
+// length of the mapping holding the pixels, 0 if they came from malloc; unplaced is
+// nonzero when IMGPROC_NUMA asked to interleave them and the kernel refused.
 typedef struct _image {
   Pixel *data;
   int rows;
   int cols;
+  int maxval;
+  Pixel16 *data16;
+  size_t mapped;
+  int unplaced;
 } Image;
 
+// Struct to store a single channel (gray) image, a third the size of the same image
+// in RGB; 8 bit images keep their samples in data, 16 bit ones in data16
+typedef struct _gray_image {
+  unsigned char *data;
+  int rows;
+  int cols;
+  int maxval;
+  unsigned short *data16;
+  size_t mapped;
+} GrayImage;
+
+// Struct to store a binary (black and white) image at one bit per pixel, the layout
+// of PBM: each row starts on a byte, the leftmost pixel is the most significant bit
+// and 1 is black. Rows are stride bytes apart, a multiple of 8 so rows can be
+// processed 64 bits at a time; the padding bits are always 0.
+typedef struct _binary_image {
+  unsigned char *data;
+  int rows;
+  int cols;
+  size_t stride;
+  size_t mapped;
+} BinaryImage;
+
+// macro to check whether an image holds 16 bit samples
+#define IS_16BIT(im) ((im)->maxval > 255)
+
+// A rows x cols window of pixels in a buffer owned by the caller. Rows are stride
+// bytes apart, so a view may cover part of a larger image or a padded buffer. The
+// pixels are Pixel for maxval <= 255 and Pixel16 otherwise (IS_16BIT works on views).
+typedef struct _image_view {
+  void *data;
+  int rows;
+  int cols;
+  int maxval;
+  size_t stride;
+} ImageView;
+
 /**
  * Function: read_ppm
  * ------------------
@@ -44,6 +96,43 @@ typedef struct _image {
  */
 Image *read_ppm(FILE *fp);
 
+/**
+ * Function: read_ppm_header
+ * -------------------------
+ * Read a P6 header from a file pointer, leaving the file positioned at the first payload byte
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer
+ *  int *cols: set to the number of columns in the image
+ *  int *rows: set to the number of rows in the image
+ *  int *maxval: set to the maximum sample value of the image
+ * Returns:
+ *  -1: If the header is malformed or unsupported
+ *  0: success
+ */
+int read_ppm_header(FILE *fp, int *cols, int *rows, int *maxval);
+
+/**
+ * Function: read_ppm_region
+ * -------------------------
+ * Read only the w x h window at (x, y) of a P6 payload whose header has already been
+ * consumed by read_ppm_header. On a seekable file only the needed row spans are read
+ * (with pread); pipes fall back to streaming past the unused bytes.
+ * 
+ * Parameters:
+ *  FILE *fp: file pointer positioned at the start of the payload
+ *  int cols: number of columns in the stored image
+ *  int rows: number of rows in the stored image
+ *  int maxval: maximum sample value of the stored image
+ *  int x: column of the top left corner of the window
+ *  int y: row of the top left corner of the window
+ *  int w: width of the window
+ *  int h: height of the window
+ * Returns:
+ *  Image *: image holding the window, NULL on failure
+ */
+Image *read_ppm_region(FILE *fp, int cols, int rows, int maxval, int x, int y, int w, int h);
+
 /**
  * Function: read_num
  * ------------------
@@ -71,6 +160,34 @@ int read_num(FILE *fp);
  */
 int write_ppm(FILE* fp, const Image* img);
 
+/**
+ * Function: write_pgm
+ * -------------------
+ * Writes a gray image to the file specified by fp as a binary PGM (P5).
+ * 
+ * Parameters:
+ *  FILE* fp: the file to write to
+ *  const GrayImage* im: the image to write
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_pgm(FILE *fp, const GrayImage *im);
+
+/**
+ * Function: write_pbm
+ * -------------------
+ * Writes a binary image to the file specified by fp as a raw PBM (P4).
+ * 
+ * Parameters:
+ *  FILE* fp: the file to write to
+ *  const BinaryImage* im: the image to write
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_pbm(FILE *fp, const BinaryImage *im);
+
 /**
  * Function: make_image
  * --------------------
@@ -84,6 +201,37 @@ int write_ppm(FILE* fp, const Image* img);
  */
 Image *make_image(int rows, int cols);
 
+/**
+ * Function: make_image_maxval
+ * ---------------------------
+ * Allocate a new image of the specified size and maximum sample value, doesn't initialize
+ * pixel values; maxval above 255 allocates 16 bit pixels
+ * 
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ *  int maxval: maximum sample value (1 to 65535)
+ * Returns:
+ *  Image *: pointer to the image struct
+ */
+Image *make_image_maxval(int rows, int cols, int maxval);
+
+/**
+ * Function: make_image_alloc
+ * --------------------------
+ * Like make_image_maxval, with the allocation policy of the pixel array chosen by the
+ * caller (make_image_maxval uses PIXELS_AUTO)
+ *
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ *  int maxval: maximum sample value (1 to 65535)
+ *  PixelAlloc how: how the pixel array is allocated
+ * Returns:
+ *  Image *im: pointer to the image struct
+ */
+Image *make_image_alloc(int rows, int cols, int maxval, PixelAlloc how);
+
 /**
  * Function: output_dims
  * ---------------------
@@ -108,6 +256,72 @@ void output_dims(Image *orig);
  */
 void free_image(Image **im);
 
+/**
+ * Function: make_gray_image
+ * -------------------------
+ * Allocate a new gray image of the specified size and maximum sample value, doesn't
+ * initialize sample values; maxval above 255 allocates 16 bit samples
+ * 
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ *  int maxval: maximum sample value (1 to 65535)
+ * Returns:
+ *  GrayImage *im: pointer to the image struct
+ */
+GrayImage *make_gray_image(int rows, int cols, int maxval);
+
+/**
+ * Function: free_gray_image
+ * -------------------------
+ * utility function to free a gray image and set the pointer to null
+ * 
+ * Parameters:
+ *  GrayImage **im: pointer to the image to be freed
+ * Returns:
+ *  void
+ */
+void free_gray_image(GrayImage **im);
+
+/**
+ * Function: make_binary_image
+ * ---------------------------
+ * Allocate a new binary image of the specified size with every pixel white (0)
+ * 
+ * Parameters:
+ *  int rows: number of rows in the image
+ *  int cols: number of columns in the image
+ * Returns:
+ *  BinaryImage *im: pointer to the image struct
+ */
+BinaryImage *make_binary_image(int rows, int cols);
+
+/**
+ * Function: free_binary_image
+ * ---------------------------
+ * utility function to free a binary image and set the pointer to null
+ * 
+ * Parameters:
+ *  BinaryImage **im: pointer to the image to be freed
+ * Returns:
+ *  void
+ */
+void free_binary_image(BinaryImage **im);
+
+/**
+ * Function: replace_image
+ * -----------------------
+ * utility function for out-of-place operations: releases the pixels of im, moves the
+ * pixels and dimensions of *src into it, then frees the *src struct and sets it to null
+ * 
+ * Parameters:
+ *  Image *im: the image that receives the new pixels
+ *  Image **src: pointer to the image whose pixels are taken
+ * Returns:
+ *  void
+ */
+void replace_image(Image *im, Image **src);
+
 /**
  * Function: make_copy
  * -------------------
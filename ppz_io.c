@@ -0,0 +1,675 @@
+/**
+ * @file ppz_io.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Reading and writing compressed PPZ images
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <zlib.h>
+#include "ppz_io.h"
+#include "parallel.h"
+
+// Magic bytes at the start of every PPZ file
+static const unsigned char PPZ_MAGIC[4] = { 0x89, 'P', 'P', 'Z' };
+
+// Size of the fixed part of the header and of one chunk table entry
+#define PPZ_HEADER_BYTES 24
+#define PPZ_ENTRY_BYTES 12
+
+// PNG style prediction filters
+enum { FILTER_NONE, FILTER_SUB, FILTER_UP, FILTER_AVERAGE, FILTER_PAETH, FILTER_COUNT };
+
+// Header and chunk table of a PPZ file
+typedef struct _ppz_header {
+  int cols;
+  int rows;
+  int maxval;
+  int chunkRows;
+  int chunks;
+  unsigned long long *offsets;
+  unsigned *sizes;
+} PpzHeader;
+
+// Shared state of a parallel encode or decode
+typedef struct _ppz_job {
+  Image *im;              // image being written (encode) or filled (decode)
+  int firstRow;           // image row 0 corresponds to this row of the file
+  int firstChunk;         // chunk index of the first chunk handled
+  int chunkRows;
+  unsigned char **data;   // compressed bytes of each chunk
+  unsigned *sizes;        // compressed size of each chunk
+  int failed;
+} PpzJob;
+
+/**
+ * Function: put_u32
+ * -----------------
+ * Store a 32 bit value little endian
+ *
+ * Parameters:
+ *  unsigned char *p: destination (4 bytes)
+ *  unsigned long v: the value
+ * Returns:
+ *  void
+ */
+static void put_u32(unsigned char *p, unsigned long v) {
+  for (int i = 0; i < 4; i++) {
+    p[i] = (unsigned char)(v >> (8 * i));
+  }
+}
+
+/**
+ * Function: get_u32
+ * -----------------
+ * Load a little endian 32 bit value
+ *
+ * Parameters:
+ *  const unsigned char *p: source (4 bytes)
+ * Returns:
+ *  the value
+ */
+static unsigned long get_u32(const unsigned char *p) {
+  return (unsigned long)p[0] | ((unsigned long)p[1] << 8) | ((unsigned long)p[2] << 16) | ((unsigned long)p[3] << 24);
+}
+
+/**
+ * Function: row_bytes
+ * -------------------
+ * Number of bytes in one stored row (samples in big endian order for 16 bit images)
+ *
+ * Parameters:
+ *  const Image *im: the image
+ * Returns:
+ *  the size of a row in bytes
+ */
+static size_t row_bytes(const Image *im) {
+  return (size_t)im->cols * (IS_16BIT(im) ? 6 : 3);
+}
+
+/**
+ * Function: alloc_chunk_buffer
+ * ----------------------------
+ * Allocate room for the filtered rows of one chunk: a filter byte plus len bytes each
+ *
+ * Parameters:
+ *  size_t len: the size of a row in bytes
+ *  int chunkRows: the number of rows in a chunk
+ * Returns:
+ *  unsigned char *: the buffer, NULL if it is too large or cannot be allocated
+ */
+static unsigned char *alloc_chunk_buffer(size_t len, int chunkRows) {
+  if (chunkRows <= 0 || len + 1 > (size_t)-1 / (size_t)chunkRows) {
+    return NULL;
+  }
+  return malloc((len + 1) * (size_t)chunkRows);
+}
+
+/**
+ * Function: paeth
+ * ---------------
+ * PNG's Paeth predictor: whichever of left, up and up-left is closest to left + up - up-left
+ *
+ * Parameters:
+ *  int a: the byte to the left
+ *  int b: the byte above
+ *  int c: the byte above and to the left
+ * Returns:
+ *  the predicted byte
+ */
+static int paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+/**
+ * Function: filter_row
+ * --------------------
+ * Apply one prediction filter to a row
+ *
+ * Parameters:
+ *  int type: the filter
+ *  const unsigned char *cur: the row
+ *  const unsigned char *prev: the row above (all zeros for the first row of a chunk)
+ *  size_t len: bytes in the row
+ *  int bpp: bytes per pixel (distance to the left neighbour)
+ *  unsigned char *out: receives the filtered row
+ * Returns:
+ *  the sum of the filtered bytes taken as signed values, used to pick the best filter
+ */
+static unsigned long filter_row(int type, const unsigned char *cur, const unsigned char *prev, size_t len, int bpp, unsigned char *out) {
+  unsigned long cost = 0;
+  for (size_t i = 0; i < len; i++) {
+    int a = i >= (size_t)bpp ? cur[i - bpp] : 0;
+    int b = prev[i];
+    int c = i >= (size_t)bpp ? prev[i - bpp] : 0;
+    int pred = 0;
+    switch (type) {
+      case FILTER_SUB: pred = a; break;
+      case FILTER_UP: pred = b; break;
+      case FILTER_AVERAGE: pred = (a + b) / 2; break;
+      case FILTER_PAETH: pred = paeth(a, b, c); break;
+      default: break;
+    }
+    out[i] = (unsigned char)(cur[i] - pred);
+    cost += out[i] < 128 ? out[i] : 256 - out[i];
+  }
+  return cost;
+}
+
+/**
+ * Function: unfilter_row
+ * ----------------------
+ * Undo a prediction filter, in place
+ *
+ * Parameters:
+ *  int type: the filter
+ *  unsigned char *cur: the filtered row, replaced by the original row
+ *  const unsigned char *prev: the original row above (all zeros for the first row of a chunk)
+ *  size_t len: bytes in the row
+ *  int bpp: bytes per pixel
+ * Returns:
+ *  -1 for an unknown filter, 0 otherwise
+ */
+static int unfilter_row(int type, unsigned char *cur, const unsigned char *prev, size_t len, int bpp) {
+  if (type < 0 || type >= FILTER_COUNT) {
+    return -1;
+  }
+  for (size_t i = 0; i < len; i++) {
+    int a = i >= (size_t)bpp ? cur[i - bpp] : 0;
+    int b = prev[i];
+    int c = i >= (size_t)bpp ? prev[i - bpp] : 0;
+    int pred = 0;
+    switch (type) {
+      case FILTER_SUB: pred = a; break;
+      case FILTER_UP: pred = b; break;
+      case FILTER_AVERAGE: pred = (a + b) / 2; break;
+      case FILTER_PAETH: pred = paeth(a, b, c); break;
+      default: break;
+    }
+    cur[i] = (unsigned char)(cur[i] + pred);
+  }
+  return 0;
+}
+
+/**
+ * Function: stored_row
+ * --------------------
+ * Get one image row as stored bytes: the pixels themselves for 8 bit images, a big
+ * endian copy in scratch for 16 bit images
+ *
+ * Parameters:
+ *  const Image *im: the image
+ *  int r: the row
+ *  unsigned char *scratch: row_bytes(im) bytes used for 16 bit images
+ * Returns:
+ *  pointer to the stored bytes of the row
+ */
+static const unsigned char *stored_row(const Image *im, int r, unsigned char *scratch) {
+  if (!IS_16BIT(im)) {
+    return (const unsigned char *)&im->data[(size_t)r * im->cols];
+  }
+  const unsigned short *samples = (const unsigned short *)&im->data16[(size_t)r * im->cols];
+  for (size_t i = 0; i < (size_t)im->cols * 3; i++) {
+    scratch[2 * i] = (unsigned char)(samples[i] >> 8);
+    scratch[2 * i + 1] = (unsigned char)(samples[i] & 0xff);
+  }
+  return scratch;
+}
+
+/**
+ * Function: encode_chunks
+ * -----------------------
+ * Filter and compress the chunks [c0, c1)
+ *
+ * Parameters:
+ *  void *ctx: the PpzJob
+ *  int band: index of the band (unused)
+ *  int c0: first chunk
+ *  int c1: one past the last chunk
+ * Returns:
+ *  void
+ */
+static void encode_chunks(void *ctx, int band, int c0, int c1) {
+  PpzJob *job = ctx;
+  const Image *im = job->im;
+  size_t len = row_bytes(im);
+  int bpp = IS_16BIT(im) ? 6 : 3;
+  (void)band;
+
+  // scratch: previous row, current row (16 bit only) and one candidate per filter
+  unsigned char *scratch = malloc(len * (2 + FILTER_COUNT));
+  unsigned char *filtered = alloc_chunk_buffer(len, job->chunkRows);
+  if (!scratch || !filtered) {
+    job->failed = 1;
+    free(scratch);
+    free(filtered);
+    return;
+  }
+  unsigned char *prevScratch = scratch, *curScratch = scratch + len, *candidates = scratch + 2 * len;
+
+  for (int c = c0; c < c1 && !job->failed; c++) {
+    int r0 = c * job->chunkRows;
+    int r1 = (long long)r0 + job->chunkRows < im->rows ? r0 + job->chunkRows : im->rows;
+
+    // Filter every row of the chunk, keeping the cheapest filter for each one;
+    // the first row of a chunk is predicted from zeros so chunks stay independent
+    memset(prevScratch, 0, len);
+    const unsigned char *prev = prevScratch;
+    size_t used = 0;
+    for (int r = r0; r < r1; r++) {
+      const unsigned char *cur = stored_row(im, r, curScratch);
+      int best = 0;
+      unsigned long bestCost = 0;
+      for (int f = 0; f < FILTER_COUNT; f++) {
+        unsigned long cost = filter_row(f, cur, prev, len, bpp, candidates + f * len);
+        if (f == 0 || cost < bestCost) {
+          best = f;
+          bestCost = cost;
+        }
+      }
+      filtered[used++] = (unsigned char)best;
+      memcpy(filtered + used, candidates + best * len, len);
+      used += len;
+      if (IS_16BIT(im)) {
+        // The converted row is overwritten by the next one, so keep it as the previous row
+        memcpy(prevScratch, cur, len);
+        prev = prevScratch;
+      } else {
+        prev = cur;
+      }
+    }
+
+    // Deflate the filtered rows
+    uLongf size = compressBound(used);
+    job->data[c] = malloc(size);
+    if (!job->data[c] || compress2(job->data[c], &size, filtered, used, Z_DEFAULT_COMPRESSION) != Z_OK) {
+      job->failed = 1;
+      break;
+    }
+    job->sizes[c] = (unsigned)size;
+  }
+  free(scratch);
+  free(filtered);
+}
+
+/**
+ * Function: decode_chunks
+ * -----------------------
+ * Decompress and unfilter the chunks [c0, c1) of job (indices relative to job->firstChunk)
+ * into the image
+ *
+ * Parameters:
+ *  void *ctx: the PpzJob
+ *  int band: index of the band (unused)
+ *  int c0: first chunk
+ *  int c1: one past the last chunk
+ * Returns:
+ *  void
+ */
+static void decode_chunks(void *ctx, int band, int c0, int c1) {
+  PpzJob *job = ctx;
+  Image *im = job->im;
+  size_t len = row_bytes(im);
+  int bpp = IS_16BIT(im) ? 6 : 3;
+  (void)band;
+
+  unsigned char *filtered = alloc_chunk_buffer(len, job->chunkRows);
+  unsigned char *rowsBuf = malloc(len * 2);
+  if (!filtered || !rowsBuf) {
+    job->failed = 1;
+    free(filtered);
+    free(rowsBuf);
+    return;
+  }
+
+  for (int c = c0; c < c1 && !job->failed; c++) {
+    // Rows of the image covered by this chunk
+    int fileRow0 = (job->firstChunk + c) * job->chunkRows;
+    int r0 = fileRow0 - job->firstRow;
+    int r1 = (long long)r0 + job->chunkRows < im->rows ? r0 + job->chunkRows : im->rows;
+    uLongf expected = (uLongf)(len + 1) * (r1 - r0);
+    uLongf size = expected;
+    if (uncompress(filtered, &size, job->data[c], job->sizes[c]) != Z_OK || size != expected) {
+      job->failed = 1;
+      break;
+    }
+
+    unsigned char *prev = rowsBuf, *cur = rowsBuf + len;
+    memset(prev, 0, len);
+    for (int r = r0; r < r1; r++) {
+      unsigned char *line = filtered + (size_t)(r - r0) * (len + 1);
+      if (unfilter_row(line[0], line + 1, prev, len, bpp) != 0) {
+        job->failed = 1;
+        break;
+      }
+      if (IS_16BIT(im)) {
+        unsigned short *samples = (unsigned short *)&im->data16[(size_t)r * im->cols];
+        for (size_t i = 0; i < (size_t)im->cols * 3; i++) {
+          samples[i] = (unsigned short)((line[1 + 2 * i] << 8) | line[2 + 2 * i]);
+        }
+      } else {
+        memcpy(&im->data[(size_t)r * im->cols], line + 1, len);
+      }
+      memcpy(cur, line + 1, len);
+      unsigned char *tmp = prev;
+      prev = cur;
+      cur = tmp;
+    }
+  }
+  free(filtered);
+  free(rowsBuf);
+}
+
+/**
+ * Function: is_ppz
+ * ----------------
+ * Check whether a file starts with the PPZ magic, without consuming anything
+ *
+ * Parameters:
+ *  FILE *fp: file pointer
+ * Returns:
+ *  1 if the file is a PPZ file, 0 otherwise
+ */
+int is_ppz(FILE *fp) {
+  // The first magic byte never starts a PPM, so peeking one byte is enough
+  int ch = fgetc(fp);
+  if (ch != EOF) {
+    ungetc(ch, fp);
+  }
+  return ch == PPZ_MAGIC[0];
+}
+
+/**
+ * Function: write_ppz
+ * -------------------
+ * Write the image as a PPZ file; chunks are filtered and compressed in parallel
+ *
+ * Parameters:
+ *  FILE *fp: the file to write to
+ *  const Image *im: the image to write
+ * Returns:
+ *  -1: failure occurs
+ *  0: success
+ */
+int write_ppz(FILE *fp, const Image *im) {
+  int chunks = (im->rows + PPZ_CHUNK_ROWS - 1) / PPZ_CHUNK_ROWS;
+  PpzJob job;
+  job.im = (Image *)im;
+  job.firstRow = job.firstChunk = 0;
+  job.chunkRows = PPZ_CHUNK_ROWS;
+  job.failed = 0;
+  job.data = calloc(chunks, sizeof(unsigned char *));
+  job.sizes = calloc(chunks, sizeof(unsigned));
+  if (!job.data || !job.sizes) {
+    free(job.data);
+    free(job.sizes);
+    return -1;
+  }
+  parallel_for_range(chunks, 1, encode_chunks, &job);
+
+  // Header, chunk table, then the chunks in order
+  int rc = job.failed ? -1 : 0;
+  if (rc == 0) {
+    unsigned char header[PPZ_HEADER_BYTES];
+    memcpy(header, PPZ_MAGIC, 4);
+    put_u32(header + 4, im->cols);
+    put_u32(header + 8, im->rows);
+    put_u32(header + 12, im->maxval);
+    put_u32(header + 16, PPZ_CHUNK_ROWS);
+    put_u32(header + 20, chunks);
+    rc = fwrite(header, 1, sizeof(header), fp) == sizeof(header) ? 0 : -1;
+
+    unsigned long long offset = 0;
+    for (int c = 0; c < chunks && rc == 0; c++) {
+      unsigned char entry[PPZ_ENTRY_BYTES];
+      put_u32(entry, (unsigned long)(offset & 0xffffffffu));
+      put_u32(entry + 4, (unsigned long)(offset >> 32));
+      put_u32(entry + 8, job.sizes[c]);
+      rc = fwrite(entry, 1, sizeof(entry), fp) == sizeof(entry) ? 0 : -1;
+      offset += job.sizes[c];
+    }
+    for (int c = 0; c < chunks && rc == 0; c++) {
+      rc = fwrite(job.data[c], 1, job.sizes[c], fp) == job.sizes[c] ? 0 : -1;
+    }
+  }
+
+  for (int c = 0; c < chunks; c++) {
+    free(job.data[c]);
+  }
+  free(job.data);
+  free(job.sizes);
+  return rc;
+}
+
+/**
+ * Function: read_ppz_header
+ * -------------------------
+ * Read the header and chunk table of a PPZ file, leaving the file at the first chunk
+ *
+ * Parameters:
+ *  FILE *fp: file pointer at the start of the file
+ *  PpzHeader *h: filled with the header; h->offsets and h->sizes must be freed
+ * Returns:
+ *  -1: not a valid PPZ file
+ *  0: success
+ */
+static int read_ppz_header(FILE *fp, PpzHeader *h) {
+  unsigned char header[PPZ_HEADER_BYTES];
+  h->offsets = NULL;
+  h->sizes = NULL;
+  if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, PPZ_MAGIC, 4) != 0) {
+    fprintf(stderr, "Error:ppz_io - not a PPZ (bad tag)\n");
+    return -1;
+  }
+  h->cols = (int)get_u32(header + 4);
+  h->rows = (int)get_u32(header + 8);
+  h->maxval = (int)get_u32(header + 12);
+  h->chunkRows = (int)get_u32(header + 16);
+  h->chunks = (int)get_u32(header + 20);
+  // The count is worked out in 64 bits as rows and chunkRows come straight from the file
+  if (h->cols <= 0 || h->rows <= 0 || h->maxval <= 0 || h->maxval > 65535 || h->chunkRows <= 0 ||
+      h->chunks != ((long long)h->rows + h->chunkRows - 1) / h->chunkRows) {
+    fprintf(stderr, "Error:ppz_io - PPZ file with a bad header\n");
+    return -1;
+  }
+  // A chunk taller than the image is the one chunk of the whole image (as written for
+  // images shorter than PPZ_CHUNK_ROWS); this bounds the chunk buffers by the image
+  if (h->chunkRows > h->rows) {
+    h->chunkRows = h->rows;
+  }
+
+  h->offsets = malloc(sizeof(unsigned long long) * h->chunks);
+  h->sizes = malloc(sizeof(unsigned) * h->chunks);
+  if (!h->offsets || !h->sizes) {
+    fprintf(stderr, "Error:ppz_io - failed to allocate memory for the chunk table\n");
+    return -1;
+  }
+  for (int c = 0; c < h->chunks; c++) {
+    unsigned char entry[PPZ_ENTRY_BYTES];
+    if (fread(entry, 1, sizeof(entry), fp) != sizeof(entry)) {
+      fprintf(stderr, "Error:ppz_io - failed to read the chunk table\n");
+      return -1;
+    }
+    h->offsets[c] = get_u32(entry) | ((unsigned long long)get_u32(entry + 4) << 32);
+    h->sizes[c] = (unsigned)get_u32(entry + 8);
+  }
+  return 0;
+}
+
+/**
+ * Function: read_chunks
+ * ---------------------
+ * Read the compressed chunks [c0, c1) and decode them in parallel into an image
+ * covering the rows of those chunks
+ *
+ * Parameters:
+ *  FILE *fp: file pointer
+ *  const PpzHeader *h: the header
+ *  off_t dataStart: file offset of the first chunk, or -1 to read sequentially from
+ *                   the current position (only valid when c0 is 0)
+ *  int c0: first chunk
+ *  int c1: one past the last chunk
+ * Returns:
+ *  Image *: the decoded rows, NULL on failure
+ */
+static Image *read_chunks(FILE *fp, const PpzHeader *h, off_t dataStart, int c0, int c1) {
+  int firstRow = c0 * h->chunkRows;
+  int lastRow = (long long)c1 * h->chunkRows < h->rows ? c1 * h->chunkRows : h->rows;
+  Image *im = make_image_maxval(lastRow - firstRow, h->cols, h->maxval);
+  PpzJob job;
+  job.im = im;
+  job.firstRow = firstRow;
+  job.firstChunk = c0;
+  job.chunkRows = h->chunkRows;
+  job.failed = 0;
+  job.data = calloc(c1 - c0, sizeof(unsigned char *));
+  job.sizes = h->sizes + c0;
+  if (!im || !job.data) {
+    fprintf(stderr, "Error:ppz_io - failed to allocate memory for image pixels!\n");
+    free(job.data);
+    if (im) {
+      free_image(&im);
+    }
+    return NULL;
+  }
+
+  // Fetch the compressed bytes, then decode the chunks in parallel
+  if (dataStart >= 0 && fseeko(fp, dataStart + (off_t)h->offsets[c0], SEEK_SET) != 0) {
+    job.failed = 1;
+  }
+  for (int c = c0; c < c1 && !job.failed; c++) {
+    job.data[c - c0] = malloc(h->sizes[c] ? h->sizes[c] : 1);
+    if (!job.data[c - c0] || fread(job.data[c - c0], 1, h->sizes[c], fp) != h->sizes[c]) {
+      job.failed = 1;
+    }
+  }
+  if (!job.failed) {
+    parallel_for_range(c1 - c0, 1, decode_chunks, &job);
+  }
+
+  for (int c = 0; c < c1 - c0; c++) {
+    free(job.data[c]);
+  }
+  free(job.data);
+  if (job.failed) {
+    fprintf(stderr, "Error:ppz_io - failed to read data from file!\n");
+    free_image(&im);
+    return NULL;
+  }
+  return im;
+}
+
+/**
+ * Function: read_ppz
+ * ------------------
+ * Read a whole PPZ file; chunks are decompressed in parallel
+ *
+ * Parameters:
+ *  FILE *fp: file pointer
+ * Returns:
+ *  Image *: image pointer, NULL on failure
+ */
+Image *read_ppz(FILE *fp) {
+  PpzHeader h;
+  Image *im = NULL;
+  if (read_ppz_header(fp, &h) == 0) {
+    im = read_chunks(fp, &h, -1, 0, h.chunks);
+  }
+  free(h.offsets);
+  free(h.sizes);
+  return im;
+}
+
+/**
+ * Function: read_ppz_size
+ * -----------------------
+ * Read the dimensions from the header of a PPZ file and go back to its start
+ *
+ * Parameters:
+ *  FILE *fp: file pointer at the start of the file (seekable)
+ *  int *cols: receives the number of columns
+ *  int *rows: receives the number of rows
+ * Returns:
+ *  -1: not a PPZ file, or the file cannot be rewound
+ *  0: success
+ */
+int read_ppz_size(FILE *fp, int *cols, int *rows) {
+  unsigned char header[PPZ_HEADER_BYTES];
+  off_t start = ftello(fp);
+  if (start < 0 || fread(header, 1, sizeof(header), fp) != sizeof(header) || fseeko(fp, start, SEEK_SET) != 0 ||
+      memcmp(header, PPZ_MAGIC, 4) != 0) {
+    return -1;
+  }
+  *cols = (int)get_u32(header + 4);
+  *rows = (int)get_u32(header + 8);
+  return 0;
+}
+
+/**
+ * Function: read_ppz_rows
+ * -----------------------
+ * Read only the rows [r0, r1) of a PPZ file; only the chunks covering those rows are
+ * fetched (the file must be seekable) and decompressed
+ *
+ * Parameters:
+ *  FILE *fp: file pointer at the start of the file
+ *  int r0: first row to read
+ *  int r1: one past the last row to read
+ * Returns:
+ *  Image *: image holding the rows, NULL on failure
+ */
+Image *read_ppz_rows(FILE *fp, int r0, int r1) {
+  off_t start = ftello(fp);
+  if (start < 0) {
+    fprintf(stderr, "Error:ppz_io - reading rows needs a seekable file\n");
+    return NULL;
+  }
+
+  PpzHeader h;
+  if (read_ppz_header(fp, &h) != 0) {
+    free(h.offsets);
+    free(h.sizes);
+    return NULL;
+  }
+  if (r0 < 0 || r1 > h.rows || r0 >= r1) {
+    fprintf(stderr, "Error:ppz_io - rows lie outside of the image\n");
+    free(h.offsets);
+    free(h.sizes);
+    return NULL;
+  }
+
+  // Decode the covering chunks, then keep only the wanted rows
+  off_t dataStart = start + PPZ_HEADER_BYTES + (off_t)h.chunks * PPZ_ENTRY_BYTES;
+  int c0 = r0 / h.chunkRows, c1 = (int)(((long long)r1 + h.chunkRows - 1) / h.chunkRows);
+  Image *chunkRows = read_chunks(fp, &h, dataStart, c0, c1);
+  free(h.offsets);
+  free(h.sizes);
+  if (!chunkRows) {
+    return NULL;
+  }
+  int skip = r0 - c0 * h.chunkRows;
+  if (skip == 0 && chunkRows->rows == r1 - r0) {
+    return chunkRows;
+  }
+  Image *im = make_image_maxval(r1 - r0, chunkRows->cols, chunkRows->maxval);
+  if (im) {
+    size_t pixel = IS_16BIT(im) ? sizeof(Pixel16) : sizeof(Pixel);
+    const unsigned char *from = IS_16BIT(im) ? (const unsigned char *)chunkRows->data16 : (const unsigned char *)chunkRows->data;
+    unsigned char *to = IS_16BIT(im) ? (unsigned char *)im->data16 : (unsigned char *)im->data;
+    memcpy(to, from + (size_t)skip * im->cols * pixel, (size_t)im->rows * im->cols * pixel);
+  } else {
+    fprintf(stderr, "Error:ppz_io - failed to allocate memory for image pixels!\n");
+  }
+  free_image(&chunkRows);
+  return im;
+}
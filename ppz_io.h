@@ -0,0 +1,98 @@
+/**
+ * @file ppz_io.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for reading and writing compressed PPZ images
+ *
+ * A PPZ file holds the same pixels as a P6 file, compressed in independent chunks of
+ * PPZ_CHUNK_ROWS rows so that chunks can be encoded and decoded in parallel and read
+ * individually. Each row is first passed through a PNG style prediction filter (none,
+ * sub, up, average or Paeth, picked per row), then each chunk is deflated with zlib.
+ *
+ * Layout (all integers little endian):
+ *  "\211PPZ"                      magic (the first byte cannot start a PPM header)
+ *  u32 cols, rows, maxval, chunk_rows, chunks
+ *  chunks x (u64 offset, u32 compressed size)   offsets relative to the first chunk
+ *  compressed chunks
+ */
+
+// If not defined, define PPZ_IO_H
+#ifndef PPZ_IO_H
+#define PPZ_IO_H
+
+// Include header files
+#include <stdio.h>
+#include "ppm_io.h"
+
+// Number of rows compressed together in one independent chunk
+#define PPZ_CHUNK_ROWS 64
+
+/**
+ * Function: is_ppz
+ * ----------------
+ * Check whether a file starts with the PPZ magic, without consuming anything
+ *
+ * Parameters:
+ *  FILE *fp: file pointer
+ * Returns:
+ *  1 if the file is a PPZ file, 0 otherwise
+ */
+int is_ppz(FILE *fp);
+
+/**
+ * Function: write_ppz
+ * -------------------
+ * Write the image as a PPZ file; chunks are filtered and compressed in parallel
+ *
+ * Parameters:
+ *  FILE *fp: the file to write to
+ *  const Image *im: the image to write
+ * Returns:
+ *  -1: failure occurs
+ *  0: success
+ */
+int write_ppz(FILE *fp, const Image *im);
+
+/**
+ * Function: read_ppz
+ * ------------------
+ * Read a whole PPZ file; chunks are decompressed in parallel
+ *
+ * Parameters:
+ *  FILE *fp: file pointer
+ * Returns:
+ *  Image *: image pointer, NULL on failure
+ */
+Image *read_ppz(FILE *fp);
+
+/**
+ * Function: read_ppz_size
+ * -----------------------
+ * Read the dimensions from the header of a PPZ file and go back to its start
+ *
+ * Parameters:
+ *  FILE *fp: file pointer at the start of the file (seekable)
+ *  int *cols: receives the number of columns
+ *  int *rows: receives the number of rows
+ * Returns:
+ *  -1: not a PPZ file, or the file cannot be rewound
+ *  0: success
+ */
+int read_ppz_size(FILE *fp, int *cols, int *rows);
+
+/**
+ * Function: read_ppz_rows
+ * -----------------------
+ * Read only the rows [r0, r1) of a PPZ file; only the chunks covering those rows are
+ * fetched (the file must be seekable) and decompressed
+ *
+ * Parameters:
+ *  FILE *fp: file pointer at the start of the file
+ *  int r0: first row to read
+ *  int r1: one past the last row to read
+ * Returns:
+ *  Image *: image holding the rows, NULL on failure
+ */
+Image *read_ppz_rows(FILE *fp, int r0, int r1);
+
+// End of header file
+#endif
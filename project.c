@@ -8,8 +8,25 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "ppm_io.h"
 #include "image_manip.h"
+#include "histogram.h"
+#include "convolve.h"
+#include "canny.h"
+#include "resize.h"
+#include "morphology.h"
+#include "median.h"
+#include "components.h"
+#include "phash.h"
+#include "tiled.h"
+#include "incremental.h"
+#include "rotate.h"
+#include "point_ops.h"
+#include "stream.h"
+#include "ppz_io.h"
+#include "perf_counters.h"
+#include "result_cache.h"
 
 // Return (exit) codes
 
@@ -40,30 +57,324 @@
 // Other errors not specified above
 #define RC_UNSPECIFIED_ERR    8
 
+// Images hashed at a time by --dedup (on several threads) before they are looked up
+#define DEDUP_BATCH 256
+
+// How --incremental brings the result of an operation up to date with a changed frame:
+// not at all (the whole frame is run again), on the changed tiles plus a halo, or by
+// following the changed tiles to the pixels they move to
+#define STAGE_FULL   0
+#define STAGE_LOCAL  1
+#define STAGE_REMAP  2
+
+// An operation named on the command line together with its arguments
+typedef struct _op_call {
+    const char *name;
+    int nargs;
+    char **args;
+    // number of point operations right after this one that run fused with it
+    int fused;
+} OpCall;
+
+// Everything parsed from the command line after the file names
+typedef struct _job {
+    OpCall *ops;
+    int nops;
+    int roi, roiX, roiY, roiW, roiH;
+    // --profile: hardware counters and one running total per operation of the chain
+    int profile;
+    // --tiled: run chains of point operations on copy-on-write tiles
+    int tiled;
+    // --incremental: run only the changed tiles of each frame of a stream, tiles
+    // changing by at most maxDelta counting as unchanged
+    int incremental;
+    int maxDelta;
+    PerfCounters counters;
+    PerfSample *samples;
+    int countersOpen;
+    // --cache: directory of the result cache, NULL without one
+    const char *cache;
+    // --components and --labels: files receiving the connected components of the
+    // black pixels of the result and their label image, NULL without them
+    const char *components;
+    const char *labels;
+} Job;
+
+// What --incremental keeps from one frame of a stream to the next. The chain is cut
+// into stages (an operation, or a run of fused point operations); the leading stages
+// that can be brought up to date tile by tile keep their results, the rest of the
+// chain runs on the whole frame.
+typedef struct _incremental_state {
+    Job *job;
+    int *stages;           // first operation of each incremental stage
+    int *kinds;            // STAGE_LOCAL or STAGE_REMAP for each stage
+    int *radii;            // horizontal and vertical radius of each local stage
+    int nstages;
+    int split;             // first operation run on the whole frame
+    Image *input;          // the input as of the tiles last taken from a frame
+    Image **results;       // the result of each stage
+    Remap **maps;          // the remap of each STAGE_REMAP stage, NULL for the others
+    unsigned char *changed;
+    unsigned char *grown;
+} IncrementalState;
+
+// An image looked up by --dedup, for reporting its near-duplicates
+typedef struct _dedup_match {
+    const PhashIndex *index;
+    const char *name;
+} DedupMatch;
+
+// Supported operations, the number of arguments each one takes, how many more
+// optional arguments may follow them and whether it is a point operation (each
+// output sample depends on one input sample only, so runs of them can be fused)
+static const struct {
+    const char *name;
+    int nargs;
+    int optional;
+    int point;
+} OPERATIONS[] = {
+    { "swap", 0, 0, 1 },
+    { "invert", 0, 0, 1 },
+    { "brightness", 1, 0, 1 },
+    { "contrast", 1, 0, 1 },
+    { "gamma", 1, 0, 1 },
+    { "levels", 2, 1, 1 },
+    { "zoom-out", 0, 0, 0 },
+    { "rotate-right", 0, 0, 0 },
+    { "rotate", 1, 2, 0 },
+    { "swirl", 3, 0, 0 },
+    { "grayscale", 0, 0, 0 },
+    { "edge-detection", 1, 0, 0 },
+    { "canny", 2, 0, 0 },
+    { "crop", 4, 0, 0 },
+    { "resize", 2, 1, 0 },
+    { "blur", 1, 0, 0 },
+    { "box-blur", 1, 0, 0 },
+    { "sharpen", 1, 0, 0 },
+    { "median", 1, 0, 0 },
+    { "erode", 1, 1, 0 },
+    { "dilate", 1, 1, 0 },
+    { "open", 1, 1, 0 },
+    { "close", 1, 1, 0 },
+};
+
 void print_usage();
+static int find_operation(const char *name);
+int parse_job(int argc, char *argv[], int argi, Job *job);
+int run_job(Image *im, const Job *job, int first);
+int run_frame(Image *im, void *ctx);
+int plan_incremental(IncrementalState *state, Job *job);
+int stage_kind(const OpCall *call, int *rx, int *ry);
+int start_incremental(IncrementalState *state, Image *im);
+int update_incremental(IncrementalState *state, const Image *im);
+int run_incremental_frame(Image *im, void *ctx);
+int run_region(Image *region, void *ctx);
+void free_incremental(IncrementalState *state, int plan);
+int apply_operation(Image *im, const char *op, int nargs, char *args[]);
+int run_operation(Image *im, const Job *job, int i);
+int run_point_ops(Image *im, const OpCall *calls, int n);
+int build_point_ops(PointOp *po, int maxval, const OpCall *calls, int n);
+int run_tiled_job(TiledImage *im, const Job *job);
+int run_gray_operation(const Image *im, const Job *job, int i, GrayImage **out, BinaryImage **bits);
+int edge_threshold(const Image *im, const char *arg, double *threshold);
+int morph_operation(const char *op, MorphOp *morphOp);
+int morph_radii(const char *op, int nargs, char *args[], int *rx, int *ry);
+int start_profile(Job *job, int stream);
+void open_counters(Job *job);
+void finish_profile(Job *job);
+char *canonical_chain(const Job *job, const char *format);
+int report_components(const Job *job, const BinaryImage *bits, const Image *im);
+void report_unplaced(const Image *im);
+int run_dedup(int argc, char *argv[]);
+void print_duplicate(void *ctx, int entry, int distance);
+int parse_int(const char *str, int *val);
+int parse_double(const char *str, double *val);
 
 int main(int argc, char* argv[]) {
-    // Less than 2 command line args means that input or output filename wasn't specified
-    if (argc < 3) {
+    Job job;
+    job.ops = malloc(sizeof(OpCall) * argc);
+    if (!job.ops) {
+        return RC_UNSPECIFIED_ERR;
+    }
+
+    // Stream mode: frames come from stdin and go to stdout
+    if (argc >= 2 && strcmp(argv[1], "--stream") == 0) {
+        int rc = parse_job(argc, argv, 2, &job);
+        if (rc == RC_SUCCESS && (job.cache || job.components || job.labels)) {
+            fprintf(stderr, "Error: --cache, --components and --labels are not supported with --stream\n");
+            rc = RC_INVALID_OPERATION;
+        }
+        if (rc == RC_SUCCESS && job.incremental && job.roi) {
+            fprintf(stderr, "Error: --roi is not supported with --incremental\n");
+            rc = RC_INVALID_OPERATION;
+        }
+        IncrementalState state;
+        int incremental = rc == RC_SUCCESS && job.incremental;
+        if (incremental) {
+            rc = plan_incremental(&state, &job);
+        }
+        if (rc == RC_SUCCESS) {
+            rc = start_profile(&job, 1);
+        }
+        if (rc == RC_SUCCESS) {
+            if (incremental) {
+                rc = stream_frames(stdin, stdout, run_incremental_frame, &state, NULL);
+            } else {
+                rc = stream_frames(stdin, stdout, run_frame, &job, NULL);
+            }
+            if (rc == STREAM_READ_FAILED) {
+                fprintf(stderr, "Error: Failed to read a frame from standard input as a PPM image\n");
+                rc = RC_INVALID_PPM;
+            } else if (rc == STREAM_WRITE_FAILED) {
+                fprintf(stderr, "Error: Failed to write a frame to standard output\n");
+                rc = RC_WRITE_FAILED;
+            } else if (rc == STREAM_NO_MEMORY) {
+                rc = RC_UNSPECIFIED_ERR;
+            }
+            finish_profile(&job);
+        }
+        if (incremental) {
+            free_incremental(&state, 1);
+        }
+        free(job.ops);
+        return rc;
+    }
+
+    // Dedup mode: perceptual hashes of the images go to an index of near-duplicates
+    if (argc >= 2 && strcmp(argv[1], "--dedup") == 0) {
+        free(job.ops);
+        return run_dedup(argc, argv);
+    }
+
+    // Less than 3 command line args means that input/output filename or the operation wasn't specified
+    if (argc < 4) {
         fprintf(stderr, "Missing input/output filenames\n");
         print_usage();
+        free(job.ops);
         return RC_MISSING_FILENAME;
     }
+    int rc = parse_job(argc, argv, 3, &job);
+    if (rc == RC_SUCCESS && job.incremental) {
+        fprintf(stderr, "Error: --incremental is only supported with --stream\n");
+        rc = RC_INVALID_OPERATION;
+    }
+    if (rc != RC_SUCCESS) {
+        free(job.ops);
+        return rc;
+    }
+    // Output file names ending in .ppz are written compressed, in .pgm as one gray channel,
+    // in .pbm as one bit per pixel
+    size_t outLen = strlen(argv[2]);
+    int compressed = outLen > 4 && strcmp(argv[2] + outLen - 4, ".ppz") == 0;
+    int gray = outLen > 4 && strcmp(argv[2] + outLen - 4, ".pgm") == 0;
+    int binary = outLen > 4 && strcmp(argv[2] + outLen - 4, ".pbm") == 0;
 
+    // With a result cache, an identical earlier job is served without running the chain;
+    // the cache only holds the output image, so jobs writing components run uncached
+    ResultCache cache;
+    if (job.components || job.labels) {
+        job.cache = NULL;
+    }
+    if (job.cache) {
+        char *chain = canonical_chain(&job, compressed ? "ppz" : gray ? "pgm" : binary ? "pbm" : "ppm");
+        if (!chain || result_cache_open(&cache, job.cache) != 0 || result_cache_key(&cache, argv[1], chain) != 0) {
+            // Run uncached; a missing input is reported below
+            job.cache = NULL;
+        } else if (result_cache_fetch(&cache, argv[2]) == 0) {
+            free(chain);
+            free(job.ops);
+            return RC_SUCCESS;
+        }
+        free(chain);
+    }
 
     // Open the input PPM image file
     FILE * inputF = fopen(argv[1], "r");
     // Error checking
     if (inputF == NULL) {
         fprintf(stderr, "Error: Failed to open input file %s for reading\n", argv[1]);
+        free(job.ops);
         return RC_OPEN_FAILED;
     }
-    Image *input = read_ppm(inputF);
+
+    // With --tiled, a chain of point operations only, from an 8 bit PPM to a PPM, runs on
+    // tiles: constant areas are then read, mapped and written as one color per tile
+    Image *input = NULL;
+    TiledImage *tiledInput = NULL;
+    int labeled = job.components || job.labels;
+    int tiled = job.tiled && !job.roi && !job.profile && !compressed && !gray && !binary && !labeled &&
+                OPERATIONS[find_operation(job.ops[0].name)].point && job.ops[0].fused == job.nops - 1;
+    int first = 0;
+    if (is_ppz(inputF)) {
+        // Compressed input; a leading crop only decodes the chunks holding its rows
+        int x, y, w, h, cols, rows;
+        char **args = job.ops[0].args;
+        if (!job.roi && strcmp(job.ops[0].name, "crop") == 0 && parse_int(args[1], &y) && parse_int(args[3], &h) &&
+            parse_int(args[0], &x) && parse_int(args[2], &w) && y >= 0 && h > 0) {
+            if (read_ppz_size(inputF, &cols, &rows) == 0 &&
+                (w <= 0 || x < 0 || x > cols - w || y > rows - h)) {
+                fprintf(stderr, "Error: Invalid arguments for crop operation (rectangle must lie inside the image)\n");
+                fclose(inputF);
+                free(job.ops);
+                return RC_OP_ARGS_RANGE_ERR;
+            }
+            input = read_ppz_rows(inputF, y, y + h);
+            if (input) {
+                // Only the column range is left to crop
+                char *rowArgs[4] = { args[0], "0", args[2], args[3] };
+                rc = apply_operation(input, "crop", 4, rowArgs);
+                if (rc != RC_SUCCESS) {
+                    free_image(&input);
+                    fclose(inputF);
+                    free(job.ops);
+                    return rc;
+                }
+                first = 1;
+            }
+        } else {
+            input = read_ppz(inputF);
+        }
+    } else if (!job.roi && strcmp(job.ops[0].name, "crop") == 0) {
+        // A leading crop only needs the window, so read just those row spans
+        char **args = job.ops[0].args;
+        int cols, rows, maxval, x, y, w, h;
+        if (read_ppm_header(inputF, &cols, &rows, &maxval) != 0) {
+            fprintf(stderr, "Error: Failed to read input file %s as a PPM image file\n", argv[1]);
+            fclose(inputF);
+            free(job.ops);
+            return RC_INVALID_PPM;
+        }
+        if (!parse_int(args[0], &x) || !parse_int(args[1], &y) || !parse_int(args[2], &w) || !parse_int(args[3], &h) ||
+            w <= 0 || h <= 0 || x < 0 || y < 0 || x > cols - w || y > rows - h) {
+            fprintf(stderr, "Error: Invalid arguments for crop operation (rectangle must lie inside the image)\n");
+            fclose(inputF);
+            free(job.ops);
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        input = read_ppm_region(inputF, cols, rows, maxval, x, y, w, h);
+        // The window is already the result of the crop
+        first = 1;
+    } else if (tiled) {
+        int cols, rows, maxval = 0;
+        if (read_ppm_header(inputF, &cols, &rows, &maxval) == 0 && maxval <= 255) {
+            tiledInput = read_ppm_tiled(inputF, cols, rows, maxval);
+        } else if (maxval > 255) {
+            // 16 bit images are not tiled
+            input = read_ppm_region(inputF, cols, rows, maxval, 0, 0, cols, rows);
+        }
+    } else {
+        input = read_ppm(inputF);
+    }
+    fclose(inputF);
     // Error checking
-    if (input == NULL) {
+    if (input == NULL && tiledInput == NULL) {
         fprintf(stderr, "Error: Failed to read input file %s as a PPM image file\n", argv[1]);
+        free(job.ops);
         return RC_INVALID_PPM;
     }
+    if (input) {
+        report_unplaced(input);
+    }
     // Open the output PPM image file
     FILE *output = fopen(argv[2], "w");
 
@@ -71,50 +382,917 @@ int main(int argc, char* argv[]) {
     // Error checking
     if (output == NULL) {
         fprintf(stderr, "Failed to open output file %s for writing\n", argv[2]);
+        if (input) {
+            free_image(&input);
+        }
+        free_tiled_image(&tiledInput);
+        free(job.ops);
         return RC_WRITE_FAILED; 
     }
 
+    // A gray output of a chain ending in grayscale or edge-detection, or a binary output
+    // of one ending in edge-detection, is produced by that operation directly, without
+    // the three channel intermediate; morphology operations after it run on the gray or
+    // binary result too
+    GrayImage *grayOutput = NULL;
+    BinaryImage *binaryOutput = NULL;
+    MorphOp morphOp;
+    int tail = 0;
+    while (job.nops - tail > first && morph_operation(job.ops[job.nops-1-tail].name, &morphOp)) {
+        tail++;
+    }
+    const char *last = job.nops - tail > first ? job.ops[job.nops-1-tail].name : "";
+    // (components are taken from the three channel result unless the output is binary)
+    int direct = !job.roi && ((gray && !labeled && (strcmp(last, "grayscale") == 0 || strcmp(last, "edge-detection") == 0)) ||
+                              (binary && strcmp(last, "edge-detection") == 0)) ? tail + 1 : 0;
+    rc = tiledInput ? run_tiled_job(tiledInput, &job) : start_profile(&job, 0);
+    if (rc == RC_SUCCESS && !tiledInput) {
+        job.nops -= direct;
+        rc = run_job(input, &job, first);
+        job.nops += direct;
+        for (int i = job.nops - direct; rc == RC_SUCCESS && i < job.nops; i++) {
+            rc = run_gray_operation(input, &job, i, &grayOutput, binary ? &binaryOutput : NULL);
+        }
+        finish_profile(&job);
+    }
+    if (rc == RC_SUCCESS && gray && !grayOutput && !(grayOutput = to_gray(input))) {
+        rc = RC_UNSPECIFIED_ERR;
+    }
+    if (rc == RC_SUCCESS && binary && !binaryOutput && !(binaryOutput = to_binary(input))) {
+        rc = RC_UNSPECIFIED_ERR;
+    }
+
+    // Write the result in the format the output file name asks for
+    if (rc == RC_SUCCESS && (tiledInput ? write_ppm_tiled(output, tiledInput) :
+                             gray ? write_pgm(output, grayOutput) : binary ? write_pbm(output, binaryOutput) :
+                             compressed ? write_ppz(output, input) : write_ppm(output, input)) != 0) {
+        fprintf(stderr, "Error: Failed to write output file %s\n", argv[2]);
+        rc = RC_WRITE_FAILED;
+    }
+
+    // Close the output file, then keep a copy of it in the cache
+    if (fclose(output) != 0 && rc == RC_SUCCESS) {
+        fprintf(stderr, "Error: Failed to write output file %s\n", argv[2]);
+        rc = RC_WRITE_FAILED;
+    }
+    if (rc == RC_SUCCESS && job.cache) {
+        result_cache_store(&cache, argv[2]);
+    }
+    if (rc == RC_SUCCESS && labeled) {
+        rc = report_components(&job, binaryOutput, input);
+    }
+    if (grayOutput) {
+        free_gray_image(&grayOutput);
+    }
+    if (binaryOutput) {
+        free_binary_image(&binaryOutput);
+    }
+    if (input) {
+        free_image(&input);
+    }
+    free_tiled_image(&tiledInput);
+    free(job.ops);
+
+    // Return success
+    return rc;
+}
+
+/**
+ * Function: find_operation
+ * ------------------------
+ * Look up an operation by name
+ * 
+ * Parameters:
+ *  const char *name: the name of the operation
+ * Returns:
+ *  the index of the operation in OPERATIONS, -1 if it is not supported
+ */
+static int find_operation(const char *name) {
+    for (size_t i = 0; i < sizeof(OPERATIONS) / sizeof(OPERATIONS[0]); i++) {
+        if (strcmp(OPERATIONS[i].name, name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Function: parse_job
+ * -------------------
+ * Parse the options and the chain of operations that follow the file names. Every
+ * operation takes a fixed number of arguments, possibly followed by optional ones that
+ * are told apart from the next operation by name, so the chain is split by counting.
+ * 
+ * Parameters:
+ *  int argc: number of command line arguments
+ *  char *argv[]: the command line arguments
+ *  int argi: index of the first argument after the file names
+ *  Job *job: receives the options and operations (job->ops must hold argc entries)
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int parse_job(int argc, char *argv[], int argi, Job *job) {
+    job->nops = 0;
+    job->roi = 0;
+    job->profile = 0;
+    job->tiled = 0;
+    job->incremental = 0;
+    job->maxDelta = 0;
+    job->samples = NULL;
+    job->countersOpen = 0;
+    job->cache = NULL;
+    job->components = NULL;
+    job->labels = NULL;
+
+    while (argi < argc && strncmp(argv[argi], "--", 2) == 0) {
+        if (strcmp(argv[argi], "--roi") == 0) {
+            // Optional region of interest that limits the operations to a rectangle
+            if (argc < argi + 6) {
+                fprintf(stderr, "Error: --roi must be followed by <x> <y> <w> <h> and an operation\n");
+                return RC_INVALID_OP_ARGS;
+            }
+            if (!parse_int(argv[argi+1], &job->roiX) || !parse_int(argv[argi+2], &job->roiY) ||
+                !parse_int(argv[argi+3], &job->roiW) || !parse_int(argv[argi+4], &job->roiH)) {
+                fprintf(stderr, "Error: Invalid arguments for --roi (must be integers)\n");
+                return RC_OP_ARGS_RANGE_ERR;
+            }
+            job->roi = 1;
+            argi += 5;
+        } else if (strcmp(argv[argi], "--cache") == 0) {
+            // Serve repeated jobs from a directory of earlier outputs
+            if (argi + 1 >= argc) {
+                fprintf(stderr, "Error: --cache must be followed by <directory> and an operation\n");
+                return RC_INVALID_OP_ARGS;
+            }
+            job->cache = argv[argi+1];
+            argi += 2;
+        } else if (strcmp(argv[argi], "--components") == 0 || strcmp(argv[argi], "--labels") == 0) {
+            // Label the connected components of the black pixels of the result
+            if (argi + 1 >= argc) {
+                fprintf(stderr, "Error: %s must be followed by <file> and an operation\n", argv[argi]);
+                return RC_INVALID_OP_ARGS;
+            }
+            if (strcmp(argv[argi], "--components") == 0) {
+                job->components = argv[argi+1];
+            } else {
+                job->labels = argv[argi+1];
+            }
+            argi += 2;
+        } else if (strcmp(argv[argi], "--tiled") == 0) {
+            // Keep the image as tiles, constant ones as a single color
+            job->tiled = 1;
+            argi++;
+        } else if (strcmp(argv[argi], "--incremental") == 0) {
+            // Keep the results of the previous frame and run only its changed tiles,
+            // optionally ignoring changes of at most delta
+            job->incremental = 1;
+            argi++;
+            if (argi < argc && parse_int(argv[argi], &job->maxDelta)) {
+                if (job->maxDelta < 0) {
+                    fprintf(stderr, "Error: Invalid arguments for --incremental (delta must be >= 0)\n");
+                    return RC_OP_ARGS_RANGE_ERR;
+                }
+                argi++;
+            }
+        } else if (strcmp(argv[argi], "--profile") == 0) {
+            // Report hardware counters of every operation on standard error
+            job->profile = 1;
+            argi++;
+        } else {
+            fprintf(stderr, "Error: Unsupported option %s\n", argv[argi]);
+            print_usage();
+            return RC_INVALID_OPERATION;
+        }
+    }
+    if (argi >= argc) {
+        fprintf(stderr, "Error: No image processing operation specified\n");
+        print_usage();
+        return RC_INVALID_OPERATION;
+    }
+
+    while (argi < argc) {
+        int index = find_operation(argv[argi]);
+        if (index < 0) {
+            if (job->nops > 0) {
+                // Most likely one argument too many for the previous operation
+                fprintf(stderr, "Error: Unexpected argument %s after operation %s\n", argv[argi], job->ops[job->nops-1].name);
+                return RC_INVALID_OP_ARGS;
+            }
+            // Error checking
+            fprintf(stderr, "Error: Unsupported image processing operation %s specified\n", argv[argi]);
+            return RC_INVALID_OPERATION;
+        }
+        if (argi + OPERATIONS[index].nargs >= argc) {
+            if (OPERATIONS[index].optional > 0) {
+                fprintf(stderr, "Error: Incorrect number of arguments for %s operation (must be %d to %d)\n", OPERATIONS[index].name,
+                        OPERATIONS[index].nargs, OPERATIONS[index].nargs + OPERATIONS[index].optional);
+            } else {
+                fprintf(stderr, "Error: Incorrect number of arguments for %s operation (must be %d)\n", OPERATIONS[index].name, OPERATIONS[index].nargs);
+            }
+            return RC_INVALID_OP_ARGS;
+        }
+        // Optional arguments are taken as long as they are not the next operation
+        int nargs = OPERATIONS[index].nargs;
+        while (nargs < OPERATIONS[index].nargs + OPERATIONS[index].optional && argi + 1 + nargs < argc &&
+               find_operation(argv[argi + 1 + nargs]) < 0) {
+            nargs++;
+        }
+        job->ops[job->nops].name = OPERATIONS[index].name;
+        job->ops[job->nops].nargs = nargs;
+        job->ops[job->nops].args = argv + argi + 1;
+        job->ops[job->nops].fused = 0;
+        // A point operation following another one is fused into the start of the run
+        int start = job->nops;
+        while (start > 0 && OPERATIONS[index].point && OPERATIONS[find_operation(job->ops[start-1].name)].point) {
+            start--;
+        }
+        if (start < job->nops) {
+            job->ops[start].fused++;
+        }
+        job->nops++;
+        argi += 1 + nargs;
+    }
+    return RC_SUCCESS;
+}
+
+/**
+ * Function: canonical_chain
+ * -------------------------
+ * Text describing everything about a job that affects its output, for the result
+ * cache: the output format, the region of interest and the operations with their
+ * arguments, numbers written in one canonical form (so 20 and 20.0 match)
+ * 
+ * Parameters:
+ *  const Job *job: the parsed command line
+ *  const char *format: the output format (ppm, ppz, pgm or pbm)
+ * Returns:
+ *  the text (to be freed), NULL if memory runs out
+ */
+char *canonical_chain(const Job *job, const char *format) {
+    size_t size = 64;
+    for (int i = 0; i < job->nops; i++) {
+        size += strlen(job->ops[i].name) + 2;
+        for (int a = 0; a < job->ops[i].nargs; a++) {
+            size += strlen(job->ops[i].args[a]) + 32;
+        }
+    }
+    char *chain = malloc(size);
+    if (!chain) {
+        return NULL;
+    }
+
+    size_t len = (size_t) snprintf(chain, size, "%s", format);
+    if (job->roi) {
+        len += (size_t) snprintf(chain + len, size - len, " roi %d %d %d %d", job->roiX, job->roiY, job->roiW, job->roiH);
+    }
+    for (int i = 0; i < job->nops; i++) {
+        len += (size_t) snprintf(chain + len, size - len, "; %s", job->ops[i].name);
+        for (int a = 0; a < job->ops[i].nargs; a++) {
+            double value;
+            if (parse_double(job->ops[i].args[a], &value)) {
+                len += (size_t) snprintf(chain + len, size - len, " %.17g", value);
+            } else {
+                len += (size_t) snprintf(chain + len, size - len, " %s", job->ops[i].args[a]);
+            }
+        }
+    }
+    return chain;
+}
+
+/**
+ * Function: run_job
+ * -----------------
+ * Run the chain of operations on the image, limited to the region of interest if
+ * one was given
+ * 
+ * Parameters:
+ *  Image *im: the image to be processed
+ *  const Job *job: the parsed command line
+ *  int first: index of the first operation to run
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_job(Image *im, const Job *job, int first) {
+    int rc = RC_SUCCESS;
+    if (!job->roi) {
+        for (int i = first; i < job->nops && rc == RC_SUCCESS; i += 1 + job->ops[i].fused) {
+            rc = run_operation(im, job, i);
+        }
+        return rc;
+    }
+
+    // Run the operations on the rectangle only
+    if (job->roiW <= 0 || job->roiH <= 0 || job->roiX < 0 || job->roiY < 0 ||
+        job->roiX > im->cols - job->roiW || job->roiY > im->rows - job->roiH) {
+        fprintf(stderr, "Error: Invalid arguments for --roi (rectangle must lie inside the image)\n");
+        return RC_OP_ARGS_RANGE_ERR;
+    }
+    Image *region = copy_region(im, job->roiX, job->roiY, job->roiW, job->roiH);
+    if (region == NULL) {
+        return RC_UNSPECIFIED_ERR;
+    }
+    for (int i = first; i < job->nops && rc == RC_SUCCESS; i += 1 + job->ops[i].fused) {
+        rc = run_operation(region, job, i);
+    }
+    // Size preserving chains are written back in place, anything else
+    // (zoom-out, rotate-right, crop) produces the processed rectangle alone
+    if (rc == RC_SUCCESS && region->rows == job->roiH && region->cols == job->roiW) {
+        paste_region(im, region, job->roiX, job->roiY);
+        free_image(&region);
+    } else if (rc == RC_SUCCESS) {
+        replace_image(im, &region);
+    } else {
+        free_image(&region);
+    }
+    return rc;
+}
+
+/**
+ * Function: run_operation
+ * -----------------------
+ * Run one operation of the chain, or the run of point operations fused into it,
+ * measuring it if profiling was requested
+ * 
+ * Parameters:
+ *  Image *im: the image to be processed
+ *  const Job *job: the parsed command line
+ *  int i: index of the operation in the chain
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_operation(Image *im, const Job *job, int i) {
+    const OpCall *call = &job->ops[i];
+    PerfSnapshot snapshot;
+    // Throughput is counted against the pixels the operation was given
+    double megapixels = (double)im->rows * im->cols / 1e6;
+    if (job->profile) {
+        perf_begin(&job->counters, &snapshot);
+    }
+    int rc = call->fused > 0 ? run_point_ops(im, call, call->fused + 1) : apply_operation(im, call->name, call->nargs, call->args);
+    if (!job->profile) {
+        return rc;
+    }
+    perf_end(&job->counters, &snapshot, megapixels, &job->samples[i]);
+    return rc;
+}
+
+/**
+ * Function: run_gray_operation
+ * ----------------------------
+ * Run a grayscale or edge-detection operation of the chain into a new gray image, or
+ * an edge-detection into a new binary image, or a morphology operation on the gray or
+ * binary result of an earlier one, profiled like run_operation
+ * 
+ * Parameters:
+ *  const Image *im: the image to be processed
+ *  const Job *job: the parsed command line
+ *  int i: index of the operation
+ *  GrayImage **out: receives (or holds) the gray result
+ *  BinaryImage **bits: receives (or holds) the binary result instead, if not NULL
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_gray_operation(const Image *im, const Job *job, int i, GrayImage **out, BinaryImage **bits) {
+    const OpCall *call = &job->ops[i];
+    PerfSnapshot snapshot;
+    double megapixels = (double)im->rows * im->cols / 1e6;
+    if (job->profile) {
+        perf_begin(&job->counters, &snapshot);
+    }
+    int rc = RC_SUCCESS;
+    MorphOp morphOp;
+    if (morph_operation(call->name, &morphOp)) {
+        int rx, ry;
+        rc = morph_radii(call->name, call->nargs, call->args, &rx, &ry);
+        if (rc == RC_SUCCESS && (bits ? morph_binary(*bits, morphOp, rx, ry) : morph_gray(*out, morphOp, rx, ry)) != 0) {
+            rc = RC_UNSPECIFIED_ERR;
+        }
+    } else if (strcmp(call->name, "edge-detection") == 0) {
+        double threshold;
+        rc = edge_threshold(im, call->args[0], &threshold);
+        if (rc == RC_SUCCESS && bits && !(*bits = edges_binary(im, threshold))) {
+            rc = RC_UNSPECIFIED_ERR;
+        } else if (rc == RC_SUCCESS && !bits && !(*out = edges_gray(im, threshold))) {
+            rc = RC_UNSPECIFIED_ERR;
+        }
+    } else if (!(*out = to_gray(im))) {
+        rc = RC_UNSPECIFIED_ERR;
+    }
+    if (job->profile) {
+        perf_end(&job->counters, &snapshot, megapixels, &job->samples[i]);
+    }
+    return rc;
+}
+
+/**
+ * Function: start_profile
+ * -----------------------
+ * Open the performance counters if profiling was requested; without permission to
+ * use them only the wall clock time is reported. A stream opens them with its first
+ * frame instead, after its reader and writer threads have started: the counters
+ * take in the threads started after them, and the frame I/O would be counted as
+ * part of every operation.
+ * 
+ * Parameters:
+ *  Job *job: the parsed command line
+ *  int stream: nonzero in stream mode
+ * Returns:
+ *  RC_SUCCESS or RC_UNSPECIFIED_ERR if memory runs out
+ */
+int start_profile(Job *job, int stream) {
+    if (!job->profile) {
+        return RC_SUCCESS;
+    }
+    job->samples = calloc(job->nops, sizeof(PerfSample));
+    if (!job->samples) {
+        return RC_UNSPECIFIED_ERR;
+    }
+    if (!stream) {
+        open_counters(job);
+    }
+    return RC_SUCCESS;
+}
+
+/**
+ * Function: open_counters
+ * -----------------------
+ * Open the performance counters of a profiled job unless they are open already
+ * 
+ * Parameters:
+ *  Job *job: the parsed command line
+ * Returns:
+ *  void
+ */
+void open_counters(Job *job) {
+    if (job->samples && !job->countersOpen) {
+        perf_open(&job->counters);
+        job->countersOpen = 1;
+    }
+}
+
+/**
+ * Function: finish_profile
+ * ------------------------
+ * Print one line per operation of the chain that ran, summed over all frames of a
+ * stream, and close the counters
+ * 
+ * Parameters:
+ *  Job *job: the parsed command line
+ * Returns:
+ *  void
+ */
+void finish_profile(Job *job) {
+    if (!job->samples) {
+        return;
+    }
+    // A stream without frames has nothing to report
+    if (!job->countersOpen) {
+        free(job->samples);
+        job->samples = NULL;
+        return;
+    }
+    perf_report_header(stderr, &job->counters);
+    for (int i = 0; i < job->nops; i++) {
+        if (job->samples[i].runs > 0) {
+            // Fused runs of point operations are listed as "first+others"
+            char label[64];
+            if (job->ops[i].fused > 0) {
+                snprintf(label, sizeof(label), "%s+%d", job->ops[i].name, job->ops[i].fused);
+            } else {
+                snprintf(label, sizeof(label), "%s", job->ops[i].name);
+            }
+            perf_report(stderr, &job->counters, label, &job->samples[i]);
+        }
+    }
+    perf_close(&job->counters);
+    job->countersOpen = 0;
+    free(job->samples);
+    job->samples = NULL;
+}
+
+/**
+ * Function: report_unplaced
+ * -------------------------
+ * Warn, once per run, that the pixels of an image could not be interleaved over the
+ * NUMA nodes as IMGPROC_NUMA asked
+ * 
+ * Parameters:
+ *  const Image *im: the image
+ * Returns:
+ *  void
+ */
+void report_unplaced(const Image *im) {
+    static int reported = 0;
+    if (im->unplaced && !reported) {
+        reported = 1;
+        fprintf(stderr, "Warning: IMGPROC_NUMA interleave is not available, the pixels follow the default memory policy\n");
+    }
+}
+
+/**
+ * Function: run_frame
+ * -------------------
+ * Stream mode callback that runs the whole job on one frame
+ * 
+ * Parameters:
+ *  Image *im: the frame
+ *  void *ctx: the Job
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_frame(Image *im, void *ctx) {
+    report_unplaced(im);
+    open_counters(ctx);
+    return run_job(im, ctx, 0);
+}
+
+/**
+ * Function: stage_kind
+ * --------------------
+ * How --incremental can bring the result of one stage of the chain up to date, and
+ * how far each pixel of a local stage reads around itself. Operations whose result
+ * depends on the whole image (thresholds picked from its histogram) or that change
+ * its size are run on the whole frame, as are operations with bad arguments (which
+ * are reported when they run).
+ * 
+ * Parameters:
+ *  const OpCall *call: the first operation of the stage
+ *  int *rx: receives the horizontal radius of a local stage
+ *  int *ry: receives the vertical radius of a local stage
+ * Returns:
+ *  STAGE_FULL, STAGE_LOCAL or STAGE_REMAP
+ */
+int stage_kind(const OpCall *call, int *rx, int *ry) {
+    const char *op = call->name;
+    MorphOp morphOp;
+    double value;
+    int radius;
+    *rx = 0;
+    *ry = 0;
+    if (OPERATIONS[find_operation(op)].point || strcmp(op, "grayscale") == 0) {
+        return STAGE_LOCAL;
+    }
+    if (strcmp(op, "swirl") == 0) {
+        return STAGE_REMAP;
+    }
+    if (strcmp(op, "edge-detection") == 0) {
+        // The gradient reads the four neighbors
+        *rx = *ry = 1;
+        return strcmp(call->args[0], "auto") == 0 || call->args[0][0] == 'p' ? STAGE_FULL : STAGE_LOCAL;
+    }
+    if (strcmp(op, "blur") == 0 || strcmp(op, "sharpen") == 0) {
+        // The Gaussian reaches 3 sigma; sharpen blurs with a sigma of 1
+        if (!parse_double(call->args[0], &value) || value <= 0 || value > 100) {
+            return STAGE_FULL;
+        }
+        *rx = *ry = (int)ceil(3 * (strcmp(op, "blur") == 0 ? value : 1.0));
+        return STAGE_LOCAL;
+    }
+    if (strcmp(op, "box-blur") == 0 || strcmp(op, "median") == 0) {
+        if (!parse_int(call->args[0], &radius) || radius < 0 || radius > BOX_MAX_RADIUS) {
+            return STAGE_FULL;
+        }
+        *rx = *ry = radius;
+        return STAGE_LOCAL;
+    }
+    if (morph_operation(op, &morphOp)) {
+        // Opening and closing are two passes
+        int passes = morphOp == MORPH_OPEN || morphOp == MORPH_CLOSE ? 2 : 1;
+        if (call->nargs < 1 || call->nargs > 2 || !parse_int(call->args[0], rx) || *rx < 0 ||
+            (call->nargs == 2 && (!parse_int(call->args[1], ry) || *ry < 0))) {
+            return STAGE_FULL;
+        }
+        if (call->nargs == 1) {
+            *ry = *rx;
+        }
+        *rx *= passes;
+        *ry *= passes;
+        return STAGE_LOCAL;
+    }
+    return STAGE_FULL;
+}
+
+/**
+ * Function: plan_incremental
+ * --------------------------
+ * Find the leading stages of the chain that --incremental runs tile by tile; the
+ * state can be freed with free_incremental even if this fails
+ * 
+ * Parameters:
+ *  IncrementalState *state: receives the plan, with nothing kept yet
+ *  Job *job: the parsed command line
+ * Returns:
+ *  RC_SUCCESS or RC_UNSPECIFIED_ERR if memory runs out
+ */
+int plan_incremental(IncrementalState *state, Job *job) {
+    state->job = job;
+    state->nstages = 0;
+    state->split = 0;
+    state->input = NULL;
+    state->changed = NULL;
+    state->grown = NULL;
+    state->stages = malloc(sizeof(int) * job->nops);
+    state->kinds = malloc(sizeof(int) * job->nops);
+    state->radii = malloc(sizeof(int) * 2 * job->nops);
+    state->results = calloc(job->nops, sizeof(Image *));
+    state->maps = calloc(job->nops, sizeof(Remap *));
+    if (!state->stages || !state->kinds || !state->radii || !state->results || !state->maps) {
+        return RC_UNSPECIFIED_ERR;
+    }
+    while (state->split < job->nops) {
+        int k = state->nstages;
+        state->kinds[k] = stage_kind(&job->ops[state->split], &state->radii[2 * k], &state->radii[2 * k + 1]);
+        if (state->kinds[k] == STAGE_FULL) {
+            break;
+        }
+        state->stages[k] = state->split;
+        state->nstages++;
+        state->split += 1 + job->ops[state->split].fused;
+    }
+    return RC_SUCCESS;
+}
+
+/**
+ * Function: start_incremental
+ * ---------------------------
+ * Run the incremental stages on the whole of a frame (the first one, or one of a new
+ * size or maxval) and keep their results
+ * 
+ * Parameters:
+ *  IncrementalState *state: the state, whatever was kept is dropped
+ *  Image *im: the frame
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int start_incremental(IncrementalState *state, Image *im) {
+    const Job *job = state->job;
+    free_incremental(state, 0);
+    size_t tiles = (size_t)tile_count(im->rows) * tile_count(im->cols);
+    state->changed = malloc(tiles);
+    state->grown = malloc(tiles);
+    state->input = make_copy(im);
+    if (!state->changed || !state->grown || !state->input) {
+        free_incremental(state, 0);
+        return RC_UNSPECIFIED_ERR;
+    }
+
+    for (int k = 0; k < state->nstages; k++) {
+        const OpCall *call = &job->ops[state->stages[k]];
+        state->results[k] = make_copy(k > 0 ? state->results[k-1] : state->input);
+        if (!state->results[k]) {
+            free_incremental(state, 0);
+            return RC_UNSPECIFIED_ERR;
+        }
+        int rc = run_operation(state->results[k], job, state->stages[k]);
+        if (rc != RC_SUCCESS) {
+            free_incremental(state, 0);
+            return rc;
+        }
+        if (state->kinds[k] == STAGE_REMAP) {
+            // A swirl sends every pixel to the same place in every frame
+            int *sources = malloc(sizeof(int) * ((size_t)im->rows * im->cols));
+            if (sources) {
+                swirl_sources(im->rows, im->cols, atoi(call->args[0]), atoi(call->args[1]), atoi(call->args[2]), sources);
+            }
+            state->maps[k] = make_remap(im->rows, im->cols, sources);
+            if (!state->maps[k]) {
+                free_incremental(state, 0);
+                return RC_UNSPECIFIED_ERR;
+            }
+        }
+    }
+    return RC_SUCCESS;
+}
+
+/**
+ * Function: update_incremental
+ * ----------------------------
+ * Bring the results of the incremental stages up to date with a frame: the tiles of
+ * the frame that changed are taken into the kept input, and each stage computes
+ * again the tiles its input changed in, handing on the tiles it changed itself
+ * 
+ * Parameters:
+ *  IncrementalState *state: the state
+ *  const Image *im: the frame (the same size as the kept input)
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int update_incremental(IncrementalState *state, const Image *im) {
+    Job *job = state->job;
+    int count = diff_tiles(state->input, im, job->maxDelta, state->changed);
+    if (count < 0) {
+        return RC_UNSPECIFIED_ERR;
+    }
+    copy_tiles(state->input, im, state->changed);
+
+    for (int k = 0; k < state->nstages && count > 0; k++) {
+        const Image *src = k > 0 ? state->results[k-1] : state->input;
+        PerfSnapshot snapshot;
+        double megapixels = (double)im->rows * im->cols / 1e6;
+        if (job->profile) {
+            perf_begin(&job->counters, &snapshot);
+        }
+        int rx = state->radii[2 * k], ry = state->radii[2 * k + 1];
+        if (state->kinds[k] == STAGE_REMAP) {
+            count = remap_tiles(state->maps[k], src, state->results[k], state->changed, state->grown);
+        } else {
+            count = grow_tiles(state->changed, state->grown, im->rows, im->cols, rx, ry);
+            if (update_tiles(state->results[k], src, state->grown, rx, ry, run_region, &job->ops[state->stages[k]]) != 0) {
+                count = -1;
+            }
+        }
+        if (job->profile) {
+            perf_end(&job->counters, &snapshot, megapixels, &job->samples[state->stages[k]]);
+        }
+        if (count < 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+        // The tiles this stage changed are the ones the next stage reads anew
+        unsigned char *swap = state->changed;
+        state->changed = state->grown;
+        state->grown = swap;
+    }
+    return RC_SUCCESS;
+}
+
+/**
+ * Function: run_region
+ * --------------------
+ * Run one incremental stage on a rectangle of its input (the region_fn of
+ * update_tiles)
+ * 
+ * Parameters:
+ *  Image *region: the rectangle
+ *  void *ctx: the first OpCall of the stage
+ * Returns:
+ *  0 on success, nonzero otherwise
+ */
+int run_region(Image *region, void *ctx) {
+    const OpCall *call = ctx;
+    return call->fused > 0 ? run_point_ops(region, call, call->fused + 1) : apply_operation(region, call->name, call->nargs, call->args);
+}
+
+/**
+ * Function: run_incremental_frame
+ * -------------------------------
+ * Stream mode callback of --incremental: the incremental stages are brought up to
+ * date with the frame, and the rest of the chain runs on a copy of their result
+ * 
+ * Parameters:
+ *  Image *im: the frame
+ *  void *ctx: the IncrementalState
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_incremental_frame(Image *im, void *ctx) {
+    IncrementalState *state = ctx;
+    report_unplaced(im);
+    open_counters(state->job);
+    if (state->nstages == 0) {
+        return run_job(im, state->job, 0);
+    }
+    int rc;
+    if (!state->input || state->input->rows != im->rows || state->input->cols != im->cols ||
+        state->input->maxval != im->maxval) {
+        rc = start_incremental(state, im);
+    } else {
+        rc = update_incremental(state, im);
+    }
+    if (rc != RC_SUCCESS) {
+        return rc;
+    }
+    ImageView result = image_view(state->results[state->nstages - 1]), frame = image_view(im);
+    imgproc_copy(&result, &frame);
+    return run_job(im, state->job, state->split);
+}
+
+/**
+ * Function: free_incremental
+ * --------------------------
+ * Free everything --incremental kept from earlier frames, and the plan as well
+ * 
+ * Parameters:
+ *  IncrementalState *state: the state
+ *  int plan: nonzero to free the plan too
+ * Returns:
+ *  void
+ */
+void free_incremental(IncrementalState *state, int plan) {
+    if (state->input) {
+        free_image(&state->input);
+    }
+    for (int k = 0; k < state->nstages; k++) {
+        if (state->results[k]) {
+            free_image(&state->results[k]);
+        }
+        free_remap(&state->maps[k]);
+    }
+    free(state->changed);
+    free(state->grown);
+    state->changed = NULL;
+    state->grown = NULL;
+    if (plan) {
+        free(state->stages);
+        free(state->kinds);
+        free(state->radii);
+        free(state->results);
+        free(state->maps);
+    }
+}
 
+/**
+ * Function: apply_operation
+ * -------------------------
+ * Check the arguments of an operation and run it on the image
+ * 
+ * Parameters:
+ *  Image *im: the image to be processed
+ *  const char *op: the name of the operation
+ *  int nargs: the number of arguments given to the operation
+ *  char *args[]: the arguments given to the operation
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int apply_operation(Image *im, const char *op, int nargs, char *args[]) {
+    MorphOp morphOp;
     // Check which operation to perform, conduct error checking
     // Swap
-    if (strcmp(argv[3], "swap") == 0) {
-        if(argc != 4){
+    if (strcmp(op, "swap") == 0) {
+        if(nargs != 0){
             return RC_INVALID_OP_ARGS;
         }
         // Implement swap function
-        swap(input);
+        swap(im);
     }
     // Invert
-    else if (strcmp(argv[3], "invert") == 0) {
-        if(argc != 4){
+    else if (strcmp(op, "invert") == 0) {
+        if(nargs != 0){
             return RC_INVALID_OP_ARGS;
         }
         // Implement invert function
-        invert(input);
+        invert(im);
+    }
+    // Brightness, contrast, gamma and levels are run as a point operation of their own
+    else if (strcmp(op, "brightness") == 0 || strcmp(op, "contrast") == 0 || strcmp(op, "gamma") == 0 ||
+             strcmp(op, "levels") == 0) {
+        OpCall call;
+        call.name = op;
+        call.nargs = nargs;
+        call.args = args;
+        call.fused = 0;
+        return run_point_ops(im, &call, 1);
     }
     // Zoom-out
-    else if (strcmp(argv[3], "zoom-out") == 0) {
-        if(argc != 4){
+    else if (strcmp(op, "zoom-out") == 0) {
+        if(nargs != 0){
             return RC_INVALID_OP_ARGS;
         }
         // Implement zoom-out function
-        zoom_out(input);
+        zoom_out(im);
     }
     // Rotate-right
-    else if (strcmp(argv[3], "rotate-right") == 0) {
-        if(argc != 4){
+    else if (strcmp(op, "rotate-right") == 0) {
+        if(nargs != 0){
             return RC_INVALID_OP_ARGS;
         }
         // Implement rotate-right function
-        rotate_right(input);
-        // Copy input to output
-        write_ppm(output, input);
+        rotate_right(im);
+    }
+    // Rotate by any angle
+    else if (strcmp(op, "rotate") == 0) {
+        // Check if number of arguments is correct
+        if (nargs < 1 || nargs > 3) {
+            fprintf(stderr, "Error: Incorrect number of arguments for rotate operation (must be 1 to 3)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        double degrees;
+        if (!parse_double(args[0], &degrees)) {
+            fprintf(stderr, "Error: Invalid arguments for rotate operation (angle must be a number)\n");
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        // The canvas and sampling options may come in either order
+        RotateCanvas canvas = ROTATE_EXPAND;
+        RotateSampling sampling = ROTATE_BILINEAR;
+        for (int i = 1; i < nargs; i++) {
+            // "crop" alone would be taken for the crop operation
+            if (strcmp(args[i], "expand") == 0 || strcmp(args[i], "cropped") == 0) {
+                canvas = args[i][0] == 'e' ? ROTATE_EXPAND : ROTATE_CROP;
+            } else if (strcmp(args[i], "nearest") == 0 || strcmp(args[i], "bilinear") == 0) {
+                sampling = args[i][0] == 'n' ? ROTATE_NEAREST : ROTATE_BILINEAR;
+            } else {
+                fprintf(stderr, "Error: Invalid arguments for rotate operation (options are expand, cropped, nearest and bilinear)\n");
+                return RC_OP_ARGS_RANGE_ERR;
+            }
+        }
+        if (rotate(im, degrees, canvas, sampling) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
     }
     // Swirl
-    else if (strcmp(argv[3], "swirl") == 0) {
+    else if (strcmp(op, "swirl") == 0) {
         // Check if the number of arguments is correct
-        if (argc != 7) {
-            fprintf(stderr, "Error: Incorrect number of arguments for swirl operation (must be 6)\n");
+        if (nargs != 3) {
+            fprintf(stderr, "Error: Incorrect number of arguments for swirl operation (must be 3)\n");
             return RC_INVALID_OP_ARGS;
         }
         // Check if arguments are valid
@@ -122,71 +1300,630 @@ int main(int argc, char* argv[]) {
         
 
         // the minimum value allowed for the coordinates should be -1
-        if (atoi(argv[4]) < -1 || atoi(argv[5]) < -1) {
+        if (atoi(args[0]) < -1 || atoi(args[1]) < -1) {
             fprintf(stderr, "Error: Invalid arguments for swirl operation (must be >= -1)\n");
             return RC_OP_ARGS_RANGE_ERR;
         }
 
         //check if atoi returns a valid value
-        if(atoi(argv[4]) == 0 /* returns 0 upon invalid read*/ && (strcmp(argv[4],"0") != 0)){
+        if(atoi(args[0]) == 0 /* returns 0 upon invalid read*/ && (strcmp(args[0],"0") != 0)){
             return RC_OP_ARGS_RANGE_ERR;
         }
-        if(atoi(argv[5]) == 0 /* returns 0 upon invalid read*/ && (strcmp(argv[5],"0") != 0)){
+        if(atoi(args[1]) == 0 /* returns 0 upon invalid read*/ && (strcmp(args[1],"0") != 0)){
             return RC_OP_ARGS_RANGE_ERR;
         }
-        if(atoi(argv[6]) == 0 /* returns 0 upon invalid read*/ && (strcmp(argv[6],"0") != 0)){
+        if(atoi(args[2]) == 0 /* returns 0 upon invalid read*/ && (strcmp(args[2],"0") != 0)){
             return RC_OP_ARGS_RANGE_ERR;
         }
 
         // Get cx, cy, s from command line argument
-        double cx = atoi(argv[4]);
-        double cy = atoi(argv[5]);
-        double s = atoi(argv[6]);
+        double cx = atoi(args[0]);
+        double cy = atoi(args[1]);
+        double s = atoi(args[2]);
 
         // Implement swirl function
-        swirl(input, cx, cy, s);
+        swirl(im, cx, cy, s);
     }
     // Edge-detection
-    else if (strcmp(argv[3], "edge-detection") == 0) {
+    else if (strcmp(op, "edge-detection") == 0) {
         // Check if number of arguments is correct
-        if (argc != 5) {
-            fprintf(stderr, "Error: Incorrect number of arguments for edge-detection operation (must be 5)\n");
+        if (nargs != 1) {
+            fprintf(stderr, "Error: Incorrect number of arguments for edge-detection operation (must be 1)\n");
             return RC_INVALID_OP_ARGS;
         }
 
-        //check if atoi returns a valid value
-        if(atoi(argv[4]) == 0 /* returns 0 upon invalid read*/ && (strcmp(argv[4],"0") != 0)){
-            return RC_OP_ARGS_RANGE_ERR;
+        double threshold;
+        int rc = edge_threshold(im, args[0], &threshold);
+        if (rc != RC_SUCCESS) {
+            return rc;
         }
-        //Get the threshold number from command line
-        double threshold = atoi(argv[4]);
         // Implement edge-detection function, ignore error
-        edges(input, threshold);
+        edges(im, threshold);
 
     }
+    // Grayscale
+    else if (strcmp(op, "grayscale") == 0) {
+        if (nargs != 0) {
+            fprintf(stderr, "Error: Incorrect number of arguments for grayscale operation (must be 0)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        grayscale(im);
+    }
+    // Canny edge detection
+    else if (strcmp(op, "canny") == 0) {
+        // Check if number of arguments is correct
+        if (nargs != 2) {
+            fprintf(stderr, "Error: Incorrect number of arguments for canny operation (must be 2)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        double low, high;
+        if (!parse_double(args[0], &low) || !parse_double(args[1], &high) || low < 0 || high < low) {
+            fprintf(stderr, "Error: Invalid arguments for canny operation (must be 0 <= low <= high)\n");
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        if (canny(im, low, high) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+    }
+    // Crop
+    else if (strcmp(op, "crop") == 0) {
+        // Check if number of arguments is correct
+        if (nargs != 4) {
+            fprintf(stderr, "Error: Incorrect number of arguments for crop operation (must be 4)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        int x, y, w, h;
+        if (!parse_int(args[0], &x) || !parse_int(args[1], &y) || !parse_int(args[2], &w) || !parse_int(args[3], &h) ||
+            w <= 0 || h <= 0 || x < 0 || y < 0 || x > im->cols - w || y > im->rows - h) {
+            fprintf(stderr, "Error: Invalid arguments for crop operation (rectangle must lie inside the image)\n");
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        crop(im, x, y, w, h);
+    }
+    // Resize
+    else if (strcmp(op, "resize") == 0) {
+        // Check if number of arguments is correct
+        if (nargs != 2 && nargs != 3) {
+            fprintf(stderr, "Error: Incorrect number of arguments for resize operation (must be 2 or 3)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        int w, h;
+        if (!parse_int(args[0], &w) || !parse_int(args[1], &h) || w <= 0 || h <= 0) {
+            fprintf(stderr, "Error: Invalid arguments for resize operation (width and height must be > 0)\n");
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        ResizeFilter filter = RESIZE_LANCZOS;
+        if (nargs == 3) {
+            if (strcmp(args[2], "nearest") == 0) {
+                filter = RESIZE_NEAREST;
+            } else if (strcmp(args[2], "bilinear") == 0) {
+                filter = RESIZE_BILINEAR;
+            } else if (strcmp(args[2], "box") == 0) {
+                filter = RESIZE_BOX;
+            } else if (strcmp(args[2], "lanczos") != 0) {
+                fprintf(stderr, "Error: Invalid arguments for resize operation (filter must be nearest, bilinear, lanczos or box)\n");
+                return RC_OP_ARGS_RANGE_ERR;
+            }
+        }
+        if (resize(im, w, h, filter) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+    }
+    // Gaussian blur
+    else if (strcmp(op, "blur") == 0) {
+        // Check if number of arguments is correct
+        if (nargs != 1) {
+            fprintf(stderr, "Error: Incorrect number of arguments for blur operation (must be 1)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        double sigma;
+        if (!parse_double(args[0], &sigma) || sigma <= 0 || sigma > 100) {
+            fprintf(stderr, "Error: Invalid arguments for blur operation (sigma must be in (0, 100])\n");
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        if (gaussian_blur(im, sigma) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+    }
+    // Box blur
+    else if (strcmp(op, "box-blur") == 0) {
+        // Check if number of arguments is correct
+        if (nargs != 1) {
+            fprintf(stderr, "Error: Incorrect number of arguments for box-blur operation (must be 1)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        int radius;
+        if (!parse_int(args[0], &radius) || radius < 0 || radius > BOX_MAX_RADIUS) {
+            fprintf(stderr, "Error: Invalid arguments for box-blur operation (radius must be in [0, %d])\n", BOX_MAX_RADIUS);
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        if (box_blur(im, radius) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+    }
+    // Sharpen
+    else if (strcmp(op, "sharpen") == 0) {
+        // Check if number of arguments is correct
+        if (nargs != 1) {
+            fprintf(stderr, "Error: Incorrect number of arguments for sharpen operation (must be 1)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        double amount;
+        if (!parse_double(args[0], &amount) || amount < 0) {
+            fprintf(stderr, "Error: Invalid arguments for sharpen operation (amount must be >= 0)\n");
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        if (sharpen(im, amount) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+    }
+    // Median filter
+    else if (strcmp(op, "median") == 0) {
+        // Check if number of arguments is correct
+        if (nargs != 1) {
+            fprintf(stderr, "Error: Incorrect number of arguments for median operation (must be 1)\n");
+            return RC_INVALID_OP_ARGS;
+        }
+        int radius;
+        if (!parse_int(args[0], &radius) || radius < 0 || radius > MEDIAN_MAX_RADIUS) {
+            fprintf(stderr, "Error: Invalid arguments for median operation (radius must be in [0, %d])\n", MEDIAN_MAX_RADIUS);
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        if (median_filter(im, radius) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+    }
+    // Erode, dilate, open and close
+    else if (morph_operation(op, &morphOp)) {
+        int rx, ry;
+        int rc = morph_radii(op, nargs, args, &rx, &ry);
+        if (rc != RC_SUCCESS) {
+            return rc;
+        }
+        if (morph(im, morphOp, rx, ry) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+    }
     else  {
         // Error checking
-        fprintf(stderr, "Error: Unsupported image processing operation %s specified\n", argv[3]);
+        fprintf(stderr, "Error: Unsupported image processing operation %s specified\n", op);
         return RC_INVALID_OPERATION;
     }
-    
 
-    // Close the input and output files
-    fclose(output);
-    fclose(inputF);
-    free_image(&input);
+    return RC_SUCCESS;
+}
 
-    // Return success
+/**
+ * Function: report_components
+ * ---------------------------
+ * Label the 8-connected components of the black pixels (darker than half of maxval,
+ * as edge-detection leaves edge points) of the result, and write their measurements
+ * and label image to the files of --components and --labels
+ * 
+ * Parameters:
+ *  const Job *job: the parsed command line
+ *  const BinaryImage *bits: the binary result, NULL to threshold im instead
+ *  const Image *im: the result
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int report_components(const Job *job, const BinaryImage *bits, const Image *im) {
+    BinaryImage *own = NULL;
+    if (!bits && !(bits = own = to_binary(im))) {
+        return RC_UNSPECIFIED_ERR;
+    }
+    Components *comps = label_components(bits, 8, job->labels != NULL);
+    if (own) {
+        free_binary_image(&own);
+    }
+    if (!comps) {
+        return RC_UNSPECIFIED_ERR;
+    }
+
+    int rc = RC_SUCCESS;
+    if (job->components) {
+        // The file is closed whether or not writing it worked
+        FILE *fp = fopen(job->components, "w");
+        int failed = !fp || write_components(fp, comps) != 0;
+        if ((fp && fclose(fp) != 0) || failed) {
+            fprintf(stderr, "Error: Failed to write components file %s\n", job->components);
+            rc = RC_WRITE_FAILED;
+        }
+    }
+    if (rc == RC_SUCCESS && job->labels) {
+        GrayImage *labels = label_image(comps);
+        FILE *fp = labels ? fopen(job->labels, "w") : NULL;
+        if (!labels) {
+            rc = RC_UNSPECIFIED_ERR;
+        } else {
+            int failed = !fp || write_pgm(fp, labels) != 0;
+            if ((fp && fclose(fp) != 0) || failed) {
+                fprintf(stderr, "Error: Failed to write label image %s\n", job->labels);
+                rc = RC_WRITE_FAILED;
+            }
+        }
+        if (labels) {
+            free_gray_image(&labels);
+        }
+    }
+    free_components(&comps);
+    return rc;
+}
+
+/**
+ * Function: run_dedup
+ * -------------------
+ * ./project --dedup <index> [--distance <d>] <image> [...]: add the perceptual hash of
+ * each image to the index file (created if missing), and print "<image> <earlier image>
+ * <distance>" for every image of the index, or earlier on the command line, within the
+ * distance of it. Only these candidate pairs need a full comparison with img_cmp.
+ * 
+ * Parameters:
+ *  int argc: number of command line arguments
+ *  char *argv[]: the command line arguments
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_dedup(int argc, char *argv[]) {
+    int distance = PHASH_DEFAULT_DISTANCE;
+    int argi = 3;
+    if (argc > argi && strcmp(argv[argi], "--distance") == 0) {
+        if (argc < argi + 2 || !parse_int(argv[argi+1], &distance) || distance < 0 || distance > PHASH_MAX_DISTANCE) {
+            fprintf(stderr, "Error: --distance must be followed by a distance from 0 to %d\n", PHASH_MAX_DISTANCE);
+            return RC_INVALID_OP_ARGS;
+        }
+        argi += 2;
+    }
+    if (argc <= argi) {
+        fprintf(stderr, "Error: --dedup must be followed by <index> and the images to add to it\n");
+        print_usage();
+        return RC_MISSING_FILENAME;
+    }
+    PhashIndex *index = phash_index_load(argv[2]);
+    if (!index) {
+        return RC_OPEN_FAILED;
+    }
+
+    // Hash a batch of images on several threads, then look them up and add them in order
+    unsigned long long hashes[DEDUP_BATCH];
+    int ok[DEDUP_BATCH];
+    int rc = RC_SUCCESS;
+    for (; argi < argc && rc != RC_UNSPECIFIED_ERR; argi += DEDUP_BATCH) {
+        int n = argc - argi < DEDUP_BATCH ? argc - argi : DEDUP_BATCH;
+        phash_files(argv + argi, n, hashes, ok);
+        for (int i = 0; i < n && rc != RC_UNSPECIFIED_ERR; i++) {
+            if (!ok[i]) {
+                fprintf(stderr, "Error: Failed to read input file %s as a PPM image file\n", argv[argi+i]);
+                rc = RC_INVALID_PPM;
+                continue;
+            }
+            DedupMatch match = { index, argv[argi+i] };
+            phash_index_query(index, hashes[i], distance, print_duplicate, &match);
+            if (phash_index_add(index, hashes[i], argv[argi+i]) != 0) {
+                rc = RC_UNSPECIFIED_ERR;
+            }
+        }
+    }
+
+    // Keep what was added even if some images were not
+    if (phash_index_save(index, argv[2]) != 0) {
+        rc = RC_WRITE_FAILED;
+    }
+    free_phash_index(&index);
+    return rc;
+}
+
+/**
+ * Function: print_duplicate
+ * -------------------------
+ * Print an image and an entry of the index found near it
+ * 
+ * Parameters:
+ *  void *ctx: the DedupMatch of the image
+ *  int entry: the entry of the index
+ *  int distance: the Hamming distance of their hashes
+ * Returns:
+ *  void
+ */
+void print_duplicate(void *ctx, int entry, int distance) {
+    DedupMatch *match = ctx;
+    printf("%s %s %d\n", match->name, match->index->names[entry], distance);
+}
+
+/**
+ * Function: morph_operation
+ * -------------------------
+ * Look up a morphology operation by its command name
+ * 
+ * Parameters:
+ *  const char *op: the command name
+ *  MorphOp *morphOp: receives the operation
+ * Returns:
+ *  1 if op is erode, dilate, open or close, 0 otherwise
+ */
+int morph_operation(const char *op, MorphOp *morphOp) {
+    static const char *names[] = { "erode", "dilate", "open", "close" };
+    static const MorphOp ops[] = { MORPH_ERODE, MORPH_DILATE, MORPH_OPEN, MORPH_CLOSE };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(op, names[i]) == 0) {
+            *morphOp = ops[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Function: morph_radii
+ * ---------------------
+ * Parse the arguments of a morphology operation: the horizontal radius of the
+ * rectangle and optionally its vertical radius (the same by default)
+ * 
+ * Parameters:
+ *  const char *op: the command name, for the error messages
+ *  int nargs: number of arguments
+ *  char *args[]: the arguments
+ *  int *rx: receives the horizontal radius
+ *  int *ry: receives the vertical radius
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int morph_radii(const char *op, int nargs, char *args[], int *rx, int *ry) {
+    // Check if number of arguments is correct
+    if (nargs != 1 && nargs != 2) {
+        fprintf(stderr, "Error: Incorrect number of arguments for %s operation (must be 1 or 2)\n", op);
+        return RC_INVALID_OP_ARGS;
+    }
+    if (!parse_int(args[0], rx) || *rx < 0 || (nargs == 2 && (!parse_int(args[1], ry) || *ry < 0))) {
+        fprintf(stderr, "Error: Invalid arguments for %s operation (radii must be >= 0)\n", op);
+        return RC_OP_ARGS_RANGE_ERR;
+    }
+    if (nargs == 1) {
+        *ry = *rx;
+    }
     return RC_SUCCESS;
 }
 
+/**
+ * Function: edge_threshold
+ * ------------------------
+ * Turn the argument of edge-detection into a threshold: a number, "auto" (Otsu's
+ * method on the gradient histogram) or "p<percentile>" of the gradient magnitudes
+ * 
+ * Parameters:
+ *  const Image *im: the image the edges will be detected in
+ *  const char *arg: the argument
+ *  double *threshold: receives the threshold
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int edge_threshold(const Image *im, const char *arg, double *threshold) {
+    int percent = 0;
+    if (strcmp(arg, "auto") == 0 || (arg[0] == 'p' && parse_int(arg + 1, &percent))) {
+        // Pick the threshold from the gradient histogram: Otsu's method for "auto",
+        // otherwise the given percentile of gradient magnitudes ("p90")
+        ImageStats stats;
+        if (arg[0] == 'p' && (percent < 0 || percent > 100)) {
+            fprintf(stderr, "Error: Invalid arguments for edge-detection operation (percentile must be 0 to 100)\n");
+            return RC_OP_ARGS_RANGE_ERR;
+        }
+        if (image_stats(im, &stats) != 0) {
+            return RC_UNSPECIFIED_ERR;
+        }
+        *threshold = arg[0] == 'p' ? percentile_threshold(stats.gradient, percent) : otsu_threshold(stats.gradient);
+        return RC_SUCCESS;
+    }
+    //check if atoi returns a valid value
+    if(atoi(arg) == 0 /* returns 0 upon invalid read*/ && (strcmp(arg,"0") != 0)){
+        return RC_OP_ARGS_RANGE_ERR;
+    }
+    //Get the threshold number from command line
+    *threshold = atoi(arg);
+    return RC_SUCCESS;
+}
+
+/**
+ * Function: run_point_ops
+ * -----------------------
+ * Check the arguments of a run of point operations, compose them into lookup tables
+ * and apply them all in a single pass over the image
+ * 
+ * Parameters:
+ *  Image *im: the image to be processed
+ *  const OpCall *calls: the point operations
+ *  int n: the number of operations
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_point_ops(Image *im, const OpCall *calls, int n) {
+    PointOp po;
+    int rc = build_point_ops(&po, im->maxval, calls, n);
+    if (rc != RC_SUCCESS) {
+        return rc;
+    }
+    if (point_op_apply(im, &po) != 0) {
+        rc = RC_UNSPECIFIED_ERR;
+    }
+    point_op_free(&po);
+    return rc;
+}
+
+/**
+ * Function: run_tiled_job
+ * -----------------------
+ * Run a chain made of one run of point operations on a tiled 8 bit image
+ * 
+ * Parameters:
+ *  TiledImage *im: the image to be processed
+ *  const Job *job: the parsed command line
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int run_tiled_job(TiledImage *im, const Job *job) {
+    PointOp po;
+    int rc = build_point_ops(&po, im->maxval, job->ops, job->nops);
+    if (rc != RC_SUCCESS) {
+        return rc;
+    }
+    if (tiled_point_op(im, &po) != 0) {
+        rc = RC_UNSPECIFIED_ERR;
+    }
+    point_op_free(&po);
+    return rc;
+}
+
+/**
+ * Function: build_point_ops
+ * -------------------------
+ * Check the arguments of a run of point operations and compose them into lookup tables
+ * 
+ * Parameters:
+ *  PointOp *po: set to the composed chain, to be freed with point_op_free after
+ *               success
+ *  int maxval: maxval of the images the chain is for
+ *  const OpCall *calls: the point operations
+ *  int n: the number of operations
+ * Returns:
+ *  RC_SUCCESS or the return code describing the error
+ */
+int build_point_ops(PointOp *po, int maxval, const OpCall *calls, int n) {
+    if (point_op_init(po, maxval) != 0) {
+        return RC_UNSPECIFIED_ERR;
+    }
+    int rc = RC_SUCCESS;
+    for (int i = 0; i < n && rc == RC_SUCCESS; i++) {
+        const char *op = calls[i].name;
+        char **args = calls[i].args;
+        int nargs = calls[i].nargs;
+        int amount, black, white;
+        double value, gamma = 1;
+        if (strcmp(op, "swap") == 0 && nargs == 0) {
+            point_op_swap(po);
+        } else if (strcmp(op, "invert") == 0 && nargs == 0) {
+            point_op_invert(po);
+        } else if (strcmp(op, "brightness") == 0 && nargs == 1) {
+            if (!parse_int(args[0], &amount) || amount < -255 || amount > 255) {
+                fprintf(stderr, "Error: Invalid arguments for brightness operation (must be -255 to 255)\n");
+                rc = RC_OP_ARGS_RANGE_ERR;
+            } else {
+                point_op_brightness(po, amount);
+            }
+        } else if (strcmp(op, "contrast") == 0 && nargs == 1) {
+            if (!parse_double(args[0], &value) || value < 0) {
+                fprintf(stderr, "Error: Invalid arguments for contrast operation (factor must be >= 0)\n");
+                rc = RC_OP_ARGS_RANGE_ERR;
+            } else {
+                point_op_contrast(po, value);
+            }
+        } else if (strcmp(op, "gamma") == 0 && nargs == 1) {
+            if (!parse_double(args[0], &value) || value <= 0) {
+                fprintf(stderr, "Error: Invalid arguments for gamma operation (must be > 0)\n");
+                rc = RC_OP_ARGS_RANGE_ERR;
+            } else {
+                point_op_gamma(po, value);
+            }
+        } else if (strcmp(op, "levels") == 0 && (nargs == 2 || nargs == 3)) {
+            if (!parse_int(args[0], &black) || !parse_int(args[1], &white) || black < 0 || white > 255 ||
+                black >= white || (nargs == 3 && (!parse_double(args[2], &gamma) || gamma <= 0))) {
+                fprintf(stderr, "Error: Invalid arguments for levels operation (must be 0 <= black < white <= 255, gamma > 0)\n");
+                rc = RC_OP_ARGS_RANGE_ERR;
+            } else {
+                point_op_levels(po, black, white, gamma);
+            }
+        } else {
+            fprintf(stderr, "Error: Incorrect number of arguments for %s operation\n", op);
+            rc = RC_INVALID_OP_ARGS;
+        }
+    }
+    if (rc != RC_SUCCESS) {
+        point_op_free(po);
+    }
+    return rc;
+}
+
+/**
+ * Function: parse_int
+ * -------------------
+ * Parse a whole command line argument as a base 10 integer
+ * 
+ * Parameters:
+ *  const char *str: the argument
+ *  int *val: set to the parsed value
+ * Returns:
+ *  1: success
+ *  0: the argument is not an integer
+ */
+int parse_int(const char *str, int *val) {
+    char *end;
+    long parsed = strtol(str, &end, 10);
+    if (end == str || *end != '\0' || parsed < -2147483647L || parsed > 2147483647L) {
+        return 0;
+    }
+    *val = (int)parsed;
+    return 1;
+}
+
+/**
+ * Function: parse_double
+ * ----------------------
+ * Parse a whole command line argument as a finite floating point number
+ * 
+ * Parameters:
+ *  const char *str: the argument
+ *  double *val: set to the parsed value
+ * Returns:
+ *  1: success
+ *  0: the argument is not a number
+ */
+int parse_double(const char *str, double *val) {
+    char *end;
+    double parsed = strtod(str, &end);
+    if (end == str || *end != '\0' || parsed != parsed || parsed > 1e300 || parsed < -1e300) {
+        return 0;
+    }
+    *val = parsed;
+    return 1;
+}
+
 void print_usage() {
-    printf("USAGE: ./project <input-image> <output-image> <command-name> <command-args>\n");
+    printf("USAGE: ./project <input-image> <output-image> [options] <command-name> <command-args> [<command-name> <command-args> ...]\n");
+    printf("       ./project --stream [options] <command-name> <command-args> [...]   (PPM frames from stdin to stdout)\n");
+    printf("       ./project --dedup <index> [--distance <d>] <image> [...]   (add images to a perceptual hash index and print\n");
+    printf("                 each near-duplicate pair, within d bits (0 to %d, default %d), for a full check with img_cmp)\n",
+           PHASH_MAX_DISTANCE, PHASH_DEFAULT_DISTANCE);
+    printf("Input files may be PPM or PPZ (compressed); output file names ending in .ppz are written compressed,\n");
+    printf("ending in .pgm as a single gray channel, ending in .pbm as black and white at one bit per pixel\n");
     printf("SUPPORTED COMMANDS:\n");
     printf("   swap\n");
     printf("   invert\n");
+    printf("   brightness <amount>   (-255 to 255)\n");
+    printf("   contrast <factor>\n");
+    printf("   gamma <gamma>\n");
+    printf("   levels <black> <white> [gamma]\n");
     printf("   zoom-out\n");
     printf("   rotate-right\n");
+    printf("   rotate <degrees> [expand | cropped] [nearest | bilinear]   (clockwise, default expand bilinear)\n");
     printf("   swirl <cx> <cy> <strength>\n");
-    printf("   edge-detection <threshold>\n");
+    printf("   grayscale\n");
+    printf("   edge-detection <threshold | auto | p<percentile>>\n");
+    printf("   canny <low> <high>\n");
+    printf("   crop <x> <y> <w> <h>\n");
+    printf("   resize <w> <h> [nearest | bilinear | lanczos | box]   (default lanczos)\n");
+    printf("   blur <sigma>\n");
+    printf("   box-blur <radius>   (0 to %d)\n", BOX_MAX_RADIUS);
+    printf("   sharpen <amount>\n");
+    printf("   median <radius>   (0 to %d)\n", MEDIAN_MAX_RADIUS);
+    printf("   erode | dilate | open | close <rx> [ry]   (rectangle of 2rx+1 by 2ry+1, erode thickens dark edges)\n");
+    printf("OPTIONS (before <command-name>):\n");
+    printf("   --roi <x> <y> <w> <h>   limit the commands to a rectangle\n");
+    printf("   --profile               report time and hardware counters of each command on stderr\n");
+    printf("   --tiled                 keep constant %dx%d tiles as one color while running point commands (swap, invert,\n", TILE_SIZE, TILE_SIZE);
+    printf("                           brightness, contrast, gamma, levels) on an 8 bit PPM; saves memory and time on sparse images\n");
+    printf("   --incremental [delta]   with --stream, run each frame only on the %dx%d tiles that changed by more than delta\n", INCREMENTAL_TILE, INCREMENTAL_TILE);
+    printf("                           (default 0) since the previous one, plus the pixels they reach, as far as the\n");
+    printf("                           chain allows (point commands, grayscale, edge-detection <threshold>, swirl, blur, box-blur,\n");
+    printf("                           sharpen, median, erode, dilate, open, close); keep the previous result everywhere else\n");
+    printf("   --cache <directory>     reuse the output of identical earlier runs (size bound IMGPROC_CACHE_MB, default %d)\n", RESULT_CACHE_DEFAULT_MB);
+    printf("   --components <file>     write area, bounding box and centroid of each connected group of black pixels of the result\n");
+    printf("   --labels <file>         write the component number of each pixel of the result as a PGM image\n");
 }
@@ -0,0 +1,441 @@
+/**
+ * @file resize.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Resizing images to arbitrary sizes
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "resize.h"
+#include "convolve.h"
+#include "integral.h"
+#include "parallel.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// Fixed point weights of one axis: output i reads taps consecutive input pixels
+// starting at start[i], weighted by weights[i * taps .. i * taps + taps - 1]
+typedef struct _resize_axis {
+  int taps;
+  int *start;
+  short *weights;
+} ResizeAxis;
+
+// Shared state of one resampling pass
+typedef struct _resize_job {
+  const Image *src;
+  Image *dst;
+  const ResizeAxis *axis;
+  int failed;
+} ResizeJob;
+
+// Shared state of one box resize
+typedef struct _box_job {
+  const IntegralImage *table;
+  Image *dst;
+} BoxJob;
+
+/**
+ * Function: box_span
+ * ------------------
+ * The input pixels covered by an output pixel along one axis: from in * i / out up to
+ * in * (i + 1) / out, but at least one pixel when enlarging
+ *
+ * Parameters:
+ *  int i: index of the output pixel
+ *  int in: input size
+ *  int out: output size
+ *  int *len: receives the number of input pixels
+ * Return:
+ *  the first input pixel
+ */
+static int box_span(int i, int in, int out, int *len) {
+  int first = (int)((long long)in * i / out);
+  int last = (int)((long long)in * (i + 1) / out);
+  *len = last > first ? last - first : 1;
+  return first;
+}
+
+/**
+ * Function: box_band
+ * ------------------
+ * Box resize of a band of output rows: every output pixel is the rounded mean of its
+ * block of input pixels
+ *
+ * Parameters:
+ *  void *ctx: the BoxJob
+ *  int band: index of the band (unused)
+ *  int r0: first output row of the band
+ *  int r1: one past the last output row of the band
+ * Return:
+ *  void
+ */
+static void box_band(void *ctx, int band, int r0, int r1) {
+  BoxJob *job = ctx;
+  Image *dst = job->dst;
+  (void)band;
+
+  for (int r = r0; r < r1; r++) {
+    int h, y = box_span(r, job->table->rows, dst->rows, &h);
+    for (int c = 0; c < dst->cols; c++) {
+      int w, x = box_span(c, job->table->cols, dst->cols, &w);
+      unsigned long long sum[3], area = (unsigned long long)w * h;
+      integral_sum(job->table, x, y, w, h, sum);
+      for (int i = 0; i < 3; i++) {
+        sum[i] = (sum[i] + area / 2) / area;
+      }
+      if (IS_16BIT(dst)) {
+        Pixel16 *p = &dst->data16[(size_t)r * dst->cols + c];
+        p->r = (unsigned short)sum[0];
+        p->g = (unsigned short)sum[1];
+        p->b = (unsigned short)sum[2];
+      } else {
+        Pixel *p = &dst->data[(size_t)r * dst->cols + c];
+        p->r = (unsigned char)sum[0];
+        p->g = (unsigned char)sum[1];
+        p->b = (unsigned char)sum[2];
+      }
+    }
+  }
+}
+
+/**
+ * Function: box_resize
+ * --------------------
+ * Resize with the box filter through the summed-area table of the image
+ *
+ * Parameters:
+ *  Image *im: the image to be resized (8 or 16 bit)
+ *  int cols: the new width
+ *  int rows: the new height
+ * Return:
+ *  -1: allocation failure
+ *  0: success
+ */
+static int box_resize(Image *im, int cols, int rows) {
+  IntegralImage *table = make_integral_image(im, 0);
+  Image *result = table ? make_image_maxval(rows, cols, im->maxval) : NULL;
+  if (!result) {
+    fprintf(stderr, "Error:resize - resize failed to allocate memory\n");
+    free_integral_image(&table);
+    return -1;
+  }
+  BoxJob job = { table, result };
+  parallel_for_bands(rows, box_band, &job);
+  free_integral_image(&table);
+
+  // Free the old image and set the pointer to the new image
+  replace_image(im, &result);
+  return 0;
+}
+
+/**
+ * Function: filter_weight
+ * -----------------------
+ * Value of a resampling filter at distance x from its center
+ *
+ * Parameters:
+ *  ResizeFilter filter: the filter (bilinear or Lanczos-3)
+ *  double x: the distance in input pixels (already divided by the widening factor)
+ * Return:
+ *  the unnormalized weight
+ */
+static double filter_weight(ResizeFilter filter, double x) {
+  x = fabs(x);
+  if (filter == RESIZE_BILINEAR) {
+    return x < 1 ? 1 - x : 0;
+  }
+  if (x < 1e-9) {
+    return 1;
+  }
+  if (x >= 3) {
+    return 0;
+  }
+  // sinc(x) * sinc(x / 3)
+  const double pi = 3.14159265358979323846;
+  return 3 * sin(pi * x) * sin(pi * x / 3) / (pi * pi * x * x);
+}
+
+/**
+ * Function: free_axis
+ * -------------------
+ * Free the tables of an axis
+ *
+ * Parameters:
+ *  ResizeAxis *axis: the axis
+ * Return:
+ *  void
+ */
+static void free_axis(ResizeAxis *axis) {
+  free(axis->start);
+  free(axis->weights);
+  axis->start = NULL;
+  axis->weights = NULL;
+}
+
+/**
+ * Function: build_axis
+ * --------------------
+ * Compute the weight table mapping in input pixels onto out output pixels. Taps that
+ * fall outside the input are folded onto the border pixel (replicated border), and
+ * every window is shifted to lie inside the input so all outputs share one tap count.
+ *
+ * Parameters:
+ *  ResizeAxis *axis: receives the tables
+ *  int in: number of input pixels
+ *  int out: number of output pixels
+ *  ResizeFilter filter: the filter
+ * Return:
+ *  0 on success, -1 if memory runs out
+ */
+static int build_axis(ResizeAxis *axis, int in, int out, ResizeFilter filter) {
+  double scale = (double)in / out;
+  double widen = scale > 1 ? scale : 1;
+  double radius = (filter == RESIZE_LANCZOS ? 3 : 1) * widen;
+  int taps = filter == RESIZE_NEAREST ? 1 : (int)ceil(2 * radius) + 2;
+  if (taps > in) {
+    taps = in;
+  }
+
+  axis->taps = taps;
+  axis->start = malloc(sizeof(int) * out);
+  axis->weights = malloc(sizeof(short) * out * taps);
+  double *window = malloc(sizeof(double) * taps);
+  if (!axis->start || !axis->weights || !window) {
+    free_axis(axis);
+    free(window);
+    return -1;
+  }
+
+  for (int i = 0; i < out; i++) {
+    double center = (i + 0.5) * scale;
+    short *w = &axis->weights[i * taps];
+    if (filter == RESIZE_NEAREST) {
+      int j = (int)center;
+      axis->start[i] = j < in ? j : in - 1;
+      w[0] = 1 << CONV_SHIFT;
+      continue;
+    }
+
+    int lo = (int)floor(center - radius), hi = (int)ceil(center + radius);
+    int first = lo < 0 ? 0 : (lo >= in ? in - 1 : lo);
+    int start = first < in - taps ? first : in - taps;
+    axis->start[i] = start;
+    memset(window, 0, sizeof(double) * taps);
+    double total = 0;
+    for (int j = lo; j <= hi; j++) {
+      double v = filter_weight(filter, (j + 0.5 - center) / widen);
+      int k = (j < 0 ? 0 : (j >= in ? in - 1 : j)) - start;
+      window[k] += v;
+      total += v;
+    }
+
+    // Normalize to fixed point; the rounding error goes to the largest tap so the
+    // weights sum to exactly 1 << CONV_SHIFT and flat areas stay unchanged
+    int sum = 0, largest = 0;
+    for (int k = 0; k < taps; k++) {
+      w[k] = (short)lround(window[k] / total * (1 << CONV_SHIFT));
+      sum += w[k];
+      if (abs(w[k]) > abs(w[largest])) {
+        largest = k;
+      }
+    }
+    w[largest] = (short)(w[largest] + (1 << CONV_SHIFT) - sum);
+  }
+  free(window);
+  return 0;
+}
+
+/**
+ * Function: horizontal_band
+ * -------------------------
+ * Horizontal pass over one band of rows: every output pixel is a weighted sum of taps
+ * consecutive input pixels of the same row
+ *
+ * Parameters:
+ *  void *ctx: the ResizeJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void horizontal_band(void *ctx, int band, int r0, int r1) {
+  ResizeJob *job = ctx;
+  const ResizeAxis *axis = job->axis;
+  int taps = axis->taps, inCols = job->src->cols, outCols = job->dst->cols;
+  (void)band;
+
+  for (int r = r0; r < r1; r++) {
+    const Pixel *in = &job->src->data[r * inCols];
+    Pixel *out = &job->dst->data[r * outCols];
+    for (int c = 0; c < outCols; c++) {
+      const Pixel *px = &in[axis->start[c]];
+      const short *w = &axis->weights[c * taps];
+#ifdef __SSE2__
+      // One pixel per 16 bit lane group (r, g, b, 0); taps are consumed in pairs so a
+      // single _mm_madd_epi16 applies two weights to all three channels
+      const __m128i zero = _mm_setzero_si128();
+      __m128i acc = _mm_set1_epi32(1 << (CONV_SHIFT - 1));
+      for (int k = 0; k < taps; k += 2) {
+        int k1 = k + 1 < taps ? k + 1 : k;
+        short w1 = k + 1 < taps ? w[k + 1] : 0;
+        __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(px[k].r | px[k].g << 8 | px[k].b << 16), zero);
+        __m128i b = _mm_unpacklo_epi8(_mm_cvtsi32_si128(px[k1].r | px[k1].g << 8 | px[k1].b << 16), zero);
+        __m128i pair = _mm_set1_epi32((int)(((unsigned)(unsigned short)w1 << 16) | (unsigned short)w[k]));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pair));
+      }
+      acc = _mm_srai_epi32(acc, CONV_SHIFT);
+      int packed = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(acc, zero), zero));
+      out[c].r = (unsigned char)packed;
+      out[c].g = (unsigned char)(packed >> 8);
+      out[c].b = (unsigned char)(packed >> 16);
+#else
+      int accR = 1 << (CONV_SHIFT - 1), accG = accR, accB = accR;
+      for (int k = 0; k < taps; k++) {
+        accR += w[k] * px[k].r;
+        accG += w[k] * px[k].g;
+        accB += w[k] * px[k].b;
+      }
+      accR >>= CONV_SHIFT;
+      accG >>= CONV_SHIFT;
+      accB >>= CONV_SHIFT;
+      out[c].r = (unsigned char)(accR < 0 ? 0 : (accR > 255 ? 255 : accR));
+      out[c].g = (unsigned char)(accG < 0 ? 0 : (accG > 255 ? 255 : accG));
+      out[c].b = (unsigned char)(accB < 0 ? 0 : (accB > 255 ? 255 : accB));
+#endif
+    }
+  }
+}
+
+/**
+ * Function: vertical_band
+ * -----------------------
+ * Vertical pass over one band of output rows: every output row is a weighted sum of
+ * taps consecutive input rows, which is exactly what conv_accumulate computes
+ *
+ * Parameters:
+ *  void *ctx: the ResizeJob
+ *  int band: index of the band (unused)
+ *  int r0: first row of the band
+ *  int r1: one past the last row of the band
+ * Return:
+ *  void
+ */
+static void vertical_band(void *ctx, int band, int r0, int r1) {
+  ResizeJob *job = ctx;
+  const ResizeAxis *axis = job->axis;
+  int taps = axis->taps, cols = job->src->cols;
+  (void)band;
+
+  const unsigned char **srcs = malloc(sizeof(*srcs) * taps);
+  if (!srcs) {
+    job->failed = 1;
+    return;
+  }
+  for (int r = r0; r < r1; r++) {
+    for (int k = 0; k < taps; k++) {
+      srcs[k] = (const unsigned char *)&job->src->data[(axis->start[r] + k) * cols];
+    }
+    conv_accumulate((unsigned char *)&job->dst->data[r * cols], srcs, &axis->weights[r * taps], taps, cols * 3);
+  }
+  free((void *)srcs);
+}
+
+/**
+ * Function: resample_pass
+ * -----------------------
+ * Run one pass of the resize into a new image
+ *
+ * Parameters:
+ *  const Image *src: the input of the pass
+ *  int rows: rows of the output
+ *  int cols: columns of the output
+ *  int horizontal: 1 for the horizontal pass, 0 for the vertical pass
+ *  ResizeFilter filter: the filter
+ * Return:
+ *  the output of the pass, NULL if memory runs out
+ */
+static Image *resample_pass(const Image *src, int rows, int cols, int horizontal, ResizeFilter filter) {
+  ResizeAxis axis;
+  if (build_axis(&axis, horizontal ? src->cols : src->rows, horizontal ? cols : rows, filter) != 0) {
+    return NULL;
+  }
+  ResizeJob job;
+  job.src = src;
+  job.dst = make_image(rows, cols);
+  job.axis = &axis;
+  job.failed = 0;
+  if (job.dst) {
+    // Both passes split the rows they produce
+    parallel_for_bands(rows, horizontal ? horizontal_band : vertical_band, &job);
+    if (job.failed) {
+      free_image(&job.dst);
+    }
+  }
+  free_axis(&axis);
+  return job.dst;
+}
+
+/**
+ * Function: resize
+ * ----------------
+ * Resize an 8 bit image to cols x rows pixels as a horizontal pass followed by a
+ * vertical pass. The fixed point weights of every output column and row are computed
+ * once up front; when shrinking, the filter is widened by the scale factor so every
+ * input pixel contributes (no aliasing). The box filter instead averages the block of
+ * input pixels under each output pixel with constant time queries of a summed-area
+ * table, whatever the scale, and also takes 16 bit images.
+ *
+ * Parameters:
+ *  Image *im: the image to be resized
+ *  int cols: the new width
+ *  int rows: the new height
+ *  ResizeFilter filter: nearest neighbor, bilinear (triangle), Lanczos-3 or box
+ * Return:
+ *  -1: bad image pointer, 16 bit image (other than with box), bad size or allocation
+ *      failure
+ *  0: success
+ */
+int resize(Image *im, int cols, int rows, ResizeFilter filter) {
+  // Error check
+  if (!im || (IS_16BIT(im) ? !im->data16 || filter != RESIZE_BOX : !im->data)) {
+    fprintf(stderr, "Error:resize - resize given a bad (or 16 bit) image pointer\n");
+    return -1;
+  }
+  if (cols <= 0 || rows <= 0 || (long long)cols * rows > INT_MAX / 3 ||
+      (long long)im->rows * cols > INT_MAX / 3) {
+    fprintf(stderr, "Error:resize - resize given a bad size\n");
+    return -1;
+  }
+  if (filter == RESIZE_BOX) {
+    return box_resize(im, cols, rows);
+  }
+
+  // A pass that keeps its axis unchanged is skipped
+  Image *wide = NULL, *result = im;
+  if (cols != im->cols) {
+    wide = resample_pass(im, im->rows, cols, 1, filter);
+    result = wide;
+  }
+  if (result && rows != im->rows) {
+    result = resample_pass(result, rows, cols, 0, filter);
+    if (wide) {
+      free_image(&wide);
+    }
+  }
+  if (!result) {
+    fprintf(stderr, "Error:resize - resize failed to allocate memory\n");
+    return -1;
+  }
+  if (result != im) {
+    // Free the old image and set the pointer to the new image
+    replace_image(im, &result);
+  }
+  return 0;
+}
@@ -0,0 +1,45 @@
+/**
+ * @file resize.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for resizing images to arbitrary sizes
+ */
+
+// If not defined, define RESIZE_H
+#ifndef RESIZE_H
+#define RESIZE_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Resampling filters
+typedef enum {
+  RESIZE_NEAREST,
+  RESIZE_BILINEAR,
+  RESIZE_LANCZOS,
+  RESIZE_BOX        // mean of the input pixels each output pixel covers
+} ResizeFilter;
+
+/**
+ * Function: resize
+ * ----------------
+ * Resize an 8 bit image to cols x rows pixels as a horizontal pass followed by a
+ * vertical pass. The fixed point weights of every output column and row are computed
+ * once up front; when shrinking, the filter is widened by the scale factor so every
+ * input pixel contributes (no aliasing). The box filter instead averages the block of
+ * input pixels under each output pixel with constant time queries of a summed-area
+ * table, whatever the scale, and also takes 16 bit images.
+ *
+ * Parameters:
+ *  Image *im: the image to be resized
+ *  int cols: the new width
+ *  int rows: the new height
+ *  ResizeFilter filter: nearest neighbor, bilinear (triangle), Lanczos-3 or box
+ * Return:
+ *  -1: bad image pointer, 16 bit image (other than with box), bad size or allocation
+ *      failure
+ *  0: success
+ */
+int resize(Image *im, int cols, int rows, ResizeFilter filter);
+
+// End of header file
+#endif
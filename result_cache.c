@@ -0,0 +1,500 @@
+/**
+ * @file result_cache.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief The on-disk cache of finished outputs
+ */
+
+// copy_file_range() and the FICLONE ioctl are not part of POSIX
+#define _GNU_SOURCE
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "result_cache.h"
+#include "parallel.h"
+
+// The input file is hashed in blocks of this size, the block hashes are hashed again
+#define HASH_BLOCK ((size_t)1 << 20)
+
+// Primes of xxHash64
+#define PRIME1 11400714785074694791ULL
+#define PRIME2 14029467366897019727ULL
+#define PRIME3 1609587929392839161ULL
+#define PRIME4 9650029242287828579ULL
+#define PRIME5 2870177450012600261ULL
+
+// Rotate a 64 bit value left
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+// Shared state of hashing one input file
+typedef struct _hash_job {
+  int fd;
+  size_t size;
+  unsigned long long *hashes;   // one per block
+  char *failed;                 // one flag per band
+} HashJob;
+
+// A file of the cache directory, for eviction
+typedef struct _cache_entry {
+  char name[33];
+  time_t mtime;
+  unsigned long long size;
+} CacheEntry;
+
+/**
+ * Function: read64
+ * ----------------
+ * Load 8 unaligned bytes
+ *
+ * Parameters:
+ *  const unsigned char *p: the bytes
+ * Returns:
+ *  the value in host byte order
+ */
+static unsigned long long read64(const unsigned char *p) {
+  unsigned long long v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/**
+ * Function: read32
+ * ----------------
+ * Load 4 unaligned bytes
+ *
+ * Parameters:
+ *  const unsigned char *p: the bytes
+ * Returns:
+ *  the value in host byte order
+ */
+static unsigned long long read32(const unsigned char *p) {
+  unsigned int v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/**
+ * Function: hash_round
+ * --------------------
+ * Mix 8 bytes of input into an accumulator
+ *
+ * Parameters:
+ *  unsigned long long acc: the accumulator
+ *  unsigned long long input: the input
+ * Returns:
+ *  the new accumulator
+ */
+static unsigned long long hash_round(unsigned long long acc, unsigned long long input) {
+  acc += input * PRIME2;
+  acc = ROTL64(acc, 31);
+  return acc * PRIME1;
+}
+
+/**
+ * Function: hash_merge
+ * --------------------
+ * Fold one of the four stripe accumulators into the hash
+ *
+ * Parameters:
+ *  unsigned long long h: the hash
+ *  unsigned long long acc: the accumulator
+ * Returns:
+ *  the new hash
+ */
+static unsigned long long hash_merge(unsigned long long h, unsigned long long acc) {
+  h ^= hash_round(0, acc);
+  return h * PRIME1 + PRIME4;
+}
+
+/**
+ * Function: hash64
+ * ----------------
+ * Fast 64 bit hash of a block of memory (the xxHash64 construction)
+ *
+ * Parameters:
+ *  const void *data: the block
+ *  size_t len: its length in bytes
+ *  unsigned long long seed: the seed, for chaining hashes of consecutive blocks
+ * Returns:
+ *  the hash
+ */
+unsigned long long hash64(const void *data, size_t len, unsigned long long seed) {
+  const unsigned char *p = data, *end = p + len;
+  unsigned long long h;
+
+  if (len >= 32) {
+    // Four independent lanes over 32 byte stripes
+    unsigned long long v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+    for (; p + 32 <= end; p += 32) {
+      v1 = hash_round(v1, read64(p));
+      v2 = hash_round(v2, read64(p + 8));
+      v3 = hash_round(v3, read64(p + 16));
+      v4 = hash_round(v4, read64(p + 24));
+    }
+    h = ROTL64(v1, 1) + ROTL64(v2, 7) + ROTL64(v3, 12) + ROTL64(v4, 18);
+    h = hash_merge(h, v1);
+    h = hash_merge(h, v2);
+    h = hash_merge(h, v3);
+    h = hash_merge(h, v4);
+  } else {
+    h = seed + PRIME5;
+  }
+  h += len;
+
+  // The tail, 8, 4 and 1 bytes at a time
+  for (; p + 8 <= end; p += 8) {
+    h ^= hash_round(0, read64(p));
+    h = ROTL64(h, 27) * PRIME1 + PRIME4;
+  }
+  if (p + 4 <= end) {
+    h ^= read32(p) * PRIME1;
+    h = ROTL64(h, 23) * PRIME2 + PRIME3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h ^= *p * PRIME5;
+    h = ROTL64(h, 11) * PRIME1;
+  }
+
+  // Final avalanche
+  h ^= h >> 33;
+  h *= PRIME2;
+  h ^= h >> 29;
+  h *= PRIME3;
+  h ^= h >> 32;
+  return h;
+}
+
+/**
+ * Function: hash_band
+ * -------------------
+ * Hash one band of blocks of the input file
+ *
+ * Parameters:
+ *  void *ctx: the HashJob
+ *  int band: index of the band
+ *  int b0: first block of the band
+ *  int b1: one past the last block of the band
+ * Returns:
+ *  void
+ */
+static void hash_band(void *ctx, int band, int b0, int b1) {
+  HashJob *job = ctx;
+  unsigned char *buffer = malloc(HASH_BLOCK);
+  if (!buffer) {
+    job->failed[band] = 1;
+    return;
+  }
+  for (int b = b0; b < b1; b++) {
+    off_t offset = (off_t)b * (off_t)HASH_BLOCK;
+    size_t bytes = job->size - (size_t)offset < HASH_BLOCK ? job->size - (size_t)offset : HASH_BLOCK;
+    for (size_t done = 0; done < bytes; ) {
+      ssize_t got = pread(job->fd, buffer + done, bytes - done, offset + (off_t)done);
+      if (got <= 0) {
+        job->failed[band] = 1;
+        free(buffer);
+        return;
+      }
+      done += (size_t)got;
+    }
+    job->hashes[b] = hash64(buffer, bytes, 0);
+  }
+  free(buffer);
+}
+
+/**
+ * Function: entry_path
+ * --------------------
+ * Build the path of a file in the cache directory
+ *
+ * Parameters:
+ *  const char *dir: the cache directory
+ *  const char *name: the file name
+ *  const char *suffix: appended to the name
+ * Returns:
+ *  the path (to be freed), NULL if memory runs out
+ */
+static char *entry_path(const char *dir, const char *name, const char *suffix) {
+  size_t len = strlen(dir) + strlen(name) + strlen(suffix) + 2;
+  char *path = malloc(len);
+  if (path) {
+    snprintf(path, len, "%s/%s%s", dir, name, suffix);
+  }
+  return path;
+}
+
+/**
+ * Function: clone_file
+ * --------------------
+ * Make to a copy of from: a reflink where the file system shares extents, otherwise an
+ * in-kernel copy, otherwise a read/write loop
+ *
+ * Parameters:
+ *  const char *from: the file to copy
+ *  const char *to: the file to create or truncate
+ * Returns:
+ *  0 on success, -1 on failure
+ */
+static int clone_file(const char *from, const char *to) {
+  int in = open(from, O_RDONLY);
+  if (in < 0) {
+    return -1;
+  }
+  int out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (out < 0) {
+    close(in);
+    return -1;
+  }
+
+  int rc = 0;
+  if (ioctl(out, FICLONE, in) != 0) {
+    ssize_t n;
+    while ((n = copy_file_range(in, NULL, out, NULL, (size_t)1 << 30, 0)) > 0) {
+    }
+    if (n < 0) {
+      // No in-kernel copy between these files, copy through a buffer from the start
+      char *buffer = malloc(HASH_BLOCK);
+      rc = buffer && lseek(in, 0, SEEK_SET) == 0 && lseek(out, 0, SEEK_SET) == 0 && ftruncate(out, 0) == 0 ? 0 : -1;
+      while (rc == 0 && (n = read(in, buffer, HASH_BLOCK)) > 0) {
+        for (ssize_t done = 0; done < n; ) {
+          ssize_t put = write(out, buffer + done, (size_t)(n - done));
+          if (put <= 0) {
+            rc = -1;
+            break;
+          }
+          done += put;
+        }
+      }
+      if (n < 0) {
+        rc = -1;
+      }
+      free(buffer);
+    }
+  }
+  close(in);
+  if (close(out) != 0) {
+    rc = -1;
+  }
+  return rc;
+}
+
+/**
+ * Function: is_entry_name
+ * -----------------------
+ * Check whether a directory entry is a cache entry (32 hex digits)
+ *
+ * Parameters:
+ *  const char *name: the name
+ * Returns:
+ *  1 if it is, 0 otherwise
+ */
+static int is_entry_name(const char *name) {
+  if (strlen(name) != 32) {
+    return 0;
+  }
+  return strspn(name, "0123456789abcdef") == 32;
+}
+
+/**
+ * Function: older_entry
+ * ---------------------
+ * qsort comparison ordering entries from least to most recently used
+ *
+ * Parameters:
+ *  const void *a: the first CacheEntry
+ *  const void *b: the second CacheEntry
+ * Returns:
+ *  negative, zero or positive
+ */
+static int older_entry(const void *a, const void *b) {
+  const CacheEntry *x = a, *y = b;
+  return (x->mtime > y->mtime) - (x->mtime < y->mtime);
+}
+
+/**
+ * Function: evict
+ * ---------------
+ * Delete least recently used entries until the cache fits its size bound
+ *
+ * Parameters:
+ *  const ResultCache *cache: the cache
+ * Returns:
+ *  void
+ */
+static void evict(const ResultCache *cache) {
+  DIR *dir = opendir(cache->dir);
+  if (!dir) {
+    return;
+  }
+  CacheEntry *entries = NULL;
+  size_t count = 0, capacity = 0;
+  unsigned long long total = 0;
+  struct dirent *d;
+
+  while ((d = readdir(dir)) != NULL) {
+    struct stat st;
+    if (!is_entry_name(d->d_name) || fstatat(dirfd(dir), d->d_name, &st, 0) != 0) {
+      continue;
+    }
+    if (count == capacity) {
+      capacity = capacity ? capacity * 2 : 64;
+      CacheEntry *grown = realloc(entries, capacity * sizeof(CacheEntry));
+      if (!grown) {
+        break;
+      }
+      entries = grown;
+    }
+    strcpy(entries[count].name, d->d_name);
+    entries[count].mtime = st.st_mtime;
+    entries[count].size = (unsigned long long)st.st_size;
+    total += entries[count].size;
+    count++;
+  }
+
+  if (total > cache->max_bytes) {
+    qsort(entries, count, sizeof(CacheEntry), older_entry);
+    for (size_t i = 0; i < count && total > cache->max_bytes; i++) {
+      // Never evict the entry just stored
+      if (strcmp(entries[i].name, cache->key) != 0 && unlinkat(dirfd(dir), entries[i].name, 0) == 0) {
+        total -= entries[i].size;
+      }
+    }
+  }
+  free(entries);
+  closedir(dir);
+}
+
+/**
+ * Function: result_cache_open
+ * ---------------------------
+ * Use a directory as the cache, creating it if needed; its size bound is taken from
+ * the IMGPROC_CACHE_MB environment variable
+ *
+ * Parameters:
+ *  ResultCache *cache: the cache
+ *  const char *dir: the directory
+ * Returns:
+ *  0 on success, -1 if the directory cannot be created
+ */
+int result_cache_open(ResultCache *cache, const char *dir) {
+  const char *env = getenv("IMGPROC_CACHE_MB");
+  cache->dir = dir;
+  cache->max_bytes = (unsigned long long)(env && atoi(env) > 0 ? atoi(env) : RESULT_CACHE_DEFAULT_MB) << 20;
+  cache->key[0] = '\0';
+  if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+    fprintf(stderr, "Error:result_cache - failed to create cache directory %s\n", dir);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Function: result_cache_key
+ * --------------------------
+ * Compute the key of a job; the input file is hashed in blocks on several threads
+ *
+ * Parameters:
+ *  ResultCache *cache: the cache, whose key is set
+ *  const char *input: the name of the input file
+ *  const char *chain: the canonical text of everything that affects the output
+ * Returns:
+ *  0 on success, -1 if the input file cannot be read
+ */
+int result_cache_key(ResultCache *cache, const char *input, const char *chain) {
+  struct stat st;
+  int fd = open(input, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+
+  HashJob job;
+  int blocks = (int)(((size_t)st.st_size + HASH_BLOCK - 1) / HASH_BLOCK);
+  int bands = parallel_range_count(blocks, 1);
+  job.fd = fd;
+  job.size = (size_t)st.st_size;
+  job.hashes = malloc(sizeof(unsigned long long) * (blocks + 1));
+  job.failed = calloc((size_t)bands, 1);
+  int rc = job.hashes && job.failed ? 0 : -1;
+  if (rc == 0 && blocks > 0) {
+    parallel_for_range(blocks, 1, hash_band, &job);
+    for (int b = 0; b < bands; b++) {
+      rc |= job.failed[b] ? -1 : 0;
+    }
+  }
+  if (rc == 0) {
+    unsigned long long image = hash64(job.hashes, sizeof(unsigned long long) * blocks, job.size);
+    unsigned long long ops = hash64(chain, strlen(chain), RESULT_CACHE_VERSION);
+    snprintf(cache->key, sizeof(cache->key), "%016llx%016llx", image, ops);
+  }
+  free(job.hashes);
+  free(job.failed);
+  close(fd);
+  return rc;
+}
+
+/**
+ * Function: result_cache_fetch
+ * ----------------------------
+ * Serve the current job from the cache if it holds its output
+ *
+ * Parameters:
+ *  const ResultCache *cache: the cache
+ *  const char *output: the name of the output file to create
+ * Returns:
+ *  0 on a hit (the output has been written), -1 on a miss
+ */
+int result_cache_fetch(const ResultCache *cache, const char *output) {
+  char *path = entry_path(cache->dir, cache->key, "");
+  if (!path || access(path, R_OK) != 0 || clone_file(path, output) != 0) {
+    free(path);
+    return -1;
+  }
+  // Mark the entry as recently used
+  utimensat(AT_FDCWD, path, NULL, 0);
+  free(path);
+  return 0;
+}
+
+/**
+ * Function: result_cache_store
+ * ----------------------------
+ * Add the output of the current job to the cache, then evict least recently used
+ * entries beyond the size bound
+ *
+ * Parameters:
+ *  const ResultCache *cache: the cache
+ *  const char *output: the name of the output file just written
+ * Returns:
+ *  0 on success, -1 if the entry could not be written
+ */
+int result_cache_store(const ResultCache *cache, const char *output) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".tmp%ld", (long)getpid());
+  char *path = entry_path(cache->dir, cache->key, "");
+  char *tmp = entry_path(cache->dir, cache->key, suffix);
+
+  // Written under a temporary name, so concurrent jobs never see a partial entry
+  int rc = path && tmp && clone_file(output, tmp) == 0 && rename(tmp, path) == 0 ? 0 : -1;
+  if (rc != 0) {
+    if (tmp) {
+      unlink(tmp);
+    }
+    fprintf(stderr, "Error:result_cache - failed to store the output in %s\n", cache->dir);
+  } else {
+    evict(cache);
+  }
+  free(path);
+  free(tmp);
+  return rc;
+}
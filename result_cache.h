@@ -0,0 +1,105 @@
+/**
+ * @file result_cache.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for the on-disk cache of finished outputs
+ *
+ * A job is identified by a 64 bit hash of the bytes of the input file (header and
+ * pixels) and a 64 bit hash of the canonical text of its options and operation chain.
+ * The output of a job is kept in the cache directory under the hex of the two hashes;
+ * a later identical job gets the file cloned (reflinked where the file system can, so
+ * no data is copied) or copied into place instead of running the chain. Every hit
+ * refreshes the file's modification time, and after each store the least recently
+ * used entries are deleted until the directory fits its size bound.
+ */
+
+// If not defined, define RESULT_CACHE_H
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+// Include header files
+#include <stddef.h>
+
+// Size bound of the cache directory unless IMGPROC_CACHE_MB says otherwise
+#define RESULT_CACHE_DEFAULT_MB 1024
+
+// Bump whenever an operation changes its output, so old entries stop matching
+#define RESULT_CACHE_VERSION 1
+
+// The cache directory and the key of the current job
+typedef struct _result_cache {
+  const char *dir;
+  unsigned long long max_bytes;
+  char key[33];   // 32 hex digits
+} ResultCache;
+
+/**
+ * Function: hash64
+ * ----------------
+ * Fast 64 bit hash of a block of memory (the xxHash64 construction)
+ *
+ * Parameters:
+ *  const void *data: the block
+ *  size_t len: its length in bytes
+ *  unsigned long long seed: the seed, for chaining hashes of consecutive blocks
+ * Returns:
+ *  the hash
+ */
+unsigned long long hash64(const void *data, size_t len, unsigned long long seed);
+
+/**
+ * Function: result_cache_open
+ * ---------------------------
+ * Use a directory as the cache, creating it if needed; its size bound is taken from
+ * the IMGPROC_CACHE_MB environment variable
+ *
+ * Parameters:
+ *  ResultCache *cache: the cache
+ *  const char *dir: the directory
+ * Returns:
+ *  0 on success, -1 if the directory cannot be created
+ */
+int result_cache_open(ResultCache *cache, const char *dir);
+
+/**
+ * Function: result_cache_key
+ * --------------------------
+ * Compute the key of a job; the input file is hashed in blocks on several threads
+ *
+ * Parameters:
+ *  ResultCache *cache: the cache, whose key is set
+ *  const char *input: the name of the input file
+ *  const char *chain: the canonical text of everything that affects the output
+ * Returns:
+ *  0 on success, -1 if the input file cannot be read
+ */
+int result_cache_key(ResultCache *cache, const char *input, const char *chain);
+
+/**
+ * Function: result_cache_fetch
+ * ----------------------------
+ * Serve the current job from the cache if it holds its output
+ *
+ * Parameters:
+ *  const ResultCache *cache: the cache
+ *  const char *output: the name of the output file to create
+ * Returns:
+ *  0 on a hit (the output has been written), -1 on a miss
+ */
+int result_cache_fetch(const ResultCache *cache, const char *output);
+
+/**
+ * Function: result_cache_store
+ * ----------------------------
+ * Add the output of the current job to the cache, then evict least recently used
+ * entries beyond the size bound
+ *
+ * Parameters:
+ *  const ResultCache *cache: the cache
+ *  const char *output: the name of the output file just written
+ * Returns:
+ *  0 on success, -1 if the entry could not be written
+ */
+int result_cache_store(const ResultCache *cache, const char *output);
+
+// End of header file
+#endif
@@ -0,0 +1,197 @@
+/**
+ * @file rotate.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Rotating images by arbitrary angles
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+#include "rotate.h"
+#include "parallel.h"
+
+// Output tiles are ROTATE_TILE x ROTATE_TILE pixels, small enough that a tile and the
+// source pixels it reads stay in the L1/L2 cache
+#define ROTATE_TILE 64
+
+// Source coordinates are stepped in fixed point with this many fractional bits
+#define FIX_BITS 16
+#define FIX_ONE (1LL << FIX_BITS)
+
+// Shared state of one rotate call
+typedef struct _rotate_job {
+  const Image *src;
+  Image *dst;
+  RotateSampling sampling;
+  // Source coordinates of output pixel (x, y) are
+  // (x0 + x * dxCol + y * dxRow, y0 + x * dyCol + y * dyRow)
+  double x0, y0, dxCol, dyCol, dxRow, dyRow;
+} RotateJob;
+
+/**
+ * Function: sample_bilinear
+ * -------------------------
+ * Bilinear sample at a fixed point source position; taps outside the image count as
+ * black, which antialiases the border of the rotated image
+ *
+ * Parameters:
+ *  const Image *im: the source image
+ *  long long fx: column in fixed point
+ *  long long fy: row in fixed point
+ *  Pixel *out: receives the sample
+ * Return:
+ *  void
+ */
+static void sample_bilinear(const Image *im, long long fx, long long fy, Pixel *out) {
+  int x = (int)(fx >> FIX_BITS), y = (int)(fy >> FIX_BITS);
+  // 8 bit interpolation weights
+  int ax = (int)((fx >> (FIX_BITS - 8)) & 255), ay = (int)((fy >> (FIX_BITS - 8)) & 255);
+  int w[4] = { (256 - ax) * (256 - ay), ax * (256 - ay), (256 - ax) * ay, ax * ay };
+  int r = 1 << 15, g = 1 << 15, b = 1 << 15;
+
+  if (x >= 0 && y >= 0 && x < im->cols - 1 && y < im->rows - 1) {
+    // All four taps inside, the common case
+    const Pixel *p = &im->data[(size_t)y * im->cols + x];
+    const Pixel *q = p + im->cols;
+    r += w[0] * p[0].r + w[1] * p[1].r + w[2] * q[0].r + w[3] * q[1].r;
+    g += w[0] * p[0].g + w[1] * p[1].g + w[2] * q[0].g + w[3] * q[1].g;
+    b += w[0] * p[0].b + w[1] * p[1].b + w[2] * q[0].b + w[3] * q[1].b;
+  } else {
+    for (int t = 0; t < 4; t++) {
+      int tx = x + (t & 1), ty = y + (t >> 1);
+      if (tx >= 0 && ty >= 0 && tx < im->cols && ty < im->rows) {
+        const Pixel *p = &im->data[(size_t)ty * im->cols + tx];
+        r += w[t] * p->r;
+        g += w[t] * p->g;
+        b += w[t] * p->b;
+      }
+    }
+  }
+  out->r = (unsigned char)(r >> 16);
+  out->g = (unsigned char)(g >> 16);
+  out->b = (unsigned char)(b >> 16);
+}
+
+/**
+ * Function: rotate_band
+ * ---------------------
+ * Fill the output tiles of one band of tile rows. At the start of every row of a tile
+ * the source position is computed exactly, then stepped by a constant per column.
+ *
+ * Parameters:
+ *  void *ctx: the RotateJob
+ *  int band: index of the band (unused)
+ *  int t0: first tile row of the band
+ *  int t1: one past the last tile row of the band
+ * Return:
+ *  void
+ */
+static void rotate_band(void *ctx, int band, int t0, int t1) {
+  RotateJob *job = ctx;
+  const Image *src = job->src;
+  Image *dst = job->dst;
+  long long stepX = llround(job->dxCol * FIX_ONE), stepY = llround(job->dyCol * FIX_ONE);
+  // Nearest neighbor rounds instead of truncating
+  long long half = job->sampling == ROTATE_NEAREST ? FIX_ONE / 2 : 0;
+  (void)band;
+
+  for (int ty = t0 * ROTATE_TILE; ty < t1 * ROTATE_TILE && ty < dst->rows; ty += ROTATE_TILE) {
+    int yEnd = ty + ROTATE_TILE < dst->rows ? ty + ROTATE_TILE : dst->rows;
+    for (int tx = 0; tx < dst->cols; tx += ROTATE_TILE) {
+      int xEnd = tx + ROTATE_TILE < dst->cols ? tx + ROTATE_TILE : dst->cols;
+      for (int y = ty; y < yEnd; y++) {
+        long long fx = llround((job->x0 + tx * job->dxCol + y * job->dxRow) * FIX_ONE) + half;
+        long long fy = llround((job->y0 + tx * job->dyCol + y * job->dyRow) * FIX_ONE) + half;
+        Pixel *out = &dst->data[(size_t)y * dst->cols];
+        for (int x = tx; x < xEnd; x++, fx += stepX, fy += stepY) {
+          if (job->sampling == ROTATE_BILINEAR) {
+            sample_bilinear(src, fx, fy, &out[x]);
+            continue;
+          }
+          int sx = (int)(fx >> FIX_BITS), sy = (int)(fy >> FIX_BITS);
+          if (sx >= 0 && sy >= 0 && sx < src->cols && sy < src->rows) {
+            out[x] = src->data[(size_t)sy * src->cols + sx];
+          } else {
+            out[x].r = out[x].g = out[x].b = 0;
+          }
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Function: rotate
+ * ----------------
+ * Rotate an 8 bit image clockwise about its center by any angle. Every output pixel
+ * is mapped back into the input; the output is walked in small square tiles and the
+ * source coordinates are stepped incrementally in fixed point along each tile row, so
+ * there is no trigonometry per pixel. Areas that come from outside the input are black.
+ *
+ * Parameters:
+ *  Image *im: the image to be rotated
+ *  double degrees: the angle, clockwise (negative turns counterclockwise)
+ *  RotateCanvas canvas: expand the canvas or keep the input size
+ *  RotateSampling sampling: nearest neighbor or bilinear sampling
+ * Return:
+ *  -1: bad image pointer, 16 bit image, canvas too large or allocation failure
+ *  0: success
+ */
+int rotate(Image *im, double degrees, RotateCanvas canvas, RotateSampling sampling) {
+  // Error check
+  if (!im || IS_16BIT(im) || !im->data) {
+    fprintf(stderr, "Error:rotate - rotate given a bad (or 16 bit) image pointer\n");
+    return -1;
+  }
+
+  const double pi = 3.14159265358979323846;
+  double a = fmod(degrees, 360) * pi / 180;
+  double cs = cos(a), sn = sin(a);
+  // Snap the values of multiples of 90 degrees so those rotations are exact
+  if (fabs(cs) < 1e-12) {
+    cs = 0;
+  }
+  if (fabs(sn) < 1e-12) {
+    sn = 0;
+  }
+
+  int cols = im->cols, rows = im->rows;
+  if (canvas == ROTATE_EXPAND) {
+    // Bounding box of the rotated image, with a little slack for rounding
+    double w = fabs(im->cols * cs) + fabs(im->rows * sn), h = fabs(im->cols * sn) + fabs(im->rows * cs);
+    if (w * h * 3 > INT_MAX) {
+      fprintf(stderr, "Error:rotate - rotate canvas is too large\n");
+      return -1;
+    }
+    cols = (int)ceil(w - 1e-6);
+    rows = (int)ceil(h - 1e-6);
+  }
+
+  RotateJob job;
+  job.src = im;
+  job.sampling = sampling;
+  job.dst = make_image(rows, cols);
+  if (!job.dst) {
+    fprintf(stderr, "Error:rotate - rotate failed to allocate memory\n");
+    return -1;
+  }
+
+  // Map the output pixel centers back through the inverse rotation (counterclockwise
+  // on screen, where y grows downwards) around the two image centers
+  double ox = cols / 2.0, oy = rows / 2.0, ix = im->cols / 2.0, iy = im->rows / 2.0;
+  job.dxCol = cs;
+  job.dyCol = -sn;
+  job.dxRow = sn;
+  job.dyRow = cs;
+  job.x0 = (0.5 - ox) * cs + (0.5 - oy) * sn + ix - 0.5;
+  job.y0 = -(0.5 - ox) * sn + (0.5 - oy) * cs + iy - 0.5;
+
+  int tileRows = (rows + ROTATE_TILE - 1) / ROTATE_TILE;
+  parallel_for_range(tileRows, 1, rotate_band, &job);
+
+  // Free the old image and set the pointer to the new image
+  replace_image(im, &job.dst);
+  return 0;
+}
@@ -0,0 +1,46 @@
+/**
+ * @file rotate.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for rotating images by arbitrary angles
+ */
+
+// If not defined, define ROTATE_H
+#ifndef ROTATE_H
+#define ROTATE_H
+
+// Include header files
+#include "ppm_io.h"
+
+// Size of the output canvas
+typedef enum {
+  ROTATE_EXPAND,   // large enough to hold the whole rotated image
+  ROTATE_CROP      // the size of the input, corners that rotate out are lost
+} RotateCanvas;
+
+// How source pixels are sampled
+typedef enum {
+  ROTATE_NEAREST,
+  ROTATE_BILINEAR
+} RotateSampling;
+
+/**
+ * Function: rotate
+ * ----------------
+ * Rotate an 8 bit image clockwise about its center by any angle. Every output pixel
+ * is mapped back into the input; the output is walked in small square tiles and the
+ * source coordinates are stepped incrementally in fixed point along each tile row, so
+ * there is no trigonometry per pixel. Areas that come from outside the input are black.
+ *
+ * Parameters:
+ *  Image *im: the image to be rotated
+ *  double degrees: the angle, clockwise (negative turns counterclockwise)
+ *  RotateCanvas canvas: expand the canvas or keep the input size
+ *  RotateSampling sampling: nearest neighbor or bilinear sampling
+ * Return:
+ *  -1: bad image pointer, 16 bit image, canvas too large or allocation failure
+ *  0: success
+ */
+int rotate(Image *im, double degrees, RotateCanvas canvas, RotateSampling sampling);
+
+// End of header file
+#endif
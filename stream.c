@@ -0,0 +1,297 @@
+/**
+ * @file stream.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Processing streams of concatenated PPM frames
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "stream.h"
+
+// Bounded queue of frames between two pipeline stages
+typedef struct _frame_queue {
+  Image *frames[STREAM_QUEUE_DEPTH];
+  int head;
+  int count;
+  int closed;   // the producer will not push any more frames
+  int aborted;  // the consumer stopped, pushes fail from now on
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+} FrameQueue;
+
+// State shared by the three pipeline stages
+typedef struct _pipeline {
+  FILE *in;
+  FILE *out;
+  FrameQueue toProcess;
+  FrameQueue toWrite;
+  int readStatus;
+  int writeStatus;
+  long written;
+} Pipeline;
+
+/**
+ * Function: queue_init
+ * --------------------
+ * Initialize an empty queue
+ *
+ * Parameters:
+ *  FrameQueue *q: the queue
+ * Returns:
+ *  0 on success, -1 if the lock could not be created
+ */
+static int queue_init(FrameQueue *q) {
+  q->head = q->count = q->closed = q->aborted = 0;
+  if (pthread_mutex_init(&q->lock, NULL) != 0) {
+    return -1;
+  }
+  if (pthread_cond_init(&q->changed, NULL) != 0) {
+    pthread_mutex_destroy(&q->lock);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Function: queue_destroy
+ * -----------------------
+ * Free any frames left in a queue and release its lock
+ *
+ * Parameters:
+ *  FrameQueue *q: the queue
+ * Returns:
+ *  void
+ */
+static void queue_destroy(FrameQueue *q) {
+  while (q->count > 0) {
+    free_image(&q->frames[q->head]);
+    q->head = (q->head + 1) % STREAM_QUEUE_DEPTH;
+    q->count--;
+  }
+  pthread_cond_destroy(&q->changed);
+  pthread_mutex_destroy(&q->lock);
+}
+
+/**
+ * Function: queue_push
+ * --------------------
+ * Append a frame, waiting while the queue is full
+ *
+ * Parameters:
+ *  FrameQueue *q: the queue
+ *  Image *im: the frame; the queue owns it on success
+ * Returns:
+ *  0 on success, -1 if the consumer aborted (the caller keeps the frame)
+ */
+static int queue_push(FrameQueue *q, Image *im) {
+  pthread_mutex_lock(&q->lock);
+  while (q->count == STREAM_QUEUE_DEPTH && !q->aborted) {
+    pthread_cond_wait(&q->changed, &q->lock);
+  }
+  int rc = -1;
+  if (!q->aborted) {
+    q->frames[(q->head + q->count) % STREAM_QUEUE_DEPTH] = im;
+    q->count++;
+    rc = 0;
+    pthread_cond_broadcast(&q->changed);
+  }
+  pthread_mutex_unlock(&q->lock);
+  return rc;
+}
+
+/**
+ * Function: queue_pop
+ * -------------------
+ * Take the oldest frame, waiting while the queue is empty and still open
+ *
+ * Parameters:
+ *  FrameQueue *q: the queue
+ * Returns:
+ *  the frame (now owned by the caller), NULL once the queue is closed and drained
+ */
+static Image *queue_pop(FrameQueue *q) {
+  pthread_mutex_lock(&q->lock);
+  while (q->count == 0 && !q->closed) {
+    pthread_cond_wait(&q->changed, &q->lock);
+  }
+  Image *im = NULL;
+  if (q->count > 0) {
+    im = q->frames[q->head];
+    q->head = (q->head + 1) % STREAM_QUEUE_DEPTH;
+    q->count--;
+    pthread_cond_broadcast(&q->changed);
+  }
+  pthread_mutex_unlock(&q->lock);
+  return im;
+}
+
+/**
+ * Function: queue_close
+ * ---------------------
+ * Mark that the producer is done (close) or that the consumer gave up (abort)
+ *
+ * Parameters:
+ *  FrameQueue *q: the queue
+ *  int abort: 0 to close, 1 to abort
+ * Returns:
+ *  void
+ */
+static void queue_close(FrameQueue *q, int abort) {
+  pthread_mutex_lock(&q->lock);
+  if (abort) {
+    q->aborted = 1;
+  } else {
+    q->closed = 1;
+  }
+  pthread_cond_broadcast(&q->changed);
+  pthread_mutex_unlock(&q->lock);
+}
+
+/**
+ * Function: reader_stage
+ * ----------------------
+ * Pipeline stage that reads frames until the end of the input
+ *
+ * Parameters:
+ *  void *arg: the Pipeline
+ * Returns:
+ *  NULL
+ */
+static void *reader_stage(void *arg) {
+  Pipeline *p = arg;
+  for (;;) {
+    // Whitespace between frames is tolerated; the end of the input ends the stream
+    int ch;
+    while ((ch = fgetc(p->in)) != EOF && isspace(ch)) {
+    }
+    if (ch == EOF) {
+      break;
+    }
+    ungetc(ch, p->in);
+
+    Image *im = read_ppm(p->in);
+    if (!im) {
+      p->readStatus = STREAM_READ_FAILED;
+      break;
+    }
+    if (queue_push(&p->toProcess, im) != 0) {
+      free_image(&im);
+      break;
+    }
+  }
+  queue_close(&p->toProcess, 0);
+  return NULL;
+}
+
+/**
+ * Function: writer_stage
+ * ----------------------
+ * Pipeline stage that writes and flushes frames in order
+ *
+ * Parameters:
+ *  void *arg: the Pipeline
+ * Returns:
+ *  NULL
+ */
+static void *writer_stage(void *arg) {
+  Pipeline *p = arg;
+  Image *im;
+  while ((im = queue_pop(&p->toWrite)) != NULL) {
+    int failed = write_ppm(p->out, im) != 0 || fflush(p->out) != 0;
+    free_image(&im);
+    if (failed) {
+      p->writeStatus = STREAM_WRITE_FAILED;
+      queue_close(&p->toWrite, 1);
+      break;
+    }
+    p->written++;
+  }
+  return NULL;
+}
+
+/**
+ * Function: stream_frames
+ * -----------------------
+ * Read successive PPM frames from in, apply fn to each one and write the results to out,
+ * in order. Reading, processing and writing run as three overlapped pipeline stages (a
+ * reader thread, the calling thread and a writer thread) connected by bounded queues
+ * of STREAM_QUEUE_DEPTH frames, so at most a fixed number of frames is ever in memory.
+ * Each written frame is flushed so downstream consumers see it right away.
+ *
+ * Parameters:
+ *  FILE *in: the input stream
+ *  FILE *out: the output stream
+ *  frame_fn fn: the work done on each frame
+ *  void *ctx: passed unchanged to fn
+ *  long *frames: if not NULL, set to the number of frames written
+ * Returns:
+ *  0: every frame was processed and written
+ *  STREAM_READ_FAILED: a frame could not be read as a PPM image
+ *  STREAM_WRITE_FAILED: a frame could not be written
+ *  STREAM_NO_MEMORY: the pipeline could not be set up
+ *  otherwise: the nonzero code returned by fn
+ */
+int stream_frames(FILE *in, FILE *out, frame_fn fn, void *ctx, long *frames) {
+  Pipeline p;
+  p.in = in;
+  p.out = out;
+  p.readStatus = p.writeStatus = 0;
+  p.written = 0;
+  if (frames) {
+    *frames = 0;
+  }
+  if (queue_init(&p.toProcess) != 0) {
+    return STREAM_NO_MEMORY;
+  }
+  if (queue_init(&p.toWrite) != 0) {
+    queue_destroy(&p.toProcess);
+    return STREAM_NO_MEMORY;
+  }
+
+  pthread_t reader, writer;
+  if (pthread_create(&reader, NULL, reader_stage, &p) != 0) {
+    queue_destroy(&p.toProcess);
+    queue_destroy(&p.toWrite);
+    return STREAM_NO_MEMORY;
+  }
+  if (pthread_create(&writer, NULL, writer_stage, &p) != 0) {
+    queue_close(&p.toProcess, 1);
+    pthread_join(reader, NULL);
+    queue_destroy(&p.toProcess);
+    queue_destroy(&p.toWrite);
+    return STREAM_NO_MEMORY;
+  }
+
+  // The calling thread is the processing stage
+  int status = 0;
+  Image *im;
+  while ((im = queue_pop(&p.toProcess)) != NULL) {
+    status = fn(im, ctx);
+    if (status != 0 || queue_push(&p.toWrite, im) != 0) {
+      free_image(&im);
+      break;
+    }
+  }
+
+  // Stop the reader if we gave up early, let the writer drain what was processed
+  queue_close(&p.toProcess, 1);
+  queue_close(&p.toWrite, 0);
+  pthread_join(writer, NULL);
+  pthread_join(reader, NULL);
+  queue_destroy(&p.toProcess);
+  queue_destroy(&p.toWrite);
+
+  if (frames) {
+    *frames = p.written;
+  }
+  if (status != 0) {
+    return status;
+  }
+  if (p.writeStatus != 0) {
+    return p.writeStatus;
+  }
+  return p.readStatus;
+}
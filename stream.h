@@ -0,0 +1,51 @@
+/**
+ * @file stream.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for processing streams of concatenated PPM frames
+ */
+
+// If not defined, define STREAM_H
+#ifndef STREAM_H
+#define STREAM_H
+
+// Include header files
+#include <stdio.h>
+#include "ppm_io.h"
+
+// Return codes of stream_frames besides 0 (success) and the codes returned by the frame work
+#define STREAM_READ_FAILED  -1
+#define STREAM_WRITE_FAILED -2
+#define STREAM_NO_MEMORY    -3
+
+// Number of frames each queue between two pipeline stages can hold
+#define STREAM_QUEUE_DEPTH 4
+
+// Work applied to each frame in place; returns 0 to continue or a nonzero code to stop the stream
+typedef int (*frame_fn)(Image *im, void *ctx);
+
+/**
+ * Function: stream_frames
+ * -----------------------
+ * Read successive PPM frames from in, apply fn to each one and write the results to out,
+ * in order. Reading, processing and writing run as three overlapped pipeline stages (a
+ * reader thread, the calling thread and a writer thread) connected by bounded queues
+ * of STREAM_QUEUE_DEPTH frames, so at most a fixed number of frames is ever in memory.
+ * Each written frame is flushed so downstream consumers see it right away.
+ *
+ * Parameters:
+ *  FILE *in: the input stream
+ *  FILE *out: the output stream
+ *  frame_fn fn: the work done on each frame
+ *  void *ctx: passed unchanged to fn
+ *  long *frames: if not NULL, set to the number of frames written
+ * Returns:
+ *  0: every frame was processed and written
+ *  STREAM_READ_FAILED: a frame could not be read as a PPM image
+ *  STREAM_WRITE_FAILED: a frame could not be written
+ *  STREAM_NO_MEMORY: the pipeline could not be set up
+ *  otherwise: the nonzero code returned by fn
+ */
+int stream_frames(FILE *in, FILE *out, frame_fn fn, void *ctx, long *frames);
+
+// End of header file
+#endif
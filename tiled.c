@@ -0,0 +1,657 @@
+/**
+ * @file tiled.c
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Tiled, copy-on-write 8 bit images
+ */
+
+// Include header files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "tiled.h"
+#include "parallel.h"
+
+// Pixels of one tile
+#define TILE_PIXELS ((size_t)TILE_SIZE * TILE_SIZE)
+
+// Distinct tiles mapped per thread at least, so small images stay on one thread
+#define TILED_MIN_GROUPS 16
+
+// A place of an image and the tile it points at, for grouping the places by tile
+typedef struct _tile_place {
+  uintptr_t tile;
+  int place;
+} TilePlace;
+
+// Shared state of mapping the distinct tiles of an image
+typedef struct _tile_map_job {
+  TiledImage *im;
+  const PointOp *op;
+  const TilePlace *order;   // places sorted by the tile they point at
+  const int *groups;        // start of each run of places sharing a tile in order,
+                            // then one past the last place
+  int failed;
+} TileMapJob;
+
+/**
+ * Function: same_pixel
+ * --------------------
+ * Whether two pixels have the same color
+ *
+ * Parameters:
+ *  const Pixel *a: one pixel
+ *  const Pixel *b: the other pixel
+ * Returns:
+ *  1 if they are the same, 0 otherwise
+ */
+static int same_pixel(const Pixel *a, const Pixel *b) {
+  return a->r == b->r && a->g == b->g && a->b == b->b;
+}
+
+/**
+ * Function: make_tile
+ * -------------------
+ * Allocate a tile with one reference, either uniform or with (uninitialized) pixels
+ *
+ * Parameters:
+ *  int uniform: nonzero for a uniform tile
+ *  Pixel color: the color of a uniform tile
+ * Returns:
+ *  Tile *: the tile, NULL on allocation failure
+ */
+static Tile *make_tile(int uniform, Pixel color) {
+  Tile *t = malloc(sizeof(Tile));
+  if (!t) {
+    return NULL;
+  }
+  t->refs = 1;
+  t->uniform = uniform;
+  t->color = color;
+  t->data = NULL;
+  if (!uniform && !(t->data = malloc(sizeof(Pixel) * TILE_PIXELS))) {
+    free(t);
+    return NULL;
+  }
+  return t;
+}
+
+/**
+ * Function: release_tile
+ * ----------------------
+ * Drop one reference to a tile, freeing it with the last one
+ *
+ * Parameters:
+ *  Tile *t: the tile, may be NULL
+ * Returns:
+ *  void
+ */
+static void release_tile(Tile *t) {
+  if (t && --t->refs == 0) {
+    free(t->data);
+    free(t);
+  }
+}
+
+/**
+ * Function: uniform_color
+ * -----------------------
+ * Whether all pixels of a w x h window have one color
+ *
+ * Parameters:
+ *  const Pixel *p: the top left pixel of the window
+ *  size_t stride: pixels from one row of the window to the next
+ *  int w: width of the window
+ *  int h: height of the window
+ *  Pixel *color: set to the color if there is one
+ * Returns:
+ *  1 if the window is uniform, 0 otherwise
+ */
+static int uniform_color(const Pixel *p, size_t stride, int w, int h, Pixel *color) {
+  for (int c = 1; c < w; c++) {
+    if (!same_pixel(&p[c], &p[0])) {
+      return 0;
+    }
+  }
+  // Every other row must then equal the first one
+  for (int r = 1; r < h; r++) {
+    if (memcmp(p + r * stride, p, sizeof(Pixel) * w) != 0) {
+      return 0;
+    }
+  }
+  *color = p[0];
+  return 1;
+}
+
+/**
+ * Function: alloc_tiled_image
+ * ---------------------------
+ * Allocate an image with no tiles yet
+ *
+ * Parameters:
+ *  int rows: number of rows
+ *  int cols: number of columns
+ *  int maxval: the maximum sample value (1 to 255)
+ * Returns:
+ *  TiledImage *: the image, its tile pointers NULL; NULL on bad dimensions or
+ *                allocation failure
+ */
+static TiledImage *alloc_tiled_image(int rows, int cols, int maxval) {
+  if (rows <= 0 || cols <= 0 || maxval < 1 || maxval > 255) {
+    return NULL;
+  }
+  TiledImage *im = malloc(sizeof(TiledImage));
+  if (!im) {
+    return NULL;
+  }
+  im->rows = rows;
+  im->cols = cols;
+  im->maxval = maxval;
+  im->trows = (rows + TILE_SIZE - 1) / TILE_SIZE;
+  im->tcols = (cols + TILE_SIZE - 1) / TILE_SIZE;
+  if (!(im->tiles = calloc((size_t)im->trows * im->tcols, sizeof(Tile *)))) {
+    free(im);
+    return NULL;
+  }
+  return im;
+}
+
+/**
+ * Function: fill_tile_row
+ * -----------------------
+ * Make the tiles of one row of tiles from a strip of flat pixels. A uniform tile
+ * shares the tile to its left or above when that has the same color.
+ *
+ * Parameters:
+ *  TiledImage *im: the image
+ *  int tr: the row of tiles
+ *  const Pixel *strip: the first pixel of the strip
+ *  size_t stride: pixels from one row of the strip to the next
+ * Returns:
+ *  -1: allocation failure
+ *  0: success
+ */
+static int fill_tile_row(TiledImage *im, int tr, const Pixel *strip, size_t stride) {
+  int h = im->rows - tr * TILE_SIZE < TILE_SIZE ? im->rows - tr * TILE_SIZE : TILE_SIZE;
+  for (int tc = 0; tc < im->tcols; tc++) {
+    int w = im->cols - tc * TILE_SIZE < TILE_SIZE ? im->cols - tc * TILE_SIZE : TILE_SIZE;
+    const Pixel *src = strip + (size_t)tc * TILE_SIZE;
+    Tile **slot = &im->tiles[(size_t)tr * im->tcols + tc];
+    Pixel color = src[0];
+    if (uniform_color(src, stride, w, h, &color)) {
+      Tile *left = tc > 0 ? slot[-1] : NULL, *above = tr > 0 ? slot[-im->tcols] : NULL;
+      if (left && left->uniform && same_pixel(&left->color, &color)) {
+        *slot = left;
+        left->refs++;
+      } else if (above && above->uniform && same_pixel(&above->color, &color)) {
+        *slot = above;
+        above->refs++;
+      } else if (!(*slot = make_tile(1, color))) {
+        return -1;
+      }
+      continue;
+    }
+    if (!(*slot = make_tile(0, color))) {
+      return -1;
+    }
+    if (w < TILE_SIZE || h < TILE_SIZE) {
+      memset((*slot)->data, 0, sizeof(Pixel) * TILE_PIXELS);
+    }
+    for (int r = 0; r < h; r++) {
+      memcpy((*slot)->data + (size_t)r * TILE_SIZE, src + r * stride, sizeof(Pixel) * w);
+    }
+  }
+  return 0;
+}
+
+/**
+ * Function: make_tiled_image
+ * --------------------------
+ * Make an image of one color; all of its places share a single uniform tile
+ *
+ * Parameters:
+ *  int rows: number of rows
+ *  int cols: number of columns
+ *  int maxval: the maximum sample value (1 to 255)
+ *  Pixel color: the color
+ * Returns:
+ *  TiledImage *: the image, NULL on bad dimensions or allocation failure
+ */
+TiledImage *make_tiled_image(int rows, int cols, int maxval, Pixel color) {
+  TiledImage *im = alloc_tiled_image(rows, cols, maxval);
+  Tile *t = im ? make_tile(1, color) : NULL;
+  if (!t) {
+    fprintf(stderr, "Error:tiled - make_tiled_image given bad dimensions or failed to allocate memory\n");
+    free_tiled_image(&im);
+    return NULL;
+  }
+  size_t n = (size_t)im->trows * im->tcols;
+  for (size_t i = 0; i < n; i++) {
+    im->tiles[i] = t;
+  }
+  t->refs = (int)n;
+  return im;
+}
+
+/**
+ * Function: tile_image
+ * --------------------
+ * Copy an 8 bit image into tiles
+ *
+ * Parameters:
+ *  const Image *im: the image
+ * Returns:
+ *  TiledImage *: the tiled copy, NULL on a bad (or 16 bit) image or allocation failure
+ */
+TiledImage *tile_image(const Image *im) {
+  // Error check
+  if (!im || IS_16BIT(im) || !im->data) {
+    fprintf(stderr, "Error:tiled - tile_image given a bad (or 16 bit) image pointer\n");
+    return NULL;
+  }
+
+  TiledImage *tiled = alloc_tiled_image(im->rows, im->cols, im->maxval);
+  for (int tr = 0; tiled && tr < tiled->trows; tr++) {
+    if (fill_tile_row(tiled, tr, im->data + (size_t)tr * TILE_SIZE * im->cols, im->cols) != 0) {
+      free_tiled_image(&tiled);
+    }
+  }
+  if (!tiled) {
+    fprintf(stderr, "Error:tiled - tile_image failed to allocate memory\n");
+  }
+  return tiled;
+}
+
+/**
+ * Function: copy_tile_row
+ * -----------------------
+ * Copy one row of tiles into a strip of flat pixels
+ *
+ * Parameters:
+ *  const TiledImage *im: the image
+ *  int tr: the row of tiles
+ *  Pixel *strip: the first pixel of the strip
+ *  size_t stride: pixels from one row of the strip to the next
+ * Returns:
+ *  void
+ */
+static void copy_tile_row(const TiledImage *im, int tr, Pixel *strip, size_t stride) {
+  int h = im->rows - tr * TILE_SIZE < TILE_SIZE ? im->rows - tr * TILE_SIZE : TILE_SIZE;
+  for (int tc = 0; tc < im->tcols; tc++) {
+    int w = im->cols - tc * TILE_SIZE < TILE_SIZE ? im->cols - tc * TILE_SIZE : TILE_SIZE;
+    const Tile *t = im->tiles[(size_t)tr * im->tcols + tc];
+    Pixel *dst = strip + (size_t)tc * TILE_SIZE;
+    if (t->uniform) {
+      for (int c = 0; c < w; c++) {
+        dst[c] = t->color;
+      }
+      for (int r = 1; r < h; r++) {
+        memcpy(dst + r * stride, dst, sizeof(Pixel) * w);
+      }
+    } else {
+      for (int r = 0; r < h; r++) {
+        memcpy(dst + r * stride, t->data + (size_t)r * TILE_SIZE, sizeof(Pixel) * w);
+      }
+    }
+  }
+}
+
+/**
+ * Function: untile_image
+ * ----------------------
+ * Copy a tiled image into a flat one
+ *
+ * Parameters:
+ *  const TiledImage *im: the tiled image
+ * Returns:
+ *  Image *: the flat copy, NULL on allocation failure
+ */
+Image *untile_image(const TiledImage *im) {
+  Image *flat = im ? make_image_maxval(im->rows, im->cols, im->maxval) : NULL;
+  if (!flat) {
+    fprintf(stderr, "Error:tiled - untile_image given a bad image pointer or failed to allocate memory\n");
+    return NULL;
+  }
+  for (int tr = 0; tr < im->trows; tr++) {
+    copy_tile_row(im, tr, flat->data + (size_t)tr * TILE_SIZE * im->cols, im->cols);
+  }
+  return flat;
+}
+
+/**
+ * Function: read_ppm_tiled
+ * ------------------------
+ * Read the payload of an 8 bit P6 file whose header has already been consumed by
+ * read_ppm_header straight into tiles, one strip of TILE_SIZE rows at a time, so the
+ * flat image is never held in memory
+ *
+ * Parameters:
+ *  FILE *fp: file pointer positioned at the start of the payload
+ *  int cols: number of columns
+ *  int rows: number of rows
+ *  int maxval: the maximum sample value from the header (1 to 255)
+ * Returns:
+ *  TiledImage *: the image, NULL on a bad maxval, a short file or allocation failure
+ */
+TiledImage *read_ppm_tiled(FILE *fp, int cols, int rows, int maxval) {
+  TiledImage *im = alloc_tiled_image(rows, cols, maxval);
+  Pixel *strip = im ? malloc(sizeof(Pixel) * TILE_SIZE * cols) : NULL;
+  if (!strip) {
+    fprintf(stderr, "Error:tiled - read_ppm_tiled failed to allocate memory\n");
+    free_tiled_image(&im);
+    return NULL;
+  }
+
+  for (int tr = 0; tr < im->trows; tr++) {
+    int h = rows - tr * TILE_SIZE < TILE_SIZE ? rows - tr * TILE_SIZE : TILE_SIZE;
+    if (fread(strip, sizeof(Pixel), (size_t)h * cols, fp) != (size_t)h * cols) {
+      fprintf(stderr, "Error:tiled - failed to read data from file!\n");
+      free_tiled_image(&im);
+      break;
+    }
+    if (fill_tile_row(im, tr, strip, cols) != 0) {
+      fprintf(stderr, "Error:tiled - read_ppm_tiled failed to allocate memory\n");
+      free_tiled_image(&im);
+      break;
+    }
+  }
+  free(strip);
+  return im;
+}
+
+/**
+ * Function: write_ppm_tiled
+ * -------------------------
+ * Writes a tiled image to the file specified by fp as a P6 PPM.
+ *
+ * Parameters:
+ *  FILE *fp: the file to write to
+ *  const TiledImage *im: the image to write
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_ppm_tiled(FILE *fp, const TiledImage *im) {
+  Pixel *strip = im ? malloc(sizeof(Pixel) * TILE_SIZE * im->cols) : NULL;
+  if (!strip) {
+    fprintf(stderr, "Error:tiled - write_ppm_tiled given a bad image pointer or failed to allocate memory\n");
+    return -1;
+  }
+
+  // write tag
+  int failed = fprintf(fp, "P6\n%d %d\n%d\n", im->cols, im->rows, im->maxval) < 0;
+  for (int tr = 0; !failed && tr < im->trows; tr++) {
+    int h = im->rows - tr * TILE_SIZE < TILE_SIZE ? im->rows - tr * TILE_SIZE : TILE_SIZE;
+    copy_tile_row(im, tr, strip, im->cols);
+    failed = fwrite(strip, sizeof(Pixel), (size_t)h * im->cols, fp) != (size_t)h * im->cols;
+  }
+  free(strip);
+  return failed ? -1 : 0;
+}
+
+/**
+ * Function: copy_tiled_image
+ * --------------------------
+ * Copy an image by sharing its tiles; nothing is copied until one of them is written
+ *
+ * Parameters:
+ *  const TiledImage *im: the image
+ * Returns:
+ *  TiledImage *: the copy, NULL on allocation failure
+ */
+TiledImage *copy_tiled_image(const TiledImage *im) {
+  TiledImage *copy = im ? alloc_tiled_image(im->rows, im->cols, im->maxval) : NULL;
+  if (!copy) {
+    fprintf(stderr, "Error:tiled - copy_tiled_image given a bad image pointer or failed to allocate memory\n");
+    return NULL;
+  }
+  size_t n = (size_t)im->trows * im->tcols;
+  for (size_t i = 0; i < n; i++) {
+    copy->tiles[i] = im->tiles[i];
+    copy->tiles[i]->refs++;
+  }
+  return copy;
+}
+
+/**
+ * Function: tile_for_write
+ * ------------------------
+ * The pixels of one tile, ready to be written: a shared tile is copied first and a
+ * uniform one is expanded
+ *
+ * Parameters:
+ *  TiledImage *im: the image
+ *  int tr: row of the tile
+ *  int tc: column of the tile
+ * Returns:
+ *  Pixel *: the TILE_SIZE x TILE_SIZE pixels, NULL on bad indices or allocation
+ *           failure
+ */
+Pixel *tile_for_write(TiledImage *im, int tr, int tc) {
+  // Error check
+  if (!im || tr < 0 || tc < 0 || tr >= im->trows || tc >= im->tcols) {
+    fprintf(stderr, "Error:tiled - tile_for_write given a bad image pointer or tile\n");
+    return NULL;
+  }
+
+  Tile **slot = &im->tiles[(size_t)tr * im->tcols + tc];
+  Tile *t = *slot;
+  if (t->refs == 1 && !t->uniform) {
+    return t->data;
+  }
+  Tile *own = make_tile(0, t->color);
+  if (!own) {
+    fprintf(stderr, "Error:tiled - tile_for_write failed to allocate memory\n");
+    return NULL;
+  }
+  if (t->uniform) {
+    for (size_t i = 0; i < TILE_PIXELS; i++) {
+      own->data[i] = t->color;
+    }
+  } else {
+    memcpy(own->data, t->data, sizeof(Pixel) * TILE_PIXELS);
+  }
+  release_tile(t);
+  *slot = own;
+  return own->data;
+}
+
+/**
+ * Function: map_pixel
+ * -------------------
+ * Apply a chain of point operations to one pixel
+ *
+ * Parameters:
+ *  const PointOp *op: the chain
+ *  Pixel p: the pixel
+ * Returns:
+ *  the mapped pixel
+ */
+static Pixel map_pixel(const PointOp *op, Pixel p) {
+  const unsigned char in[3] = { p.r, p.g, p.b };
+  p.r = (unsigned char)op->lut[0][in[op->shuffle[0]]];
+  p.g = (unsigned char)op->lut[1][in[op->shuffle[1]]];
+  p.b = (unsigned char)op->lut[2][in[op->shuffle[2]]];
+  return p;
+}
+
+/**
+ * Function: map_pixels
+ * --------------------
+ * Apply a chain of point operations to the pixels of a tile
+ *
+ * Parameters:
+ *  const PointOp *op: the chain
+ *  const Pixel *in: the pixels
+ *  Pixel *out: set to the mapped pixels, may be in
+ * Returns:
+ *  void
+ */
+static void map_pixels(const PointOp *op, const Pixel *in, Pixel *out) {
+  const unsigned short *lr = op->lut[0], *lg = op->lut[1], *lb = op->lut[2];
+  if (op->shuffle[0] == 0 && op->shuffle[1] == 1 && op->shuffle[2] == 2) {
+    // No channel movement, straight table lookups
+    for (size_t i = 0; i < TILE_PIXELS; i++) {
+      out[i].r = (unsigned char)lr[in[i].r];
+      out[i].g = (unsigned char)lg[in[i].g];
+      out[i].b = (unsigned char)lb[in[i].b];
+    }
+    return;
+  }
+  for (size_t i = 0; i < TILE_PIXELS; i++) {
+    out[i] = map_pixel(op, in[i]);
+  }
+}
+
+/**
+ * Function: map_band
+ * ------------------
+ * Map a range of the distinct tiles of an image. A tile only this image points at
+ * is changed in place, otherwise the image gets its own mapped copy; a data tile at
+ * a single place that comes out uniform is collapsed to its color.
+ *
+ * Parameters:
+ *  void *ctx: the TileMapJob
+ *  int band: index of the range (unused)
+ *  int g0: first group of the range
+ *  int g1: one past the last group of the range
+ * Returns:
+ *  void
+ */
+static void map_band(void *ctx, int band, int g0, int g1) {
+  TileMapJob *job = ctx;
+  TiledImage *im = job->im;
+  (void)band;
+
+  for (int g = g0; g < g1; g++) {
+    int first = job->groups[g], count = job->groups[g+1] - first;
+    Tile *t = im->tiles[job->order[first].place];
+    Tile *out = t;
+    if (t->refs != count) {
+      // Shared with other images: leave theirs alone
+      if (!(out = make_tile(t->uniform, t->color))) {
+        job->failed = 1;
+        continue;
+      }
+      out->refs = count;
+      t->refs -= count;
+      for (int i = first; i < first + count; i++) {
+        im->tiles[job->order[i].place] = out;
+      }
+    }
+    if (t->uniform) {
+      out->color = map_pixel(job->op, t->color);
+      continue;
+    }
+    map_pixels(job->op, t->data, out->data);
+
+    // The place tells the part of the tile inside the image
+    int place = job->order[first].place;
+    int tr = place / im->tcols, tc = place % im->tcols;
+    int h = im->rows - tr * TILE_SIZE < TILE_SIZE ? im->rows - tr * TILE_SIZE : TILE_SIZE;
+    int w = im->cols - tc * TILE_SIZE < TILE_SIZE ? im->cols - tc * TILE_SIZE : TILE_SIZE;
+    if (count == 1 && uniform_color(out->data, TILE_SIZE, w, h, &out->color)) {
+      free(out->data);
+      out->data = NULL;
+      out->uniform = 1;
+    }
+  }
+}
+
+/**
+ * Function: compare_places
+ * ------------------------
+ * qsort comparison of two TilePlaces by the address of their tile, then by place
+ *
+ * Parameters:
+ *  const void *a: one TilePlace
+ *  const void *b: the other TilePlace
+ * Returns:
+ *  <0, 0 or >0 as a comes before, is or comes after b
+ */
+static int compare_places(const void *a, const void *b) {
+  const TilePlace *pa = a, *pb = b;
+  return pa->tile < pb->tile ? -1 : (pa->tile > pb->tile ? 1 : pa->place - pb->place);
+}
+
+/**
+ * Function: tiled_point_op
+ * ------------------------
+ * Apply a chain of point operations (built for the maxval of the image) to a tiled
+ * image. Each distinct tile is mapped once: a uniform tile by mapping its color, the
+ * others pixel by pixel on several threads. Tiles that other images share are copied
+ * rather than changed, and tiles the chain leaves uniform are collapsed to their
+ * color.
+ *
+ * Parameters:
+ *  TiledImage *im: the image
+ *  const PointOp *op: the chain
+ * Returns:
+ *  -1: bad image pointer, maxval mismatch or allocation failure
+ *  0: success
+ */
+int tiled_point_op(TiledImage *im, const PointOp *op) {
+  // Error check
+  if (!im || !op || op->maxval != im->maxval) {
+    fprintf(stderr, "Error:tiled - tiled_point_op given a bad image pointer or a chain for another maxval\n");
+    return -1;
+  }
+
+  // Group the places by tile
+  int n = im->trows * im->tcols;
+  TilePlace *order = malloc(sizeof(TilePlace) * n);
+  int *groups = malloc(sizeof(int) * (n + 1));
+  if (!order || !groups) {
+    fprintf(stderr, "Error:tiled - tiled_point_op failed to allocate memory\n");
+    free(order);
+    free(groups);
+    return -1;
+  }
+  for (int i = 0; i < n; i++) {
+    order[i].tile = (uintptr_t)im->tiles[i];
+    order[i].place = i;
+  }
+  qsort(order, n, sizeof(TilePlace), compare_places);
+  int ngroups = 0;
+  for (int i = 0; i < n; i++) {
+    if (i == 0 || order[i].tile != order[i-1].tile) {
+      groups[ngroups++] = i;
+    }
+  }
+  groups[ngroups] = n;
+
+  TileMapJob job = { im, op, order, groups, 0 };
+  parallel_for_range(ngroups, TILED_MIN_GROUPS, map_band, &job);
+  free(order);
+  free(groups);
+  if (job.failed) {
+    fprintf(stderr, "Error:tiled - tiled_point_op failed to allocate memory\n");
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Function: free_tiled_image
+ * --------------------------
+ * utility function to release the tiles of an image, free it and set the pointer to
+ * null
+ *
+ * Parameters:
+ *  TiledImage **im: pointer to the image to be freed
+ * Returns:
+ *  void
+ */
+void free_tiled_image(TiledImage **im) {
+  TiledImage *rmv = *im;
+  if (!rmv) {
+    return;
+  }
+  size_t n = (size_t)rmv->trows * rmv->tcols;
+  for (size_t i = 0; i < n; i++) {
+    release_tile(rmv->tiles[i]);
+  }
+  free(rmv->tiles);
+  free(rmv);
+  *im = NULL;
+}
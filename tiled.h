@@ -0,0 +1,178 @@
+/**
+ * @file tiled.h
+ * @author Benjamin Chang (bchang26, 4414D5)/Timothy Lin (tlin56, 70941C)
+ * @brief Header file for tiled, copy-on-write 8 bit images
+ *
+ * A TiledImage keeps its pixels in square tiles of TILE_SIZE pixels. Tiles are
+ * reference counted: copying an image only shares its tiles, and a shared tile is
+ * copied the first time one of its images writes to it. A tile whose pixels all have
+ * one color is stored as that color alone, and neighboring tiles of the same color
+ * share one tile, so constant areas (synthetic images, scanned pages) take next to
+ * no memory and point operations map them in one lookup per tile.
+ *
+ * Tiles are not locked: an image and its copies must be used from one thread at a
+ * time.
+ */
+
+// If not defined, define TILED_H
+#ifndef TILED_H
+#define TILED_H
+
+// Include header files
+#include <stdio.h>
+#include "ppm_io.h"
+#include "point_ops.h"
+
+// Side of a tile in pixels
+#define TILE_SIZE 64
+
+// A tile of pixels shared by the images (and places) that point at it
+typedef struct _tile {
+  int refs;      // pointers at the tile from all images
+  int uniform;   // nonzero if every pixel is color; data is then NULL
+  Pixel color;
+  Pixel *data;   // TILE_SIZE x TILE_SIZE pixels, rows TILE_SIZE pixels apart; the
+                 // part past the image edge is unused
+} Tile;
+
+// An 8 bit image kept as tiles
+typedef struct _tiled_image {
+  Tile **tiles;  // trows x tcols, row major
+  int rows;
+  int cols;
+  int maxval;    // 1 to 255
+  int trows;
+  int tcols;
+} TiledImage;
+
+/**
+ * Function: make_tiled_image
+ * --------------------------
+ * Make an image of one color; all of its places share a single uniform tile
+ *
+ * Parameters:
+ *  int rows: number of rows
+ *  int cols: number of columns
+ *  int maxval: the maximum sample value (1 to 255)
+ *  Pixel color: the color
+ * Returns:
+ *  TiledImage *: the image, NULL on bad dimensions or allocation failure
+ */
+TiledImage *make_tiled_image(int rows, int cols, int maxval, Pixel color);
+
+/**
+ * Function: tile_image
+ * --------------------
+ * Copy an 8 bit image into tiles
+ *
+ * Parameters:
+ *  const Image *im: the image
+ * Returns:
+ *  TiledImage *: the tiled copy, NULL on a bad (or 16 bit) image or allocation failure
+ */
+TiledImage *tile_image(const Image *im);
+
+/**
+ * Function: untile_image
+ * ----------------------
+ * Copy a tiled image into a flat one
+ *
+ * Parameters:
+ *  const TiledImage *im: the tiled image
+ * Returns:
+ *  Image *: the flat copy, NULL on allocation failure
+ */
+Image *untile_image(const TiledImage *im);
+
+/**
+ * Function: read_ppm_tiled
+ * ------------------------
+ * Read the payload of an 8 bit P6 file whose header has already been consumed by
+ * read_ppm_header straight into tiles, one strip of TILE_SIZE rows at a time, so the
+ * flat image is never held in memory
+ *
+ * Parameters:
+ *  FILE *fp: file pointer positioned at the start of the payload
+ *  int cols: number of columns
+ *  int rows: number of rows
+ *  int maxval: the maximum sample value from the header (1 to 255)
+ * Returns:
+ *  TiledImage *: the image, NULL on a bad maxval, a short file or allocation failure
+ */
+TiledImage *read_ppm_tiled(FILE *fp, int cols, int rows, int maxval);
+
+/**
+ * Function: write_ppm_tiled
+ * -------------------------
+ * Writes a tiled image to the file specified by fp as a P6 PPM.
+ *
+ * Parameters:
+ *  FILE *fp: the file to write to
+ *  const TiledImage *im: the image to write
+ * Returns:
+ *  -1: faliure occurs
+ *  0: success
+ */
+int write_ppm_tiled(FILE *fp, const TiledImage *im);
+
+/**
+ * Function: copy_tiled_image
+ * --------------------------
+ * Copy an image by sharing its tiles; nothing is copied until one of them is written
+ *
+ * Parameters:
+ *  const TiledImage *im: the image
+ * Returns:
+ *  TiledImage *: the copy, NULL on allocation failure
+ */
+TiledImage *copy_tiled_image(const TiledImage *im);
+
+/**
+ * Function: tile_for_write
+ * ------------------------
+ * The pixels of one tile, ready to be written: a shared tile is copied first and a
+ * uniform one is expanded
+ *
+ * Parameters:
+ *  TiledImage *im: the image
+ *  int tr: row of the tile
+ *  int tc: column of the tile
+ * Returns:
+ *  Pixel *: the TILE_SIZE x TILE_SIZE pixels, NULL on bad indices or allocation
+ *           failure
+ */
+Pixel *tile_for_write(TiledImage *im, int tr, int tc);
+
+/**
+ * Function: tiled_point_op
+ * ------------------------
+ * Apply a chain of point operations (built for the maxval of the image) to a tiled
+ * image. Each distinct tile is mapped once: a uniform tile by mapping its color, the
+ * others pixel by pixel on several threads. Tiles that other images share are copied
+ * rather than changed, and tiles the chain leaves uniform are collapsed to their
+ * color.
+ *
+ * Parameters:
+ *  TiledImage *im: the image
+ *  const PointOp *op: the chain
+ * Returns:
+ *  -1: bad image pointer, maxval mismatch or allocation failure
+ *  0: success
+ */
+int tiled_point_op(TiledImage *im, const PointOp *op);
+
+/**
+ * Function: free_tiled_image
+ * --------------------------
+ * utility function to release the tiles of an image, free it and set the pointer to
+ * null
+ *
+ * Parameters:
+ *  TiledImage **im: pointer to the image to be freed
+ * Returns:
+ *  void
+ */
+void free_tiled_image(TiledImage **im);
+
+// End of header file
+#endif